@@ -1,6 +1,6 @@
 MODULE_NAME := benchmark-runner
 MODULE_CPPFLAGS := -I.
-MODULE_LIBRARIES := allocator
+MODULE_LIBRARIES := allocator itch protocol util
 
 $(use-fmt)
 $(use-google-benchmark)
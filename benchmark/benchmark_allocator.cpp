@@ -1,12 +1,17 @@
+#include "allocator/concurrent_memory_pool.hpp"
 #include "allocator/memory_pool.hpp"
+#include "allocator/memory_resource.hpp"
 #include "allocator/mp_allocator.hpp"
 #include <benchmark/benchmark.h>
 #include <algorithm> // std::uniform_int_distribution
+#include <atomic>
 #include <cstddef>   // std::size_t
 #include <cstdint>
 #include <functional> // std::equal_to
 #include <limits>
 #include <list>
+#include <memory_resource>
+#include <mutex>
 #include <random>
 #include <unordered_map>
 #include <utility>
@@ -105,3 +110,168 @@ std_unordered_map(benchmark::State& state)
         map.emplace(dist(rng), object(dist(rng), dist(rng), dist(rng)));
 }
 BENCHMARK(std_unordered_map);
+
+static void
+pmr_list(benchmark::State& state)
+{
+    std::random_device dev;
+    std::mt19937 rng(dev());
+    std::uniform_int_distribution<std::mt19937::result_type> dist(
+            0, std::numeric_limits<int>::max());
+
+    constexpr std::size_t node_size = 16 + sizeof(object);
+    memory_pool pool(node_size, NumPoolElements);
+    pool_resource<> resource(pool);
+    std::pmr::list<object> list(&resource);
+    for (auto _ : state) // NOLINT
+        list.emplace_back(dist(rng), dist(rng), dist(rng));
+}
+BENCHMARK(pmr_list);
+
+static void
+arena_list(benchmark::State& state)
+{
+    std::random_device dev;
+    std::mt19937 rng(dev());
+    std::uniform_int_distribution<std::mt19937::result_type> dist(
+            0, std::numeric_limits<int>::max());
+
+    monotonic_arena_resource<> resource(1 << 20);
+    std::pmr::list<object> list(&resource);
+    for (auto _ : state) // NOLINT
+        list.emplace_back(dist(rng), dist(rng), dist(rng));
+}
+BENCHMARK(arena_list);
+
+static void
+pmr_unordered_map(benchmark::State& state)
+{
+    std::random_device dev;
+    std::mt19937 rng(dev());
+    std::uniform_int_distribution<std::mt19937::result_type> dist(
+            0, std::numeric_limits<int>::max());
+
+    constexpr std::size_t node_size = 16 + sizeof(std::pair<const int, object>);
+    memory_pool pool(node_size, NumPoolElements);
+    pool_resource<> resource(pool);
+    std::pmr::unordered_map<int, object> map(&resource);
+    for (auto _ : state) // NOLINT
+        map.emplace(dist(rng), object(dist(rng), dist(rng), dist(rng)));
+}
+BENCHMARK(pmr_unordered_map);
+
+static void
+arena_unordered_map(benchmark::State& state)
+{
+    std::random_device dev;
+    std::mt19937 rng(dev());
+    std::uniform_int_distribution<std::mt19937::result_type> dist(
+            0, std::numeric_limits<int>::max());
+
+    monotonic_arena_resource<> resource(1 << 20);
+    std::pmr::unordered_map<int, object> map(&resource);
+    for (auto _ : state) // NOLINT
+        map.emplace(dist(rng), object(dist(rng), dist(rng), dist(rng)));
+}
+BENCHMARK(arena_unordered_map);
+
+
+namespace { // unnamed
+
+    constexpr std::size_t PoolNodeSize = 64;
+    constexpr std::size_t MaxThreads = 16;
+
+    /// memory_pool shared the only way it can be, one thread at a time
+    class locked_memory_pool
+    {
+    private:
+        std::mutex mutex_;
+        memory_pool pool_;
+
+    public:
+        locked_memory_pool(std::size_t node_size, std::size_t count) noexcept
+                : pool_(node_size, count)
+        {
+            // empty
+        }
+
+        void*
+        allocate_node() noexcept
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return pool_.allocate_node();
+        }
+
+        void
+        deallocate_node(void* ptr) noexcept
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pool_.deallocate_node(ptr);
+        }
+    };
+
+    /// where a thread leaves a node for the next one to free
+    struct alignas(64) mailbox
+    {
+        std::atomic<void*> ptr = nullptr;
+    };
+
+    mailbox mailboxes[MaxThreads];
+
+} // namespace
+
+/// every thread allocates a node and frees the one the previous thread
+/// left it, so most frees are cross-thread
+template <typename Pool>
+static void
+pool_handoff(benchmark::State& state)
+{
+    static Pool* pool = nullptr;
+    if (state.thread_index() == 0)
+        pool = new Pool(PoolNodeSize, 64 * 1024);
+
+    mailbox& mine = mailboxes[(state.thread_index() + 1) % state.threads()];
+    for (auto _ : state) { // NOLINT
+        void* ptr = pool->allocate_node();
+        benchmark::DoNotOptimize(ptr);
+        void* theirs = mine.ptr.exchange(ptr, std::memory_order_acq_rel);
+        if (theirs != nullptr)
+            pool->deallocate_node(theirs);
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0) {
+        for (mailbox& m : mailboxes)
+            m.ptr.store(nullptr, std::memory_order_relaxed);
+        delete pool;
+    }
+}
+BENCHMARK_TEMPLATE(pool_handoff, locked_memory_pool)->ThreadRange(1, MaxThreads)->UseRealTime();
+BENCHMARK_TEMPLATE(pool_handoff, concurrent_memory_pool)->ThreadRange(1, MaxThreads)->UseRealTime();
+
+/// every thread allocates a burst of nodes and frees them again
+template <typename Pool>
+static void
+pool_burst(benchmark::State& state)
+{
+    constexpr std::size_t Burst = 32;
+    static Pool* pool = nullptr;
+    if (state.thread_index() == 0)
+        pool = new Pool(PoolNodeSize, 64 * 1024);
+
+    void* nodes[Burst];
+    for (auto _ : state) { // NOLINT
+        for (void*& ptr : nodes)
+            ptr = pool->allocate_node();
+        benchmark::DoNotOptimize(nodes);
+        for (void* ptr : nodes)
+            pool->deallocate_node(ptr);
+    }
+    state.SetItemsProcessed(state.iterations() * Burst);
+
+    if (state.thread_index() == 0)
+        delete pool;
+}
+BENCHMARK_TEMPLATE(pool_burst, memory_pool);
+BENCHMARK_TEMPLATE(pool_burst, locked_memory_pool)->ThreadRange(1, MaxThreads)->UseRealTime();
+BENCHMARK_TEMPLATE(pool_burst, concurrent_memory_pool)->ThreadRange(1, MaxThreads)->UseRealTime();
@@ -0,0 +1,161 @@
+#include "protocol/itch/itch.cppgen.hpp"
+#include <benchmark/benchmark.h>
+#include <endian.h>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cstdlib> // std::abort
+#include <cstring> // std::memcpy
+#include <random>
+#include <utility> // std::pair
+#include <vector>
+
+
+namespace { // unnamed
+
+    using namespace itch;
+
+    constexpr std::size_t NumMsgs = 4'000'000;
+
+    /// sums a field of every msg so the handler calls can't be dropped
+    struct counting_handler
+    {
+        std::uint64_t sum = 0;
+
+        template <typename T>
+        void
+        count(T const* m) noexcept
+        {
+            sum += m->stock_locate + m->msg_type;
+        }
+
+        // clang-format off
+        void handle_system_event(system_event const* m) noexcept { count(m); }
+        void handle_stock_directory(stock_directory const* m) noexcept { count(m); }
+        void handle_stock_trading_action(stock_trading_action const* m) noexcept { count(m); }
+        void handle_reg_sho_restriction(reg_sho_restriction const* m) noexcept { count(m); }
+        void handle_market_participant_position(market_participant_position const* m) noexcept { count(m); }
+        void handle_mwcb_decline_level(mwcb_decline_level const* m) noexcept { count(m); }
+        void handle_mwcb_status(mwcb_status const* m) noexcept { count(m); }
+        void handle_ipo_quoting_period_update(ipo_quoting_period_update const* m) noexcept { count(m); }
+        void handle_luld_auction_collar(luld_auction_collar const* m) noexcept { count(m); }
+        void handle_operational_halt(operational_halt const* m) noexcept { count(m); }
+        void handle_add_order(add_order const* m) noexcept { count(m); }
+        void handle_add_order_with_mpid(add_order_with_mpid const* m) noexcept { count(m); }
+        void handle_order_executed(order_executed const* m) noexcept { count(m); }
+        void handle_order_executed_with_price(order_executed_with_price const* m) noexcept { count(m); }
+        void handle_order_cancel(order_cancel const* m) noexcept { count(m); }
+        void handle_order_delete(order_delete const* m) noexcept { count(m); }
+        void handle_order_replace(order_replace const* m) noexcept { count(m); }
+        void handle_trade_non_cross(trade_non_cross const* m) noexcept { count(m); }
+        void handle_trade_cross(trade_cross const* m) noexcept { count(m); }
+        void handle_broken_trade(broken_trade const* m) noexcept { count(m); }
+        void handle_noii(noii const* m) noexcept { count(m); }
+        void handle_unknown(header const*) noexcept { std::abort(); }
+        // clang-format on
+    };
+
+    /// the hand-ordered switch parser::process_msg() used before the
+    /// generated dispatch table
+    template <typename Handler>
+    void
+    switch_dispatch(Handler& h, header const* hdr) noexcept
+    {
+        // clang-format off
+        switch (hdr->msg_type) {
+            case 'A': h.handle_add_order(reinterpret_cast<add_order const*>(hdr)); break;
+            case 'D': h.handle_order_delete(reinterpret_cast<order_delete const*>(hdr)); break;
+            case 'U': h.handle_order_replace(reinterpret_cast<order_replace const*>(hdr)); break;
+            case 'E': h.handle_order_executed(reinterpret_cast<order_executed const*>(hdr)); break;
+            case 'X': h.handle_order_cancel(reinterpret_cast<order_cancel const*>(hdr)); break;
+            case 'I': h.handle_noii(reinterpret_cast<noii const*>(hdr)); break;
+            case 'F': h.handle_add_order_with_mpid(reinterpret_cast<add_order_with_mpid const*>(hdr)); break;
+            case 'P': h.handle_trade_non_cross(reinterpret_cast<trade_non_cross const*>(hdr)); break;
+            case 'L': h.handle_market_participant_position(reinterpret_cast<market_participant_position const*>(hdr)); break;
+            case 'C': h.handle_order_executed_with_price(reinterpret_cast<order_executed_with_price const*>(hdr)); break;
+            case 'Q': h.handle_trade_cross(reinterpret_cast<trade_cross const*>(hdr)); break;
+            case 'Y': h.handle_reg_sho_restriction(reinterpret_cast<reg_sho_restriction const*>(hdr)); break;
+            case 'H': h.handle_stock_trading_action(reinterpret_cast<stock_trading_action const*>(hdr)); break;
+            case 'R': h.handle_stock_directory(reinterpret_cast<stock_directory const*>(hdr)); break;
+            case 'S': h.handle_system_event(reinterpret_cast<system_event const*>(hdr)); break;
+            case 'J': h.handle_luld_auction_collar(reinterpret_cast<luld_auction_collar const*>(hdr)); break;
+            case 'K': h.handle_ipo_quoting_period_update(reinterpret_cast<ipo_quoting_period_update const*>(hdr)); break;
+            case 'V': h.handle_mwcb_decline_level(reinterpret_cast<mwcb_decline_level const*>(hdr)); break;
+            case 'W': h.handle_mwcb_status(reinterpret_cast<mwcb_status const*>(hdr)); break;
+            case 'h': h.handle_operational_halt(reinterpret_cast<operational_halt const*>(hdr)); break;
+            case 'B': h.handle_broken_trade(reinterpret_cast<broken_trade const*>(hdr)); break;
+            default: h.handle_unknown(hdr); break;
+        }
+        // clang-format on
+    }
+
+    /// Msgs with roughly the type mix of a full trading day: mostly adds,
+    /// deletes and replaces, interleaved at random.
+    std::vector<std::uint8_t> const&
+    get_msgs()
+    {
+        static std::vector<std::uint8_t> const msgs = [] {
+            // clang-format off
+            std::vector<std::pair<char, double>> const mix = {
+                {'A', 44.0}, {'D', 42.0}, {'U', 5.0}, {'E', 3.0}, {'X', 1.5}, {'I', 1.5},
+                {'F', 0.8}, {'P', 0.6}, {'L', 0.1}, {'C', 0.1}, {'Q', 0.05}, {'Y', 0.05},
+                {'H', 0.05}, {'R', 0.05}, {'S', 0.01}, {'J', 0.01}, {'K', 0.01}, {'B', 0.01},
+            };
+            // clang-format on
+
+            std::vector<double> weights;
+            for (auto const& [type, weight] : mix)
+                weights.push_back(weight);
+
+            std::mt19937 rng(42);
+            std::discrete_distribution<std::size_t> type_dist(weights.begin(), weights.end());
+            std::uniform_int_distribution<std::uint16_t> locate_dist(1, 8000);
+
+            std::vector<std::uint8_t> v;
+            v.reserve(NumMsgs * 40);
+            for (std::size_t i = 0; i < NumMsgs; ++i) {
+                char const type = mix[type_dist(rng)].first;
+                std::uint16_t const msg_len = msg_types[static_cast<std::uint8_t>(type)].length;
+
+                header hdr = {};
+                hdr.length = htobe16(msg_len - sizeof(hdr.length));
+                hdr.msg_type = type;
+                hdr.stock_locate = locate_dist(rng);
+
+                std::size_t const pos = v.size();
+                v.resize(pos + msg_len);
+                std::memcpy(v.data() + pos, &hdr, sizeof(hdr));
+            }
+            return v;
+        }();
+        return msgs;
+    }
+
+} // namespace
+
+
+template <bool UseTable>
+static void
+msg_dispatch(benchmark::State& state)
+{
+    auto const& msgs = get_msgs();
+    counting_handler h;
+
+    for (auto _ : state) { // NOLINT
+        std::uint8_t const* buf = msgs.data();
+        std::uint8_t const* end = buf + msgs.size();
+        while (buf < end) {
+            auto hdr = reinterpret_cast<header const*>(buf);
+            std::size_t const msg_len = be16toh(hdr->length) + sizeof(hdr->length);
+            if constexpr (UseTable)
+                dispatch(h, hdr, msg_len);
+            else
+                switch_dispatch(h, hdr);
+            buf += msg_len;
+        }
+        benchmark::DoNotOptimize(h.sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * NumMsgs);
+}
+BENCHMARK_TEMPLATE(msg_dispatch, false)->Name("msg_dispatch/switch");
+BENCHMARK_TEMPLATE(msg_dispatch, true)->Name("msg_dispatch/table");
@@ -0,0 +1,605 @@
+#include "allocator/lowlevel_allocator.hpp"
+#include "itch/basic_book.hpp"
+#include "itch/bitmap_book.hpp"
+#include "itch/book.hpp"
+#include "itch/btree_book.hpp"
+#include "itch/compact_book.hpp"
+#include "itch/core.hpp"
+#include "itch/hashed_book.hpp"
+#include "itch/l3_book.hpp"
+#include "itch/ladder_book.hpp"
+#include "itch/map_book.hpp"
+#include "itch/mp_book.hpp"
+#include "itch/order_store.hpp"
+#include "itch/price_map.hpp"
+#include "itch/vector_book.hpp"
+#include <benchmark/benchmark.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm> // std::shuffle
+#include <cstddef>   // std::size_t
+#include <cstdint>
+#include <memory>  // std::make_unique
+#include <numeric> // std::iota
+#include <random>
+#include <unordered_map>
+#include <utility> // std::swap
+#include <vector>
+
+
+namespace { // unnamed
+
+    /// distinct order reference numbers in the replayed stream
+    constexpr std::size_t NumOrders = 2'000'000;
+
+    /// orders stay live until this many later orders have been added
+    constexpr std::size_t NumLiveOrders = 100'000;
+
+    /// number of books the orders are spread over
+    constexpr std::size_t NumBooks = 64;
+
+    struct op
+    {
+        enum : std::uint8_t
+        {
+            Add,
+            Cancel,
+            Delete
+        } type = Add;
+        itch::Side side = itch::Side::Bid;
+        std::uint16_t book = 0;
+        itch::price_t price = 0;
+        itch::qty_t qty = 0;
+        itch::oid_t oid = 0;
+    };
+
+    /// Synthetic add/cancel/delete stream. Order reference numbers are
+    /// shuffled so that, as in a real feed, the order touched by a
+    /// cancel or delete is rarely near the one touched before it.
+    std::vector<op> const&
+    get_ops()
+    {
+        static std::vector<op> const ops = [] {
+            std::mt19937 rng(42);
+            std::uniform_int_distribution<std::uint32_t> qty_dist(1, 50);
+            std::geometric_distribution<std::uint32_t> offset_dist(0.3);
+            std::uniform_int_distribution<std::uint16_t> book_dist(0, NumBooks - 1);
+
+            std::vector<itch::oid_t> refs(NumOrders);
+            std::iota(refs.begin(), refs.end(), 0);
+            std::shuffle(refs.begin(), refs.end(), rng);
+
+            std::vector<op> adds(NumOrders);
+            std::vector<op> v;
+            v.reserve(NumOrders * 3);
+            for (std::size_t i = 0; i < NumOrders + NumLiveOrders; ++i) {
+                if (i < NumOrders) {
+                    op& a = adds[i];
+                    a.side = (rng() & 1) ? itch::Side::Ask : itch::Side::Bid;
+                    a.book = book_dist(rng);
+                    std::uint32_t const offset = (offset_dist(rng) + 1) * 100;
+                    a.price = (a.side == itch::Side::Bid) ? 1'000'000 - offset : 1'000'000 + offset;
+                    a.qty = qty_dist(rng) * 100;
+                    a.oid = refs[i];
+                    v.push_back(a);
+                }
+
+                if (i >= NumLiveOrders) {
+                    op d = adds[i - NumLiveOrders];
+                    if (d.oid % 4 == 0) {
+                        d.type = op::Cancel;
+                        d.qty /= 2;
+                        v.push_back(d);
+                    }
+                    d.type = op::Delete;
+                    v.push_back(d);
+                }
+            }
+            return v;
+        }();
+        return ops;
+    }
+
+    /// levels per side of the deep book, about as deep as the busiest
+    /// names (AAPL, AMZN, QQQ) in regtest.csv get
+    constexpr std::uint32_t NumDeepLevels = 3000;
+
+    /// orders live at once in the deep book
+    constexpr std::size_t NumDeepLiveOrders = 20'000;
+
+    /// Add/delete stream for a single deep, wide book: prices are spread
+    /// evenly over NumDeepLevels ticks on either side, so most lookups
+    /// land far from the inside.
+    std::vector<op> const&
+    get_deep_ops()
+    {
+        static std::vector<op> const ops = [] {
+            std::mt19937 rng(42);
+            std::uniform_int_distribution<std::uint32_t> qty_dist(1, 50);
+            std::uniform_int_distribution<std::uint32_t> offset_dist(1, NumDeepLevels);
+
+            std::vector<op> adds(NumOrders);
+            std::vector<op> v;
+            v.reserve(NumOrders * 2);
+            for (std::size_t i = 0; i < NumOrders + NumDeepLiveOrders; ++i) {
+                if (i < NumOrders) {
+                    op& a = adds[i];
+                    a.side = (rng() & 1) ? itch::Side::Ask : itch::Side::Bid;
+                    std::uint32_t const offset = offset_dist(rng) * 100;
+                    a.price = (a.side == itch::Side::Bid) ? 1'000'000 - offset : 1'000'000 + offset;
+                    a.qty = qty_dist(rng) * 100;
+                    a.oid = i;
+                    v.push_back(a);
+                }
+
+                if (i >= NumDeepLiveOrders) {
+                    op d = adds[i - NumDeepLiveOrders];
+                    d.type = op::Delete;
+                    v.push_back(d);
+                }
+            }
+            return v;
+        }();
+        return ops;
+    }
+
+} // namespace
+
+
+namespace { // unnamed
+
+    using malloc_pages = lowlevel_allocator<malloc_allocator>;
+    using huge_pages = lowlevel_allocator<mmap_hugepage_allocator>;
+
+    /// Counts the dTLB load misses of the calling thread in user space,
+    /// with perf_event_open(). valid() is false where the kernel doesn't
+    /// allow it (perf_event_paranoid > 2) or there is no PMU (most VMs).
+    class dtlb_counter
+    {
+    private:
+        int fd_ = -1;
+
+    public:
+        dtlb_counter() noexcept
+        {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd_ = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+
+        ~dtlb_counter() noexcept
+        {
+            if (fd_ >= 0)
+                ::close(fd_);
+        }
+
+        dtlb_counter(dtlb_counter const&) noexcept = delete;
+        dtlb_counter& operator=(dtlb_counter const&) noexcept = delete;
+
+        bool
+        valid() const noexcept
+        {
+            return fd_ >= 0;
+        }
+
+        void
+        start() noexcept
+        {
+            ::ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+
+        void
+        stop() noexcept
+        {
+            ::ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        }
+
+        std::uint64_t
+        count() const noexcept
+        {
+            std::uint64_t n = 0;
+            if (::read(fd_, &n, sizeof(n)) != sizeof(n))
+                return 0;
+            return n;
+        }
+    };
+
+} // namespace
+
+
+template <typename Book, typename LLAllocator = malloc_pages>
+static void
+book_replay(benchmark::State& state)
+{
+    using namespace itch;
+    using Order = book_order_t<Book>;
+
+    auto const& ops = get_ops();
+    std::size_t store_bytes = 0;
+    dtlb_counter dtlb;
+    std::uint64_t misses = 0;
+
+    for (auto _ : state) { // NOLINT
+        state.PauseTiming();
+        auto store = std::make_unique<order_store<Order, 16, LLAllocator>>(NumOrders);
+        auto books = std::make_unique<std::vector<Book>>(NumBooks);
+        if (dtlb.valid())
+            dtlb.start();
+        state.ResumeTiming();
+
+        for (op const& next : ops) {
+            Book& book = (*books)[next.book];
+            switch (next.type) {
+                case op::Add: {
+                    Order& o = store->insert(next.oid);
+                    o = Order(next.side, next.price, next.qty);
+                    book.add_order(o);
+                } break;
+
+                case op::Cancel:
+                    book.cancel_order(*store->find(next.oid), next.qty);
+                    break;
+
+                case op::Delete:
+                    book.delete_order(*store->find(next.oid));
+                    store->erase(next.oid);
+                    break;
+            }
+        }
+
+        state.PauseTiming();
+        if (dtlb.valid()) {
+            dtlb.stop();
+            misses += dtlb.count();
+        }
+        store_bytes = store->max_pages_in_use() * store->page_bytes();
+        store.reset();
+        books.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * ops.size());
+    state.counters["order_bytes"] = sizeof(Order);
+    state.counters["store_bytes"] = benchmark::Counter(static_cast<double>(store_bytes),
+            benchmark::Counter::kDefaults, benchmark::Counter::OneK::kIs1024);
+    if (dtlb.valid())
+        state.counters["dtlb_misses"] = static_cast<double>(misses)
+                / static_cast<double>(state.iterations() * ops.size());
+}
+BENCHMARK_TEMPLATE(book_replay, itch::basic_book)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::compact_book<itch::basic_book>)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::compact_book<itch::basic_book, true>)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::mp_book)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::compact_book<itch::mp_book>)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::compact_book<itch::mp_book, true>)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::mp_book, huge_pages)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::map_book)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::compact_book<itch::map_book>)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::compact_book<itch::map_book, true>)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::hashed_book)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::compact_book<itch::hashed_book>)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::compact_book<itch::hashed_book, true>)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::ladder_book)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::compact_book<itch::ladder_book>)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::compact_book<itch::ladder_book, true>)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::vector_book)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::compact_book<itch::vector_book>)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::compact_book<itch::vector_book, true>)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::bitmap_book)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::compact_book<itch::bitmap_book>)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::compact_book<itch::bitmap_book, true>)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::btree_book)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::compact_book<itch::btree_book>)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::compact_book<itch::btree_book, true>)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_replay, itch::l3_book)->Unit(benchmark::kMillisecond);
+
+/// Replays get_deep_ops() into a single book.
+template <typename Book>
+static void
+book_deep(benchmark::State& state)
+{
+    using namespace itch;
+
+    auto const& ops = get_deep_ops();
+
+    for (auto _ : state) { // NOLINT
+        state.PauseTiming();
+        auto orders = std::make_unique<std::vector<order>>(NumOrders);
+        auto book = std::make_unique<Book>();
+        state.ResumeTiming();
+
+        for (op const& next : ops) {
+            order& o = (*orders)[next.oid];
+            if (next.type == op::Add) {
+                o = order(next.side, next.price, next.qty);
+                book->add_order(o);
+            } else {
+                book->delete_order(o);
+            }
+        }
+
+        state.PauseTiming();
+        orders.reset();
+        book.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * ops.size());
+}
+BENCHMARK_TEMPLATE(book_deep, itch::map_book)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_deep, itch::hashed_book)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(book_deep, itch::btree_book)->Unit(benchmark::kMillisecond);
+
+/// Worst case for recovering the best price: a one-sided book of
+/// range(0) levels, one tick apart, is swept from the inside out one
+/// delete at a time, reading the new best bid after each.
+template <typename Book>
+static void
+book_sweep(benchmark::State& state)
+{
+    using namespace itch;
+
+    std::size_t const num_levels = static_cast<std::size_t>(state.range(0));
+    std::vector<order> orders;
+
+    for (auto _ : state) { // NOLINT
+        state.PauseTiming();
+        auto book = std::make_unique<Book>();
+        orders.clear();
+        for (std::size_t i = 0; i < num_levels; ++i)
+            orders.emplace_back(Side::Bid, 1'000'000 - (num_levels - 1 - i) * 100, 100);
+        for (order& o : orders)
+            book->add_order(o);
+        state.ResumeTiming();
+
+        for (auto itr = orders.rbegin(); itr != orders.rend(); ++itr) {
+            book->delete_order(*itr);
+            benchmark::DoNotOptimize(book->best_bid());
+        }
+
+        state.PauseTiming();
+        book.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * num_levels);
+}
+BENCHMARK_TEMPLATE(book_sweep, itch::basic_book)->Arg(1000)->Arg(5000);
+BENCHMARK_TEMPLATE(book_sweep, itch::mp_book)->Arg(1000)->Arg(5000);
+BENCHMARK_TEMPLATE(book_sweep, itch::map_book)->Arg(1000)->Arg(5000);
+BENCHMARK_TEMPLATE(book_sweep, itch::hashed_book)->Arg(1000)->Arg(5000);
+BENCHMARK_TEMPLATE(book_sweep, itch::ladder_book)->Arg(1000)->Arg(5000);
+BENCHMARK_TEMPLATE(book_sweep, itch::vector_book)->Arg(1000)->Arg(5000);
+BENCHMARK_TEMPLATE(book_sweep, itch::bitmap_book)->Arg(1000)->Arg(5000);
+BENCHMARK_TEMPLATE(book_sweep, itch::btree_book)->Arg(1000)->Arg(5000);
+
+/// book_sweep the other way around: the levels are deleted from the
+/// outside in, so every delete takes out the level furthest from the
+/// inside and best_bid() never changes until the last one.
+template <typename Book>
+static void
+book_drain(benchmark::State& state)
+{
+    using namespace itch;
+
+    std::size_t const num_levels = static_cast<std::size_t>(state.range(0));
+    std::vector<order> orders;
+
+    for (auto _ : state) { // NOLINT
+        state.PauseTiming();
+        auto book = std::make_unique<Book>();
+        orders.clear();
+        for (std::size_t i = 0; i < num_levels; ++i)
+            orders.emplace_back(Side::Bid, 1'000'000 - (num_levels - 1 - i) * 100, 100);
+        for (order& o : orders)
+            book->add_order(o);
+        state.ResumeTiming();
+
+        for (order& o : orders) {
+            book->delete_order(o);
+            benchmark::DoNotOptimize(book->best_bid());
+        }
+
+        state.PauseTiming();
+        book.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * num_levels);
+}
+BENCHMARK_TEMPLATE(book_drain, itch::basic_book)->Arg(1000)->Arg(5000);
+BENCHMARK_TEMPLATE(book_drain, itch::mp_book)->Arg(1000)->Arg(5000);
+BENCHMARK_TEMPLATE(book_drain, itch::map_book)->Arg(1000)->Arg(5000);
+
+/// depth() of the best 10 levels a side out of 100, into the same
+/// buffers every time
+template <typename Book>
+static void
+book_depth(benchmark::State& state)
+{
+    using namespace itch;
+
+    constexpr std::size_t NumLevels = 100;
+    constexpr std::size_t Depth = 10;
+    auto book = std::make_unique<Book>();
+    std::vector<book_order_t<Book>> orders;
+    orders.reserve(2 * NumLevels);
+    for (std::size_t i = 0; i < NumLevels; ++i) {
+        orders.emplace_back(Side::Bid, 1'000'000 - i * 100, 100);
+        orders.emplace_back(Side::Ask, 1'000'100 + i * 100, 100);
+    }
+    for (auto& o : orders)
+        book->add_order(o);
+
+    pq bids[Depth];
+    pq asks[Depth];
+    for (auto _ : state) { // NOLINT
+        book->depth(Depth, bids, asks);
+        benchmark::DoNotOptimize(bids);
+        benchmark::DoNotOptimize(asks);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(book_depth, itch::basic_book);
+BENCHMARK_TEMPLATE(book_depth, itch::mp_book);
+BENCHMARK_TEMPLATE(book_depth, itch::map_book);
+BENCHMARK_TEMPLATE(book_depth, itch::hashed_book);
+BENCHMARK_TEMPLATE(book_depth, itch::ladder_book);
+BENCHMARK_TEMPLATE(book_depth, itch::vector_book);
+BENCHMARK_TEMPLATE(book_depth, itch::bitmap_book);
+BENCHMARK_TEMPLATE(book_depth, itch::btree_book);
+BENCHMARK_TEMPLATE(book_depth, itch::l3_book);
+
+namespace { // unnamed
+
+    // hashed_book's price index, before and after price_map
+    using std_price_index = std::unordered_map<itch::price_t, void*>;
+    using flat_price_index = itch::price_map<void*>;
+
+    void*
+    index_find(std_price_index& m, itch::price_t p)
+    {
+        auto itr = m.find(p);
+        return (itr == m.end()) ? nullptr : itr->second;
+    }
+
+    void*
+    index_find(flat_price_index& m, itch::price_t p)
+    {
+        void** v = m.find(p);
+        return (v == nullptr) ? nullptr : *v;
+    }
+
+    void
+    index_insert(std_price_index& m, itch::price_t p, void* v)
+    {
+        m.emplace(p, v);
+    }
+
+    void
+    index_insert(flat_price_index& m, itch::price_t p, void* v)
+    {
+        m.insert(p, v);
+    }
+
+    void
+    index_erase(std_price_index& m, itch::price_t p)
+    {
+        m.erase(p);
+    }
+
+    void
+    index_erase(flat_price_index& m, itch::price_t p)
+    {
+        m.erase(p);
+    }
+
+} // namespace
+
+/// A price index on its own: range(0) levels a tick apart, looked up in
+/// random order, with every 8th step erasing a level and adding one
+/// back elsewhere, as levels come and go around a book.
+template <typename Index>
+static void
+price_index(benchmark::State& state)
+{
+    using namespace itch;
+
+    std::uint32_t const num_levels = static_cast<std::uint32_t>(state.range(0));
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<std::uint32_t> tick_dist(0, num_levels * 2 - 1);
+    std::vector<price_t> live;
+    std::vector<price_t> gone;
+    for (std::uint32_t t = 0; t < num_levels * 2; ++t)
+        ((t % 2 == 0) ? live : gone).push_back(1'000'000 - t * 100);
+    std::shuffle(live.begin(), live.end(), rng);
+    std::shuffle(gone.begin(), gone.end(), rng);
+
+    Index index(100);
+    for (price_t p : live)
+        index_insert(index, p, &index);
+
+    std::size_t i = 0;
+    for (auto _ : state) { // NOLINT
+        std::size_t const n = i++ % num_levels;
+        benchmark::DoNotOptimize(index_find(index, live[n]));
+        if (i % 8 == 0) {
+            index_erase(index, live[n]);
+            std::swap(live[n], gone[n]);
+            index_insert(index, live[n], &index);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(price_index, std_price_index)->Arg(50)->Arg(3000);
+BENCHMARK_TEMPLATE(price_index, flat_price_index)->Arg(50)->Arg(3000);
+
+/// Random look-ups of range(0) orders committed in an order store, with
+/// its pages on 4 KB (malloc) or 2 MB (mmap_hugepage_allocator) pages.
+/// Past a few thousand 4 KB pages almost every look-up misses the dTLB,
+/// reported as dtlb_misses per look-up where perf counters are allowed.
+template <typename LLAllocator>
+static void
+order_lookup(benchmark::State& state)
+{
+    using namespace itch;
+
+    constexpr std::size_t NumLookups = 1'000'000;
+    std::size_t const num_orders = static_cast<std::size_t>(state.range(0));
+    auto store = std::make_unique<order_store<order, 16, LLAllocator>>(num_orders);
+    for (oid_t oid = 0; oid < num_orders; ++oid)
+        store->insert(oid) = order(Side::Bid, 1'000'000, oid % 100 + 1);
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<oid_t> oid_dist(0, num_orders - 1);
+    std::vector<oid_t> oids(NumLookups);
+    for (oid_t& oid : oids)
+        oid = oid_dist(rng);
+
+    dtlb_counter dtlb;
+    std::uint64_t misses = 0;
+    for (auto _ : state) { // NOLINT
+        if (dtlb.valid())
+            dtlb.start();
+        qty_t sum = 0;
+        for (oid_t oid : oids)
+            sum += store->slot(oid)->qty;
+        benchmark::DoNotOptimize(sum);
+        if (dtlb.valid()) {
+            dtlb.stop();
+            misses += dtlb.count();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * NumLookups);
+    if (dtlb.valid())
+        state.counters["dtlb_misses"] = static_cast<double>(misses)
+                / static_cast<double>(state.iterations() * NumLookups);
+}
+BENCHMARK_TEMPLATE(order_lookup, malloc_pages)->Arg(1 << 20)->Arg(1 << 25);
+BENCHMARK_TEMPLATE(order_lookup, huge_pages)->Arg(1 << 20)->Arg(1 << 25);
@@ -0,0 +1,357 @@
+#include "itch/bbo.hpp"
+#include "itch/extract.hpp"
+#include "itch/msg_columns.hpp"
+#include "itch/parser.hpp"
+#include "protocol/itch/itch.cppgen.hpp"
+#include <benchmark/benchmark.h>
+#include <endian.h>
+#include <algorithm> // std::max
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <memory>  // std::make_unique
+#include <random>
+#include <type_traits> // std::is_same_v
+#include <vector>
+
+
+namespace { // unnamed
+
+    using namespace itch;
+
+    constexpr std::size_t NumMsgs = 6'000'000;
+
+    /// orders resting in the books at any time, spread over NumLocates
+    constexpr std::size_t NumLiveOrders = 1'000'000;
+    constexpr std::uint16_t NumLocates = 8000;
+
+    template <typename T>
+    void
+    append(std::vector<std::uint8_t>& buf, T& m, char type, std::uint16_t locate)
+    {
+        m.length = htobe16(sizeof(T) - sizeof(m.length));
+        m.msg_type = type;
+        m.stock_locate = htobe16(locate);
+
+        std::size_t const pos = buf.size();
+        buf.resize(pos + sizeof(T));
+        std::memcpy(buf.data() + pos, &m, sizeof(T));
+    }
+
+    /// Add/delete/execute/cancel/replace stream over a large set of live
+    /// orders. Orders are added with increasing reference numbers, as in
+    /// a real feed, but are removed in random order, so most msgs other
+    /// than adds touch an order slot (and price level) that's not in cache.
+    std::vector<std::uint8_t> const&
+    get_msgs()
+    {
+        static std::vector<std::uint8_t> const msgs = [] {
+            struct live_order
+            {
+                oid_t oid;
+                std::uint16_t locate;
+                std::uint32_t qty;
+                std::uint32_t price;
+            };
+
+            std::mt19937 rng(42);
+            std::uniform_int_distribution<std::uint16_t> locate_dist(1, NumLocates);
+            std::uniform_int_distribution<std::uint32_t> qty_dist(1, 50);
+            std::geometric_distribution<std::uint32_t> offset_dist(0.2);
+            std::uniform_int_distribution<std::uint32_t> op_dist(0, 99);
+
+            std::vector<std::uint8_t> v;
+            v.reserve(NumMsgs * 36);
+            std::vector<live_order> live;
+            live.reserve(NumLiveOrders + 1);
+            oid_t next_oid = 1;
+
+            auto add = [&](std::uint16_t locate) {
+                bool const bid = rng() & 1;
+                std::uint32_t const offset = (offset_dist(rng) + 1) * 100;
+                live_order const o = {next_oid++, locate, qty_dist(rng) * 100,
+                        bid ? 1'000'000 - offset : 1'000'000 + offset};
+                live.push_back(o);
+
+                add_order m = {};
+                m.order_reference_number = htobe64(o.oid);
+                m.buy_sell_indicator = bid ? 'B' : 'S';
+                m.shares = htobe32(o.qty);
+                m.price = htobe32(o.price);
+                append(v, m, 'A', locate);
+            };
+
+            for (std::size_t i = 0; i < NumMsgs; ++i) {
+                if (live.size() < NumLiveOrders) {
+                    add(locate_dist(rng));
+                    continue;
+                }
+
+                std::uint32_t const op = op_dist(rng);
+                if (op < 50) {
+                    add(locate_dist(rng));
+                    continue;
+                }
+
+                std::size_t const victim = rng() % live.size();
+                live_order& o = live[victim];
+                if (op < 85) {
+                    order_delete m = {};
+                    m.order_reference_number = htobe64(o.oid);
+                    append(v, m, 'D', o.locate);
+                    o = live.back();
+                    live.pop_back();
+                } else if (op < 90) {
+                    order_executed m = {};
+                    m.order_reference_number = htobe64(o.oid);
+                    m.executed_shares = htobe32(100);
+                    m.match_number = htobe64(i);
+                    append(v, m, 'E', o.locate);
+                    if ((o.qty -= 100) == 0) {
+                        o = live.back();
+                        live.pop_back();
+                    }
+                } else if (op < 95) {
+                    order_cancel m = {};
+                    m.order_reference_number = htobe64(o.oid);
+                    m.cancelled_shares = htobe32(100);
+                    append(v, m, 'X', o.locate);
+                    if ((o.qty -= 100) == 0) {
+                        o = live.back();
+                        live.pop_back();
+                    }
+                } else {
+                    order_replace m = {};
+                    m.original_order_reference_number = htobe64(o.oid);
+                    m.new_order_reference_number = htobe64(next_oid);
+                    m.shares = htobe32(o.qty);
+                    m.price = htobe32(o.price);
+                    append(v, m, 'U', o.locate);
+                    o.oid = next_oid++;
+                }
+            }
+            return v;
+        }();
+        return msgs;
+    }
+
+    /// on_bbo() hook that only counts
+    struct bbo_counter
+    {
+        std::size_t updates = 0;
+
+        void on_bbo(bbo_update const&) noexcept { ++updates; }
+    };
+
+    template <typename Handler>
+    Handler
+    make_handler()
+    {
+        if constexpr (std::is_same_v<Handler, bbo_file_writer>)
+            return bbo_file_writer("/dev/null");
+        else
+            return Handler();
+    }
+
+} // namespace
+
+
+static void
+parse_prefetch(benchmark::State& state)
+{
+    auto const& msgs = get_msgs();
+
+    for (auto _ : state) { // NOLINT
+        state.PauseTiming();
+        auto p = std::make_unique<parser<false>>("", false);
+        p->prefetch_depth(state.range(0));
+        state.ResumeTiming();
+
+        p->parse(msgs.data(), msgs.size());
+
+        state.PauseTiming();
+        p.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * NumMsgs);
+}
+BENCHMARK(parse_prefetch)
+        ->ArgName("depth")
+        ->Arg(0)
+        ->Arg(2)
+        ->Arg(4)
+        ->Arg(8)
+        ->Arg(16)
+        ->Arg(32)
+        ->Arg(64)
+        ->Unit(benchmark::kMillisecond);
+
+/// decode stage of parse_batched() on its own
+static void
+decode_columns(benchmark::State& state)
+{
+    auto const& msgs = get_msgs();
+    auto cols = std::make_unique<msg_columns<>>();
+
+    for (auto _ : state) { // NOLINT
+        std::size_t pos = 0;
+        while (pos < msgs.size()) {
+            pos += decode(msgs.data() + pos, msgs.size() - pos, *cols);
+            benchmark::DoNotOptimize(cols->oid);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * NumMsgs);
+    state.SetBytesProcessed(state.iterations() * msgs.size());
+}
+BENCHMARK(decode_columns)->Unit(benchmark::kMillisecond);
+
+template <bool Batched>
+static void
+parse_mode(benchmark::State& state)
+{
+    auto const& msgs = get_msgs();
+
+    for (auto _ : state) { // NOLINT
+        state.PauseTiming();
+        auto p = std::make_unique<parser<false>>("", false);
+        state.ResumeTiming();
+
+        if constexpr (Batched)
+            p->parse_batched(msgs.data(), msgs.size());
+        else
+            p->parse(msgs.data(), msgs.size());
+
+        state.PauseTiming();
+        p.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * NumMsgs);
+}
+BENCHMARK_TEMPLATE(parse_mode, false)->Name("parse_mode/parse")->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(parse_mode, true)->Name("parse_mode/batched")->Unit(benchmark::kMillisecond);
+
+/// cost of the on_bbo() hook: none, a counter, and the file writer
+/// (to /dev/null)
+template <typename Handler>
+static void
+parse_bbo(benchmark::State& state)
+{
+    auto const& msgs = get_msgs();
+
+    for (auto _ : state) { // NOLINT
+        state.PauseTiming();
+        auto p = std::make_unique<parser<false, Handler>>(
+                "", false, false, make_handler<Handler>());
+        state.ResumeTiming();
+
+        p->parse(msgs.data(), msgs.size());
+
+        state.PauseTiming();
+        if constexpr (std::is_same_v<Handler, bbo_counter>)
+            state.counters["updates"] = static_cast<double>(p->handler().updates);
+        p.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * NumMsgs);
+}
+BENCHMARK_TEMPLATE(parse_bbo, default_handler)
+        ->Name("parse_bbo/none")
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(parse_bbo, bbo_counter)->Name("parse_bbo/count")->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(parse_bbo, bbo_file_writer)
+        ->Name("parse_bbo/file")
+        ->Unit(benchmark::kMillisecond);
+
+/// order store pages on 4 KB (malloc) vs 2 MB (mmap_hugepage_allocator)
+/// pages, see order_lookup in benchmark_order
+template <typename LLAllocator>
+static void
+parse_pages(benchmark::State& state)
+{
+    using parser_type =
+            parser<false, default_handler, mp_book, order_store<order, 16, LLAllocator>>;
+    auto const& msgs = get_msgs();
+
+    for (auto _ : state) { // NOLINT
+        state.PauseTiming();
+        auto p = std::make_unique<parser_type>("", false);
+        state.ResumeTiming();
+
+        p->parse(msgs.data(), msgs.size());
+
+        state.PauseTiming();
+        p.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * NumMsgs);
+}
+BENCHMARK_TEMPLATE(parse_pages, lowlevel_allocator<malloc_allocator>)
+        ->Name("parse_pages/malloc")
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(parse_pages, lowlevel_allocator<mmap_hugepage_allocator>)
+        ->Name("parse_pages/huge")
+        ->Unit(benchmark::kMillisecond);
+
+/// extracts the fields of every order msg with the extractors of a
+/// simd_level (or extract_scalar() inlined, for level -1)
+static void
+extract_fields(benchmark::State& state)
+{
+    auto const& msgs = get_msgs();
+    int const level = state.range(0);
+    if (level > static_cast<int>(detect_simd_level())) {
+        state.SkipWithError("simd level not supported");
+        return;
+    }
+    order_extractors const& x = get_extractors(static_cast<simd_level>(std::max(level, 0)));
+
+    auto extract = [&](auto const* m, auto fn, order_fields& f) {
+        if (level < 0)
+            extract_scalar(m, f);
+        else
+            (x.*fn)(m, f);
+    };
+
+    for (auto _ : state) { // NOLINT
+        order_fields f;
+        std::uint64_t sum = 0;
+        for (std::size_t pos = 0; pos < msgs.size();) {
+            auto hdr = reinterpret_cast<header const*>(msgs.data() + pos);
+            switch (hdr->msg_type) {
+                case 'A':
+                    extract(reinterpret_cast<add_order const*>(hdr), &order_extractors::add, f);
+                    break;
+                case 'E':
+                    extract(reinterpret_cast<order_executed const*>(hdr),
+                            &order_extractors::execute, f);
+                    break;
+                case 'D':
+                    extract(reinterpret_cast<order_delete const*>(hdr),
+                            &order_extractors::remove, f);
+                    break;
+                case 'U':
+                    extract(reinterpret_cast<order_replace const*>(hdr),
+                            &order_extractors::replace, f);
+                    break;
+                default: break;
+            }
+            sum += f.oid + f.qty + f.price + f.timestamp + f.locate;
+            pos += be16toh(hdr->length) + sizeof(hdr->length);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * NumMsgs);
+}
+BENCHMARK(extract_fields)
+        ->ArgName("level")
+        ->Arg(-1)
+        ->Arg(static_cast<int>(simd_level::scalar))
+        ->Arg(static_cast<int>(simd_level::sse4))
+        ->Arg(static_cast<int>(simd_level::avx2))
+        ->Unit(benchmark::kMillisecond);
@@ -16,6 +16,18 @@ type jsonData struct {
 	Constants       []constant `json:"constants"`
 	Enums           []enum     `json:"enums"`
 	Structs         []cStruct  `json:"structs"`
+	MsgHeader       string     `json:"msg_header"`
+}
+
+// MsgStructs returns the structs that are msgs, i.e. have a msg_type
+func (d jsonData) MsgStructs() []cStruct {
+	var msgs []cStruct
+	for _, s := range d.Structs {
+		if s.MsgType != "" {
+			msgs = append(msgs, s)
+		}
+	}
+	return msgs
 }
 
 type constant struct {
@@ -41,6 +53,7 @@ type enumDef struct {
 
 type cStruct struct {
 	ID      string        `json:"identifier"`
+	MsgType string        `json:"msg_type"`
 	Packed  bool          `json:"packed"`
 	Members []*memberDecl `json:"members"`
 }
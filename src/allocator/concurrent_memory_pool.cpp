@@ -0,0 +1,51 @@
+#include "concurrent_memory_pool.hpp"
+#include <bit> // std::countr_one
+#include <cstdint>
+#include <mutex>
+
+
+namespace detail {
+
+    namespace { // unnamed
+
+        static_assert(MaxThreadSlots <= 64);
+
+        std::mutex slots_mutex;
+        std::uint64_t slots_taken = 0; ///< a bit per slot
+
+        /// gives the slot of a thread back when it exits. a thread that
+        /// takes it over gets the magazines too, after the lock has made
+        /// the previous owner's writes to them visible
+        struct thread_slot_release
+        {
+            ~thread_slot_release() noexcept
+            {
+                std::size_t const slot = thread_slot;
+                thread_slot = NoThreadSlot;
+                if (slot >= MaxThreadSlots)
+                    return;
+
+                std::lock_guard<std::mutex> lock(slots_mutex);
+                slots_taken &= ~(std::uint64_t(1) << slot);
+            }
+        };
+
+    } // namespace
+
+    std::size_t
+    assign_thread_slot() noexcept
+    {
+        thread_local thread_slot_release release;
+
+        std::lock_guard<std::mutex> lock(slots_mutex);
+        auto const slot = static_cast<std::size_t>(std::countr_one(slots_taken));
+        if (slot < MaxThreadSlots) {
+            slots_taken |= std::uint64_t(1) << slot;
+            thread_slot = slot;
+        } else {
+            thread_slot = NoThreadSlot;
+        }
+        return thread_slot;
+    }
+
+} // namespace detail
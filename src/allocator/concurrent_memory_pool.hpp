@@ -0,0 +1,382 @@
+#pragma once
+
+#include "detail.hpp"
+#include "free_list.hpp" // detail::list_get_next, detail::list_set_next
+#include "growing_block_allocator.hpp"
+#include "lowlevel_allocator.hpp"
+#include "memory_arena.hpp"
+#include "memory_block.hpp"
+#include "util/assert.hpp"
+#include <algorithm> // std::max, std::min
+#include <array>
+#include <atomic>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cstdlib>   // std::free, std::malloc
+#include <exception> // std::terminate
+#include <mutex>
+#include <utility> // std::forward, std::swap
+
+
+namespace detail {
+
+    /// threads that hold a slot cache nodes in every concurrent_memory_pool
+    constexpr std::size_t MaxThreadSlots = 64;
+
+    /// the slot of threads beyond MaxThreadSlots, and of exiting threads
+    constexpr std::size_t NoThreadSlot = MaxThreadSlots;
+
+    constexpr std::size_t UnassignedThreadSlot = MaxThreadSlots + 1;
+
+    inline thread_local std::size_t thread_slot = UnassignedThreadSlot;
+
+    /// takes the lowest free slot (or NoThreadSlot) for the calling
+    /// thread, given back when it exits
+    std::size_t assign_thread_slot() noexcept;
+
+    inline std::size_t
+    this_thread_slot() noexcept
+    {
+        std::size_t const slot = thread_slot;
+        return (slot != UnassignedThreadSlot) ? slot : assign_thread_slot();
+    }
+
+    /// A pointer and a 16 bit tag in one word: x86-64 and aarch64 user
+    /// space addresses fit in the low 48 bits.
+    struct tagged_ptr
+    {
+        static constexpr int PtrBits = 48;
+        static constexpr std::uint64_t PtrMask = (std::uint64_t(1) << PtrBits) - 1;
+
+        std::uint64_t word = 0;
+
+        static tagged_ptr
+        make(std::uint8_t* ptr, std::uint64_t tag) noexcept
+        {
+            DEBUG_ASSERT((to_int(ptr) & ~PtrMask) == 0);
+            return {(tag << PtrBits) | to_int(ptr)};
+        }
+
+        std::uint8_t*
+        ptr() const noexcept
+        {
+            return from_int(word & PtrMask);
+        }
+
+        std::uint16_t
+        tag() const noexcept
+        {
+            return static_cast<std::uint16_t>(word >> PtrBits);
+        }
+    };
+    static_assert(sizeof(void*) == sizeof(std::uint64_t), "tagged_ptr needs 64 bit pointers");
+
+} // namespace detail
+
+
+/// Thread-safe counterpart of memory_pool: any thread may allocate a node
+/// and any other free it, e.g. a decode thread handing orders to book
+/// threads. Works with mp_allocator<T, concurrent_memory_pool>.
+///
+/// Each thread caches up to two magazines of MagazineSize free nodes in
+/// the pool (a slot of its own, so no atomics on the fast path) and
+/// swaps whole magazines with a depot: a lock-free stack of node chains
+/// whose top carries a tag bumped on every update, so a pop can't be
+/// fooled by a chain that was popped and pushed back meanwhile (ABA).
+/// Only growing the pool by another block takes a lock. Threads beyond
+/// detail::MaxThreadSlots go to the depot for every node.
+///
+/// Arrays of more than one node come straight from malloc, and nodes
+/// parked in a thread's magazines stay there until it allocates again
+/// (or a new thread takes over its slot).
+template <typename BlockAllocator = growing_block_allocator<lowlevel_allocator<malloc_allocator>>>
+class basic_concurrent_memory_pool
+{
+public:
+    using allocator_type = BlockAllocator;
+
+    /// nodes per magazine
+    static constexpr std::size_t MagazineSize = 64;
+
+private:
+    static constexpr std::size_t CacheLineSize = 64;
+
+    /// nodes linked through their first word. in the depot the second
+    /// word of the first node holds a tagged_ptr to the next chain,
+    /// tagged with the number of nodes in this one
+    struct magazine
+    {
+        std::uint8_t* first = nullptr;
+        std::size_t count = 0;
+    };
+
+    struct alignas(CacheLineSize) thread_cache
+    {
+        magazine loaded;   ///< nodes are taken from and put back here
+        magazine previous; ///< either empty or full
+    };
+
+private:
+    alignas(CacheLineSize) std::atomic<std::uint64_t> depot_ = 0; ///< tagged_ptr
+    std::array<thread_cache, detail::MaxThreadSlots> caches_;
+    alignas(CacheLineSize) std::size_t node_size_;
+    mutable std::mutex mutex_; ///< guards arena_
+    memory_arena<allocator_type> arena_;
+
+public:
+    /// args are passed on to the BlockAllocator ctor, see memory_arena
+    template <typename... Args>
+    basic_concurrent_memory_pool(std::size_t node_size, std::size_t count, Args&&... args) noexcept;
+    ~basic_concurrent_memory_pool() noexcept = default;
+    basic_concurrent_memory_pool(basic_concurrent_memory_pool const&) noexcept = delete;
+    basic_concurrent_memory_pool(basic_concurrent_memory_pool&&) noexcept = delete;
+    basic_concurrent_memory_pool& operator=(basic_concurrent_memory_pool const&) noexcept = delete;
+    basic_concurrent_memory_pool& operator=(basic_concurrent_memory_pool&&) noexcept = delete;
+    void* allocate_node() noexcept;
+    void* allocate_array(std::size_t n) noexcept;
+    void deallocate_node(void* ptr) noexcept;
+    void deallocate_array(void* ptr, std::size_t n) noexcept;
+    std::size_t node_size() const noexcept;
+    std::size_t next_capacity() const noexcept;
+
+private:
+    static void* take(magazine&) noexcept;
+    static void put(magazine&, void* ptr) noexcept;
+    static detail::tagged_ptr chain_link(std::uint8_t* first) noexcept;
+    static void set_chain_link(std::uint8_t* first, std::uint8_t* next, std::size_t count) noexcept;
+    magazine pop_chain() noexcept;
+    void push_chains(std::uint8_t* first, std::uint8_t* last) noexcept;
+    void push_chain(magazine) noexcept;
+    bool grow(magazine&) noexcept;
+};
+
+/**********************************************************************/
+
+template <typename BlockAllocator>
+template <typename... Args>
+basic_concurrent_memory_pool<BlockAllocator>::basic_concurrent_memory_pool(
+        std::size_t node_size, std::size_t count, Args&&... args) noexcept
+        : node_size_(std::max(detail::round_up_to_align(node_size), 2 * detail::MinElementSize))
+        , arena_(node_size_ * count, std::forward<Args>(args)...)
+{
+    magazine m;
+    if (grow(m))
+        push_chain(m);
+}
+
+template <typename BlockAllocator>
+void*
+basic_concurrent_memory_pool<BlockAllocator>::allocate_node() noexcept
+{
+    std::size_t const slot = detail::this_thread_slot();
+    if (slot == detail::NoThreadSlot) {
+        magazine m = pop_chain();
+        void* ptr = take(m);
+        if (m.count != 0)
+            push_chain(m);
+        return ptr;
+    }
+
+    thread_cache& cache = caches_[slot];
+    if (cache.loaded.count == 0) {
+        if (cache.previous.count != 0)
+            std::swap(cache.loaded, cache.previous);
+        else
+            cache.loaded = pop_chain();
+    }
+    return take(cache.loaded);
+}
+
+template <typename BlockAllocator>
+void*
+basic_concurrent_memory_pool<BlockAllocator>::allocate_array(std::size_t n) noexcept
+{
+    if (n <= 1)
+        return allocate_node();
+
+    void* mem = std::malloc(n * node_size_);
+    if (mem == nullptr)
+        std::terminate();
+    return mem;
+}
+
+template <typename BlockAllocator>
+void
+basic_concurrent_memory_pool<BlockAllocator>::deallocate_node(void* ptr) noexcept
+{
+    DEBUG_ASSERT(ptr != nullptr);
+    std::size_t const slot = detail::this_thread_slot();
+    if (slot == detail::NoThreadSlot) {
+        magazine m;
+        put(m, ptr);
+        push_chain(m);
+        return;
+    }
+
+    thread_cache& cache = caches_[slot];
+    if (cache.loaded.count == MagazineSize) {
+        if (cache.previous.count != 0)
+            push_chain(cache.previous);
+        cache.previous = cache.loaded;
+        cache.loaded = magazine();
+    }
+    put(cache.loaded, ptr);
+}
+
+template <typename BlockAllocator>
+void
+basic_concurrent_memory_pool<BlockAllocator>::deallocate_array(void* ptr, std::size_t n) noexcept
+{
+    if (n <= 1)
+        deallocate_node(ptr);
+    else
+        std::free(ptr);
+}
+
+template <typename BlockAllocator>
+std::size_t
+basic_concurrent_memory_pool<BlockAllocator>::node_size() const noexcept
+{
+    return node_size_;
+}
+
+template <typename BlockAllocator>
+std::size_t
+basic_concurrent_memory_pool<BlockAllocator>::next_capacity() const noexcept
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return arena_.next_block_size();
+}
+
+// private
+
+template <typename BlockAllocator>
+void*
+basic_concurrent_memory_pool<BlockAllocator>::take(magazine& m) noexcept
+{
+    DEBUG_ASSERT(m.count != 0);
+    std::uint8_t* node = m.first;
+    m.first = detail::list_get_next(node);
+    --m.count;
+    return node;
+}
+
+template <typename BlockAllocator>
+void
+basic_concurrent_memory_pool<BlockAllocator>::put(magazine& m, void* ptr) noexcept
+{
+    auto* node = static_cast<std::uint8_t*>(ptr);
+    detail::list_set_next(node, m.first);
+    m.first = node;
+    ++m.count;
+}
+
+/// the link is read while another thread may already own the chain, as
+/// a pop that lost the race does; the tag check then throws it away
+template <typename BlockAllocator>
+detail::tagged_ptr
+basic_concurrent_memory_pool<BlockAllocator>::chain_link(std::uint8_t* first) noexcept
+{
+    auto* word = reinterpret_cast<std::uint64_t*>(first) + 1;
+    return {std::atomic_ref<std::uint64_t>(*word).load(std::memory_order_relaxed)};
+}
+
+template <typename BlockAllocator>
+void
+basic_concurrent_memory_pool<BlockAllocator>::set_chain_link(
+        std::uint8_t* first, std::uint8_t* next, std::size_t count) noexcept
+{
+    auto* word = reinterpret_cast<std::uint64_t*>(first) + 1;
+    std::atomic_ref<std::uint64_t>(*word).store(
+            detail::tagged_ptr::make(next, count).word, std::memory_order_relaxed);
+}
+
+template <typename BlockAllocator>
+typename basic_concurrent_memory_pool<BlockAllocator>::magazine
+basic_concurrent_memory_pool<BlockAllocator>::pop_chain() noexcept
+{
+    magazine m;
+    std::uint64_t top = depot_.load(std::memory_order_acquire);
+    for (;;) {
+        detail::tagged_ptr const t{top};
+        if (t.ptr() == nullptr) {
+            if (grow(m))
+                return m;
+            top = depot_.load(std::memory_order_acquire);
+            continue;
+        }
+
+        detail::tagged_ptr const link = chain_link(t.ptr());
+        detail::tagged_ptr const next = detail::tagged_ptr::make(link.ptr(), t.tag() + 1u);
+        if (depot_.compare_exchange_weak(
+                    top, next.word, std::memory_order_acq_rel, std::memory_order_acquire))
+            return {t.ptr(), link.tag()};
+    }
+}
+
+/// pushes the chains from first to last, linked through their chain links
+template <typename BlockAllocator>
+void
+basic_concurrent_memory_pool<BlockAllocator>::push_chains(
+        std::uint8_t* first, std::uint8_t* last) noexcept
+{
+    std::uint16_t const last_count = chain_link(last).tag();
+    std::uint64_t top = depot_.load(std::memory_order_relaxed);
+    for (;;) {
+        detail::tagged_ptr const t{top};
+        set_chain_link(last, t.ptr(), last_count);
+        detail::tagged_ptr const next = detail::tagged_ptr::make(first, t.tag() + 1u);
+        if (depot_.compare_exchange_weak(
+                    top, next.word, std::memory_order_acq_rel, std::memory_order_relaxed))
+            return;
+    }
+}
+
+template <typename BlockAllocator>
+void
+basic_concurrent_memory_pool<BlockAllocator>::push_chain(magazine m) noexcept
+{
+    DEBUG_ASSERT(m.count != 0);
+    set_chain_link(m.first, nullptr, m.count);
+    push_chains(m.first, m.first);
+}
+
+/// carves a new block into chains, returning the first in m and pushing
+/// the rest. returns false, leaving m alone, if another thread filled
+/// the depot while this one waited for the lock
+template <typename BlockAllocator>
+bool
+basic_concurrent_memory_pool<BlockAllocator>::grow(magazine& m) noexcept
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (detail::tagged_ptr{depot_.load(std::memory_order_acquire)}.ptr() != nullptr)
+        return false;
+
+    memory_block const mb = arena_.allocate_block();
+    std::size_t const num_nodes = mb.size / node_size_;
+    DEBUG_ASSERT(num_nodes != 0);
+
+    auto* const mem = static_cast<std::uint8_t*>(mb.memory);
+    std::uint8_t* prev_chain = nullptr;
+    std::size_t prev_count = 0;
+    for (std::size_t i = 0; i < num_nodes; i += MagazineSize) {
+        std::size_t const count = std::min(MagazineSize, num_nodes - i);
+        std::uint8_t* const first = mem + i * node_size_;
+        for (std::size_t j = 0; j + 1 < count; ++j)
+            detail::list_set_next(first + j * node_size_, first + (j + 1) * node_size_);
+        detail::list_set_next(first + (count - 1) * node_size_, nullptr);
+
+        set_chain_link(first, nullptr, count);
+        if (prev_chain != nullptr)
+            set_chain_link(prev_chain, first, prev_count);
+        prev_chain = first;
+        prev_count = count;
+    }
+
+    m = {mem, std::min(MagazineSize, num_nodes)};
+    if (num_nodes > MagazineSize)
+        push_chains(mem + MagazineSize * node_size_, prev_chain);
+    return true;
+}
+
+using concurrent_memory_pool = basic_concurrent_memory_pool<>;
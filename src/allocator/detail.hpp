@@ -33,4 +33,13 @@ namespace detail {
         return address % alignment == 0u;
     }
 
+    /// returns the first address at or after ptr aligned to alignment
+    inline std::uint8_t*
+    align_up(std::uint8_t* ptr, std::size_t alignment) noexcept
+    {
+        DEBUG_ASSERT(is_valid_alignment(alignment));
+        auto const address = reinterpret_cast<std::uintptr_t>(ptr);
+        return ptr + ((alignment - address % alignment) % alignment);
+    }
+
 } // namespace detail
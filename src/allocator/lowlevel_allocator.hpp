@@ -1,27 +1,36 @@
 #pragma once
 
+#include "util/assert.hpp"
 #include <sys/mman.h>
+#include <cstddef>   // std::size_t
+#include <cstdint>   // std::uintptr_t
 #include <cstdlib>   // ::posix_memalign
 #include <exception> // std::terminate
 #include <memory>
 #include <new>
+#include <utility> // std::move
 
 
+/// Functor maps and unmaps blocks, see malloc_allocator. Most functors
+/// are stateless, a stateful one (e.g. numa_allocator) is passed to the
+/// ctor.
 template <typename Functor>
-class lowlevel_allocator
+class lowlevel_allocator : private Functor
 {
 public:
     constexpr lowlevel_allocator() noexcept = default;
-    constexpr lowlevel_allocator(lowlevel_allocator&&) noexcept = default;
-    constexpr ~lowlevel_allocator() noexcept = default;
-    lowlevel_allocator(lowlevel_allocator const&) noexcept = delete;
 
-    constexpr lowlevel_allocator&
-    operator=(lowlevel_allocator&&) noexcept
+    constexpr lowlevel_allocator(Functor f) noexcept
+            : Functor(std::move(f))
     {
-        return *this;
+        // empty
     }
 
+    constexpr lowlevel_allocator(lowlevel_allocator&&) noexcept = default;
+    constexpr ~lowlevel_allocator() noexcept = default;
+    lowlevel_allocator(lowlevel_allocator const&) noexcept = delete;
+    constexpr lowlevel_allocator& operator=(lowlevel_allocator&&) noexcept = default;
+
     lowlevel_allocator& operator=(lowlevel_allocator const&) = delete;
 
     [[nodiscard]] constexpr void*
@@ -45,6 +54,12 @@ public:
     {
         return Functor::max_node_size();
     }
+
+    constexpr Functor const&
+    functor() const noexcept
+    {
+        return *this;
+    }
 };
 
 struct malloc_allocator
@@ -122,7 +137,9 @@ struct mmap_allocator
     [[nodiscard]] static void*
     allocate(std::size_t size, std::size_t /*alignment*/) noexcept
     {
-        return ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        void* ptr =
+                ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return ptr == MAP_FAILED ? nullptr : ptr;
     }
 
     static void
@@ -137,3 +154,64 @@ struct mmap_allocator
         return std::allocator_traits<std::allocator<char>>::max_size({});
     }
 };
+
+/// Maps blocks on 2 MB huge pages, so a big pool or order store needs
+/// a fraction of the TLB entries it does on 4 KB pages. Tries
+/// MAP_HUGETLB first, which needs pages reserved in
+/// /proc/sys/vm/nr_hugepages. Without them it maps a 2 MB aligned
+/// region and asks for transparent huge pages with madvise(), a hint
+/// that the kernel may ignore (THP set to never, or fragmented memory)
+/// and that leaves plain 4 KB pages behind. Sizes are rounded up to
+/// whole huge pages, so this is only worth it for blocks of a few MB.
+struct mmap_hugepage_allocator
+{
+    static constexpr std::size_t HugePageSize = std::size_t(1) << 21;
+
+    [[nodiscard]] static void*
+    allocate(std::size_t size, [[maybe_unused]] std::size_t alignment) noexcept
+    {
+        DEBUG_ASSERT(alignment <= HugePageSize);
+        std::size_t const bytes = round_up(size);
+
+        void* ptr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED)
+            return ptr;
+
+        // THP only backs 2 MB aligned ranges: map a huge page more than
+        // needed and trim it to an aligned region
+        ptr = ::mmap(nullptr, bytes + HugePageSize, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED)
+            return nullptr;
+
+        auto const addr = reinterpret_cast<std::uintptr_t>(ptr);
+        std::uintptr_t const aligned = (addr + HugePageSize - 1) & ~(HugePageSize - 1);
+        std::size_t const head = aligned - addr;
+        if (head != 0)
+            ::munmap(ptr, head);
+        ::munmap(reinterpret_cast<void*>(aligned + bytes), HugePageSize - head);
+
+        void* const mem = reinterpret_cast<void*>(aligned);
+        ::madvise(mem, bytes, MADV_HUGEPAGE);
+        return mem;
+    }
+
+    static void
+    deallocate(void* ptr, std::size_t size, std::size_t /*alignment*/) noexcept
+    {
+        ::munmap(ptr, round_up(size));
+    }
+
+    static std::size_t
+    max_node_size() noexcept
+    {
+        return std::allocator_traits<std::allocator<char>>::max_size({});
+    }
+
+    static constexpr std::size_t
+    round_up(std::size_t size) noexcept
+    {
+        return (size + HugePageSize - 1) & ~(HugePageSize - 1);
+    }
+};
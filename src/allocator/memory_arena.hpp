@@ -14,7 +14,10 @@ private:
     memory_block_stack used_;
 
 public:
-    constexpr explicit memory_arena(std::size_t block_size) noexcept;
+    /// args are passed on to the BlockAllocator ctor, e.g. a
+    /// numa_allocator to place the blocks
+    template <typename... Args>
+    constexpr explicit memory_arena(std::size_t block_size, Args&&... args) noexcept;
 
     /// Deallocates all memory blocks that where requested back to the
     /// BlockAllocator.
@@ -45,8 +48,10 @@ public:
 /**********************************************************************/
 
 template <typename BlockAllocator>
-constexpr memory_arena<BlockAllocator>::memory_arena(std::size_t block_size) noexcept
-        : BlockAllocator(block_size)
+template <typename... Args>
+constexpr memory_arena<BlockAllocator>::memory_arena(
+        std::size_t block_size, Args&&... args) noexcept
+        : BlockAllocator(block_size, std::forward<Args>(args)...)
 {
     // empty
 }
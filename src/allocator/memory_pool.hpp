@@ -6,6 +6,8 @@
 #include "lowlevel_allocator.hpp"
 #include "memory_arena.hpp"
 #include "util/assert.hpp"
+#include <cstddef> // std::size_t
+#include <cstdint>
 #include <cstdlib>
 #include <exception> // std::terminate
 #include <new>
@@ -13,71 +15,100 @@
 #include <utility>
 
 
-class memory_pool
+/// BlockAllocator is where blocks of nodes come from, e.g.
+/// growing_block_allocator<lowlevel_allocator<mmap_hugepage_allocator>>
+/// to put a big pool on huge pages. Nodes are aligned to Alignment, a
+/// power of two; above the default, each block is over-allocated by
+/// Alignment bytes so its first node can be aligned.
+template <typename BlockAllocator = growing_block_allocator<lowlevel_allocator<malloc_allocator>>,
+        std::size_t Alignment = detail::DefaultAlignment>
+class basic_memory_pool
 {
+    static_assert(detail::is_valid_alignment(Alignment) && Alignment >= detail::DefaultAlignment,
+            "invalid alignment");
+
 public:
-    using allocator_type = growing_block_allocator<lowlevel_allocator<malloc_allocator>>;
+    using allocator_type = BlockAllocator;
+    static constexpr std::size_t alignment = Alignment;
+
+private:
+    /// bytes a block needs beyond its nodes to align the first one
+    static constexpr std::size_t AlignmentSlack
+            = (Alignment > detail::DefaultAlignment) ? Alignment : 0;
 
 private:
     memory_arena<allocator_type> arena_;
     free_list free_list_;
 
 public:
-    inline memory_pool(std::size_t node_size, std::size_t count) noexcept;
-    ~memory_pool() noexcept = default;
-    inline memory_pool(memory_pool&&) noexcept;
-    memory_pool(memory_pool const&) noexcept = delete;
-    inline memory_pool& operator=(memory_pool&&) noexcept;
-    memory_pool& operator=(memory_pool const&) noexcept = delete;
-    inline void* allocate_node() noexcept;
-    inline void* allocate_array(std::size_t n) noexcept;
-    inline void deallocate_node(void* ptr) noexcept;
-    inline void deallocate_array(void* ptr, std::size_t n) noexcept;
-    inline std::size_t node_size() const noexcept;
-    inline std::size_t max_used() const noexcept;
-    inline std::size_t capacity_left() const noexcept;
-    inline std::size_t next_capacity() const noexcept;
-    inline allocator_type& get_allocator() noexcept;
+    /// args are passed on to the BlockAllocator ctor, see memory_arena
+    template <typename... Args>
+    basic_memory_pool(std::size_t node_size, std::size_t count, Args&&... args) noexcept;
+    ~basic_memory_pool() noexcept = default;
+    basic_memory_pool(basic_memory_pool&&) noexcept;
+    basic_memory_pool(basic_memory_pool const&) noexcept = delete;
+    basic_memory_pool& operator=(basic_memory_pool&&) noexcept;
+    basic_memory_pool& operator=(basic_memory_pool const&) noexcept = delete;
+    void* allocate_node() noexcept;
+    void* allocate_array(std::size_t n) noexcept;
+    void deallocate_node(void* ptr) noexcept;
+    void deallocate_array(void* ptr, std::size_t n) noexcept;
+    std::size_t node_size() const noexcept;
+    std::size_t max_used() const noexcept;
+    std::size_t capacity_left() const noexcept;
+    std::size_t next_capacity() const noexcept;
+    allocator_type& get_allocator() noexcept;
 
 private:
-    inline void allocate_block() noexcept;
+    void allocate_block() noexcept;
 };
 
 /**********************************************************************/
 
-memory_pool::memory_pool(std::size_t node_size, std::size_t count) noexcept
-        : arena_(detail::round_up_to_align(node_size) * count)
-        , free_list_(detail::round_up_to_align(node_size))
+template <typename BlockAllocator, std::size_t Alignment>
+template <typename... Args>
+basic_memory_pool<BlockAllocator, Alignment>::basic_memory_pool(
+        std::size_t node_size, std::size_t count, Args&&... args) noexcept
+        : arena_(detail::round_up_to_align(node_size, static_cast<int>(Alignment)) * count
+                        + AlignmentSlack,
+                std::forward<Args>(args)...)
+        , free_list_(detail::round_up_to_align(node_size, static_cast<int>(Alignment)))
 {
     allocate_block();
 }
 
-memory_pool::memory_pool(memory_pool&& other) noexcept
+template <typename BlockAllocator, std::size_t Alignment>
+basic_memory_pool<BlockAllocator, Alignment>::basic_memory_pool(basic_memory_pool&& other) noexcept
         : arena_(std::move(other.arena_))
         , free_list_(std::move(other.free_list_))
 {
     // empty
 }
 
-memory_pool&
-memory_pool::operator=(memory_pool&& other) noexcept
+template <typename BlockAllocator, std::size_t Alignment>
+basic_memory_pool<BlockAllocator, Alignment>&
+basic_memory_pool<BlockAllocator, Alignment>::operator=(basic_memory_pool&& other) noexcept
 {
     arena_ = std::move(other.arena_);
     free_list_ = std::move(other.free_list_);
     return *this;
 }
 
+template <typename BlockAllocator, std::size_t Alignment>
 void*
-memory_pool::allocate_node() noexcept
+basic_memory_pool<BlockAllocator, Alignment>::allocate_node() noexcept
 {
     if (free_list_.empty())
         allocate_block();
     DEBUG_ASSERT(!free_list_.empty());
-    return free_list_.allocate();
+    void* mem = free_list_.allocate();
+    DEBUG_ASSERT(detail::is_aligned(mem, Alignment));
+    return mem;
 }
 
+template <typename BlockAllocator, std::size_t Alignment>
 void*
-memory_pool::allocate_array(std::size_t n) noexcept
+basic_memory_pool<BlockAllocator, Alignment>::allocate_array(std::size_t n) noexcept
 {
     void* mem = free_list_.empty() ? nullptr : free_list_.allocate(n * node_size());
     if (mem == nullptr) {
@@ -89,53 +120,75 @@ memory_pool::allocate_array(std::size_t n) noexcept
     return mem;
 }
 
+template <typename BlockAllocator, std::size_t Alignment>
 void
-memory_pool::deallocate_node(void* ptr) noexcept
+basic_memory_pool<BlockAllocator, Alignment>::deallocate_node(void* ptr) noexcept
 {
     free_list_.deallocate(ptr);
 }
 
+template <typename BlockAllocator, std::size_t Alignment>
 void
-memory_pool::deallocate_array(void* ptr, std::size_t n) noexcept
+basic_memory_pool<BlockAllocator, Alignment>::deallocate_array(void* ptr, std::size_t n) noexcept
 {
     free_list_.deallocate(ptr, n * node_size());
 }
 
+template <typename BlockAllocator, std::size_t Alignment>
 std::size_t
-memory_pool::node_size() const noexcept
+basic_memory_pool<BlockAllocator, Alignment>::node_size() const noexcept
 {
     return free_list_.node_size();
 }
 
+template <typename BlockAllocator, std::size_t Alignment>
 std::size_t
-memory_pool::max_used() const noexcept
+basic_memory_pool<BlockAllocator, Alignment>::max_used() const noexcept
 {
     return free_list_.max_used();
 }
 
+template <typename BlockAllocator, std::size_t Alignment>
 std::size_t
-memory_pool::capacity_left() const noexcept
+basic_memory_pool<BlockAllocator, Alignment>::capacity_left() const noexcept
 {
     return free_list_.capacity_left() * node_size();
 }
 
+template <typename BlockAllocator, std::size_t Alignment>
 std::size_t
-memory_pool::next_capacity() const noexcept
+basic_memory_pool<BlockAllocator, Alignment>::next_capacity() const noexcept
 {
     return arena_.next_block_size();
 }
 
-memory_pool::allocator_type&
-memory_pool::get_allocator() noexcept
+template <typename BlockAllocator, std::size_t Alignment>
+typename basic_memory_pool<BlockAllocator, Alignment>::allocator_type&
+basic_memory_pool<BlockAllocator, Alignment>::get_allocator() noexcept
 {
     return arena_.get_allocator();
 }
 
 // private
 
+template <typename BlockAllocator, std::size_t Alignment>
 void
-memory_pool::allocate_block() noexcept
+basic_memory_pool<BlockAllocator, Alignment>::allocate_block() noexcept
 {
     memory_block mb = arena_.allocate_block();
+    if constexpr (AlignmentSlack != 0) {
+        auto* const mem = static_cast<std::uint8_t*>(mb.memory);
+        auto* const first = detail::align_up(mem, Alignment);
+        mb.size -= static_cast<std::size_t>(first - mem);
+        mb.memory = first;
+    }
     free_list_.insert(mb.memory, mb.size);
 }
+
+using memory_pool = basic_memory_pool<>;
+
+/// memory_pool with nodes aligned to Alignment, e.g. to cache lines
+template <std::size_t Alignment>
+using aligned_memory_pool
+        = basic_memory_pool<growing_block_allocator<lowlevel_allocator<malloc_allocator>>,
+                Alignment>;
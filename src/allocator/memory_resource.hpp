@@ -0,0 +1,201 @@
+#pragma once
+
+#include "detail.hpp"
+#include "growing_block_allocator.hpp"
+#include "lowlevel_allocator.hpp"
+#include "memory_arena.hpp"
+#include "memory_block.hpp"
+#include "memory_pool.hpp"
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <memory> // std::align
+#include <memory_resource>
+#include <utility> // std::forward
+
+
+/// std::pmr::memory_resource over a Pool held by reference (memory_pool,
+/// or concurrent_memory_pool), so pooled containers are plain std::pmr
+/// types. Requests that fit a node come from the pool, anything bigger
+/// or aligned beyond 8 bytes (e.g. hash buckets) from upstream.
+template <typename Pool = memory_pool>
+class pool_resource : public std::pmr::memory_resource
+{
+private:
+    Pool* pool_;
+    std::pmr::memory_resource* upstream_;
+
+public:
+    explicit pool_resource(Pool& pool,
+            std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) noexcept;
+
+    Pool& pool() const noexcept;
+    std::pmr::memory_resource* upstream_resource() const noexcept;
+
+private:
+    bool fits(std::size_t bytes, std::size_t alignment) const noexcept;
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override;
+};
+
+/// Monotonic std::pmr::memory_resource that bumps through blocks of a
+/// memory_arena, which keeps them on its memory_block_stack, and frees
+/// nothing until release() or destruction. Like
+/// std::pmr::monotonic_buffer_resource, but blocks come from
+/// BlockAllocator, e.g. on huge pages or a NUMA node. Requests that
+/// wouldn't fit the first block go to std::pmr::new_delete_resource(),
+/// and back to it on deallocate.
+template <typename BlockAllocator = growing_block_allocator<lowlevel_allocator<malloc_allocator>>>
+class monotonic_arena_resource : public std::pmr::memory_resource
+{
+private:
+    memory_arena<BlockAllocator> arena_;
+    std::size_t max_bump_; ///< bytes + alignment, bigger goes upstream
+    std::uint8_t* cur_ = nullptr;
+    std::uint8_t* end_ = nullptr;
+
+public:
+    /// args are passed on to the BlockAllocator ctor, see memory_arena
+    template <typename... Args>
+    explicit monotonic_arena_resource(std::size_t block_size, Args&&... args) noexcept;
+
+    /// hands all blocks back to the BlockAllocator
+    void release() noexcept;
+
+    /// blocks in use
+    std::size_t num_blocks() const noexcept;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override;
+};
+
+/**********************************************************************/
+
+template <typename Pool>
+pool_resource<Pool>::pool_resource(Pool& pool, std::pmr::memory_resource* upstream) noexcept
+        : pool_(&pool)
+        , upstream_(upstream)
+{
+    // empty
+}
+
+template <typename Pool>
+Pool&
+pool_resource<Pool>::pool() const noexcept
+{
+    return *pool_;
+}
+
+template <typename Pool>
+std::pmr::memory_resource*
+pool_resource<Pool>::upstream_resource() const noexcept
+{
+    return upstream_;
+}
+
+// private
+
+template <typename Pool>
+bool
+pool_resource<Pool>::fits(std::size_t bytes, std::size_t alignment) const noexcept
+{
+    return bytes <= pool_->node_size()
+            && alignment <= static_cast<std::size_t>(detail::DefaultAlignment);
+}
+
+template <typename Pool>
+void*
+pool_resource<Pool>::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    if (fits(bytes, alignment))
+        return pool_->allocate_node();
+    return upstream_->allocate(bytes, alignment);
+}
+
+template <typename Pool>
+void
+pool_resource<Pool>::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment)
+{
+    if (fits(bytes, alignment))
+        pool_->deallocate_node(ptr);
+    else
+        upstream_->deallocate(ptr, bytes, alignment);
+}
+
+template <typename Pool>
+bool
+pool_resource<Pool>::do_is_equal(std::pmr::memory_resource const& other) const noexcept
+{
+    auto const* p = dynamic_cast<pool_resource const*>(&other);
+    return p != nullptr && p->pool_ == pool_ && p->upstream_->is_equal(*upstream_);
+}
+
+/**********************************************************************/
+
+template <typename BlockAllocator>
+template <typename... Args>
+monotonic_arena_resource<BlockAllocator>::monotonic_arena_resource(
+        std::size_t block_size, Args&&... args) noexcept
+        : arena_(block_size, std::forward<Args>(args)...)
+        , max_bump_(arena_.next_block_size())
+{
+    // empty
+}
+
+template <typename BlockAllocator>
+void
+monotonic_arena_resource<BlockAllocator>::release() noexcept
+{
+    while (num_blocks() != 0)
+        arena_.deallocate_block();
+    cur_ = nullptr;
+    end_ = nullptr;
+}
+
+template <typename BlockAllocator>
+std::size_t
+monotonic_arena_resource<BlockAllocator>::num_blocks() const noexcept
+{
+    return arena_.size();
+}
+
+// private
+
+template <typename BlockAllocator>
+void*
+monotonic_arena_resource<BlockAllocator>::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    if (bytes + alignment > max_bump_)
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+
+    void* mem = cur_;
+    std::size_t space = static_cast<std::size_t>(end_ - cur_);
+    if (cur_ == nullptr || std::align(alignment, bytes, mem, space) == nullptr) {
+        memory_block const mb = arena_.allocate_block();
+        mem = mb.memory;
+        space = mb.size;
+        std::align(alignment, bytes, mem, space);
+        end_ = static_cast<std::uint8_t*>(mb.memory) + mb.size;
+    }
+    cur_ = static_cast<std::uint8_t*>(mem) + bytes;
+    return mem;
+}
+
+template <typename BlockAllocator>
+void
+monotonic_arena_resource<BlockAllocator>::do_deallocate(
+        void* ptr, std::size_t bytes, std::size_t alignment)
+{
+    if (bytes + alignment > max_bump_)
+        std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+}
+
+template <typename BlockAllocator>
+bool
+monotonic_arena_resource<BlockAllocator>::do_is_equal(
+        std::pmr::memory_resource const& other) const noexcept
+{
+    return this == &other;
+}
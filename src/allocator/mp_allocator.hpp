@@ -5,8 +5,10 @@
 #include <utility>     // std::forward
 
 
-template <typename T>
-class mp_allocator : private reference_storage
+/// allocates from a Pool held by reference: memory_pool, or
+/// concurrent_memory_pool for containers shared between threads
+template <typename T, typename Pool = memory_pool>
+class mp_allocator : private reference_storage<Pool>
 {
 public:
     using value_type = T;
@@ -19,15 +21,15 @@ public:
     template <typename U>
     struct rebind
     {
-        using other = mp_allocator<U>;
+        using other = mp_allocator<U, Pool>;
     };
 
-    using allocator_type = reference_storage::allocator_type;
+    using allocator_type = typename reference_storage<Pool>::allocator_type;
 
     /// ctor used when initializing std containers
     template <typename Alloc>
     mp_allocator(Alloc& alloc) noexcept;
-    mp_allocator<T> select_on_container_copy_construction() const;
+    mp_allocator select_on_container_copy_construction() const;
     value_type* allocate(size_type n, void* = nullptr) noexcept;
     void deallocate(value_type* ptr, size_type n) noexcept;
     template <typename U, typename... Args>
@@ -39,31 +41,32 @@ public:
     allocator_type const& get_allocator() const noexcept;
 
 private:
-    template <typename T1, typename T2>
-    friend bool operator==(mp_allocator<T1> const& lhs, mp_allocator<T2> const& rhs) noexcept;
+    template <typename T1, typename T2, typename P>
+    friend bool operator==(
+            mp_allocator<T1, P> const& lhs, mp_allocator<T2, P> const& rhs) noexcept;
 
-    template <typename U>
+    template <typename U, typename P>
     friend class mp_allocator;
 };
 
-template <typename T>
+template <typename T, typename Pool>
 template <typename Alloc>
-mp_allocator<T>::mp_allocator(Alloc& alloc) noexcept
-        : reference_storage(alloc)
+mp_allocator<T, Pool>::mp_allocator(Alloc& alloc) noexcept
+        : reference_storage<Pool>(alloc)
 {
     // empty
 }
 
-template <typename T>
-mp_allocator<T>
-mp_allocator<T>::select_on_container_copy_construction() const
+template <typename T, typename Pool>
+mp_allocator<T, Pool>
+mp_allocator<T, Pool>::select_on_container_copy_construction() const
 {
     return *this;
 }
 
-template <typename T>
-typename mp_allocator<T>::value_type*
-mp_allocator<T>::allocate(size_type n, void*) noexcept
+template <typename T, typename Pool>
+typename mp_allocator<T, Pool>::value_type*
+mp_allocator<T, Pool>::allocate(size_type n, void*) noexcept
 {
     if (n == 1)
         return static_cast<value_type*>(get_allocator().allocate_node());
@@ -71,9 +74,9 @@ mp_allocator<T>::allocate(size_type n, void*) noexcept
         return static_cast<value_type*>(get_allocator().allocate_array(n));
 }
 
-template <typename T>
+template <typename T, typename Pool>
 void
-mp_allocator<T>::deallocate(value_type* ptr, size_type n) noexcept
+mp_allocator<T, Pool>::deallocate(value_type* ptr, size_type n) noexcept
 {
     if (n == 1)
         get_allocator().deallocate_node(ptr);
@@ -81,55 +84,55 @@ mp_allocator<T>::deallocate(value_type* ptr, size_type n) noexcept
         get_allocator().deallocate_array(ptr, n);
 }
 
-template <typename T>
+template <typename T, typename Pool>
 template <typename U, typename... Args>
 void
-mp_allocator<T>::construct(U* p, Args&&... args)
+mp_allocator<T, Pool>::construct(U* p, Args&&... args)
 {
     void* mem = p;
     ::new (mem) U(std::forward<Args>(args)...);
 }
 
-template <typename T>
+template <typename T, typename Pool>
 template <typename U>
 void
-mp_allocator<T>::destroy(U* p) noexcept
+mp_allocator<T, Pool>::destroy(U* p) noexcept
 {
     p->~U();
 }
 
-template <typename T>
-typename mp_allocator<T>::size_type
-mp_allocator<T>::max_size() const noexcept
+template <typename T, typename Pool>
+typename mp_allocator<T, Pool>::size_type
+mp_allocator<T, Pool>::max_size() const noexcept
 {
     return this->max_array_size() / sizeof(value_type);
 }
 
-template <typename T>
-typename mp_allocator<T>::allocator_type&
-mp_allocator<T>::get_allocator() noexcept
+template <typename T, typename Pool>
+typename mp_allocator<T, Pool>::allocator_type&
+mp_allocator<T, Pool>::get_allocator() noexcept
 {
-    return reference_storage::get_allocator();
+    return reference_storage<Pool>::get_allocator();
 }
 
-template <typename T>
-typename mp_allocator<T>::allocator_type const&
-mp_allocator<T>::get_allocator() const noexcept
+template <typename T, typename Pool>
+typename mp_allocator<T, Pool>::allocator_type const&
+mp_allocator<T, Pool>::get_allocator() const noexcept
 {
-    return reference_storage::get_allocator();
+    return reference_storage<Pool>::get_allocator();
 }
 
 
-template <typename T, typename U>
+template <typename T, typename U, typename Pool>
 bool
-operator==(mp_allocator<T> const& lhs, mp_allocator<U> const& rhs) noexcept
+operator==(mp_allocator<T, Pool> const& lhs, mp_allocator<U, Pool> const& rhs) noexcept
 {
     return &lhs.get_allocator() == &rhs.get_allocator();
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename Pool>
 bool
-operator!=(mp_allocator<T> const& lhs, mp_allocator<U> const& rhs) noexcept
+operator!=(mp_allocator<T, Pool> const& lhs, mp_allocator<U, Pool> const& rhs) noexcept
 {
     return !(lhs == rhs);
 }
@@ -0,0 +1,192 @@
+#include "numa.hpp"
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib> // std::strtoul
+
+
+namespace numa {
+
+    namespace { // unnamed
+
+        constexpr std::size_t BitsPerWord = 8 * sizeof(unsigned long);
+
+        /// a node set as the syscalls take it
+        struct node_mask
+        {
+            unsigned long words[MaxNodes / BitsPerWord] = {};
+
+            /// the kernel drops the last bit of the size it's given
+            static constexpr unsigned long MaxNode = MaxNodes + 1;
+
+            void
+            set(int node) noexcept
+            {
+                words[node / BitsPerWord] |= 1ul << (node % BitsPerWord);
+            }
+
+            bool
+            test(int node) const noexcept
+            {
+                return words[node / BitsPerWord] & (1ul << (node % BitsPerWord));
+            }
+
+            /// the only node in the set, AnyNode if there are more or none
+            int
+            single() const noexcept
+            {
+                int node = AnyNode;
+                for (int n = 0; n < MaxNodes; ++n) {
+                    if (!test(n))
+                        continue;
+                    if (node != AnyNode)
+                        return AnyNode;
+                    node = n;
+                }
+                return node;
+            }
+        };
+
+        long
+        get_mempolicy(int* mode, node_mask* mask, void const* addr, unsigned long flags) noexcept
+        {
+            return ::syscall(SYS_get_mempolicy, mode, mask ? mask->words : nullptr,
+                    mask ? node_mask::MaxNode : 0, addr, flags);
+        }
+
+        bool
+        allowed_nodes(node_mask& mask) noexcept
+        {
+            return get_mempolicy(nullptr, &mask, nullptr, MPOL_F_MEMS_ALLOWED) == 0;
+        }
+
+        /// parses a sysfs cpu list, e.g. "0-3,8,10-11"
+        bool
+        parse_cpu_list(char const* list, cpu_set_t& cpus) noexcept
+        {
+            CPU_ZERO(&cpus);
+            char const* p = list;
+            while (*p != '\0' && *p != '\n') {
+                char* end = nullptr;
+                unsigned long const first = std::strtoul(p, &end, 10);
+                unsigned long last = first;
+                if (end == p)
+                    return false;
+                if (*end == '-') {
+                    p = end + 1;
+                    last = std::strtoul(p, &end, 10);
+                    if (end == p)
+                        return false;
+                }
+                for (unsigned long cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+                    CPU_SET(cpu, &cpus);
+                p = (*end == ',') ? end + 1 : end;
+            }
+            return CPU_COUNT(&cpus) > 0;
+        }
+
+    } // namespace
+
+    bool
+    available() noexcept
+    {
+        node_mask mask;
+        return allowed_nodes(mask);
+    }
+
+    bool
+    node_allowed(int node) noexcept
+    {
+        if (node < 0 || node >= MaxNodes)
+            return false;
+
+        node_mask mask;
+        if (!allowed_nodes(mask))
+            return node == 0;
+        return mask.test(node);
+    }
+
+    int
+    num_nodes() noexcept
+    {
+        node_mask mask;
+        if (!allowed_nodes(mask))
+            return 1;
+
+        for (int node = MaxNodes - 1; node > 0; --node) {
+            if (mask.test(node))
+                return node + 1;
+        }
+        return 1;
+    }
+
+    bool
+    bind_memory(void* ptr, std::size_t size, int node) noexcept
+    {
+        if (!node_allowed(node))
+            return false;
+
+        node_mask mask;
+        mask.set(node);
+        return ::syscall(SYS_mbind, ptr, size, MPOL_BIND, mask.words, node_mask::MaxNode, 0) == 0;
+    }
+
+    int
+    bound_node(void const* ptr) noexcept
+    {
+        int mode = MPOL_DEFAULT;
+        node_mask mask;
+        if (get_mempolicy(&mode, &mask, ptr, MPOL_F_ADDR) != 0 || mode != MPOL_BIND)
+            return AnyNode;
+        return mask.single();
+    }
+
+    bool
+    prefer_node(int node) noexcept
+    {
+        if (node == AnyNode)
+            return ::syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0) == 0;
+
+        if (!node_allowed(node))
+            return false;
+
+        node_mask mask;
+        mask.set(node);
+        return ::syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask.words, node_mask::MaxNode) == 0;
+    }
+
+    int
+    preferred_node() noexcept
+    {
+        int mode = MPOL_DEFAULT;
+        node_mask mask;
+        if (get_mempolicy(&mode, &mask, nullptr, 0) != 0 || mode != MPOL_PREFERRED)
+            return AnyNode;
+        return mask.single();
+    }
+
+    bool
+    run_on_node(int node) noexcept
+    {
+        if (!node_allowed(node))
+            return false;
+
+        char fpath[64];
+        std::snprintf(fpath, sizeof(fpath), "/sys/devices/system/node/node%d/cpulist", node);
+        std::FILE* f = std::fopen(fpath, "r");
+        if (f == nullptr)
+            return false;
+
+        char buf[4096];
+        bool const read = std::fgets(buf, sizeof(buf), f) != nullptr;
+        std::fclose(f);
+
+        cpu_set_t cpus;
+        if (!read || !parse_cpu_list(buf, cpus))
+            return false;
+        return ::sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+    }
+
+} // namespace numa
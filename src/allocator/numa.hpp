@@ -0,0 +1,123 @@
+#pragma once
+
+#include "growing_block_allocator.hpp"
+#include "lowlevel_allocator.hpp"
+#include "memory_pool.hpp"
+#include <cstddef> // std::size_t
+
+
+/// NUMA placement, over the raw mbind/set_mempolicy/get_mempolicy and
+/// sched_setaffinity syscalls (no libnuma). Everything fails soft: on a
+/// kernel without NUMA support, or for a node the process isn't allowed
+/// to use, nothing is bound and memory comes from wherever the default
+/// policy puts it (the node of the thread that first touches it).
+namespace numa {
+
+    /// no particular node
+    constexpr int AnyNode = -1;
+
+    /// nodes are numbered from 0 to MaxNodes - 1
+    constexpr int MaxNodes = 1024;
+
+    /// whether the kernel supports memory policies. without them
+    /// nothing can be bound, but node 0 still counts as allowed
+    bool available() noexcept;
+
+    /// whether the process may allocate memory on node. false for every
+    /// node but 0 without NUMA support
+    bool node_allowed(int node) noexcept;
+
+    /// highest allowed node + 1, 1 without NUMA support
+    int num_nodes() noexcept;
+
+    /// binds the pages of [ptr, ptr + size) to node (MPOL_BIND), which
+    /// must be done before they're first touched. ptr must be page
+    /// aligned. returns false, leaving the range as it was, if node
+    /// isn't allowed or the kernel refuses
+    bool bind_memory(void* ptr, std::size_t size, int node) noexcept;
+
+    /// the node the page at ptr is bound to, AnyNode unless it's bound
+    /// to exactly one node
+    int bound_node(void const* ptr) noexcept;
+
+    /// new memory of the calling thread comes from node first, then from
+    /// any other node once it's full (MPOL_PREFERRED). AnyNode restores
+    /// the default policy. returns false, changing nothing, on failure
+    bool prefer_node(int node) noexcept;
+
+    /// node new memory of the calling thread comes from first, AnyNode
+    /// with the default policy
+    int preferred_node() noexcept;
+
+    /// pins the calling thread to the cpus of node. returns false,
+    /// changing nothing, if they can't be found or set
+    bool run_on_node(int node) noexcept;
+
+} // namespace numa
+
+/// lowlevel_allocator functor that maps blocks with Map (mmap_allocator,
+/// or mmap_hugepage_allocator: both page aligned, as mbind needs) and
+/// binds them to a node before they're touched. Stateful, so it's
+/// passed to lowlevel_allocator, and through growing_block_allocator,
+/// memory_arena, memory_pool or order_store ctors. A node the process
+/// can't use leaves node() at numa::AnyNode: blocks are then mapped
+/// with Map alone.
+template <typename Map = mmap_allocator>
+class numa_allocator
+{
+private:
+    int node_ = numa::AnyNode;
+
+public:
+    constexpr numa_allocator() noexcept = default;
+
+    explicit numa_allocator(int node) noexcept
+            : node_(numa::node_allowed(node) ? node : numa::AnyNode)
+    {
+        // empty
+    }
+
+    [[nodiscard]] void*
+    allocate(std::size_t size, std::size_t alignment) const noexcept
+    {
+        void* ptr = Map::allocate(size, alignment);
+        if (ptr != nullptr && node_ != numa::AnyNode)
+            numa::bind_memory(ptr, bind_size(size), node_);
+        return ptr;
+    }
+
+    static void
+    deallocate(void* ptr, std::size_t size, std::size_t alignment) noexcept
+    {
+        Map::deallocate(ptr, size, alignment);
+    }
+
+    static std::size_t
+    max_node_size() noexcept
+    {
+        return Map::max_node_size();
+    }
+
+    /// node blocks are bound to, numa::AnyNode if none
+    constexpr int
+    node() const noexcept
+    {
+        return node_;
+    }
+
+private:
+    /// huge page mappings must be bound whole
+    static constexpr std::size_t
+    bind_size(std::size_t size) noexcept
+    {
+        if constexpr (requires { Map::round_up(size); })
+            return Map::round_up(size);
+        else
+            return size;
+    }
+};
+
+/// memory_pool whose blocks are bound to the node of the numa_allocator
+/// passed to its ctor, e.g. numa_memory_pool(size, count, numa_allocator<>(node))
+using numa_memory_pool =
+        basic_memory_pool<growing_block_allocator<lowlevel_allocator<numa_allocator<>>>>;
@@ -3,15 +3,18 @@
 #include "memory_pool.hpp"
 
 
+/// Pool is memory_pool, or anything else with its allocate_node/array
+/// and deallocate_node/array, e.g. concurrent_memory_pool
+template <typename Pool = memory_pool>
 class reference_storage
 {
 public:
-    using allocator_type = memory_pool;
+    using allocator_type = Pool;
 
     constexpr reference_storage() noexcept = default;
     constexpr ~reference_storage() noexcept = default;
 
-    constexpr reference_storage(memory_pool& alloc) noexcept
+    constexpr reference_storage(Pool& alloc) noexcept
             : alloc_(&alloc)
     {
         // empty
@@ -28,12 +31,12 @@ public:
         return alloc_ != nullptr;
     }
 
-    constexpr memory_pool&
+    constexpr Pool&
     get_allocator() const noexcept
     {
         return *alloc_;
     }
 
 private:
-    memory_pool* alloc_ = nullptr;
+    Pool* alloc_ = nullptr;
 };
@@ -88,3 +88,9 @@ file_reader::print_stats() const
         stats_.nsec_count / NsecInSec);
     // clang-format on
 }
+
+bool
+file_reader::compressed() const noexcept
+{
+    return input_file_.extension() == ".gz";
+}
@@ -43,6 +43,10 @@ public:
 
     void print_stats() const;
 
+    /// whether process_file() inflates the file. if not, the whole
+    /// mapped file is passed to a single call of its callable
+    bool compressed() const noexcept;
+
     template <typename Callable>
     bool process_file(Callable&& fn);
 
@@ -60,7 +64,7 @@ template <typename Callable>
 bool
 file_reader::process_file(Callable&& fn)
 {
-    return (input_file_.extension() == ".gz") ? process_gz(fn) : process_raw(fn);
+    return compressed() ? process_gz(fn) : process_raw(fn);
 }
 
 template <typename Callable>
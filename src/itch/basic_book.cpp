@@ -1,4 +1,6 @@
 #include "basic_book.hpp"
+#include "book.hpp" // detail::fill_depth
+#include "level_table.hpp" // handled_level
 #include "util/assert.hpp"
 #include <algorithm> // std::find_if
 #include <cstdint>
@@ -9,41 +11,36 @@
 
 namespace itch {
 
-    basic_book::basic_book() noexcept
+    template <typename Level>
+    basic_basic_book<Level>::basic_basic_book() noexcept
             : bids_()
             , asks_()
     {
         // empty
     }
 
+    template <typename Level>
     void
-    basic_book::add_order(order& order) noexcept
+    basic_basic_book<Level>::add_order(order& order) noexcept
     {
         auto* book = (order.side == Side::Bid) ? &bids_ : &asks_;
 
         // emplace functions may throw, in which case we abort
         try {
-            if (book->empty()) {
-                order.pl = &book->emplace_front(order.price, order.qty);
+            // find location in book
+            auto pl_itr = std::find_if(book->begin(), book->end(), [&order](auto const& pl) {
+                return (order.side == Side::Bid) ? pl.price() <= order.price
+                                                 : pl.price() >= order.price;
+            });
+
+            if (pl_itr != book->end() && pl_itr->price() == order.price) {
+                // price_level exists, adjust qty
+                pl_itr->inc_qty(order.qty);
+                order.pl = &(*pl_itr);
             } else {
-                // find location in book
-                auto pl_itr = std::find_if(book->begin(), book->end(), [&order](auto const& pl) {
-                    return (order.side == Side::Bid) ? pl.price() <= order.price
-                                                     : pl.price() >= order.price;
-                });
-
-                if (pl_itr == book->end()) {
-                    // establish price_level (at bottom of book)
-                    order.pl = &book->emplace_back(order.price, order.qty);
-                } else if (pl_itr->price() == order.price) {
-                    // price exists, adjust qty
-                    pl_itr->inc_qty(order.qty);
-                    order.pl = &(*pl_itr);
-                } else {
-                    // establish new price level (in middle of book)
-                    auto i_itr = book->emplace(pl_itr, order.price, order.qty);
-                    order.pl = &(*i_itr);
-                }
+                // establish new price level ahead of the first worse one,
+                // at the bottom of the book if there is none
+                order.pl = &level_node::emplace(*book, pl_itr, order.price, order.qty);
             }
         } catch (std::exception const& e) {
             std::fprintf(stderr, "[ERROR] exception in %s: %s\n", __builtin_FUNCTION(), e.what());
@@ -51,8 +48,9 @@ namespace itch {
         }
     }
 
+    template <typename Level>
     void
-    basic_book::delete_order(order& order) noexcept
+    basic_basic_book<Level>::delete_order(order& order) noexcept
     {
         DEBUG_ASSERT(order.pl != nullptr);
         if (order.pl == nullptr)
@@ -64,22 +62,15 @@ namespace itch {
         if (order.qty < order.pl->agg_qty()) {
             order.pl->dec_qty(order.qty);
         } else {
-            if (order.side == Side::Bid) {
-                auto found_itr = std::find_if(bids_.begin(), bids_.end(),
-                        [&order](auto& pl) { return order.price == pl.price(); });
-                bids_.erase(found_itr);
-            } else {
-                auto found_itr = std::find_if(asks_.begin(), asks_.end(),
-                        [&order](auto& pl) { return order.price == pl.price(); });
-                asks_.erase(found_itr);
-            }
+            level_node::erase((order.side == Side::Bid) ? bids_ : asks_, order.pl);
         }
 
         order.clear();
     }
 
+    template <typename Level>
     void
-    basic_book::cancel_order(order& order, qty_t remove_qty) noexcept
+    basic_basic_book<Level>::cancel_order(order& order, qty_t remove_qty) noexcept
     {
         DEBUG_ASSERT(remove_qty <= order.qty);
 
@@ -93,8 +84,9 @@ namespace itch {
         }
     }
 
+    template <typename Level>
     void
-    basic_book::replace_order(order& old_order, order& new_order) noexcept
+    basic_basic_book<Level>::replace_order(order& old_order, order& new_order) noexcept
     {
         DEBUG_ASSERT(old_order.pl != nullptr);
         DEBUG_ASSERT(new_order.pl == nullptr);
@@ -106,20 +98,23 @@ namespace itch {
         DEBUG_ASSERT(new_order.pl != nullptr);
     }
 
-    decltype(basic_book::bids_) const&
-    basic_book::bids() const noexcept
+    template <typename Level>
+    typename basic_basic_book<Level>::level_list const&
+    basic_basic_book<Level>::bids() const noexcept
     {
         return bids_;
     }
 
-    decltype(basic_book::asks_) const&
-    basic_book::asks() const noexcept
+    template <typename Level>
+    typename basic_basic_book<Level>::level_list const&
+    basic_basic_book<Level>::asks() const noexcept
     {
         return asks_;
     }
 
+    template <typename Level>
     pq
-    basic_book::best_bid() const noexcept
+    basic_basic_book<Level>::best_bid() const noexcept
     {
         if (bids_.empty())
             return {0, 0};
@@ -127,8 +122,9 @@ namespace itch {
         return {bids_.front().price(), bids_.front().agg_qty()};
     }
 
+    template <typename Level>
     pq
-    basic_book::best_ask() const noexcept
+    basic_basic_book<Level>::best_ask() const noexcept
     {
         if (asks_.empty())
             return {0, 0};
@@ -136,4 +132,19 @@ namespace itch {
         return {asks_.front().price(), asks_.front().agg_qty()};
     }
 
+    template <typename Level>
+    void
+    basic_basic_book<Level>::depth(
+            std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept
+    {
+        DEBUG_ASSERT(n <= bids.size() && n <= asks.size());
+
+        detail::fill_depth(bids_, bids.first(n));
+        detail::fill_depth(asks_, asks.first(n));
+    }
+
+    // explicit instantiations
+    template class basic_basic_book<price_level>;
+    template class basic_basic_book<handled_level>;
+
 } // namespace itch
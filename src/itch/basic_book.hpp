@@ -1,39 +1,29 @@
 #pragma once
 
 #include "core.hpp"
+#include "listed_level.hpp"
 #include "price_level.hpp"
 #include <cstddef> // std::size_t
-#include <list>
+#include <span>
 
 
-// Book Interface:
-// struct book
-// {
-//     book() noexcept;
-
-//     void add_order(order&) noexcept;
-//     void delete_order(order&) noexcept;
-//     void cancel_order(order&, qty_t remove_qty) noexcept;
-//     void replace_order(order& old_order, order& new_order) noexcept;
-
-//     // accessors
-//     decltype(bids_) const& bids() const noexcept;
-//     decltype(asks_) const& asks() const noexcept;
-//     pq best_bid() const noexcept;
-//     pq best_ask() const noexcept;
-// };
+// Book Interface: see Book in book.hpp
 
 namespace itch {
 
     /// Two-sided book
-    class basic_book
+    template <typename Level = price_level>
+    class basic_basic_book
     {
     private:
-        std::list<price_level> bids_;
-        std::list<price_level> asks_;
+        using level_node = listed_level<std::allocator, Level>;
+        using level_list = typename level_node::list_type;
+
+        level_list bids_;
+        level_list asks_;
 
     public:
-        basic_book() noexcept;
+        basic_basic_book() noexcept;
         void add_order(order&) noexcept;
         void delete_order(order&) noexcept;
         void cancel_order(order&, qty_t remove_qty) noexcept;
@@ -41,10 +31,11 @@ namespace itch {
 
         // accessors
     public:
-        decltype(bids_) const& bids() const noexcept;
-        decltype(asks_) const& asks() const noexcept;
+        level_list const& bids() const noexcept;
+        level_list const& asks() const noexcept;
         pq best_bid() const noexcept;
         pq best_ask() const noexcept;
+        void depth(std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept;
         constexpr std::size_t
         max_bid_book_depth() const noexcept
         {
@@ -67,4 +58,6 @@ namespace itch {
         }
     };
 
+    using basic_book = basic_basic_book<>;
+
 } // namespace itch
@@ -0,0 +1,58 @@
+#include "bbo.hpp"
+#include <fmt/format.h>
+#include <cerrno>
+#include <cstring> // std::strerror
+#include <stdexcept>
+#include <utility> // std::exchange
+
+
+namespace itch {
+
+    bbo_file_writer::bbo_file_writer(std::filesystem::path const& fpath)
+            : file_(std::fopen(fpath.c_str(), "wb"))
+            , buf_(std::make_unique<bbo_update[]>(BufferRecords))
+    {
+        if (file_ == nullptr)
+            throw std::runtime_error(fmt::format("{}: failed to open file: {} [{}]",
+                    __builtin_FUNCTION(), fpath.c_str(), std::strerror(errno)));
+    }
+
+    bbo_file_writer::~bbo_file_writer() noexcept
+    {
+        if (file_ == nullptr)
+            return;
+
+        flush();
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+
+    bbo_file_writer::bbo_file_writer(bbo_file_writer&& rhs) noexcept
+            : file_(std::exchange(rhs.file_, nullptr))
+            , buf_(std::move(rhs.buf_))
+            , buffered_(std::exchange(rhs.buffered_, 0))
+            , count_(std::exchange(rhs.count_, 0))
+    {
+        // empty
+    }
+
+    void
+    bbo_file_writer::flush() noexcept
+    {
+        if (buffered_ == 0)
+            return;
+
+        if (std::fwrite(buf_.get(), sizeof(bbo_update), buffered_, file_) != buffered_)
+            std::fprintf(stderr, "[ERROR] %s: write failed: %s\n", __builtin_FUNCTION(),
+                    std::strerror(errno));
+        count_ += buffered_;
+        buffered_ = 0;
+    }
+
+    std::size_t
+    bbo_file_writer::count() const noexcept
+    {
+        return count_ + buffered_;
+    }
+
+} // namespace itch
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "core.hpp"
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cstdio> // std::FILE
+#include <filesystem>
+#include <memory> // std::unique_ptr
+
+
+namespace itch {
+
+    /// A change of an instrument's best bid or offer (price or qty), as
+    /// passed to the on_bbo() hook of a parser handler. Fixed size and
+    /// trivially copyable, so a sink can store it as is.
+    struct bbo_update
+    {
+        std::uint64_t timestamp = 0; ///< nsecs since midnight, of the msg that moved it
+        pq bid;                      ///< {0, 0} without bids
+        pq ask;                      ///< {0, 0} without asks
+        std::uint16_t locate = 0;
+        std::uint8_t reserved[6] = {};
+
+        bool operator==(bbo_update const&) const noexcept = default;
+    };
+    static_assert(sizeof(bbo_update) == 32);
+
+    /// Parser handler that writes every bbo_update to a binary file, as
+    /// raw 32-byte records in host byte order with no header. Records
+    /// are buffered and written a block at a time.
+    class bbo_file_writer
+    {
+    private:
+        enum
+        {
+            /// records buffered between writes
+            BufferRecords = 4096
+        };
+
+    private:
+        std::FILE* file_ = nullptr;
+        std::unique_ptr<bbo_update[]> buf_;
+        std::size_t buffered_ = 0;
+        std::size_t count_ = 0;
+
+    public:
+        /// throws std::runtime_error if the file can't be opened
+        explicit bbo_file_writer(std::filesystem::path const&);
+        ~bbo_file_writer() noexcept;
+        bbo_file_writer(bbo_file_writer const&) noexcept = delete;
+        bbo_file_writer(bbo_file_writer&&) noexcept;
+        bbo_file_writer& operator=(bbo_file_writer const&) noexcept = delete;
+        bbo_file_writer& operator=(bbo_file_writer&&) noexcept = delete;
+
+        void
+        on_bbo(bbo_update const& u) noexcept
+        {
+            buf_[buffered_++] = u;
+            if (buffered_ == BufferRecords)
+                flush();
+        }
+
+        /// writes out the buffered records
+        void flush() noexcept;
+
+        /// records written (or buffered) so far
+        std::size_t count() const noexcept;
+    };
+
+} // namespace itch
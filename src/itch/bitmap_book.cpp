@@ -0,0 +1,439 @@
+#include "bitmap_book.hpp"
+#include "level_table.hpp" // handled_level
+#include "util/assert.hpp"
+#include <algorithm> // std::fill, std::max, std::reverse
+#include <cstdio>    // std::fprintf
+#include <cstdlib>   // std::abort
+#include <exception>
+#include <new> // placement new
+
+
+namespace { // unnamed
+
+    // allocate this many price levels in the memory pool
+    constexpr std::uint32_t NumPriceLevels = 50;
+
+    // allocate this many bitmap nodes in the node pools, a book near
+    // the inside only needs one or two
+    constexpr std::uint32_t NumLeaves = 4;
+    constexpr std::uint32_t NumMids = 2;
+
+    // prices are quoted in cents from $1 up, in 1/100 cents below
+    constexpr itch::price_t OneDollar = 10000;
+    constexpr itch::price_t PennyTick = 100;
+    constexpr itch::price_t SubPennyTick = 1;
+
+    constexpr std::uint64_t
+    bit(std::uint32_t i) noexcept
+    {
+        return std::uint64_t(1) << i;
+    }
+
+} // namespace
+
+
+namespace itch {
+
+    namespace detail {
+
+        template <Side S, typename Level>
+        price_bitmap<S, Level>::price_bitmap() noexcept
+                : pool_(sizeof(Level), NumPriceLevels)
+                , leaf_pool_(sizeof(leaf), NumLeaves)
+                , mid_pool_(sizeof(mid), NumMids)
+        {
+            // empty
+        }
+
+        template <Side S, typename Level>
+        price_level&
+        price_bitmap<S, Level>::find_or_add(price_t price) noexcept
+        {
+            // may throw, in which case we abort
+            try {
+                if (tick_ == 0) {
+                    // first level, the tick size follows the price and the
+                    // window is centered on it
+                    tick_ = (price >= OneDollar) ? PennyTick : SubPennyTick;
+                    std::int64_t const aligned = price - price % tick_;
+                    base_ = std::max<std::int64_t>(aligned - std::int64_t(Width / 2) * tick_, 0);
+                    root_ = std::make_unique<root>();
+                }
+
+                std::uint32_t const i = index_of(price);
+                if (i == NoIndex) {
+                    auto [itr, inserted] = overflow_.try_emplace(price, nullptr);
+                    if (inserted)
+                        itr->second = new (pool_.allocate_node()) Level(price, 0);
+                    return *itr->second;
+                }
+
+                std::uint32_t const i2 = i / (Fanout * Fanout);
+                std::uint32_t const i1 = i / Fanout % Fanout;
+                std::uint32_t const i0 = i % Fanout;
+
+                mid*& m = root_->children[i2];
+                if (m == nullptr) {
+                    m = new (mid_pool_.allocate_node()) mid();
+                    root_->bits |= bit(i2);
+                }
+                leaf*& l = m->children[i1];
+                if (l == nullptr) {
+                    l = new (leaf_pool_.allocate_node()) leaf();
+                    m->bits |= bit(i1);
+                }
+                price_level*& pl = l->children[i0];
+                if (pl == nullptr) {
+                    pl = new (pool_.allocate_node()) Level(price, 0);
+                    l->bits |= bit(i0);
+                    // indexes grow with the price
+                    if (best_ == NoIndex || better()(i, best_))
+                        best_ = i;
+                }
+                return *pl;
+            } catch (std::exception const& e) {
+                std::fprintf(
+                        stderr, "[ERROR] exception in %s: %s\n", __builtin_FUNCTION(), e.what());
+                std::abort();
+            }
+        }
+
+        template <Side S, typename Level>
+        void
+        price_bitmap<S, Level>::erase(price_level& pl) noexcept
+        {
+            std::uint32_t const i = index_of(pl.price());
+            if (i == NoIndex) {
+                DEBUG_ASSERT(overflow_.count(pl.price()) == 1);
+                overflow_.erase(pl.price());
+                pool_.deallocate_node(&pl);
+                return;
+            }
+
+            std::uint32_t const i2 = i / (Fanout * Fanout);
+            std::uint32_t const i1 = i / Fanout % Fanout;
+            std::uint32_t const i0 = i % Fanout;
+
+            // free the nodes that empty out, so set bits never lead to
+            // an empty subtree
+            mid* m = root_->children[i2];
+            leaf* l = m->children[i1];
+            DEBUG_ASSERT(l->children[i0] == &pl);
+            l->children[i0] = nullptr;
+            l->bits &= ~bit(i0);
+            if (l->bits == 0) {
+                leaf_pool_.deallocate_node(l);
+                m->children[i1] = nullptr;
+                m->bits &= ~bit(i1);
+                if (m->bits == 0) {
+                    mid_pool_.deallocate_node(m);
+                    root_->children[i2] = nullptr;
+                    root_->bits &= ~bit(i2);
+                }
+            }
+            pool_.deallocate_node(&pl);
+
+            if (i == best_)
+                best_ = find_best();
+        }
+
+        template <Side S, typename Level>
+        price_level const*
+        price_bitmap<S, Level>::best() const noexcept
+        {
+            price_level const* pl = at(best_);
+            if (!overflow_.empty()) {
+                price_level const* o = overflow_.begin()->second;
+                if (pl == nullptr || better()(o->price(), pl->price()))
+                    pl = o;
+            }
+            return pl;
+        }
+
+        template <Side S, typename Level>
+        std::vector<price_level>
+        price_bitmap<S, Level>::levels() const
+        {
+            // window levels in index (ascending price) order
+            std::vector<price_level const*> window;
+            for (std::uint64_t b2 = root_ ? root_->bits : 0; b2 != 0; b2 &= b2 - 1) {
+                mid const* m = root_->children[__builtin_ctzll(b2)];
+                for (std::uint64_t b1 = m->bits; b1 != 0; b1 &= b1 - 1) {
+                    leaf const* l = m->children[__builtin_ctzll(b1)];
+                    for (std::uint64_t b0 = l->bits; b0 != 0; b0 &= b0 - 1)
+                        window.push_back(l->children[__builtin_ctzll(b0)]);
+                }
+            }
+            if constexpr (S == Side::Bid)
+                std::reverse(window.begin(), window.end());
+
+            // both are in best-first order, overflow levels may be
+            // interleaved with the window's (off the tick grid)
+            std::vector<price_level> v;
+            v.reserve(window.size() + overflow_.size());
+            auto itr = overflow_.begin();
+            for (price_level const* pl : window) {
+                for (; itr != overflow_.end() && better()(itr->first, pl->price()); ++itr)
+                    v.push_back(*itr->second);
+                v.push_back(*pl);
+            }
+            for (; itr != overflow_.end(); ++itr)
+                v.push_back(*itr->second);
+
+            return v;
+        }
+
+        template <Side S, typename Level>
+        void
+        price_bitmap<S, Level>::depth(std::span<pq> out) const noexcept
+        {
+            std::size_t n = 0;
+            auto put = [&out, &n](price_level const* pl) noexcept {
+                out[n++] = {pl->price(), pl->agg_qty()};
+            };
+
+            // merged as in levels(), but walking the window best first
+            // and stopping once out is full
+            auto itr = overflow_.begin();
+            for (std::uint64_t b2 = root_ ? root_->bits : 0; b2 != 0; b2 &= ~(1ULL << pick(b2))) {
+                mid const* m = root_->children[pick(b2)];
+                for (std::uint64_t b1 = m->bits; b1 != 0; b1 &= ~(1ULL << pick(b1))) {
+                    leaf const* l = m->children[pick(b1)];
+                    for (std::uint64_t b0 = l->bits; b0 != 0; b0 &= ~(1ULL << pick(b0))) {
+                        price_level const* pl = l->children[pick(b0)];
+                        for (; itr != overflow_.end() && better()(itr->first, pl->price());
+                                ++itr) {
+                            if (n == out.size())
+                                return;
+                            put(itr->second);
+                        }
+                        if (n == out.size())
+                            return;
+                        put(pl);
+                    }
+                }
+            }
+            for (; itr != overflow_.end() && n < out.size(); ++itr)
+                put(itr->second);
+            std::fill(out.begin() + n, out.end(), pq());
+        }
+
+        template <Side S, typename Level>
+        std::size_t
+        price_bitmap<S, Level>::max_levels() const noexcept
+        {
+            return pool_.max_used();
+        }
+
+        // private
+
+        /// the window index for a price, or NoIndex if it has none
+        template <Side S, typename Level>
+        std::uint32_t
+        price_bitmap<S, Level>::index_of(price_t price) const noexcept
+        {
+            std::int64_t const distance = std::int64_t(price) - base_;
+            if (tick_ == 0 || distance < 0 || distance % tick_ != 0)
+                return NoIndex;
+
+            std::int64_t const i = distance / tick_;
+            return (i < std::int64_t(Width)) ? static_cast<std::uint32_t>(i) : NoIndex;
+        }
+
+        template <Side S, typename Level>
+        price_level*
+        price_bitmap<S, Level>::at(std::uint32_t i) const noexcept
+        {
+            if (i == NoIndex)
+                return nullptr;
+
+            mid const* m = root_->children[i / (Fanout * Fanout)];
+            leaf const* l = m->children[i / Fanout % Fanout];
+            return l->children[i % Fanout];
+        }
+
+        /// the best populated index, walking down from the root: the
+        /// highest set bit of each node for bids, the lowest for asks
+        template <Side S, typename Level>
+        std::uint32_t
+        price_bitmap<S, Level>::find_best() const noexcept
+        {
+            if (root_->bits == 0)
+                return NoIndex;
+
+            std::uint32_t const i2 = pick(root_->bits);
+            mid const* m = root_->children[i2];
+            std::uint32_t const i1 = pick(m->bits);
+            leaf const* l = m->children[i1];
+            std::uint32_t const i0 = pick(l->bits);
+            return (i2 * Fanout + i1) * Fanout + i0;
+        }
+
+        /// the best set bit
+        template <Side S, typename Level>
+        std::uint32_t
+        price_bitmap<S, Level>::pick(std::uint64_t bits) noexcept
+        {
+            if constexpr (S == Side::Bid)
+                return 63 - __builtin_clzll(bits);
+            else
+                return __builtin_ctzll(bits);
+        }
+
+        template class price_bitmap<Side::Bid, price_level>;
+        template class price_bitmap<Side::Bid, handled_level>;
+        template class price_bitmap<Side::Ask, price_level>;
+        template class price_bitmap<Side::Ask, handled_level>;
+
+    } // namespace detail
+
+    template <typename Level>
+    basic_bitmap_book<Level>::basic_bitmap_book() noexcept
+            : bids_()
+            , asks_()
+    {
+        // empty
+    }
+
+    template <typename Level>
+    void
+    basic_bitmap_book<Level>::add_order(order& order) noexcept
+    {
+        price_level& pl = (order.side == Side::Bid) ? bids_.find_or_add(order.price)
+                                                    : asks_.find_or_add(order.price);
+        pl.inc_qty(order.qty);
+        order.pl = &pl;
+    }
+
+    template <typename Level>
+    void
+    basic_bitmap_book<Level>::delete_order(order& order) noexcept
+    {
+        DEBUG_ASSERT(order.pl != nullptr);
+        if (order.pl == nullptr)
+            return;
+
+        DEBUG_ASSERT(order.qty <= order.pl->agg_qty());
+
+        // decrease qty on price level, if it goes to zero, delete the level
+        if (order.qty < order.pl->agg_qty()) {
+            order.pl->dec_qty(order.qty);
+        } else if (order.side == Side::Bid) {
+            bids_.erase(*order.pl);
+        } else {
+            asks_.erase(*order.pl);
+        }
+
+        order.clear();
+    }
+
+    template <typename Level>
+    void
+    basic_bitmap_book<Level>::cancel_order(order& order, qty_t remove_qty) noexcept
+    {
+        DEBUG_ASSERT(remove_qty <= order.qty);
+
+        if (remove_qty < order.qty) {
+            order.qty -= remove_qty;
+            order.pl->dec_qty(remove_qty);
+        } else {
+            // this cancel will remove the order (may happen if caused
+            // by an execution)
+            delete_order(order);
+        }
+    }
+
+    template <typename Level>
+    void
+    basic_bitmap_book<Level>::replace_order(order& old_order, order& new_order) noexcept
+    {
+        DEBUG_ASSERT(old_order.pl != nullptr);
+        DEBUG_ASSERT(new_order.pl == nullptr);
+
+        delete_order(old_order);
+        DEBUG_ASSERT(old_order.pl == nullptr);
+
+        add_order(new_order);
+        DEBUG_ASSERT(new_order.pl != nullptr);
+    }
+
+    template <typename Level>
+    std::vector<price_level>
+    basic_bitmap_book<Level>::bids() const
+    {
+        return bids_.levels();
+    }
+
+    template <typename Level>
+    std::vector<price_level>
+    basic_bitmap_book<Level>::asks() const
+    {
+        return asks_.levels();
+    }
+
+    template <typename Level>
+    pq
+    basic_bitmap_book<Level>::best_bid() const noexcept
+    {
+        price_level const* pl = bids_.best();
+        if (pl == nullptr)
+            return {0, 0};
+
+        return {pl->price(), pl->agg_qty()};
+    }
+
+    template <typename Level>
+    pq
+    basic_bitmap_book<Level>::best_ask() const noexcept
+    {
+        price_level const* pl = asks_.best();
+        if (pl == nullptr)
+            return {0, 0};
+
+        return {pl->price(), pl->agg_qty()};
+    }
+
+    template <typename Level>
+    void
+    basic_bitmap_book<Level>::depth(
+            std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept
+    {
+        DEBUG_ASSERT(n <= bids.size() && n <= asks.size());
+
+        bids_.depth(bids.first(n));
+        asks_.depth(asks.first(n));
+    }
+
+    template <typename Level>
+    std::size_t
+    basic_bitmap_book<Level>::max_bid_book_depth() const noexcept
+    {
+        return bids_.max_levels();
+    }
+
+    template <typename Level>
+    std::size_t
+    basic_bitmap_book<Level>::max_ask_book_depth() const noexcept
+    {
+        return asks_.max_levels();
+    }
+
+    template <typename Level>
+    std::size_t
+    basic_bitmap_book<Level>::max_bid_order_depth() const noexcept
+    {
+        return max_bid_order_depth_;
+    }
+
+    template <typename Level>
+    std::size_t
+    basic_bitmap_book<Level>::max_ask_order_depth() const noexcept
+    {
+        return max_ask_order_depth_;
+    }
+
+    // explicit instantiations
+    template class basic_bitmap_book<price_level>;
+    template class basic_bitmap_book<handled_level>;
+
+} // namespace itch
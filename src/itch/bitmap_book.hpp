@@ -0,0 +1,130 @@
+#pragma once
+
+#include "core.hpp"
+#include "price_level.hpp"
+#include "allocator/memory_pool.hpp"
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <functional> // std::greater, std::less
+#include <map>
+#include <memory>      // std::unique_ptr
+#include <span>
+#include <type_traits> // std::conditional_t
+#include <vector>
+
+
+namespace itch {
+
+    namespace detail {
+
+        /// One side of a bitmap_book.
+        ///
+        /// Levels on the tick grid within a window of Width ticks are
+        /// indexed by a three-level, 64-ary tree of occupancy bitmaps: a
+        /// bit is set in a node if the child (or, in a leaf, the level)
+        /// under it is populated. Nodes are allocated when their first
+        /// level is added and freed with their last one, so every set bit
+        /// leads to a level and the best level is found from the root
+        /// with one lzcnt (bids) or tzcnt (asks) per tree level, however
+        /// many levels were just swept.
+        ///
+        /// The window is anchored around the first price added and never
+        /// moves. Levels outside it, or off the tick grid, go to a sorted
+        /// overflow map.
+        template <Side S, typename Level = price_level>
+        class price_bitmap
+        {
+        public:
+            static constexpr std::uint32_t Fanout = 64;
+            /// ticks covered by the window
+            static constexpr std::uint32_t Width = Fanout * Fanout * Fanout;
+
+        private:
+            static constexpr std::uint32_t NoIndex = Width;
+            using better = std::conditional_t<S == Side::Bid, std::greater<>, std::less<>>;
+
+            template <typename Child>
+            struct node
+            {
+                std::uint64_t bits = 0;
+                Child* children[Fanout] = {};
+            };
+            using leaf = node<price_level>;
+            using mid = node<leaf>;
+            using root = node<mid>;
+
+        private:
+            memory_pool pool_;      ///< price_levels
+            memory_pool leaf_pool_;
+            memory_pool mid_pool_;
+            std::unique_ptr<root> root_; ///< allocated when first anchored
+            std::int64_t base_ = 0;      ///< price of index 0
+            price_t tick_ = 0;
+            std::uint32_t best_ = NoIndex;
+            std::map<price_t, price_level*, better> overflow_;
+
+        public:
+            price_bitmap() noexcept;
+
+            /// returns the level at price, creating it (with 0 qty) if
+            /// there isn't one
+            price_level& find_or_add(price_t) noexcept;
+
+            /// erases a level and frees it
+            void erase(price_level&) noexcept;
+
+            price_level const* best() const noexcept;
+
+            /// all levels, best first
+            std::vector<price_level> levels() const;
+
+            /// copies the best out.size() levels to out, {0, 0} past the
+            /// last one
+            void depth(std::span<pq> out) const noexcept;
+
+            std::size_t max_levels() const noexcept;
+
+        private:
+            std::uint32_t index_of(price_t) const noexcept;
+            price_level* at(std::uint32_t index) const noexcept;
+            std::uint32_t find_best() const noexcept;
+            static std::uint32_t pick(std::uint64_t bits) noexcept;
+        };
+
+    } // namespace detail
+
+    /// Two-sided book on hierarchical occupancy bitmaps, see
+    /// detail::price_bitmap.
+    template <typename Level = price_level>
+    class basic_bitmap_book
+    {
+    private:
+        detail::price_bitmap<Side::Bid, Level> bids_;
+        detail::price_bitmap<Side::Ask, Level> asks_;
+        std::size_t max_bid_order_depth_ = 0; ///< stats only
+        std::size_t max_ask_order_depth_ = 0; ///< stats only
+
+    public:
+        basic_bitmap_book() noexcept;
+        void add_order(order&) noexcept;
+        void delete_order(order&) noexcept;
+        void cancel_order(order&, qty_t remove_qty) noexcept;
+        void replace_order(order& old_order, order& new_order) noexcept;
+
+        // accessors
+    public:
+        /// snapshots of the levels, best first. not for the hot path
+        std::vector<price_level> bids() const;
+        std::vector<price_level> asks() const;
+        pq best_bid() const noexcept;
+        pq best_ask() const noexcept;
+        void depth(std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept;
+        std::size_t max_bid_book_depth() const noexcept;
+        std::size_t max_ask_book_depth() const noexcept;
+        std::size_t max_bid_order_depth() const noexcept;
+        std::size_t max_ask_order_depth() const noexcept;
+    };
+
+    using bitmap_book = basic_bitmap_book<>;
+
+} // namespace itch
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "core.hpp"
+#include "price_level.hpp"
+#include <algorithm> // std::fill
+#include <concepts>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <span>
+#include <type_traits> // std::is_trivially_destructible_v
+
+
+namespace itch {
+
+    namespace detail {
+
+        template <typename B>
+        struct book_order
+        {
+            using type = order;
+        };
+
+        template <typename B>
+            requires requires { typename B::order_type; }
+        struct book_order<B>
+        {
+            using type = typename B::order_type;
+        };
+
+        /// copies the first out.size() levels of a best-first range of
+        /// price_levels to out, {0, 0} past the last one
+        template <typename Levels>
+        void
+        fill_depth(Levels&& levels, std::span<pq> out) noexcept
+        {
+            std::size_t n = 0;
+            for (price_level const& pl : levels) {
+                if (n == out.size())
+                    break;
+                out[n++] = {pl.price(), pl.agg_qty()};
+            }
+            std::fill(out.begin() + n, out.end(), pq());
+        }
+
+        template <typename B, typename Level>
+        struct rebind_level;
+
+        template <template <typename> class B, typename Old, typename Level>
+        struct rebind_level<B<Old>, Level>
+        {
+            using type = B<Level>;
+        };
+
+        /// book_pools_t of a book that doesn't share pools
+        struct no_shared_pools
+        {};
+
+        template <typename B>
+        struct book_pools
+        {
+            using type = no_shared_pools;
+        };
+
+        template <typename B>
+            requires requires { typename B::shared_pools; }
+        struct book_pools<B>
+        {
+            using type = typename B::shared_pools;
+        };
+
+    } // namespace detail
+
+    /// the pools a book can share with other books: B::shared_pools if it
+    /// declares one (e.g. mp_book), an empty placeholder otherwise
+    template <typename B>
+    using book_pools_t = typename detail::book_pools<B>::type;
+
+    /// the order type a book works on: B::order_type if it declares one
+    /// (e.g. l3_order, or compact_order for a compact_book), order
+    /// otherwise
+    template <typename B>
+    using book_order_t = typename detail::book_order<B>::type;
+
+    /// What parser and order_store need from a book's order type: an
+    /// order or a type derived from it, or a compact_order. Slots are
+    /// value initialized and cleared in place, never destroyed.
+    // clang-format off
+    template <typename O>
+    concept BookOrder = std::is_trivially_destructible_v<O>
+            && std::default_initializable<O>
+            && std::constructible_from<O, Side, price_t, qty_t>
+            && requires(O& o, O const& co, std::uint64_t ts) {
+                { order_price(co) } noexcept -> std::same_as<price_t>;
+                { order_side(co) } noexcept -> std::same_as<Side>;
+                { set_order_ts(o, ts) } noexcept;
+                { co.qty } -> std::convertible_to<qty_t>;
+                { o.clear() } noexcept;
+            };
+    // clang-format on
+
+    /// a book B<price_level> keeping its levels as Level instead, e.g.
+    /// mp_book as basic_mp_book<handled_level>
+    template <typename B, typename Level>
+    using rebind_level_t = typename detail::rebind_level<B, Level>::type;
+
+    /// Book Interface, what instrument and parser need from a book.
+    ///
+    /// A book is default constructed once per instrument and then only
+    /// sees orders that live in an order_store, so an order (and its
+    /// price level pointer) stays put from add to delete. delete_order
+    /// clears the order it takes out, and a level is erased once the
+    /// last qty on it is taken out (see compact_book). bids() and asks() list the levels
+    /// best first, as a container or a snapshot; they are meant for
+    /// tests and tools, not the hot path. depth(n, bids, asks) copies
+    /// the best n levels of each side into the caller's buffers, with
+    /// {0, 0} past the last level, and doesn't allocate.
+    // clang-format off
+    template <typename B>
+    concept Book = std::default_initializable<B>
+            && BookOrder<book_order_t<B>>
+            && requires(B& b, B const& cb, book_order_t<B>& o, qty_t qty, std::size_t n,
+                    std::span<pq> levels) {
+                { b.add_order(o) } noexcept;
+                { b.delete_order(o) } noexcept;
+                { b.cancel_order(o, qty) } noexcept;
+                { b.replace_order(o, o) } noexcept;
+
+                // accessors
+                cb.bids();
+                cb.asks();
+                { cb.best_bid() } noexcept -> std::same_as<pq>;
+                { cb.best_ask() } noexcept -> std::same_as<pq>;
+                { cb.depth(n, levels, levels) } noexcept;
+
+                // stats
+                { cb.max_bid_book_depth() } noexcept -> std::convertible_to<std::size_t>;
+                { cb.max_ask_book_depth() } noexcept -> std::convertible_to<std::size_t>;
+                { cb.max_bid_order_depth() } noexcept -> std::convertible_to<std::size_t>;
+                { cb.max_ask_order_depth() } noexcept -> std::convertible_to<std::size_t>;
+            };
+    // clang-format on
+
+    /// A Book that can also be built on pools shared with other books of
+    /// the same kind, B(book_pools_t<B>&), which must outlive it
+    template <typename B>
+    concept SharedPoolBook = Book<B> && std::constructible_from<B, book_pools_t<B>&>;
+
+} // namespace itch
@@ -0,0 +1,157 @@
+#include "btree_book.hpp"
+#include "level_table.hpp" // handled_level
+#include "util/assert.hpp"
+
+
+namespace itch {
+
+    template <typename Level>
+    basic_btree_book<Level>::basic_btree_book() noexcept
+            : bids_()
+            , asks_()
+    {
+        // empty
+    }
+
+    template <typename Level>
+    void
+    basic_btree_book<Level>::add_order(order& order) noexcept
+    {
+        price_level& pl = (order.side == Side::Bid) ? bids_.find_or_add(order.price)
+                                                    : asks_.find_or_add(order.price);
+        pl.inc_qty(order.qty);
+        order.pl = &pl;
+    }
+
+    template <typename Level>
+    void
+    basic_btree_book<Level>::delete_order(order& order) noexcept
+    {
+        DEBUG_ASSERT(order.pl != nullptr);
+        if (order.pl == nullptr)
+            return;
+
+        DEBUG_ASSERT(order.qty <= order.pl->agg_qty());
+
+        // decrease qty on price level, if it goes to zero, delete the level
+        if (order.qty < order.pl->agg_qty()) {
+            order.pl->dec_qty(order.qty);
+        } else if (order.side == Side::Bid) {
+            bids_.erase(static_cast<Level&>(*order.pl));
+        } else {
+            asks_.erase(static_cast<Level&>(*order.pl));
+        }
+
+        order.clear();
+    }
+
+    template <typename Level>
+    void
+    basic_btree_book<Level>::cancel_order(order& order, qty_t remove_qty) noexcept
+    {
+        DEBUG_ASSERT(remove_qty <= order.qty);
+
+        if (remove_qty < order.qty) {
+            order.qty -= remove_qty;
+            order.pl->dec_qty(remove_qty);
+        } else {
+            // this cancel will remove the order (may happen if caused
+            // by an execution)
+            delete_order(order);
+        }
+    }
+
+    template <typename Level>
+    void
+    basic_btree_book<Level>::replace_order(order& old_order, order& new_order) noexcept
+    {
+        DEBUG_ASSERT(old_order.pl != nullptr);
+        DEBUG_ASSERT(new_order.pl == nullptr);
+
+        delete_order(old_order);
+        DEBUG_ASSERT(old_order.pl == nullptr);
+
+        add_order(new_order);
+        DEBUG_ASSERT(new_order.pl != nullptr);
+    }
+
+    template <typename Level>
+    std::vector<price_level>
+    basic_btree_book<Level>::bids() const
+    {
+        return bids_.levels();
+    }
+
+    template <typename Level>
+    std::vector<price_level>
+    basic_btree_book<Level>::asks() const
+    {
+        return asks_.levels();
+    }
+
+    template <typename Level>
+    pq
+    basic_btree_book<Level>::best_bid() const noexcept
+    {
+        price_level const* pl = bids_.best();
+        if (pl == nullptr)
+            return {0, 0};
+
+        return {pl->price(), pl->agg_qty()};
+    }
+
+    template <typename Level>
+    pq
+    basic_btree_book<Level>::best_ask() const noexcept
+    {
+        price_level const* pl = asks_.best();
+        if (pl == nullptr)
+            return {0, 0};
+
+        return {pl->price(), pl->agg_qty()};
+    }
+
+    template <typename Level>
+    void
+    basic_btree_book<Level>::depth(
+            std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept
+    {
+        DEBUG_ASSERT(n <= bids.size() && n <= asks.size());
+
+        bids_.depth(bids.first(n));
+        asks_.depth(asks.first(n));
+    }
+
+    template <typename Level>
+    std::size_t
+    basic_btree_book<Level>::max_bid_book_depth() const noexcept
+    {
+        return bids_.max_levels();
+    }
+
+    template <typename Level>
+    std::size_t
+    basic_btree_book<Level>::max_ask_book_depth() const noexcept
+    {
+        return asks_.max_levels();
+    }
+
+    template <typename Level>
+    std::size_t
+    basic_btree_book<Level>::max_bid_order_depth() const noexcept
+    {
+        return max_bid_order_depth_;
+    }
+
+    template <typename Level>
+    std::size_t
+    basic_btree_book<Level>::max_ask_order_depth() const noexcept
+    {
+        return max_ask_order_depth_;
+    }
+
+    // explicit instantiations
+    template class basic_btree_book<price_level>;
+    template class basic_btree_book<handled_level>;
+
+} // namespace itch
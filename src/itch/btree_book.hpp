@@ -0,0 +1,46 @@
+#pragma once
+
+#include "core.hpp"
+#include "price_btree.hpp"
+#include "price_level.hpp"
+#include <cstddef> // std::size_t
+#include <span>
+#include <vector>
+
+
+namespace itch {
+
+    /// Two-sided book on B+trees, see detail::price_btree.
+    template <typename Level = price_level>
+    class basic_btree_book
+    {
+    private:
+        detail::price_btree<Side::Bid, Level> bids_;
+        detail::price_btree<Side::Ask, Level> asks_;
+        std::size_t max_bid_order_depth_ = 0; ///< stats only
+        std::size_t max_ask_order_depth_ = 0; ///< stats only
+
+    public:
+        basic_btree_book() noexcept;
+        void add_order(order&) noexcept;
+        void delete_order(order&) noexcept;
+        void cancel_order(order&, qty_t remove_qty) noexcept;
+        void replace_order(order& old_order, order& new_order) noexcept;
+
+        // accessors
+    public:
+        /// snapshots of the levels, best first. not for the hot path
+        std::vector<price_level> bids() const;
+        std::vector<price_level> asks() const;
+        pq best_bid() const noexcept;
+        pq best_ask() const noexcept;
+        void depth(std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept;
+        std::size_t max_bid_book_depth() const noexcept;
+        std::size_t max_ask_book_depth() const noexcept;
+        std::size_t max_bid_order_depth() const noexcept;
+        std::size_t max_ask_order_depth() const noexcept;
+    };
+
+    using btree_book = basic_btree_book<>;
+
+} // namespace itch
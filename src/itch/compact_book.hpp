@@ -0,0 +1,208 @@
+#pragma once
+
+#include "book.hpp"
+#include "core.hpp"
+#include "level_table.hpp"
+#include "price_level.hpp"
+#include "util/assert.hpp"
+#include <cstddef> // std::size_t
+#include <cstdio>  // std::fprintf
+#include <cstdlib> // std::abort
+#include <exception>
+#include <span>
+
+
+namespace itch {
+
+    /// A Book B taking compact_orders, so that a parser (and its
+    /// order_store) keeps 16-byte order slots rather than 32-byte ones.
+    ///
+    /// A compact_order references its price_level through a 32-bit
+    /// handle instead of a pointer, which the level_table kept here next
+    /// to the book resolves. The book is B on handled_levels, so a level
+    /// finds its own handle in O(1); B used with plain orders keeps bare
+    /// price_levels. Each update rebuilds the order around the level its
+    /// handle resolves to and goes through the book's order path. A
+    /// handle is released as the update takes the last qty off its
+    /// level, which is when a Book erases a level.
+    template <Book B, bool WithTimestamp = false>
+    class compact_book
+    {
+    public:
+        using book_type = rebind_level_t<B, handled_level>;
+        using order_type = compact_order<WithTimestamp>;
+
+    private:
+        book_type book_;
+        level_table levels_;
+
+    public:
+        void add_order(order_type&) noexcept;
+        void delete_order(order_type&) noexcept;
+        void cancel_order(order_type&, qty_t remove_qty) noexcept;
+        void replace_order(order_type& old_order, order_type& new_order) noexcept;
+
+        // accessors
+    public:
+        book_type const& book() const noexcept;
+        decltype(auto) bids() const;
+        decltype(auto) asks() const;
+        pq best_bid() const noexcept;
+        pq best_ask() const noexcept;
+        void depth(std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept;
+        price_level const* level(level_handle) const noexcept;
+        std::size_t max_bid_book_depth() const noexcept;
+        std::size_t max_ask_book_depth() const noexcept;
+        std::size_t max_bid_order_depth() const noexcept;
+        std::size_t max_ask_order_depth() const noexcept;
+    };
+
+    /**********************************************************************/
+
+    template <Book B, bool WithTimestamp>
+    void
+    compact_book<B, WithTimestamp>::add_order(order_type& co) noexcept
+    {
+        order o(co.side(), co.price(), co.qty);
+        book_.add_order(o);
+
+        // attach may throw, in which case we abort
+        try {
+            co.lh = levels_.attach(static_cast<handled_level&>(*o.pl));
+        } catch (std::exception const& e) {
+            std::fprintf(stderr, "[ERROR] exception in %s: %s\n", __builtin_FUNCTION(), e.what());
+            std::abort();
+        }
+    }
+
+    template <Book B, bool WithTimestamp>
+    void
+    compact_book<B, WithTimestamp>::delete_order(order_type& co) noexcept
+    {
+        DEBUG_ASSERT(co.lh != InvalidLevelHandle);
+        if (co.lh == InvalidLevelHandle)
+            return;
+
+        order o(co.side(), co.price(), co.qty);
+        o.pl = levels_[co.lh];
+
+        // the book erases the level as its last qty goes
+        if (o.qty >= o.pl->agg_qty())
+            levels_.release(co.lh);
+
+        book_.delete_order(o);
+        co.clear();
+    }
+
+    template <Book B, bool WithTimestamp>
+    void
+    compact_book<B, WithTimestamp>::cancel_order(order_type& co, qty_t remove_qty) noexcept
+    {
+        DEBUG_ASSERT(co.lh != InvalidLevelHandle);
+        DEBUG_ASSERT(remove_qty <= co.qty);
+
+        order o(co.side(), co.price(), co.qty);
+        o.pl = levels_[co.lh];
+
+        // the book erases the level as its last qty goes
+        if (remove_qty >= o.pl->agg_qty())
+            levels_.release(co.lh);
+
+        book_.cancel_order(o, remove_qty);
+        if (o.pl == nullptr)
+            co.clear();
+        else
+            co.qty = o.qty;
+    }
+
+    template <Book B, bool WithTimestamp>
+    void
+    compact_book<B, WithTimestamp>::replace_order(
+            order_type& old_order, order_type& new_order) noexcept
+    {
+        DEBUG_ASSERT(old_order.lh != InvalidLevelHandle);
+        DEBUG_ASSERT(new_order.lh == InvalidLevelHandle);
+
+        delete_order(old_order);
+        add_order(new_order);
+    }
+
+    template <Book B, bool WithTimestamp>
+    typename compact_book<B, WithTimestamp>::book_type const&
+    compact_book<B, WithTimestamp>::book() const noexcept
+    {
+        return book_;
+    }
+
+    template <Book B, bool WithTimestamp>
+    decltype(auto)
+    compact_book<B, WithTimestamp>::bids() const
+    {
+        return book_.bids();
+    }
+
+    template <Book B, bool WithTimestamp>
+    decltype(auto)
+    compact_book<B, WithTimestamp>::asks() const
+    {
+        return book_.asks();
+    }
+
+    template <Book B, bool WithTimestamp>
+    pq
+    compact_book<B, WithTimestamp>::best_bid() const noexcept
+    {
+        return book_.best_bid();
+    }
+
+    template <Book B, bool WithTimestamp>
+    pq
+    compact_book<B, WithTimestamp>::best_ask() const noexcept
+    {
+        return book_.best_ask();
+    }
+
+    template <Book B, bool WithTimestamp>
+    void
+    compact_book<B, WithTimestamp>::depth(
+            std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept
+    {
+        book_.depth(n, bids, asks);
+    }
+
+    template <Book B, bool WithTimestamp>
+    price_level const*
+    compact_book<B, WithTimestamp>::level(level_handle h) const noexcept
+    {
+        return levels_[h];
+    }
+
+    template <Book B, bool WithTimestamp>
+    std::size_t
+    compact_book<B, WithTimestamp>::max_bid_book_depth() const noexcept
+    {
+        return book_.max_bid_book_depth();
+    }
+
+    template <Book B, bool WithTimestamp>
+    std::size_t
+    compact_book<B, WithTimestamp>::max_ask_book_depth() const noexcept
+    {
+        return book_.max_ask_book_depth();
+    }
+
+    template <Book B, bool WithTimestamp>
+    std::size_t
+    compact_book<B, WithTimestamp>::max_bid_order_depth() const noexcept
+    {
+        return book_.max_bid_order_depth();
+    }
+
+    template <Book B, bool WithTimestamp>
+    std::size_t
+    compact_book<B, WithTimestamp>::max_ask_order_depth() const noexcept
+    {
+        return book_.max_ask_order_depth();
+    }
+
+} // namespace itch
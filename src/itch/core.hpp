@@ -2,7 +2,8 @@
 
 #include <cstdint>
 #include <limits>
-#include <utility> // std::move
+#include <type_traits> // std::conditional_t
+#include <utility>     // std::move
 
 
 namespace itch {
@@ -41,6 +42,13 @@ namespace itch {
         constexpr bool operator==(pq const&) const noexcept = default;
     };
 
+    /// handle to a price_level, resolved through the level_table of the
+    /// compact_book that owns it
+    using level_handle = std::uint32_t;
+
+    /// handle value of an order not (yet) on a price_level
+    constexpr level_handle InvalidLevelHandle = std::numeric_limits<level_handle>::max();
+
     class price_level; // forward dec
 
     struct order
@@ -78,6 +86,73 @@ namespace itch {
         }
     };
 
+    /// stand-in for compact_order::ts when timestamps aren't stored
+    struct no_timestamp
+    {
+        constexpr bool operator==(no_timestamp const&) const noexcept = default;
+    };
+
+    /// Compact alternative to order.
+    ///
+    /// itch prices never use the top bit of a price_t, so the side is
+    /// packed into it, and the price_level is referenced by a 32-bit
+    /// handle from the book instead of a pointer. Without a timestamp
+    /// this is 16 bytes (four to a cache line, never straddling one)
+    /// rather than 32.
+    template <bool WithTimestamp = false>
+    struct alignas(WithTimestamp ? alignof(std::uint64_t) : 16) compact_order
+    {
+    private:
+        static constexpr std::uint32_t SideBit = std::uint32_t(1) << 31;
+
+    private:
+        std::uint32_t price_side_ = 0;
+
+    public:
+        qty_t qty = 0;
+        level_handle lh = InvalidLevelHandle;
+        [[no_unique_address]] std::conditional_t<WithTimestamp, std::uint64_t, no_timestamp>
+                ts{}; ///< nsecs since epoch, if enabled
+
+    public:
+        constexpr compact_order(Side s, price_t p, qty_t q) noexcept
+                : price_side_((s == Side::Ask ? SideBit : 0) | p)
+                , qty(q)
+        {
+            // empty
+        }
+
+        constexpr compact_order() noexcept = default;
+        bool operator==(compact_order const&) const noexcept = default;
+
+        constexpr price_t
+        price() const noexcept
+        {
+            return price_side_ & ~SideBit;
+        }
+
+        constexpr Side
+        side() const noexcept
+        {
+            return (price_side_ & SideBit) ? Side::Ask : Side::Bid;
+        }
+
+        constexpr void
+        set(Side s, price_t p) noexcept
+        {
+            price_side_ = (s == Side::Ask ? SideBit : 0) | p;
+        }
+
+        void
+        clear() noexcept
+        {
+            price_side_ = 0;
+            qty = 0;
+            lh = InvalidLevelHandle;
+            ts = {};
+        }
+    };
+
     enum class MarketState : std::uint8_t
     {
         // clang-format off
@@ -104,6 +179,50 @@ namespace itch {
 
     /**********************************************************************/
 
+    /// Field access that works the same on an order (or an order type
+    /// derived from it) and a compact_order, for code such as parser
+    /// that takes either as a book's order type, see book_order_t.
+    constexpr price_t
+    order_price(order const& o) noexcept
+    {
+        return o.price;
+    }
+
+    template <bool WithTimestamp>
+    constexpr price_t
+    order_price(compact_order<WithTimestamp> const& o) noexcept
+    {
+        return o.price();
+    }
+
+    constexpr Side
+    order_side(order const& o) noexcept
+    {
+        return o.side;
+    }
+
+    template <bool WithTimestamp>
+    constexpr Side
+    order_side(compact_order<WithTimestamp> const& o) noexcept
+    {
+        return o.side();
+    }
+
+    /// sets the timestamp of an order, if it stores one
+    constexpr void
+    set_order_ts(order& o, std::uint64_t ts) noexcept
+    {
+        o.ts = ts;
+    }
+
+    template <bool WithTimestamp>
+    constexpr void
+    set_order_ts(compact_order<WithTimestamp>& o, [[maybe_unused]] std::uint64_t ts) noexcept
+    {
+        if constexpr (WithTimestamp)
+            o.ts = ts;
+    }
+
     /// converts nasdaq integer price to human readable floating point
     constexpr inline double
     to_hr_price(price_t p) noexcept
@@ -0,0 +1,69 @@
+#include "depth.hpp"
+#include <fmt/format.h>
+#include <algorithm> // std::max
+#include <cerrno>
+#include <cstring> // std::strerror
+#include <limits>
+#include <stdexcept>
+
+
+namespace itch {
+
+    depth_file_writer::depth_file_writer(std::filesystem::path const& fpath, std::size_t levels)
+            : levels_(levels)
+            , record_size_(sizeof(depth_header) / sizeof(pq) + 2 * levels)
+            , buffer_size_(std::max<std::size_t>(BufferBytes / sizeof(pq) / record_size_, 1)
+                      * record_size_)
+    {
+        if (levels == 0 || levels > std::numeric_limits<std::uint16_t>::max())
+            throw std::invalid_argument(
+                    fmt::format("{}: invalid depth levels: {}", __builtin_FUNCTION(), levels));
+
+        buf_ = std::make_unique<pq[]>(buffer_size_);
+        file_ = std::fopen(fpath.c_str(), "wb");
+        if (file_ == nullptr)
+            throw std::runtime_error(fmt::format("{}: failed to open file: {} [{}]",
+                    __builtin_FUNCTION(), fpath.c_str(), std::strerror(errno)));
+    }
+
+    depth_file_writer::~depth_file_writer() noexcept
+    {
+        if (file_ == nullptr)
+            return;
+
+        flush();
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+
+    void
+    depth_file_writer::flush() noexcept
+    {
+        if (buffered_ == 0)
+            return;
+
+        if (std::fwrite(buf_.get(), sizeof(pq), buffered_, file_) != buffered_)
+            std::fprintf(stderr, "[ERROR] %s: write failed: %s\n", __builtin_FUNCTION(),
+                    std::strerror(errno));
+        buffered_ = 0;
+    }
+
+    std::size_t
+    depth_file_writer::levels() const noexcept
+    {
+        return levels_;
+    }
+
+    std::size_t
+    depth_file_writer::record_bytes() const noexcept
+    {
+        return record_size_ * sizeof(pq);
+    }
+
+    std::size_t
+    depth_file_writer::count() const noexcept
+    {
+        return count_;
+    }
+
+} // namespace itch
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "book.hpp"
+#include "core.hpp"
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cstdio>  // std::FILE
+#include <cstring> // std::memcpy
+#include <filesystem>
+#include <memory> // std::unique_ptr
+
+
+namespace itch {
+
+    /// Header of a depth file record, followed by levels bid pqs and
+    /// then levels ask pqs, best first, {0, 0} past the last level.
+    struct depth_header
+    {
+        std::uint64_t timestamp = 0; ///< nsecs since midnight
+        std::uint16_t locate = 0;
+        std::uint16_t levels = 0;
+        std::uint8_t reserved[4] = {};
+    };
+    static_assert(sizeof(depth_header) == 2 * sizeof(pq));
+
+    /// Writes depth snapshots of books to a binary file, as fixed-width
+    /// records (a depth_header and 2 * levels pqs) in host byte order
+    /// with no file header. Books copy their levels straight into the
+    /// write buffer, so a snapshot doesn't allocate.
+    class depth_file_writer
+    {
+    private:
+        enum
+        {
+            /// bytes buffered between writes, rounded down to whole records
+            BufferBytes = 64 * 1024
+        };
+
+    private:
+        std::FILE* file_ = nullptr;
+        std::size_t levels_;
+        std::size_t record_size_; ///< in pqs
+        std::size_t buffer_size_; ///< in pqs
+        std::unique_ptr<pq[]> buf_;
+        std::size_t buffered_ = 0; ///< in pqs
+        std::size_t count_ = 0;
+
+    public:
+        /// throws std::invalid_argument unless 0 < levels <= 65535, and
+        /// std::runtime_error if the file can't be opened
+        depth_file_writer(std::filesystem::path const&, std::size_t levels);
+        ~depth_file_writer() noexcept;
+        depth_file_writer(depth_file_writer const&) noexcept = delete;
+        depth_file_writer(depth_file_writer&&) noexcept = delete;
+        depth_file_writer& operator=(depth_file_writer const&) noexcept = delete;
+        depth_file_writer& operator=(depth_file_writer&&) noexcept = delete;
+
+        /// writes a record of the book's best levels
+        template <Book B>
+        inline void write(std::uint64_t timestamp, std::uint16_t locate, B const&) noexcept;
+
+        /// writes out the buffered records
+        void flush() noexcept;
+
+        /// levels per side in a record
+        std::size_t levels() const noexcept;
+
+        /// bytes per record
+        std::size_t record_bytes() const noexcept;
+
+        /// records written (or buffered) so far
+        std::size_t count() const noexcept;
+    };
+
+    /**********************************************************************/
+
+    template <Book B>
+    void
+    depth_file_writer::write(std::uint64_t timestamp, std::uint16_t locate, B const& book) noexcept
+    {
+        depth_header const h{timestamp, locate, static_cast<std::uint16_t>(levels_)};
+        pq* const rec = buf_.get() + buffered_;
+        std::memcpy(static_cast<void*>(rec), &h, sizeof(h));
+
+        pq* const bids = rec + sizeof(h) / sizeof(pq);
+        book.depth(levels_, {bids, levels_}, {bids + levels_, levels_});
+
+        buffered_ += record_size_;
+        ++count_;
+        if (buffered_ == buffer_size_)
+            flush();
+    }
+
+} // namespace itch
@@ -0,0 +1,202 @@
+#include "extract.hpp"
+#include <immintrin.h>
+#include <algorithm> // std::min
+#include <cstddef> // offsetof, std::size_t
+
+
+namespace itch {
+
+    namespace { // unnamed
+
+        /// a field to move: bytes at offset src of the msg (big-endian)
+        /// go to offset dst of order_fields (little-endian)
+        struct field_move
+        {
+            std::size_t dst;
+            std::size_t src;
+            std::size_t size;
+        };
+
+        /// pshufb control for one N-byte store
+        template <std::size_t N>
+        struct shuffle_ctl
+        {
+            alignas(N) std::int8_t b[N];
+        };
+
+        /// Builds the control that shuffles an N-byte load from msg offset
+        /// src_base into the N bytes of order_fields at dst_base, moving
+        /// the fields that fall into them and zeroing the rest. pshufb
+        /// can't cross 16-byte lanes, so a field must sit in the same
+        /// lane of the load as of the store (this fails to compile if not).
+        template <std::size_t N, std::size_t M>
+        constexpr shuffle_ctl<N>
+        make_ctl(std::size_t dst_base, std::size_t src_base, field_move const (&moves)[M])
+        {
+            shuffle_ctl<N> c = {};
+            for (auto& b : c.b)
+                b = -128;
+
+            for (field_move const& mv : moves) {
+                if (mv.dst < dst_base || mv.dst + mv.size > dst_base + N)
+                    continue;
+                for (std::size_t k = 0; k < mv.size; ++k) {
+                    std::size_t const d = mv.dst - dst_base + k;
+                    std::size_t const s = mv.src + mv.size - 1 - k;
+                    std::size_t const lane = d / 16 * 16;
+                    if (s < src_base + lane || s >= src_base + lane + 16)
+                        throw "field crosses a 16-byte lane";
+                    c.b[d] = static_cast<std::int8_t>(s - src_base - lane);
+                }
+            }
+            return c;
+        }
+
+        // clang-format off
+        constexpr field_move AddOrderMoves[] = {
+            {offsetof(order_fields, timestamp), offsetof(add_order, timestamp), 6},
+            {offsetof(order_fields, oid), offsetof(add_order, order_reference_number), 8},
+            {offsetof(order_fields, price), offsetof(add_order, price), 4},
+            {offsetof(order_fields, qty), offsetof(add_order, shares), 4}};
+
+        constexpr field_move OrderExecutedMoves[] = {
+            {offsetof(order_fields, timestamp), offsetof(order_executed, timestamp), 6},
+            {offsetof(order_fields, oid), offsetof(order_executed, order_reference_number), 8},
+            {offsetof(order_fields, aux), offsetof(order_executed, match_number), 8},
+            {offsetof(order_fields, qty), offsetof(order_executed, executed_shares), 4}};
+
+        constexpr field_move OrderDeleteMoves[] = {
+            {offsetof(order_fields, timestamp), offsetof(order_delete, timestamp), 6},
+            {offsetof(order_fields, oid), offsetof(order_delete, order_reference_number), 8}};
+
+        constexpr field_move OrderReplaceMoves[] = {
+            {offsetof(order_fields, timestamp), offsetof(order_replace, timestamp), 6},
+            {offsetof(order_fields, oid), offsetof(order_replace, original_order_reference_number), 8},
+            {offsetof(order_fields, aux), offsetof(order_replace, new_order_reference_number), 8},
+            {offsetof(order_fields, price), offsetof(order_replace, price), 4},
+            {offsetof(order_fields, qty), offsetof(order_replace, shares), 4}};
+        // clang-format on
+
+        static_assert(offsetof(order_fields, timestamp) == 0);
+        static_assert(offsetof(order_fields, aux) == 16);
+        static_assert(offsetof(order_fields, qty) + sizeof(qty_t) == 32);
+
+        /// Shuffle kernels for one msg type. The first 16 bytes of
+        /// order_fields (timestamp, oid) come from a load that starts at
+        /// the timestamp, the next 16 (aux, price, qty) from the last 16
+        /// bytes of the msg. The avx2 kernel does both with one 32-byte
+        /// load from WideBase, masked to the msg's last whole dword if it
+        /// would run past the end.
+        template <typename Msg, auto const& Moves, std::size_t WideBase>
+        struct kernel
+        {
+            static constexpr std::size_t LoBase =
+                    std::min(offsetof(Msg, timestamp), sizeof(Msg) - 16);
+            static constexpr std::size_t HiBase = sizeof(Msg) - 16;
+            static constexpr bool HasHi = [] {
+                for (field_move const& mv : Moves)
+                    if (mv.dst >= 16)
+                        return true;
+                return false;
+            }();
+
+            static constexpr shuffle_ctl<16> Lo = make_ctl<16>(0, LoBase, Moves);
+            static constexpr shuffle_ctl<16> Hi = make_ctl<16>(16, HiBase, Moves);
+            static constexpr shuffle_ctl<32> Wide = make_ctl<32>(0, WideBase, Moves);
+
+            /// dwords of the wide load that are inside the msg
+            static constexpr std::size_t WideDwords =
+                    std::min<std::size_t>(8, (sizeof(Msg) - WideBase) / 4);
+            static constexpr bool WideMasked = WideDwords < 8;
+
+            static_assert([] {
+                for (field_move const& mv : Moves)
+                    if (mv.src + mv.size > WideBase + 4 * WideDwords)
+                        return false;
+                return true;
+            }());
+
+            __attribute__((target("sse4.2"))) static void
+            sse4(Msg const* m, order_fields& f) noexcept
+            {
+                auto p = reinterpret_cast<char const*>(m);
+                __m128i const lo = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + LoBase));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(&f),
+                        _mm_shuffle_epi8(lo, _mm_load_si128(
+                                reinterpret_cast<__m128i const*>(Lo.b))));
+                if constexpr (HasHi) {
+                    __m128i const hi =
+                            _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + HiBase));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(&f.aux),
+                            _mm_shuffle_epi8(hi, _mm_load_si128(
+                                    reinterpret_cast<__m128i const*>(Hi.b))));
+                } else {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(&f.aux), _mm_setzero_si128());
+                }
+                f.locate = be16toh(m->stock_locate);
+            }
+
+            __attribute__((target("avx2"))) static void
+            avx2(Msg const* m, order_fields& f) noexcept
+            {
+                auto p = reinterpret_cast<char const*>(m) + WideBase;
+                __m256i v;
+                if constexpr (WideMasked) {
+                    __m256i const mask =
+                            _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(WideDwords)),
+                                    _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+                    v = _mm256_maskload_epi32(reinterpret_cast<int const*>(p), mask);
+                } else {
+                    v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p));
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(&f),
+                        _mm256_shuffle_epi8(v, _mm256_load_si256(
+                                reinterpret_cast<__m256i const*>(Wide.b))));
+                f.locate = be16toh(m->stock_locate);
+            }
+        };
+
+        // wide loads start where both 16-byte lanes line up with their fields
+        using add_order_kernel = kernel<add_order, AddOrderMoves, 6>;
+        using order_executed_kernel = kernel<order_executed, OrderExecutedMoves, 5>;
+        using order_delete_kernel = kernel<order_delete, OrderDeleteMoves, 5>;
+        using order_replace_kernel = kernel<order_replace, OrderReplaceMoves, 5>;
+
+        // clang-format off
+        constexpr order_extractors ScalarExtractors = {
+            [](add_order const* m, order_fields& f) noexcept { extract_scalar(m, f); },
+            [](order_executed const* m, order_fields& f) noexcept { extract_scalar(m, f); },
+            [](order_delete const* m, order_fields& f) noexcept { extract_scalar(m, f); },
+            [](order_replace const* m, order_fields& f) noexcept { extract_scalar(m, f); }};
+
+        constexpr order_extractors Sse4Extractors = {
+            &add_order_kernel::sse4, &order_executed_kernel::sse4,
+            &order_delete_kernel::sse4, &order_replace_kernel::sse4};
+
+        // order_delete has no fields past the first 16 bytes
+        constexpr order_extractors Avx2Extractors = {
+            &add_order_kernel::avx2, &order_executed_kernel::avx2,
+            &order_delete_kernel::sse4, &order_replace_kernel::avx2};
+        // clang-format on
+
+    } // namespace
+
+    order_extractors const&
+    get_extractors(simd_level level) noexcept
+    {
+        switch (level) {
+            case simd_level::avx2: return Avx2Extractors;
+            case simd_level::sse4: return Sse4Extractors;
+            case simd_level::scalar: break;
+        }
+        return ScalarExtractors;
+    }
+
+    order_extractors const&
+    get_extractors() noexcept
+    {
+        static order_extractors const& best = get_extractors(detect_simd_level());
+        return best;
+    }
+
+} // namespace itch
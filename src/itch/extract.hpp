@@ -0,0 +1,117 @@
+#pragma once
+
+#include "core.hpp"
+#include "protocol/itch/itch.cppgen.hpp"
+#include "util/simd.hpp"
+#include <endian.h>
+#include <cstdint>
+#include <cstring> // std::memcpy
+
+
+namespace itch {
+
+    /// Numeric fields of an order msg, in host byte order. Fields a msg
+    /// doesn't have are 0.
+    struct order_fields
+    {
+        std::uint64_t timestamp = 0; ///< nsecs since midnight
+        oid_t oid = 0;               ///< (original) order reference number
+        /// order_replace: new order reference number,
+        /// order_executed: match number
+        std::uint64_t aux = 0;
+        price_t price = 0;
+        qty_t qty = 0;
+        std::uint16_t locate = 0;
+
+        constexpr bool operator==(order_fields const&) const noexcept = default;
+    };
+
+    /// Field extractors for one simd_level.
+    ///
+    /// The vector versions move every field straight from the packed
+    /// big-endian msg to its order_fields slot with a byte shuffle (the
+    /// 48-bit timestamp included), rather than loading and byte-swapping
+    /// one field at a time. They never read outside the msg.
+    struct order_extractors
+    {
+        void (*add)(add_order const*, order_fields&) noexcept;
+        void (*execute)(order_executed const*, order_fields&) noexcept;
+        void (*remove)(order_delete const*, order_fields&) noexcept;
+        void (*replace)(order_replace const*, order_fields&) noexcept;
+    };
+
+    /// extractors for a level, which the cpu must support
+    order_extractors const& get_extractors(simd_level) noexcept;
+
+    /// extractors for detect_simd_level(), looked up once
+    order_extractors const& get_extractors() noexcept;
+
+    // scalar reference versions
+
+    void extract_scalar(add_order const*, order_fields&) noexcept;
+    void extract_scalar(order_executed const*, order_fields&) noexcept;
+    void extract_scalar(order_delete const*, order_fields&) noexcept;
+    void extract_scalar(order_replace const*, order_fields&) noexcept;
+
+    /**********************************************************************/
+
+    namespace detail {
+
+        /// 48-bit big-endian timestamp, read as the low 6 bytes of the
+        /// 8 bytes ending with it (tracking number + timestamp)
+        template <typename Msg>
+        inline std::uint64_t
+        load_timestamp(Msg const* m) noexcept
+        {
+            std::uint64_t v;
+            std::memcpy(&v, m->timestamp + sizeof(m->timestamp) - sizeof(v), sizeof(v));
+            return be64toh(v) & ((std::uint64_t(1) << 48) - 1);
+        }
+
+    } // namespace detail
+
+    inline void
+    extract_scalar(add_order const* m, order_fields& f) noexcept
+    {
+        f.timestamp = detail::load_timestamp(m);
+        f.oid = be64toh(m->order_reference_number);
+        f.aux = 0;
+        f.price = be32toh(m->price);
+        f.qty = be32toh(m->shares);
+        f.locate = be16toh(m->stock_locate);
+    }
+
+    inline void
+    extract_scalar(order_executed const* m, order_fields& f) noexcept
+    {
+        f.timestamp = detail::load_timestamp(m);
+        f.oid = be64toh(m->order_reference_number);
+        f.aux = be64toh(m->match_number);
+        f.price = 0;
+        f.qty = be32toh(m->executed_shares);
+        f.locate = be16toh(m->stock_locate);
+    }
+
+    inline void
+    extract_scalar(order_delete const* m, order_fields& f) noexcept
+    {
+        f.timestamp = detail::load_timestamp(m);
+        f.oid = be64toh(m->order_reference_number);
+        f.aux = 0;
+        f.price = 0;
+        f.qty = 0;
+        f.locate = be16toh(m->stock_locate);
+    }
+
+    inline void
+    extract_scalar(order_replace const* m, order_fields& f) noexcept
+    {
+        f.timestamp = detail::load_timestamp(m);
+        f.oid = be64toh(m->original_order_reference_number);
+        f.aux = be64toh(m->new_order_reference_number);
+        f.price = be32toh(m->price);
+        f.qty = be32toh(m->shares);
+        f.locate = be16toh(m->stock_locate);
+    }
+
+} // namespace itch
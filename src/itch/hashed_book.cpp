@@ -1,10 +1,13 @@
 #include "hashed_book.hpp"
+#include "book.hpp" // detail::fill_depth
+#include "level_table.hpp" // handled_level
 #include "util/assert.hpp"
-#include <algorithm> // std::find_if
+#include <algorithm> // std::find_if, std::max
 #include <cstdint>
 #include <cstdio>  // std::fprintf
 #include <cstdlib> // std::abort
 #include <exception>
+#include <memory> // std::make_unique
 
 
 namespace { // unnamed
@@ -16,7 +19,7 @@ namespace { // unnamed
     // allocate this many price levels in the memory pool
     constexpr std::uint32_t NumPriceLevels = 50;
 
-    // allocate this many buckets in the mapping
+    // size the price maps for this many levels
     constexpr std::uint32_t NumBuckets = 100;
 
 } // namespace
@@ -24,50 +27,65 @@ namespace { // unnamed
 
 namespace itch {
 
-    hashed_book::hashed_book() noexcept
-            : bid_pool_(sizeof(price_level) + StdListNodeExtra, NumPriceLevels)
-            , ask_pool_(sizeof(price_level) + StdListNodeExtra, NumPriceLevels)
-            , bids_(bid_pool_)
-            , asks_(ask_pool_)
-            , bid_map_()
-            , ask_map_()
+    template <typename Level>
+    basic_hashed_book<Level>::own_pools::own_pools() noexcept
+            : bid_pool(sizeof(Level) + StdListNodeExtra, NumPriceLevels)
+            , ask_pool(sizeof(Level) + StdListNodeExtra, NumPriceLevels)
+            , bid_resource(bid_pool)
+            , ask_resource(ask_pool)
     {
-        bid_map_.reserve(NumBuckets);
-        ask_map_.reserve(NumBuckets);
+        // empty
     }
 
+    template <typename Level>
+    basic_hashed_book<Level>::basic_hashed_book() noexcept
+            : own_pools_(std::make_unique<own_pools>())
+            , bids_(&own_pools_->bid_resource)
+            , asks_(&own_pools_->ask_resource)
+            , bid_map_(NumBuckets)
+            , ask_map_(NumBuckets)
+    {
+        // empty
+    }
+
+    template <typename Level>
+    basic_hashed_book<Level>::basic_hashed_book(std::pmr::memory_resource* resource) noexcept
+            : bids_(resource)
+            , asks_(resource)
+            , bid_map_(NumBuckets)
+            , ask_map_(NumBuckets)
+    {
+        // empty
+    }
+
+    template <typename Level>
     void
-    hashed_book::add_order(order& order) noexcept
+    basic_hashed_book<Level>::add_order(order& order) noexcept
     {
         auto* book = (order.side == Side::Bid) ? &bids_ : &asks_;
         auto* map = (order.side == Side::Bid) ? &bid_map_ : &ask_map_;
 
-        // need to catch any exceptions from std::unordered_map::emplace
+        // price_map::insert may throw when it grows, in which case we abort
         try {
-            if (book->empty()) {
-                auto new_itr = book->emplace(book->begin(), order.price, order.qty);
-                map->emplace(order.price, new_itr);
-                order.pl = &(*new_itr);
+            if (auto* level_itr = map->find(order.price)) {
+                (*level_itr)->inc_qty(order.qty);
+                order.pl = &**level_itr;
             } else {
-                auto map_itr = map->find(order.price);
-
-                // price not found in the map, therefore it doesn't exist in the
-                // book. find out where it should go
-                if (map_itr == map->end()) {
-                    // find location in book
-                    auto loc = std::find_if(book->begin(), book->end(), [&order](auto const& pl) {
-                        return (order.side == Side::Bid) ? pl.price() <= order.price
-                                                         : pl.price() >= order.price;
-                    });
-
-                    // new price level
-                    auto new_itr = book->emplace(loc, order.price, order.qty);
-                    map->emplace(order.price, new_itr);
-                    order.pl = &(*new_itr);
-                } else {
-                    map_itr->second->inc_qty(order.qty);
-                    order.pl = &*(map_itr->second);
-                }
+                // price not found in the map, therefore it doesn't exist in
+                // the book. find out where it should go
+                auto loc = std::find_if(book->begin(), book->end(), [&order](auto const& pl) {
+                    return (order.side == Side::Bid) ? pl.price() <= order.price
+                                                     : pl.price() >= order.price;
+                });
+
+                // new price level
+                auto new_itr = book->emplace(loc, order.price, order.qty);
+                map->insert(order.price, new_itr);
+                order.pl = &(*new_itr);
+
+                std::size_t& max_depth = (order.side == Side::Bid) ? max_bid_book_depth_
+                                                                   : max_ask_book_depth_;
+                max_depth = std::max(max_depth, book->size());
             }
         } catch (std::exception const& e) {
             std::fprintf(stderr, "[ERROR] exception in %s: %s\n", __builtin_FUNCTION(), e.what());
@@ -75,8 +93,9 @@ namespace itch {
         }
     }
 
+    template <typename Level>
     void
-    hashed_book::delete_order(order& order) noexcept
+    basic_hashed_book<Level>::delete_order(order& order) noexcept
     {
         DEBUG_ASSERT(order.pl != nullptr);
         if (order.pl == nullptr)
@@ -91,16 +110,15 @@ namespace itch {
             auto* book = (order.side == Side::Bid) ? &bids_ : &asks_;
             auto* map = (order.side == Side::Bid) ? &bid_map_ : &ask_map_;
 
-            auto map_itr = map->find(order.pl->price());
-            book->erase(map_itr->second);
-            map->erase(map_itr);
+            book->erase(map->erase(order.pl->price()));
         }
 
         order.clear();
     }
 
+    template <typename Level>
     void
-    hashed_book::cancel_order(order& order, qty_t remove_qty) noexcept
+    basic_hashed_book<Level>::cancel_order(order& order, qty_t remove_qty) noexcept
     {
         DEBUG_ASSERT(remove_qty <= order.qty);
 
@@ -114,8 +132,9 @@ namespace itch {
         }
     }
 
+    template <typename Level>
     void
-    hashed_book::replace_order(order& old_order, order& new_order) noexcept
+    basic_hashed_book<Level>::replace_order(order& old_order, order& new_order) noexcept
     {
         DEBUG_ASSERT(old_order.pl != nullptr);
         DEBUG_ASSERT(new_order.pl == nullptr);
@@ -127,20 +146,23 @@ namespace itch {
         DEBUG_ASSERT(new_order.pl != nullptr);
     }
 
-    decltype(hashed_book::bids_) const&
-    hashed_book::bids() const noexcept
+    template <typename Level>
+    typename basic_hashed_book<Level>::level_list const&
+    basic_hashed_book<Level>::bids() const noexcept
     {
         return bids_;
     }
 
-    decltype(hashed_book::asks_) const&
-    hashed_book::asks() const noexcept
+    template <typename Level>
+    typename basic_hashed_book<Level>::level_list const&
+    basic_hashed_book<Level>::asks() const noexcept
     {
         return asks_;
     }
 
+    template <typename Level>
     pq
-    hashed_book::best_bid() const noexcept
+    basic_hashed_book<Level>::best_bid() const noexcept
     {
         if (bids_.empty())
             return {0, 0};
@@ -148,8 +170,9 @@ namespace itch {
         return {bids_.front().price(), bids_.front().agg_qty()};
     }
 
+    template <typename Level>
     pq
-    hashed_book::best_ask() const noexcept
+    basic_hashed_book<Level>::best_ask() const noexcept
     {
         if (asks_.empty())
             return {0, 0};
@@ -157,28 +180,47 @@ namespace itch {
         return {asks_.front().price(), asks_.front().agg_qty()};
     }
 
+    template <typename Level>
+    void
+    basic_hashed_book<Level>::depth(
+            std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept
+    {
+        DEBUG_ASSERT(n <= bids.size() && n <= asks.size());
+
+        detail::fill_depth(bids_, bids.first(n));
+        detail::fill_depth(asks_, asks.first(n));
+    }
+
+    template <typename Level>
     std::size_t
-    hashed_book::max_bid_book_depth() const noexcept
+    basic_hashed_book<Level>::max_bid_book_depth() const noexcept
     {
-        return bid_pool_.max_used();
+        return max_bid_book_depth_;
     }
 
+    template <typename Level>
     std::size_t
-    hashed_book::max_ask_book_depth() const noexcept
+    basic_hashed_book<Level>::max_ask_book_depth() const noexcept
     {
-        return ask_pool_.max_used();
+        return max_ask_book_depth_;
     }
 
+    template <typename Level>
     std::size_t
-    hashed_book::max_bid_order_depth() const noexcept
+    basic_hashed_book<Level>::max_bid_order_depth() const noexcept
     {
         return max_bid_order_depth_;
     }
 
+    template <typename Level>
     std::size_t
-    hashed_book::max_ask_order_depth() const noexcept
+    basic_hashed_book<Level>::max_ask_order_depth() const noexcept
     {
         return max_ask_order_depth_;
     }
 
+    // explicit instantiations
+    template class basic_hashed_book<price_level>;
+    template class basic_hashed_book<handled_level>;
+
 } // namespace itch
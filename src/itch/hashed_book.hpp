@@ -2,31 +2,55 @@
 
 #include "core.hpp"
 #include "price_level.hpp"
+#include "price_map.hpp"
 #include "allocator/memory_pool.hpp"
-#include "allocator/mp_allocator.hpp"
+#include "allocator/memory_resource.hpp"
 #include <cstddef> // std::size_t
 #include <list>
-#include <unordered_map>
+#include <memory> // std::unique_ptr
+#include <memory_resource>
+#include <span>
 
 
 namespace itch {
 
-    /// Book with std::list for ordered price levels and a
-    /// std::unordered_map keyed by price for fast look-up.
-    class hashed_book
+    /// Book with std::pmr::list for ordered price levels and a flat hash
+    /// map keyed by price for fast look-up, see price_map. Levels come
+    /// from a memory_pool per side, or from a memory_resource the book
+    /// is given.
+    template <typename Level = price_level>
+    class basic_hashed_book
     {
     private:
-        memory_pool bid_pool_;
-        memory_pool ask_pool_;
-        std::list<price_level, mp_allocator<price_level>> bids_;
-        std::list<price_level, mp_allocator<price_level>> asks_;
-        std::unordered_map<price_t, decltype(bids_)::iterator> bid_map_;
-        std::unordered_map<price_t, decltype(asks_)::iterator> ask_map_;
+        /// the pools of a book that isn't given a resource
+        struct own_pools
+        {
+            memory_pool bid_pool;
+            memory_pool ask_pool;
+            pool_resource<> bid_resource;
+            pool_resource<> ask_resource;
+
+            own_pools() noexcept;
+        };
+
+        using level_list = std::pmr::list<Level>;
+
+    private:
+        std::unique_ptr<own_pools> own_pools_; ///< unless given a resource
+        level_list bids_;
+        level_list asks_;
+        price_map<typename level_list::iterator> bid_map_;
+        price_map<typename level_list::iterator> ask_map_;
+        std::size_t max_bid_book_depth_ = 0;  ///< stats only
+        std::size_t max_ask_book_depth_ = 0;  ///< stats only
         std::size_t max_bid_order_depth_ = 0; ///< stats only
         std::size_t max_ask_order_depth_ = 0; ///< stats only
 
     public:
-        hashed_book() noexcept;
+        basic_hashed_book() noexcept;
+
+        /// allocates the levels of both sides from resource
+        explicit basic_hashed_book(std::pmr::memory_resource* resource) noexcept;
         void add_order(order&) noexcept;
         void delete_order(order&) noexcept;
         void cancel_order(order&, qty_t remove_qty) noexcept;
@@ -34,14 +58,17 @@ namespace itch {
 
         // accessors
     public:
-        decltype(bids_) const& bids() const noexcept;
-        decltype(asks_) const& asks() const noexcept;
+        level_list const& bids() const noexcept;
+        level_list const& asks() const noexcept;
         pq best_bid() const noexcept;
         pq best_ask() const noexcept;
+        void depth(std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept;
         std::size_t max_bid_book_depth() const noexcept;
         std::size_t max_ask_book_depth() const noexcept;
         std::size_t max_bid_order_depth() const noexcept;
         std::size_t max_ask_order_depth() const noexcept;
     };
 
+    using hashed_book = basic_hashed_book<>;
+
 } // namespace itch
@@ -0,0 +1,250 @@
+#pragma once
+
+#include "core.hpp"
+#include "price_map.hpp"
+#include "allocator/lowlevel_allocator.hpp"
+#include "util/assert.hpp"
+#include <algorithm> // std::min
+#include <cstddef>   // std::size_t
+#include <cstdint>
+#include <limits>
+#include <memory>      // std::uninitialized_value_construct_n
+#include <type_traits> // std::is_trivially_destructible_v
+#include <utility>     // std::move
+#include <vector>
+
+
+namespace itch {
+
+    /// Order storage for a parser that only sees some of the orders, e.g.
+    /// a sharded_parser worker.
+    ///
+    /// Order reference numbers are assigned across all instruments, so
+    /// the orders of a shard are spread thinly over the whole order
+    /// space and an order_store would commit a page for nearly every
+    /// page of refs in flight. Here orders live in slots of their own,
+    /// numbered densely from 0 in pages of 2^PageBits, and an open-
+    /// addressing map (see price_map) takes an order ref to its slot.
+    /// An erased slot is cleared and is the first to be handed out
+    /// again, so the pages committed follow the most orders the store
+    /// has held at once rather than the spread of their refs. Pages are
+    /// kept once committed.
+    ///
+    /// Same interface as order_store, so either can back a parser.
+    /// Look-up costs a hash probe rather than a shift and a mask.
+    template <typename Order = order, std::size_t PageBits = 16,
+            typename LLAllocator = lowlevel_allocator<malloc_allocator>>
+    class hashed_order_store : private LLAllocator
+    {
+        static_assert(std::is_trivially_destructible_v<Order>, "pages are never destroyed");
+        static_assert(PageBits < 32);
+
+    public:
+        using value_type = Order;
+        static constexpr std::size_t PageSize = std::size_t(1) << PageBits;
+
+    private:
+        static constexpr std::size_t PageMask = PageSize - 1;
+        static constexpr std::size_t PageBytes = PageSize * sizeof(Order);
+        static constexpr std::size_t MaxSlots = std::numeric_limits<std::uint32_t>::max();
+
+    private:
+        price_map<std::uint32_t, oid_t> slots_; ///< slot of each live order
+        std::vector<Order*> pages_;              ///< committed pages, by slot
+        std::vector<std::uint32_t> free_slots_;  ///< erased slots, re-used first
+        std::uint32_t next_slot_ = 0;            ///< first slot never handed out
+        std::size_t capacity_;
+
+    public:
+        /// capacity bounds the order refs, as for order_store. alloc
+        /// places the pages, e.g. a numa_allocator
+        explicit hashed_order_store(std::size_t capacity, LLAllocator alloc = LLAllocator());
+        ~hashed_order_store() noexcept;
+        hashed_order_store(hashed_order_store const&) noexcept = delete;
+        hashed_order_store(hashed_order_store&&) noexcept = delete;
+        hashed_order_store& operator=(hashed_order_store const&) noexcept = delete;
+        hashed_order_store& operator=(hashed_order_store&&) noexcept = delete;
+
+        /// returns the order slot, taking a free one if the order isn't
+        /// live yet, and marks it live
+        Order& insert(oid_t) noexcept;
+
+        /// returns the order if it is live (inserted and not erased since),
+        /// nullptr otherwise. never commits a page
+        Order* find(oid_t) noexcept;
+        Order const* find(oid_t) const noexcept;
+
+        /// as find(): only live orders have a slot
+        Order const* slot(oid_t) const noexcept;
+
+        /// clears a live order and frees its slot. does nothing if the
+        /// order isn't live
+        void erase(oid_t) noexcept;
+
+        /// number of live orders
+        std::size_t size() const noexcept;
+
+        constexpr std::size_t capacity() const noexcept;
+
+        /// pages are never given back, so all three are the pages
+        /// committed so far
+        constexpr std::size_t pages_in_use() const noexcept;
+        constexpr std::size_t max_pages_in_use() const noexcept;
+        constexpr std::size_t pages_allocated() const noexcept;
+        constexpr std::size_t page_bytes() const noexcept;
+
+    private:
+        Order& at(std::uint32_t slot) const noexcept;
+        void commit_page() noexcept;
+    };
+
+    /**********************************************************************/
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    hashed_order_store<Order, PageBits, LLAllocator>::hashed_order_store(
+            std::size_t capacity, LLAllocator alloc)
+            : LLAllocator(std::move(alloc))
+            , slots_(PageSize)
+            , pages_()
+            , free_slots_()
+            , capacity_(capacity)
+    {
+        // commit_page() must not allocate
+        pages_.reserve((std::min(capacity, MaxSlots) + PageMask) >> PageBits);
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    hashed_order_store<Order, PageBits, LLAllocator>::~hashed_order_store() noexcept
+    {
+        for (Order* page : pages_)
+            LLAllocator::deallocate_node(page, PageBytes, alignof(Order));
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    Order&
+    hashed_order_store<Order, PageBits, LLAllocator>::insert(oid_t oid) noexcept
+    {
+        DEBUG_ASSERT(oid < capacity_);
+
+        if (std::uint32_t const* slot = slots_.find(oid))
+            return at(*slot);
+
+        std::uint32_t slot = next_slot_;
+        if (!free_slots_.empty()) {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+        } else {
+            if (slot == pages_.size() * PageSize) [[unlikely]]
+                commit_page();
+            ++next_slot_;
+        }
+
+        // grows the map now and then, terminates if that fails
+        slots_.insert(oid, slot);
+        return at(slot);
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    Order*
+    hashed_order_store<Order, PageBits, LLAllocator>::find(oid_t oid) noexcept
+    {
+        std::uint32_t const* slot = slots_.find(oid);
+        return slot == nullptr ? nullptr : &at(*slot);
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    Order const*
+    hashed_order_store<Order, PageBits, LLAllocator>::find(oid_t oid) const noexcept
+    {
+        std::uint32_t const* slot = slots_.find(oid);
+        return slot == nullptr ? nullptr : &at(*slot);
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    Order const*
+    hashed_order_store<Order, PageBits, LLAllocator>::slot(oid_t oid) const noexcept
+    {
+        return find(oid);
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    void
+    hashed_order_store<Order, PageBits, LLAllocator>::erase(oid_t oid) noexcept
+    {
+        if (slots_.find(oid) == nullptr)
+            return;
+
+        // free_slots_ has room for every slot handed out
+        std::uint32_t const slot = slots_.erase(oid);
+        at(slot).clear();
+        free_slots_.push_back(slot);
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    std::size_t
+    hashed_order_store<Order, PageBits, LLAllocator>::size() const noexcept
+    {
+        return slots_.size();
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    constexpr std::size_t
+    hashed_order_store<Order, PageBits, LLAllocator>::capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    constexpr std::size_t
+    hashed_order_store<Order, PageBits, LLAllocator>::pages_in_use() const noexcept
+    {
+        return pages_.size();
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    constexpr std::size_t
+    hashed_order_store<Order, PageBits, LLAllocator>::max_pages_in_use() const noexcept
+    {
+        return pages_.size();
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    constexpr std::size_t
+    hashed_order_store<Order, PageBits, LLAllocator>::pages_allocated() const noexcept
+    {
+        return pages_.size();
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    constexpr std::size_t
+    hashed_order_store<Order, PageBits, LLAllocator>::page_bytes() const noexcept
+    {
+        return PageBytes;
+    }
+
+    // private
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    Order&
+    hashed_order_store<Order, PageBits, LLAllocator>::at(std::uint32_t slot) const noexcept
+    {
+        return pages_[slot >> PageBits][slot & PageMask];
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    void
+    hashed_order_store<Order, PageBits, LLAllocator>::commit_page() noexcept
+    {
+        DEBUG_ASSERT(pages_.size() < pages_.capacity());
+
+        // allocate_node() terminates on failure
+        void* mem = LLAllocator::allocate_node(PageBytes, alignof(Order));
+        auto page = static_cast<Order*>(mem);
+        std::uninitialized_value_construct_n(page, PageSize);
+        pages_.push_back(page);
+
+        // so that erase() never allocates, terminates if that fails
+        free_slots_.reserve(pages_.size() * PageSize);
+    }
+
+} // namespace itch
@@ -1,18 +1,29 @@
 #include "instrument.hpp"
+#include "basic_book.hpp"
+#include "bitmap_book.hpp"
+#include "btree_book.hpp"
+#include "compact_book.hpp"
+#include "hashed_book.hpp"
+#include "l3_book.hpp"
+#include "ladder_book.hpp"
+#include "map_book.hpp"
+#include "vector_book.hpp"
 #include <fmt/format.h>
 #include <algorithm> // std::transform
 
 
 namespace itch {
 
-    instrument::instrument() noexcept
+    template <Book B>
+    basic_instrument<B>::basic_instrument() noexcept
             : lo(InvalidLoPrice)
             , hi(InvalidHiPrice)
     {
         // empty
     }
 
-    instrument::instrument(std::uint16_t l, char const (&nm)[NameLen]) noexcept
+    template <Book B>
+    basic_instrument<B>::basic_instrument(std::uint16_t l, char const (&nm)[NameLen]) noexcept
             : locate(l)
             , lo(InvalidLoPrice)
             , hi(InvalidHiPrice)
@@ -20,15 +31,17 @@ namespace itch {
         set_name(nm);
     }
 
+    template <Book B>
     void
-    instrument::set_name(char const (&nm)[NameLen]) noexcept
+    basic_instrument<B>::set_name(char const (&nm)[NameLen]) noexcept
     {
         std::transform(std::begin(nm), std::end(nm), std::begin(name),
                 [](char c) { return c == ' ' ? '\0' : c; });
     }
 
+    template <Book B>
     std::string
-    instrument::stats_str() const
+    basic_instrument<B>::stats_str() const
     {
         // clang-format off
         return fmt::format("{}\n"
@@ -52,14 +65,16 @@ namespace itch {
         // clang-format on
     }
 
+    template <Book B>
     std::string
-    instrument::stats_csv_header() noexcept
+    basic_instrument<B>::stats_csv_header() noexcept
     {
         return "name,locate,open,close,low,high,num_trades,trade_vol,num_orders,max_bid_book_depth,max_ask_book_depth,max_bid_order_depth,max_ask_order_depth";
     }
 
+    template <Book B>
     std::string
-    instrument::stats_csv() const
+    basic_instrument<B>::stats_csv() const
     {
         // clang-format off
         return fmt::format("{},{},{:.4f},{:.4f},{:.4f},{:.4f},{},{},{},{},{},{},{}",
@@ -79,10 +94,23 @@ namespace itch {
         // clang-format on
     }
 
+    template <Book B>
     std::tuple<std::size_t, std::size_t>
-    instrument::allocator_stats() const noexcept
+    basic_instrument<B>::allocator_stats() const noexcept
     {
         return std::make_tuple(book.max_bid_book_depth(), book.max_ask_book_depth());
     }
 
+    // explicit instantiations
+    template struct basic_instrument<basic_book>;
+    template struct basic_instrument<bitmap_book>;
+    template struct basic_instrument<btree_book>;
+    template struct basic_instrument<compact_book<mp_book>>;
+    template struct basic_instrument<hashed_book>;
+    template struct basic_instrument<l3_book>;
+    template struct basic_instrument<ladder_book>;
+    template struct basic_instrument<map_book>;
+    template struct basic_instrument<mp_book>;
+    template struct basic_instrument<vector_book>;
+
 } // namespace itch
@@ -1,9 +1,7 @@
 #pragma once
 
-#include "basic_book.hpp"
+#include "book.hpp"
 #include "core.hpp"
-#include "hashed_book.hpp"
-#include "map_book.hpp"
 #include "mp_book.hpp"
 #include <cstdint>
 #include <string>
@@ -12,27 +10,41 @@
 
 namespace itch {
 
-    struct instrument
+    /// An instrument and its book. The pahole notes are for mp_book
+    template <Book B>
+    struct basic_instrument
     {
-        mp_book book;
-        // pahole: --- cacheline 2 boundary (128 bytes) was 48 bytes ago ---
+        using book_type = B;
+
+        B book;
+        // pahole: --- cacheline 1 boundary (64 bytes) was 40 bytes ago ---
         std::uint32_t num_orders = 0;
         char name[NameLen] = {0};
         std::uint16_t locate = 0;
         InstrumentState instrument_state = InstrumentState::Unknown;
 
         // pahole: XXX 1 byte hole, try to pack
-        // pahole: --- cacheline 3 boundary (192 bytes) ---
         std::uint32_t trade_qty = 0;
         std::uint32_t num_trades = 0;
+        // pahole: --- cacheline 2 boundary (128 bytes) ---
         price_t lo = InvalidHiPrice;
         price_t hi = InvalidLoPrice;
         price_t last = 0;
         price_t open = 0;
         price_t close = 0;
 
-        instrument() noexcept;
-        instrument(std::uint16_t locate, char const (&name)[NameLen]) noexcept;
+        basic_instrument() noexcept;
+        basic_instrument(std::uint16_t locate, char const (&name)[NameLen]) noexcept;
+
+        /// the book draws its levels from pools shared with other books
+        explicit basic_instrument(book_pools_t<B>& pools) noexcept
+            requires SharedPoolBook<B>
+                : book(pools)
+                , lo(InvalidLoPrice)
+                , hi(InvalidHiPrice)
+        {
+            // empty
+        }
         void set_name(char const (&name)[NameLen]) noexcept;
 
         // stats
@@ -42,4 +54,6 @@ namespace itch {
         std::tuple<std::size_t, std::size_t> allocator_stats() const noexcept;
     };
 
+    using instrument = basic_instrument<mp_book>;
+
 } // namespace itch
@@ -0,0 +1,183 @@
+#include "l3_book.hpp"
+#include <algorithm> // std::max
+
+
+namespace itch {
+
+    l3_book::l3_book() noexcept
+            : bids_()
+            , asks_()
+    {
+        // empty
+    }
+
+    void
+    l3_book::add_order(l3_order& order) noexcept
+    {
+        DEBUG_ASSERT(order.pl == nullptr);
+
+        l3_level& pl = (order.side == Side::Bid) ? bids_.find_or_add(order.price)
+                                                 : asks_.find_or_add(order.price);
+        pl.inc_qty(order.qty);
+        pl.push_back(order);
+        order.pl = &pl;
+
+        std::size_t& depth
+                = (order.side == Side::Bid) ? max_bid_order_depth_ : max_ask_order_depth_;
+        depth = std::max<std::size_t>(depth, pl.count());
+    }
+
+    void
+    l3_book::delete_order(l3_order& order) noexcept
+    {
+        DEBUG_ASSERT(order.pl != nullptr);
+        if (order.pl == nullptr)
+            return;
+
+        auto& pl = static_cast<l3_level&>(*order.pl);
+        DEBUG_ASSERT(order.qty <= pl.agg_qty());
+
+        pl.unlink(order);
+        if (pl.count() != 0) {
+            pl.dec_qty(order.qty);
+        } else if (order.side == Side::Bid) {
+            bids_.erase(pl);
+        } else {
+            asks_.erase(pl);
+        }
+
+        order.clear();
+    }
+
+    void
+    l3_book::cancel_order(l3_order& order, qty_t remove_qty) noexcept
+    {
+        DEBUG_ASSERT(remove_qty <= order.qty);
+
+        if (remove_qty < order.qty) {
+            // keeps its place in the queue
+            order.qty -= remove_qty;
+            order.pl->dec_qty(remove_qty);
+        } else {
+            // this cancel will remove the order (may happen if caused
+            // by an execution)
+            delete_order(order);
+        }
+    }
+
+    void
+    l3_book::replace_order(l3_order& old_order, l3_order& new_order) noexcept
+    {
+        DEBUG_ASSERT(old_order.pl != nullptr);
+        DEBUG_ASSERT(new_order.pl == nullptr);
+
+        delete_order(old_order);
+        DEBUG_ASSERT(old_order.pl == nullptr);
+
+        add_order(new_order);
+        DEBUG_ASSERT(new_order.pl != nullptr);
+    }
+
+    l3_level const&
+    l3_book::level_of(l3_order const& order) noexcept
+    {
+        DEBUG_ASSERT(order.pl != nullptr);
+        return static_cast<l3_level const&>(*order.pl);
+    }
+
+    l3_level const*
+    l3_book::bid_level(price_t price) const noexcept
+    {
+        return bids_.find(price);
+    }
+
+    l3_level const*
+    l3_book::ask_level(price_t price) const noexcept
+    {
+        return asks_.find(price);
+    }
+
+    qty_t
+    l3_book::queue_ahead(l3_order const& order) noexcept
+    {
+        qty_t qty = 0;
+        for (l3_order const* o = order.prev; o != nullptr; o = o->prev)
+            qty += o->qty;
+        return qty;
+    }
+
+    std::uint32_t
+    l3_book::queue_position(l3_order const& order) noexcept
+    {
+        std::uint32_t n = 0;
+        for (l3_order const* o = order.prev; o != nullptr; o = o->prev)
+            ++n;
+        return n;
+    }
+
+    std::vector<price_level>
+    l3_book::bids() const
+    {
+        return bids_.levels();
+    }
+
+    std::vector<price_level>
+    l3_book::asks() const
+    {
+        return asks_.levels();
+    }
+
+    pq
+    l3_book::best_bid() const noexcept
+    {
+        l3_level const* pl = bids_.best();
+        if (pl == nullptr)
+            return {0, 0};
+
+        return {pl->price(), pl->agg_qty()};
+    }
+
+    pq
+    l3_book::best_ask() const noexcept
+    {
+        l3_level const* pl = asks_.best();
+        if (pl == nullptr)
+            return {0, 0};
+
+        return {pl->price(), pl->agg_qty()};
+    }
+
+    void
+    l3_book::depth(std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept
+    {
+        DEBUG_ASSERT(n <= bids.size() && n <= asks.size());
+
+        bids_.depth(bids.first(n));
+        asks_.depth(asks.first(n));
+    }
+
+    std::size_t
+    l3_book::max_bid_book_depth() const noexcept
+    {
+        return bids_.max_levels();
+    }
+
+    std::size_t
+    l3_book::max_ask_book_depth() const noexcept
+    {
+        return asks_.max_levels();
+    }
+
+    std::size_t
+    l3_book::max_bid_order_depth() const noexcept
+    {
+        return max_bid_order_depth_;
+    }
+
+    std::size_t
+    l3_book::max_ask_order_depth() const noexcept
+    {
+        return max_ask_order_depth_;
+    }
+
+} // namespace itch
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "core.hpp"
+#include "price_btree.hpp"
+#include "price_level.hpp"
+#include "util/assert.hpp"
+#include <cstddef> // std::ptrdiff_t, std::size_t
+#include <cstdint>
+#include <iterator> // std::forward_iterator_tag
+#include <span>
+#include <vector>
+
+
+namespace itch {
+
+    /// An order on an l3_book, linked into the queue of its level. Like
+    /// any order it lives in an order_store, so the links cost no
+    /// allocation of their own.
+    struct l3_order : order
+    {
+        l3_order* prev = nullptr; ///< ahead in the queue
+        l3_order* next = nullptr; ///< behind in the queue
+
+        using order::order;
+        constexpr l3_order() noexcept = default;
+        bool operator==(l3_order const&) const noexcept = default;
+
+        void
+        clear() noexcept
+        {
+            order::clear();
+            prev = nullptr;
+            next = nullptr;
+        }
+    };
+
+    /// A price_level that also keeps its orders, oldest first, in an
+    /// intrusive doubly linked FIFO.
+    class l3_level : public price_level
+    {
+    private:
+        l3_order* head_ = nullptr;
+        l3_order* tail_ = nullptr;
+        std::uint32_t count_ = 0;
+
+    public:
+        class iterator
+        {
+        private:
+            l3_order const* o_ = nullptr;
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = l3_order;
+            using difference_type = std::ptrdiff_t;
+            using pointer = l3_order const*;
+            using reference = l3_order const&;
+
+            constexpr iterator() noexcept = default;
+            constexpr explicit iterator(l3_order const* o) noexcept
+                    : o_(o)
+            {
+                // empty
+            }
+
+            // clang-format off
+            constexpr reference operator*() const noexcept { return *o_; }
+            constexpr pointer operator->() const noexcept { return o_; }
+            constexpr iterator& operator++() noexcept { o_ = o_->next; return *this; }
+            constexpr iterator operator++(int) noexcept { iterator i = *this; ++*this; return i; }
+            constexpr bool operator==(iterator const&) const noexcept = default;
+            // clang-format on
+        };
+
+    public:
+        constexpr l3_level(price_t p, qty_t q) noexcept
+                : price_level(p, q)
+        {
+            // empty
+        }
+
+        /// queues an order behind the others
+        inline void push_back(l3_order&) noexcept;
+
+        /// takes an order out of the queue, wherever it is
+        inline void unlink(l3_order&) noexcept;
+
+        /// number of orders on the level
+        constexpr std::uint32_t
+        count() const noexcept
+        {
+            return count_;
+        }
+
+        /// the order first in line, or nullptr
+        constexpr l3_order const*
+        front() const noexcept
+        {
+            return head_;
+        }
+
+        /// the order last in line, or nullptr
+        constexpr l3_order const*
+        back() const noexcept
+        {
+            return tail_;
+        }
+
+        // orders, oldest first
+        constexpr iterator
+        begin() const noexcept
+        {
+            return iterator(head_);
+        }
+
+        constexpr iterator
+        end() const noexcept
+        {
+            return iterator();
+        }
+    };
+
+    /// Order-by-order (L3) book.
+    ///
+    /// Levels are kept in B+trees as in btree_book, and each one queues
+    /// its orders in time priority. Adds go to the back of the queue,
+    /// deletes (and executions or cancels that take an order's whole
+    /// qty) unlink it in O(1), partial cancels and executions keep its
+    /// place, and replaces lose it. Levels and tree nodes come from
+    /// memory pools and the queue links live in the orders, so the hot
+    /// path does no heap allocation once the pools are warm.
+    class l3_book
+    {
+    private:
+        detail::price_btree<Side::Bid, l3_level> bids_;
+        detail::price_btree<Side::Ask, l3_level> asks_;
+        std::size_t max_bid_order_depth_ = 0; ///< stats only
+        std::size_t max_ask_order_depth_ = 0; ///< stats only
+
+    public:
+        using order_type = l3_order;
+
+        l3_book() noexcept;
+        void add_order(l3_order&) noexcept;
+        void delete_order(l3_order&) noexcept;
+        void cancel_order(l3_order&, qty_t remove_qty) noexcept;
+        void replace_order(l3_order& old_order, l3_order& new_order) noexcept;
+
+        // queue queries
+    public:
+        /// the level an order is queued on
+        static l3_level const& level_of(l3_order const&) noexcept;
+
+        /// the level at a price, or nullptr if there is none
+        l3_level const* bid_level(price_t) const noexcept;
+        l3_level const* ask_level(price_t) const noexcept;
+
+        /// qty of the orders ahead of an order on its level, i.e. what
+        /// has to trade before it does. O(orders ahead)
+        static qty_t queue_ahead(l3_order const&) noexcept;
+
+        /// number of orders ahead of an order on its level
+        static std::uint32_t queue_position(l3_order const&) noexcept;
+
+        // accessors
+    public:
+        /// snapshots of the levels, best first. not for the hot path
+        std::vector<price_level> bids() const;
+        std::vector<price_level> asks() const;
+        pq best_bid() const noexcept;
+        pq best_ask() const noexcept;
+        void depth(std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept;
+        std::size_t max_bid_book_depth() const noexcept;
+        std::size_t max_ask_book_depth() const noexcept;
+        std::size_t max_bid_order_depth() const noexcept;
+        std::size_t max_ask_order_depth() const noexcept;
+    };
+
+    /**********************************************************************/
+
+    void
+    l3_level::push_back(l3_order& o) noexcept
+    {
+        DEBUG_ASSERT(o.prev == nullptr && o.next == nullptr);
+        o.prev = tail_;
+        if (tail_ != nullptr)
+            tail_->next = &o;
+        else
+            head_ = &o;
+        tail_ = &o;
+        ++count_;
+    }
+
+    void
+    l3_level::unlink(l3_order& o) noexcept
+    {
+        DEBUG_ASSERT(count_ > 0);
+        if (o.prev != nullptr)
+            o.prev->next = o.next;
+        else
+            head_ = o.next;
+        if (o.next != nullptr)
+            o.next->prev = o.prev;
+        else
+            tail_ = o.prev;
+        o.prev = nullptr;
+        o.next = nullptr;
+        --count_;
+    }
+
+} // namespace itch
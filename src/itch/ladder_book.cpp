@@ -0,0 +1,469 @@
+#include "ladder_book.hpp"
+#include "level_table.hpp" // handled_level
+#include "util/assert.hpp"
+#include <algorithm> // std::fill, std::fill_n, std::max, std::min
+#include <cstdint>
+#include <cstdio>  // std::fprintf
+#include <cstdlib> // std::abort
+#include <cstring> // std::memmove
+#include <exception>
+#include <limits>
+#include <memory>  // std::make_unique
+#include <new>     // placement new
+#include <utility> // std::pair
+
+
+namespace { // unnamed
+
+    // each std::map node needs extra memory for at least four pointers
+    // which we should account for when creating memory pool
+    constexpr std::uint32_t StdMapNodeExtra = sizeof(std::uintptr_t) * 4;
+
+    // allocate this many price levels (and overflow nodes) in the
+    // memory pools
+    constexpr std::uint32_t NumPriceLevels = 50;
+
+    // prices are quoted in cents from $1 up, in 1/100 cents below
+    constexpr itch::price_t OneDollar = 10000;
+    constexpr itch::price_t PennyTick = 100;
+    constexpr itch::price_t SubPennyTick = 1;
+
+} // namespace
+
+
+namespace itch {
+
+    namespace detail {
+
+        template <Side S, typename Level>
+        price_ladder<S, Level>::overflow_nodes::overflow_nodes() noexcept
+                : pool(sizeof(std::pair<price_t const, price_level*>) + StdMapNodeExtra,
+                        NumPriceLevels)
+                , resource(pool)
+        {
+            // empty
+        }
+
+        template <Side S, typename Level>
+        price_ladder<S, Level>::price_ladder() noexcept
+                : pool_(sizeof(Level), NumPriceLevels)
+                , overflow_nodes_(std::make_unique<overflow_nodes>())
+                , overflow_(&overflow_nodes_->resource)
+        {
+            // empty
+        }
+
+        template <Side S, typename Level>
+        price_level&
+        price_ladder<S, Level>::find_or_add(price_t price) noexcept
+        {
+            // may throw, in which case we abort
+            try {
+                if (tick_ == 0) {
+                    // first level, the tick size follows the price
+                    tick_ = (price >= OneDollar) ? PennyTick : SubPennyTick;
+                    slots_ = std::make_unique<price_level*[]>(Width);
+                    recenter(price);
+                }
+
+                std::uint32_t slot = slot_of(price);
+                if (slot == NoSlot && price % tick_ == 0
+                        && (count_ == 0 || (std::int64_t(price) - origin_) * Dir < 0)) {
+                    // a better price than the ladder holds, or an empty ladder
+                    recenter(price);
+                    slot = slot_of(price);
+                    DEBUG_ASSERT(slot != NoSlot);
+                }
+
+                if (slot != NoSlot) {
+                    if (slots_[slot] == nullptr)
+                        insert(slot, new (pool_.allocate_node()) Level(price, 0));
+                    return *slots_[slot];
+                }
+
+                auto [itr, inserted] = overflow_.try_emplace(price, nullptr);
+                if (inserted)
+                    itr->second = new (pool_.allocate_node()) Level(price, 0);
+                return *itr->second;
+            } catch (std::exception const& e) {
+                std::fprintf(
+                        stderr, "[ERROR] exception in %s: %s\n", __builtin_FUNCTION(), e.what());
+                std::abort();
+            }
+        }
+
+        template <Side S, typename Level>
+        void
+        price_ladder<S, Level>::erase(price_level& pl) noexcept
+        {
+            std::uint32_t const slot = slot_of(pl.price());
+            if (slot != NoSlot && slots_[slot] == &pl) {
+                slots_[slot] = nullptr;
+                --count_;
+
+                if (slot == best_) {
+                    best_ = NoSlot;
+                    for (std::uint32_t i = slot + 1; count_ != 0 && i < Width; ++i) {
+                        if (slots_[i] != nullptr) {
+                            best_ = i;
+                            break;
+                        }
+                    }
+                }
+
+                // the inside moved out of the ladder
+                if (count_ == 0 && !overflow_.empty())
+                    recenter(overflow_.begin()->first);
+            } else {
+                DEBUG_ASSERT(overflow_.count(pl.price()) == 1);
+                overflow_.erase(pl.price());
+            }
+
+            pool_.deallocate_node(&pl);
+        }
+
+        template <Side S, typename Level>
+        price_level const*
+        price_ladder<S, Level>::best() const noexcept
+        {
+            price_level const* pl = (best_ != NoSlot) ? slots_[best_] : nullptr;
+            if (!overflow_.empty()) {
+                price_level const* o = overflow_.begin()->second;
+                if (pl == nullptr || better()(o->price(), pl->price()))
+                    pl = o;
+            }
+            return pl;
+        }
+
+        template <Side S, typename Level>
+        std::vector<price_level>
+        price_ladder<S, Level>::levels() const
+        {
+            std::vector<price_level> v;
+            v.reserve(count_ + overflow_.size());
+
+            // both are in best-first order, overflow levels may be
+            // interleaved with the ladder's (off the tick grid)
+            auto itr = overflow_.begin();
+            for (std::uint32_t slot = 0; count_ != 0 && slot < Width; ++slot) {
+                if (slots_[slot] == nullptr)
+                    continue;
+
+                for (; itr != overflow_.end() && better()(itr->first, slots_[slot]->price()); ++itr)
+                    v.push_back(*itr->second);
+                v.push_back(*slots_[slot]);
+            }
+            for (; itr != overflow_.end(); ++itr)
+                v.push_back(*itr->second);
+
+            return v;
+        }
+
+        template <Side S, typename Level>
+        void
+        price_ladder<S, Level>::depth(std::span<pq> out) const noexcept
+        {
+            std::size_t n = 0;
+            auto put = [&out, &n](price_level const* pl) noexcept {
+                out[n++] = {pl->price(), pl->agg_qty()};
+            };
+
+            // merged as in levels(), from the best slot on
+            auto itr = overflow_.begin();
+            for (std::uint32_t slot = best_; count_ != 0 && slot < Width; ++slot) {
+                price_level const* pl = slots_[slot];
+                if (pl == nullptr)
+                    continue;
+
+                for (; itr != overflow_.end() && better()(itr->first, pl->price()); ++itr) {
+                    if (n == out.size())
+                        return;
+                    put(itr->second);
+                }
+                if (n == out.size())
+                    return;
+                put(pl);
+            }
+            for (; itr != overflow_.end() && n < out.size(); ++itr)
+                put(itr->second);
+            std::fill(out.begin() + n, out.end(), pq());
+        }
+
+        template <Side S, typename Level>
+        std::size_t
+        price_ladder<S, Level>::max_levels() const noexcept
+        {
+            return pool_.max_used();
+        }
+
+        // private
+
+        /// the ladder slot for a price, or NoSlot if it has none
+        template <Side S, typename Level>
+        std::uint32_t
+        price_ladder<S, Level>::slot_of(price_t price) const noexcept
+        {
+            std::int64_t const distance = (std::int64_t(price) - origin_) * Dir;
+            if (tick_ == 0 || distance < 0 || distance % tick_ != 0)
+                return NoSlot;
+
+            std::int64_t const slot = distance / tick_;
+            return (slot < std::int64_t(Width)) ? static_cast<std::uint32_t>(slot) : NoSlot;
+        }
+
+        template <Side S, typename Level>
+        price_t
+        price_ladder<S, Level>::price_of(std::uint32_t slot) const noexcept
+        {
+            return static_cast<price_t>(origin_ + Dir * std::int64_t(slot) * tick_);
+        }
+
+        template <Side S, typename Level>
+        void
+        price_ladder<S, Level>::insert(std::uint32_t slot, price_level* pl) noexcept
+        {
+            DEBUG_ASSERT(slots_[slot] == nullptr);
+            slots_[slot] = pl;
+            ++count_;
+            best_ = std::min(best_, slot);
+        }
+
+        /// Moves the ladder so that best sits a quarter of the way in,
+        /// leaving room for better prices. The slots are shifted in place
+        /// by the ticks the ladder moves, levels falling off either end
+        /// go to the overflow and overflow levels falling into it come
+        /// back.
+        template <Side S, typename Level>
+        void
+        price_ladder<S, Level>::recenter(price_t best) noexcept
+        {
+            // the overflow may throw, in which case we abort
+            try {
+                std::int64_t const aligned = best - best % tick_;
+                std::int64_t origin = aligned - Dir * std::int64_t(Width / 4) * tick_;
+                if constexpr (S == Side::Ask)
+                    origin = std::max<std::int64_t>(origin, 0);
+                else
+                    origin = std::min<std::int64_t>(origin, std::numeric_limits<price_t>::max());
+
+                // slots move towards slot 0 for a positive shift
+                std::int64_t const distance = (origin - origin_) * Dir;
+                std::int64_t const shift = distance / tick_;
+                if (distance % tick_ != 0 || shift >= std::int64_t(Width)
+                        || shift <= -std::int64_t(Width)) {
+                    spill(0, Width);
+                } else if (shift < 0) {
+                    auto const n = static_cast<std::uint32_t>(-shift);
+                    spill(Width - n, Width);
+                    std::memmove(&slots_[n], &slots_[0], (Width - n) * sizeof(slots_[0]));
+                    std::fill_n(&slots_[0], n, nullptr);
+                    if (best_ != NoSlot)
+                        best_ += n;
+                } else if (shift > 0) {
+                    auto const n = static_cast<std::uint32_t>(shift);
+                    spill(0, n);
+                    std::memmove(&slots_[0], &slots_[n], (Width - n) * sizeof(slots_[0]));
+                    std::fill_n(&slots_[Width - n], n, nullptr);
+                    best_ = NoSlot;
+                    for (std::uint32_t i = 0; count_ != 0 && i < Width; ++i) {
+                        if (slots_[i] != nullptr) {
+                            best_ = i;
+                            break;
+                        }
+                    }
+                }
+                if (count_ == 0)
+                    best_ = NoSlot;
+                origin_ = origin;
+
+                // overflow is in best-first order, like the slots
+                std::int64_t const end = origin_ + Dir * std::int64_t(Width) * tick_;
+                auto itr = overflow_.lower_bound(static_cast<price_t>(origin_));
+                while (itr != overflow_.end() && (end - std::int64_t(itr->first)) * Dir > 0) {
+                    std::uint32_t const slot = slot_of(itr->first);
+                    if (slot == NoSlot) {
+                        ++itr;
+                        continue;
+                    }
+                    insert(slot, itr->second);
+                    itr = overflow_.erase(itr);
+                }
+            } catch (std::exception const& e) {
+                std::fprintf(
+                        stderr, "[ERROR] exception in %s: %s\n", __builtin_FUNCTION(), e.what());
+                std::abort();
+            }
+        }
+
+        /// moves the levels in slots [first, last) to the overflow, may
+        /// throw
+        template <Side S, typename Level>
+        void
+        price_ladder<S, Level>::spill(std::uint32_t first, std::uint32_t last)
+        {
+            for (std::uint32_t slot = first; count_ != 0 && slot < last; ++slot) {
+                if (slots_[slot] != nullptr) {
+                    overflow_.emplace(price_of(slot), slots_[slot]);
+                    slots_[slot] = nullptr;
+                    --count_;
+                }
+            }
+        }
+
+        template class price_ladder<Side::Bid, price_level>;
+        template class price_ladder<Side::Bid, handled_level>;
+        template class price_ladder<Side::Ask, price_level>;
+        template class price_ladder<Side::Ask, handled_level>;
+
+    } // namespace detail
+
+    template <typename Level>
+    basic_ladder_book<Level>::basic_ladder_book() noexcept
+            : bids_()
+            , asks_()
+    {
+        // empty
+    }
+
+    template <typename Level>
+    void
+    basic_ladder_book<Level>::add_order(order& order) noexcept
+    {
+        price_level& pl = (order.side == Side::Bid) ? bids_.find_or_add(order.price)
+                                                    : asks_.find_or_add(order.price);
+        pl.inc_qty(order.qty);
+        order.pl = &pl;
+    }
+
+    template <typename Level>
+    void
+    basic_ladder_book<Level>::delete_order(order& order) noexcept
+    {
+        DEBUG_ASSERT(order.pl != nullptr);
+        if (order.pl == nullptr)
+            return;
+
+        DEBUG_ASSERT(order.qty <= order.pl->agg_qty());
+
+        // decrease qty on price level, if it goes to zero, delete the level
+        if (order.qty < order.pl->agg_qty()) {
+            order.pl->dec_qty(order.qty);
+        } else if (order.side == Side::Bid) {
+            bids_.erase(*order.pl);
+        } else {
+            asks_.erase(*order.pl);
+        }
+
+        order.clear();
+    }
+
+    template <typename Level>
+    void
+    basic_ladder_book<Level>::cancel_order(order& order, qty_t remove_qty) noexcept
+    {
+        DEBUG_ASSERT(remove_qty <= order.qty);
+
+        if (remove_qty < order.qty) {
+            order.qty -= remove_qty;
+            order.pl->dec_qty(remove_qty);
+        } else {
+            // this cancel will remove the order (may happen if caused
+            // by an execution)
+            delete_order(order);
+        }
+    }
+
+    template <typename Level>
+    void
+    basic_ladder_book<Level>::replace_order(order& old_order, order& new_order) noexcept
+    {
+        DEBUG_ASSERT(old_order.pl != nullptr);
+        DEBUG_ASSERT(new_order.pl == nullptr);
+
+        delete_order(old_order);
+        DEBUG_ASSERT(old_order.pl == nullptr);
+
+        add_order(new_order);
+        DEBUG_ASSERT(new_order.pl != nullptr);
+    }
+
+    template <typename Level>
+    std::vector<price_level>
+    basic_ladder_book<Level>::bids() const
+    {
+        return bids_.levels();
+    }
+
+    template <typename Level>
+    std::vector<price_level>
+    basic_ladder_book<Level>::asks() const
+    {
+        return asks_.levels();
+    }
+
+    template <typename Level>
+    pq
+    basic_ladder_book<Level>::best_bid() const noexcept
+    {
+        price_level const* pl = bids_.best();
+        if (pl == nullptr)
+            return {0, 0};
+
+        return {pl->price(), pl->agg_qty()};
+    }
+
+    template <typename Level>
+    pq
+    basic_ladder_book<Level>::best_ask() const noexcept
+    {
+        price_level const* pl = asks_.best();
+        if (pl == nullptr)
+            return {0, 0};
+
+        return {pl->price(), pl->agg_qty()};
+    }
+
+    template <typename Level>
+    void
+    basic_ladder_book<Level>::depth(
+            std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept
+    {
+        DEBUG_ASSERT(n <= bids.size() && n <= asks.size());
+
+        bids_.depth(bids.first(n));
+        asks_.depth(asks.first(n));
+    }
+
+    template <typename Level>
+    std::size_t
+    basic_ladder_book<Level>::max_bid_book_depth() const noexcept
+    {
+        return bids_.max_levels();
+    }
+
+    template <typename Level>
+    std::size_t
+    basic_ladder_book<Level>::max_ask_book_depth() const noexcept
+    {
+        return asks_.max_levels();
+    }
+
+    template <typename Level>
+    std::size_t
+    basic_ladder_book<Level>::max_bid_order_depth() const noexcept
+    {
+        return max_bid_order_depth_;
+    }
+
+    template <typename Level>
+    std::size_t
+    basic_ladder_book<Level>::max_ask_order_depth() const noexcept
+    {
+        return max_ask_order_depth_;
+    }
+
+    // explicit instantiations
+    template class basic_ladder_book<price_level>;
+    template class basic_ladder_book<handled_level>;
+
+} // namespace itch
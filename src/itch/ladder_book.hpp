@@ -0,0 +1,136 @@
+#pragma once
+
+#include "core.hpp"
+#include "price_level.hpp"
+#include "allocator/memory_pool.hpp"
+#include "allocator/memory_resource.hpp"
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <functional> // std::greater, std::less
+#include <map>
+#include <memory>      // std::unique_ptr
+#include <memory_resource>
+#include <span>
+#include <type_traits> // std::conditional_t
+#include <vector>
+
+
+namespace itch {
+
+    namespace detail {
+
+        /// One side of a ladder_book.
+        ///
+        /// Levels near the inside live in a ladder: a fixed run of Width
+        /// slots, one per tick, with slot 0 the best price the ladder can
+        /// hold and higher slots further from the inside. A level's slot
+        /// is computed from its price, so finding, adding and removing it
+        /// is O(1); the best level's slot is cached. Levels the ladder
+        /// can't hold (too far out, or not on the tick grid) go to a
+        /// sorted overflow map.
+        ///
+        /// The ladder is re-centered around a new best price when a
+        /// better price than it can hold comes in, or when it empties
+        /// while the overflow still has levels. Re-centering shifts the
+        /// slots in place, and only the levels falling off the far end
+        /// go to the overflow, whose nodes come from a pool of their
+        /// own. Slots point to pooled price_levels, so re-centering never
+        /// moves a level and the level pointers held by orders stay
+        /// valid.
+        template <Side S, typename Level = price_level>
+        class price_ladder
+        {
+        public:
+            /// ticks covered by the ladder
+            static constexpr std::size_t Width = 256;
+
+        private:
+            static constexpr std::uint32_t NoSlot = Width;
+            static constexpr std::int64_t Dir = (S == Side::Bid) ? -1 : 1;
+            using better = std::conditional_t<S == Side::Bid, std::greater<>, std::less<>>;
+
+            /// the nodes of overflow_, apart so that their resource
+            /// doesn't move
+            struct overflow_nodes
+            {
+                memory_pool pool;
+                pool_resource<> resource;
+
+                overflow_nodes() noexcept;
+            };
+
+        private:
+            memory_pool pool_;
+            std::unique_ptr<price_level*[]> slots_; ///< allocated when first anchored
+            std::int64_t origin_ = 0;               ///< price of slot 0
+            price_t tick_ = 0;
+            std::uint32_t best_ = NoSlot;
+            std::uint32_t count_ = 0; ///< levels in the ladder
+            std::unique_ptr<overflow_nodes> overflow_nodes_;
+            std::pmr::map<price_t, price_level*, better> overflow_;
+
+        public:
+            price_ladder() noexcept;
+
+            /// returns the level at price, creating it (with 0 qty) if
+            /// there isn't one
+            price_level& find_or_add(price_t) noexcept;
+
+            /// erases a level and frees it
+            void erase(price_level&) noexcept;
+
+            price_level const* best() const noexcept;
+
+            /// all levels, best first
+            std::vector<price_level> levels() const;
+
+            /// copies the best out.size() levels to out, {0, 0} past the
+            /// last one
+            void depth(std::span<pq> out) const noexcept;
+
+            std::size_t max_levels() const noexcept;
+
+        private:
+            std::uint32_t slot_of(price_t) const noexcept;
+            price_t price_of(std::uint32_t slot) const noexcept;
+            void insert(std::uint32_t slot, price_level*) noexcept;
+            void recenter(price_t best) noexcept;
+            void spill(std::uint32_t first, std::uint32_t last);
+        };
+
+    } // namespace detail
+
+    /// Two-sided book on dense price ladders, see detail::price_ladder.
+    template <typename Level = price_level>
+    class basic_ladder_book
+    {
+    private:
+        detail::price_ladder<Side::Bid, Level> bids_;
+        detail::price_ladder<Side::Ask, Level> asks_;
+        std::size_t max_bid_order_depth_ = 0; ///< stats only
+        std::size_t max_ask_order_depth_ = 0; ///< stats only
+
+    public:
+        basic_ladder_book() noexcept;
+        void add_order(order&) noexcept;
+        void delete_order(order&) noexcept;
+        void cancel_order(order&, qty_t remove_qty) noexcept;
+        void replace_order(order& old_order, order& new_order) noexcept;
+
+        // accessors
+    public:
+        /// snapshots of the levels, best first. not for the hot path
+        std::vector<price_level> bids() const;
+        std::vector<price_level> asks() const;
+        pq best_bid() const noexcept;
+        pq best_ask() const noexcept;
+        void depth(std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept;
+        std::size_t max_bid_book_depth() const noexcept;
+        std::size_t max_ask_book_depth() const noexcept;
+        std::size_t max_bid_order_depth() const noexcept;
+        std::size_t max_ask_order_depth() const noexcept;
+    };
+
+    using ladder_book = basic_ladder_book<>;
+
+} // namespace itch
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "core.hpp"
+#include "price_level.hpp"
+#include "util/assert.hpp"
+#include <cstddef> // std::size_t
+#include <vector>
+
+
+namespace itch {
+
+    /// A price_level that knows its own level_handle, the level type of
+    /// the book a compact_book wraps. Books used with plain orders keep
+    /// their levels as bare price_levels.
+    class handled_level : public price_level
+    {
+    private:
+        level_handle handle_ = InvalidLevelHandle;
+
+    public:
+        using price_level::price_level;
+
+        constexpr level_handle
+        handle() const noexcept
+        {
+            return handle_;
+        }
+
+        void
+        set_handle(level_handle h) noexcept
+        {
+            handle_ = h;
+        }
+    };
+
+    /// Resolves the 32-bit level_handles stored in compact_orders to the
+    /// handled_levels owned by a book. Released handles are re-used
+    /// before the table grows, so handles stay dense and the table stays
+    /// as small as the deepest the book has ever been.
+    class level_table
+    {
+    private:
+        std::vector<handled_level*> levels_;
+        std::vector<level_handle> free_;
+
+    public:
+        /// returns the handle of the given level, assigning one if it
+        /// doesn't have one yet. may throw std::bad_alloc
+        inline level_handle attach(handled_level&);
+
+        /// frees the level's handle, must be called before the level is
+        /// erased from the book
+        inline void release(level_handle) noexcept;
+
+        inline handled_level* operator[](level_handle) const noexcept;
+
+        /// number of handles in use
+        inline std::size_t size() const noexcept;
+    };
+
+    /**********************************************************************/
+
+    level_handle
+    level_table::attach(handled_level& pl)
+    {
+        if (pl.handle() != InvalidLevelHandle)
+            return pl.handle();
+
+        level_handle h = InvalidLevelHandle;
+        if (free_.empty()) {
+            h = static_cast<level_handle>(levels_.size());
+            levels_.push_back(&pl);
+
+            // release() must not allocate
+            free_.reserve(levels_.capacity());
+        } else {
+            h = free_.back();
+            free_.pop_back();
+            levels_[h] = &pl;
+        }
+
+        pl.set_handle(h);
+        return h;
+    }
+
+    void
+    level_table::release(level_handle h) noexcept
+    {
+        DEBUG_ASSERT(h < levels_.size());
+        DEBUG_ASSERT(levels_[h] != nullptr);
+        levels_[h]->set_handle(InvalidLevelHandle);
+        levels_[h] = nullptr;
+        free_.push_back(h);
+    }
+
+    handled_level*
+    level_table::operator[](level_handle h) const noexcept
+    {
+        DEBUG_ASSERT(h < levels_.size());
+        return levels_[h];
+    }
+
+    std::size_t
+    level_table::size() const noexcept
+    {
+        return levels_.size() - free_.size();
+    }
+
+} // namespace itch
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "price_level.hpp"
+#include <list>
+#include <memory> // std::allocator
+
+
+namespace itch {
+
+    /// A price_level (or a Level derived from one) in a std::list that
+    /// remembers where in the list it is, so a book that only has an
+    /// order's pl can erase the level in O(1) rather than searching the
+    /// list for it.
+    template <template <typename> class Allocator = std::allocator, typename Level = price_level>
+    class listed_level : public Level
+    {
+    public:
+        using list_type = std::list<listed_level, Allocator<listed_level>>;
+
+    private:
+        typename list_type::const_iterator self_;
+
+    public:
+        using Level::Level;
+
+        /// emplaces a level into the list before pos and points it at
+        /// its own node. may throw what emplace throws
+        static inline listed_level& emplace(list_type&, typename list_type::const_iterator pos,
+                price_t, qty_t);
+
+        /// erases the level pl points to from the list holding it
+        static inline void erase(list_type&, price_level* pl) noexcept;
+    };
+
+    /**********************************************************************/
+
+    template <template <typename> class Allocator, typename Level>
+    listed_level<Allocator, Level>&
+    listed_level<Allocator, Level>::emplace(
+            list_type& list, typename list_type::const_iterator pos, price_t p, qty_t q)
+    {
+        auto itr = list.emplace(pos, p, q);
+        itr->self_ = itr;
+        return *itr;
+    }
+
+    template <template <typename> class Allocator, typename Level>
+    void
+    listed_level<Allocator, Level>::erase(list_type& list, price_level* pl) noexcept
+    {
+        list.erase(static_cast<listed_level*>(pl)->self_);
+    }
+
+} // namespace itch
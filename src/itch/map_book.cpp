@@ -1,6 +1,11 @@
 #include "map_book.hpp"
+#include "book.hpp" // detail::fill_depth
+#include "level_table.hpp" // handled_level
 #include <fmt/format.h>
+#include <algorithm> // std::max
 #include <cstdint>
+#include <memory> // std::make_unique
+#include <ranges> // std::views::values
 
 
 namespace { // unnamed
@@ -17,34 +22,51 @@ namespace { // unnamed
 
 namespace itch {
 
-    map_book::map_book() noexcept
-            // : bids_()
-            // , asks_()
-            : bid_pool_(
-                    sizeof(std::pair<price_t const, price_level>) + StdMapNodeExtra, NumPriceLevels)
-            , bids_(bid_pool_)
-            , ask_pool_(sizeof(std::pair<price_t const, price_level>) + StdMapNodeExtra,
-                      NumPriceLevels)
-            , asks_(ask_pool_)
+    template <typename Level>
+    basic_map_book<Level>::own_pools::own_pools() noexcept
+            : bid_pool(
+                    sizeof(std::pair<price_t const, Level>) + StdMapNodeExtra, NumPriceLevels)
+            , ask_pool(
+                    sizeof(std::pair<price_t const, Level>) + StdMapNodeExtra, NumPriceLevels)
+            , bid_resource(bid_pool)
+            , ask_resource(ask_pool)
     {
         // empty
     }
 
+    template <typename Level>
+    basic_map_book<Level>::basic_map_book() noexcept
+            : own_pools_(std::make_unique<own_pools>())
+            , bids_(&own_pools_->bid_resource)
+            , asks_(&own_pools_->ask_resource)
+    {
+        // empty
+    }
+
+    template <typename Level>
+    basic_map_book<Level>::basic_map_book(std::pmr::memory_resource* resource) noexcept
+            : bids_(resource)
+            , asks_(resource)
+    {
+        // empty
+    }
+
+    template <typename Level>
     void
-    map_book::add_order(order& order) noexcept
+    basic_map_book<Level>::add_order(order& order) noexcept
     {
         // emplace functions may throw, in which case we abort
         try {
             if (order.side == Side::Bid) {
                 if (bids_.empty()) {
                     auto [itr, success]
-                            = bids_.emplace(order.price, price_level(order.price, order.qty));
+                            = bids_.emplace(order.price, Level(order.price, order.qty));
                     order.pl = &itr->second;
                 } else {
                     auto o_itr = bids_.find(order.price);
                     if (o_itr == bids_.end()) {
                         auto [itr, success]
-                                = bids_.emplace(order.price, price_level(order.price, order.qty));
+                                = bids_.emplace(order.price, Level(order.price, order.qty));
                         order.pl = &itr->second;
                     } else {
                         o_itr->second.inc_qty(order.qty);
@@ -54,13 +76,13 @@ namespace itch {
             } else if (order.side == Side::Ask) {
                 if (asks_.empty()) {
                     auto [itr, success]
-                            = asks_.emplace(order.price, price_level(order.price, order.qty));
+                            = asks_.emplace(order.price, Level(order.price, order.qty));
                     order.pl = &itr->second;
                 } else {
                     auto o_itr = asks_.find(order.price);
                     if (o_itr == asks_.end()) {
                         auto [itr, success]
-                                = asks_.emplace(order.price, price_level(order.price, order.qty));
+                                = asks_.emplace(order.price, Level(order.price, order.qty));
                         order.pl = &itr->second;
                     } else {
                         o_itr->second.inc_qty(order.qty);
@@ -72,10 +94,16 @@ namespace itch {
             std::fprintf(stderr, "[ERROR] exception in %s: %s\n", __builtin_FUNCTION(), e.what());
             std::abort();
         }
+
+        if (order.side == Side::Bid)
+            max_bid_book_depth_ = std::max(max_bid_book_depth_, bids_.size());
+        else
+            max_ask_book_depth_ = std::max(max_ask_book_depth_, asks_.size());
     }
 
+    template <typename Level>
     void
-    map_book::delete_order(order& order) noexcept
+    basic_map_book<Level>::delete_order(order& order) noexcept
     {
         DEBUG_ASSERT(order.pl != nullptr);
         if (order.pl == nullptr)
@@ -96,8 +124,9 @@ namespace itch {
         order.clear();
     }
 
+    template <typename Level>
     void
-    map_book::cancel_order(order& order, qty_t remove_qty) noexcept
+    basic_map_book<Level>::cancel_order(order& order, qty_t remove_qty) noexcept
     {
         DEBUG_ASSERT(remove_qty <= order.qty);
 
@@ -111,8 +140,9 @@ namespace itch {
         }
     }
 
+    template <typename Level>
     void
-    map_book::replace_order(order& old_order, order& new_order) noexcept
+    basic_map_book<Level>::replace_order(order& old_order, order& new_order) noexcept
     {
         DEBUG_ASSERT(old_order.pl != nullptr);
         DEBUG_ASSERT(new_order.pl == nullptr);
@@ -124,20 +154,23 @@ namespace itch {
         DEBUG_ASSERT(new_order.pl != nullptr);
     }
 
-    decltype(map_book::bids_) const&
-    map_book::bids() const noexcept
+    template <typename Level>
+    typename basic_map_book<Level>::bid_map const&
+    basic_map_book<Level>::bids() const noexcept
     {
         return bids_;
     }
 
-    decltype(map_book::asks_) const&
-    map_book::asks() const noexcept
+    template <typename Level>
+    typename basic_map_book<Level>::ask_map const&
+    basic_map_book<Level>::asks() const noexcept
     {
         return asks_;
     }
 
+    template <typename Level>
     pq
-    map_book::best_bid() const noexcept
+    basic_map_book<Level>::best_bid() const noexcept
     {
         if (bids_.empty())
             return {0, 0};
@@ -145,8 +178,9 @@ namespace itch {
         return {bids_.begin()->second.price(), bids_.begin()->second.agg_qty()};
     }
 
+    template <typename Level>
     pq
-    map_book::best_ask() const noexcept
+    basic_map_book<Level>::best_ask() const noexcept
     {
         if (asks_.empty())
             return {0, 0};
@@ -154,16 +188,33 @@ namespace itch {
         return {asks_.begin()->second.price(), asks_.begin()->second.agg_qty()};
     }
 
+    template <typename Level>
+    void
+    basic_map_book<Level>::depth(
+            std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept
+    {
+        DEBUG_ASSERT(n <= bids.size() && n <= asks.size());
+
+        detail::fill_depth(std::views::values(bids_), bids.first(n));
+        detail::fill_depth(std::views::values(asks_), asks.first(n));
+    }
+
+    template <typename Level>
     std::size_t
-    map_book::max_bid_pool_used() const noexcept
+    basic_map_book<Level>::max_bid_book_depth() const noexcept
     {
-        return bid_pool_.max_used();
+        return max_bid_book_depth_;
     }
 
+    template <typename Level>
     std::size_t
-    map_book::max_ask_pool_used() const noexcept
+    basic_map_book<Level>::max_ask_book_depth() const noexcept
     {
-        return ask_pool_.max_used();
+        return max_ask_book_depth_;
     }
 
+    // explicit instantiations
+    template class basic_map_book<price_level>;
+    template class basic_map_book<handled_level>;
+
 } // namespace itch
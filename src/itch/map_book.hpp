@@ -3,31 +3,50 @@
 #include "core.hpp"
 #include "price_level.hpp"
 #include "allocator/memory_pool.hpp"
-#include "allocator/mp_allocator.hpp"
+#include "allocator/memory_resource.hpp"
 #include <cstddef>    // std::size_t
 #include <functional> // std::greater, std::less
 #include <map>
+#include <memory> // std::unique_ptr
+#include <memory_resource>
+#include <span>
 
 
 namespace itch {
 
-    /// Two-sided book
-    class map_book
+    /// Two-sided book on std::pmr::maps. Levels come from a memory_pool
+    /// per side, or from a memory_resource the book is given, e.g. a
+    /// pool_resource over a pool shared by many books.
+    template <typename Level = price_level>
+    class basic_map_book
     {
     private:
-        // std::map<price_t, price_level, std::greater<>> bids_;
-        // std::map<price_t, price_level, std::less<>> asks_;
-        memory_pool bid_pool_;
-        std::map<price_t, price_level, std::greater<>,
-                mp_allocator<std::pair<price_t const, price_level>>>
-                bids_;
-        memory_pool ask_pool_;
-        std::map<price_t, price_level, std::less<>,
-                mp_allocator<std::pair<price_t const, price_level>>>
-                asks_;
+        /// the pools of a book that isn't given a resource
+        struct own_pools
+        {
+            memory_pool bid_pool;
+            memory_pool ask_pool;
+            pool_resource<> bid_resource;
+            pool_resource<> ask_resource;
+
+            own_pools() noexcept;
+        };
+
+        using bid_map = std::pmr::map<price_t, Level, std::greater<>>;
+        using ask_map = std::pmr::map<price_t, Level, std::less<>>;
+
+    private:
+        std::unique_ptr<own_pools> own_pools_; ///< unless given a resource
+        bid_map bids_;
+        ask_map asks_;
+        std::size_t max_bid_book_depth_ = 0; ///< stats only
+        std::size_t max_ask_book_depth_ = 0; ///< stats only
 
     public:
-        map_book() noexcept;
+        basic_map_book() noexcept;
+
+        /// allocates the levels of both sides from resource
+        explicit basic_map_book(std::pmr::memory_resource* resource) noexcept;
         void add_order(order&) noexcept;
         void delete_order(order&) noexcept;
         void cancel_order(order&, qty_t remove_qty) noexcept;
@@ -35,12 +54,25 @@ namespace itch {
 
         // accessors
     public:
-        decltype(bids_) const& bids() const noexcept;
-        decltype(asks_) const& asks() const noexcept;
+        bid_map const& bids() const noexcept;
+        ask_map const& asks() const noexcept;
         pq best_bid() const noexcept;
         pq best_ask() const noexcept;
-        std::size_t max_bid_pool_used() const noexcept;
-        std::size_t max_ask_pool_used() const noexcept;
+        void depth(std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept;
+        std::size_t max_bid_book_depth() const noexcept;
+        std::size_t max_ask_book_depth() const noexcept;
+        constexpr std::size_t
+        max_bid_order_depth() const noexcept
+        {
+            return 0;
+        }
+        constexpr std::size_t
+        max_ask_order_depth() const noexcept
+        {
+            return 0;
+        }
     };
 
+    using map_book = basic_map_book<>;
+
 } // namespace itch
@@ -1,10 +1,13 @@
 #include "mp_book.hpp"
+#include "book.hpp" // detail::fill_depth
+#include "level_table.hpp" // handled_level
 #include "util/assert.hpp"
-#include <algorithm> // std::find_if
+#include <algorithm> // std::find_if, std::max
 #include <cstdint>
 #include <cstdio>  // std::fprintf
 #include <cstdlib> // std::abort
 #include <exception>
+#include <memory> // std::make_unique
 
 
 namespace { // unnamed
@@ -13,7 +16,7 @@ namespace { // unnamed
     // should account for when creating memory pool
     constexpr std::uint32_t StdListNodeExtra = sizeof(std::uintptr_t) + sizeof(std::uintptr_t);
 
-    // allocate this many price levels in the memory pool
+    // allocate this many price levels in a book's own memory pools
     constexpr std::uint32_t NumPriceLevels = 50;
 
 } // namespace
@@ -21,44 +24,57 @@ namespace { // unnamed
 
 namespace itch {
 
-    mp_book::mp_book() noexcept
-            : bid_pool_(sizeof(price_level) + StdListNodeExtra, NumPriceLevels)
-            , ask_pool_(sizeof(price_level) + StdListNodeExtra, NumPriceLevels)
-            , bids_(bid_pool_)
-            , asks_(ask_pool_)
+    template <typename Level>
+    basic_mp_book<Level>::shared_pools::shared_pools(std::size_t levels) noexcept
+            : bids(sizeof(level_node) + StdListNodeExtra, levels)
+            , asks(sizeof(level_node) + StdListNodeExtra, levels)
     {
         // empty
     }
 
+    template <typename Level>
+    basic_mp_book<Level>::basic_mp_book() noexcept
+            : own_pools_(std::make_unique<shared_pools>(NumPriceLevels))
+            , bids_(own_pools_->bids)
+            , asks_(own_pools_->asks)
+    {
+        // empty
+    }
+
+    template <typename Level>
+    basic_mp_book<Level>::basic_mp_book(shared_pools& pools) noexcept
+            : bids_(pools.bids)
+            , asks_(pools.asks)
+    {
+        // empty
+    }
+
+    template <typename Level>
     void
-    mp_book::add_order(order& order) noexcept
+    basic_mp_book<Level>::add_order(order& order) noexcept
     {
         auto* book = (order.side == Side::Bid) ? &bids_ : &asks_;
 
         // emplace functions may throw, in which case we abort
         try {
-            if (book->empty()) {
-                // initial price_level
-                order.pl = &book->emplace_front(order.price, order.qty);
+            // find location in book
+            auto pl_itr = std::find_if(book->begin(), book->end(), [&order](auto const& pl) {
+                return (order.side == Side::Bid) ? pl.price() <= order.price
+                                                 : pl.price() >= order.price;
+            });
+
+            if (pl_itr != book->end() && pl_itr->price() == order.price) {
+                // price_level exists, adjust qty
+                pl_itr->inc_qty(order.qty);
+                order.pl = &(*pl_itr);
             } else {
-                // find location in book
-                auto pl_itr = std::find_if(book->begin(), book->end(), [&order](auto const& pl) {
-                    return (order.side == Side::Bid) ? pl.price() <= order.price
-                                                     : pl.price() >= order.price;
-                });
-
-                if (pl_itr == book->end()) {
-                    // establish price_level (at bottom of book)
-                    order.pl = &book->emplace_back(order.price, order.qty);
-                } else if (pl_itr->price() == order.price) {
-                    // price_level exists, adjust qty
-                    pl_itr->inc_qty(order.qty);
-                    order.pl = &(*pl_itr);
-                } else {
-                    // establish new price level (in middle of book)
-                    auto i_itr = book->emplace(pl_itr, order.price, order.qty);
-                    order.pl = &(*i_itr);
-                }
+                // establish new price level ahead of the first worse one,
+                // at the bottom of the book if there is none
+                order.pl = &level_node::emplace(*book, pl_itr, order.price, order.qty);
+
+                std::size_t& max_depth =
+                        (order.side == Side::Bid) ? max_bid_book_depth_ : max_ask_book_depth_;
+                max_depth = std::max(max_depth, book->size());
             }
         } catch (std::exception const& e) {
             std::fprintf(stderr, "[ERROR] exception in %s: %s\n", __builtin_FUNCTION(), e.what());
@@ -66,8 +82,9 @@ namespace itch {
         }
     }
 
+    template <typename Level>
     void
-    mp_book::delete_order(order& order) noexcept
+    basic_mp_book<Level>::delete_order(order& order) noexcept
     {
         DEBUG_ASSERT(order.pl != nullptr);
         if (order.pl == nullptr)
@@ -79,22 +96,15 @@ namespace itch {
         if (order.qty < order.pl->agg_qty()) {
             order.pl->dec_qty(order.qty);
         } else {
-            if (order.side == Side::Bid) {
-                auto found_itr = std::find_if(bids_.begin(), bids_.end(),
-                        [&order](auto& pl) { return order.price == pl.price(); });
-                bids_.erase(found_itr);
-            } else {
-                auto found_itr = std::find_if(asks_.begin(), asks_.end(),
-                        [&order](auto& pl) { return order.price == pl.price(); });
-                asks_.erase(found_itr);
-            }
+            level_node::erase((order.side == Side::Bid) ? bids_ : asks_, order.pl);
         }
 
         order.clear();
     }
 
+    template <typename Level>
     void
-    mp_book::cancel_order(order& order, qty_t remove_qty) noexcept
+    basic_mp_book<Level>::cancel_order(order& order, qty_t remove_qty) noexcept
     {
         DEBUG_ASSERT(remove_qty <= order.qty);
 
@@ -108,8 +118,9 @@ namespace itch {
         }
     }
 
+    template <typename Level>
     void
-    mp_book::replace_order(order& old_order, order& new_order) noexcept
+    basic_mp_book<Level>::replace_order(order& old_order, order& new_order) noexcept
     {
         DEBUG_ASSERT(old_order.pl != nullptr);
         DEBUG_ASSERT(new_order.pl == nullptr);
@@ -121,20 +132,23 @@ namespace itch {
         DEBUG_ASSERT(new_order.pl != nullptr);
     }
 
-    decltype(mp_book::bids_) const&
-    mp_book::bids() const noexcept
+    template <typename Level>
+    typename basic_mp_book<Level>::level_list const&
+    basic_mp_book<Level>::bids() const noexcept
     {
         return bids_;
     }
 
-    decltype(mp_book::asks_) const&
-    mp_book::asks() const noexcept
+    template <typename Level>
+    typename basic_mp_book<Level>::level_list const&
+    basic_mp_book<Level>::asks() const noexcept
     {
         return asks_;
     }
 
+    template <typename Level>
     pq
-    mp_book::best_bid() const noexcept
+    basic_mp_book<Level>::best_bid() const noexcept
     {
         if (bids_.empty())
             return {0, 0};
@@ -142,8 +156,9 @@ namespace itch {
         return {bids_.front().price(), bids_.front().agg_qty()};
     }
 
+    template <typename Level>
     pq
-    mp_book::best_ask() const noexcept
+    basic_mp_book<Level>::best_ask() const noexcept
     {
         if (asks_.empty())
             return {0, 0};
@@ -151,28 +166,47 @@ namespace itch {
         return {asks_.front().price(), asks_.front().agg_qty()};
     }
 
+    template <typename Level>
+    void
+    basic_mp_book<Level>::depth(
+            std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept
+    {
+        DEBUG_ASSERT(n <= bids.size() && n <= asks.size());
+
+        detail::fill_depth(bids_, bids.first(n));
+        detail::fill_depth(asks_, asks.first(n));
+    }
+
+    template <typename Level>
     std::size_t
-    mp_book::max_bid_book_depth() const noexcept
+    basic_mp_book<Level>::max_bid_book_depth() const noexcept
     {
-        return bid_pool_.max_used();
+        return max_bid_book_depth_;
     }
 
+    template <typename Level>
     std::size_t
-    mp_book::max_ask_book_depth() const noexcept
+    basic_mp_book<Level>::max_ask_book_depth() const noexcept
     {
-        return ask_pool_.max_used();
+        return max_ask_book_depth_;
     }
 
+    template <typename Level>
     std::size_t
-    mp_book::max_bid_order_depth() const noexcept
+    basic_mp_book<Level>::max_bid_order_depth() const noexcept
     {
         return max_bid_order_depth_;
     }
 
+    template <typename Level>
     std::size_t
-    mp_book::max_ask_order_depth() const noexcept
+    basic_mp_book<Level>::max_ask_order_depth() const noexcept
     {
         return max_ask_order_depth_;
     }
 
+    // explicit instantiations
+    template class basic_mp_book<price_level>;
+    template class basic_mp_book<handled_level>;
+
 } // namespace itch
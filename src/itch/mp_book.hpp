@@ -1,28 +1,54 @@
 #pragma once
 
 #include "core.hpp"
+#include "listed_level.hpp"
 #include "price_level.hpp"
 #include "allocator/memory_pool.hpp"
 #include "allocator/mp_allocator.hpp"
 #include <cstddef> // std::size_t
-#include <list>
+#include <memory> // std::unique_ptr
+#include <span>
 
 
 namespace itch {
 
-    /// Two-sided book with memory-pooled bids and asks
-    class mp_book
+    /// Two-sided book with memory-pooled bids and asks. By default each
+    /// book has small pools of its own, or it draws its levels from
+    /// shared_pools common to many books.
+    template <typename Level = price_level>
+    class basic_mp_book
     {
     private:
-        memory_pool bid_pool_;
-        memory_pool ask_pool_;
-        std::list<price_level, mp_allocator<price_level>> bids_;
-        std::list<price_level, mp_allocator<price_level>> asks_;
+        using level_node = listed_level<mp_allocator, Level>;
+        using level_list = typename level_node::list_type;
+
+    public:
+        /// Level nodes for any number of books, one pool per side: a few
+        /// big blocks instead of two small pools per book, with room for
+        /// levels (per side) before they grow. Not thread safe, books
+        /// built on threads of their own need pools of their own.
+        struct shared_pools
+        {
+            memory_pool bids;
+            memory_pool asks;
+
+            explicit shared_pools(std::size_t levels = 16 * 1024) noexcept;
+        };
+
+    private:
+        std::unique_ptr<shared_pools> own_pools_; ///< unless shared
+        level_list bids_;
+        level_list asks_;
+        std::size_t max_bid_book_depth_ = 0;  ///< stats only
+        std::size_t max_ask_book_depth_ = 0;  ///< stats only
         std::size_t max_bid_order_depth_ = 0; ///< stats only
         std::size_t max_ask_order_depth_ = 0; ///< stats only
 
     public:
-        mp_book() noexcept;
+        basic_mp_book() noexcept;
+
+        /// draws levels from pools, which must outlive the book
+        explicit basic_mp_book(shared_pools& pools) noexcept;
         void add_order(order&) noexcept;
         void delete_order(order&) noexcept;
         void cancel_order(order&, qty_t remove_qty) noexcept;
@@ -30,14 +56,17 @@ namespace itch {
 
         // accessors
     public:
-        decltype(bids_) const& bids() const noexcept;
-        decltype(asks_) const& asks() const noexcept;
+        level_list const& bids() const noexcept;
+        level_list const& asks() const noexcept;
         pq best_bid() const noexcept;
         pq best_ask() const noexcept;
+        void depth(std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept;
         std::size_t max_bid_book_depth() const noexcept;
         std::size_t max_ask_book_depth() const noexcept;
         std::size_t max_bid_order_depth() const noexcept;
         std::size_t max_ask_order_depth() const noexcept;
     };
 
+    using mp_book = basic_mp_book<>;
+
 } // namespace itch
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "core.hpp"
+#include "protocol/itch/itch.cppgen.hpp"
+#include <endian.h>
+#include <array>
+#include <cstddef> // offsetof, std::size_t
+#include <cstdint>
+#include <cstring> // std::memcpy
+
+
+namespace itch {
+
+    /// A chunk of msgs decoded into columns (structure of arrays).
+    ///
+    /// Row i holds the fields of the i-th msg of the chunk that book
+    /// building needs. Fields a msg type doesn't have are unspecified.
+    /// A msg of unknown type or length gets type UnknownType and only
+    /// its locate and timestamp, msg[i] always points at the raw msg.
+    /// Rows past size hold stale data.
+    template <std::size_t Capacity = 256>
+    struct msg_columns
+    {
+        static constexpr std::size_t capacity = Capacity;
+
+        /// type of a row whose msg is of unknown type or length, no itch
+        /// msg type
+        static constexpr char UnknownType = '\0';
+
+        std::size_t size = 0;
+        alignas(64) char type[Capacity] = {};
+        alignas(64) std::uint16_t locate[Capacity] = {};
+        alignas(64) oid_t oid[Capacity] = {};
+        alignas(64) oid_t new_oid[Capacity] = {}; ///< order_replace only
+        alignas(64) price_t price[Capacity] = {};
+        alignas(64) qty_t qty[Capacity] = {};
+        alignas(64) Side side[Capacity] = {};
+        alignas(64) std::uint64_t timestamp[Capacity] = {}; ///< nsecs since midnight
+        alignas(64) header const* msg[Capacity] = {};
+    };
+
+    namespace detail {
+
+        /// where decode() finds each column's field, by msg type. absent
+        /// fields are read from offset 0, which is always inside the msg
+        struct field_offsets
+        {
+            std::uint8_t oid = 0;
+            std::uint8_t new_oid = 0;
+            std::uint8_t price = 0;
+            std::uint8_t qty = 0;
+            std::uint8_t side = 0;
+        };
+
+        // clang-format off
+        constexpr std::array<field_offsets, 256> FieldOffsets = [] {
+            std::array<field_offsets, 256> t = {};
+            t['A'] = {offsetof(add_order, order_reference_number), 0,
+                      offsetof(add_order, price), offsetof(add_order, shares),
+                      offsetof(add_order, buy_sell_indicator)};
+            t['F'] = {offsetof(add_order_with_mpid, order_reference_number), 0,
+                      offsetof(add_order_with_mpid, price), offsetof(add_order_with_mpid, shares),
+                      offsetof(add_order_with_mpid, buy_sell_indicator)};
+            t['E'] = {offsetof(order_executed, order_reference_number), 0,
+                      0, offsetof(order_executed, executed_shares), 0};
+            t['X'] = {offsetof(order_cancel, order_reference_number), 0,
+                      0, offsetof(order_cancel, cancelled_shares), 0};
+            t['D'] = {offsetof(order_delete, order_reference_number), 0, 0, 0, 0};
+            t['U'] = {offsetof(order_replace, original_order_reference_number),
+                      offsetof(order_replace, new_order_reference_number),
+                      offsetof(order_replace, price), offsetof(order_replace, shares), 0};
+            return t;
+        }();
+        // clang-format on
+
+        template <typename T>
+        inline T
+        load(std::uint8_t const* p) noexcept
+        {
+            T v;
+            std::memcpy(&v, p, sizeof(T));
+            return v;
+        }
+
+    } // namespace detail
+
+    /// Decodes up to Capacity complete msgs from buf into cols and
+    /// returns the number of bytes they span.
+    ///
+    /// Runs in two passes: the first only frames msgs and copies their
+    /// big-endian fields into the columns, using per-type field offsets
+    /// rather than per-type code, the second byte-swaps whole columns.
+    /// The second pass has fixed trip counts and no branches, so the
+    /// compiler vectorizes it.
+    template <std::size_t Capacity>
+    std::size_t
+    decode(std::uint8_t const* buf, std::size_t len, msg_columns<Capacity>& cols) noexcept
+    {
+        std::size_t pos = 0;
+        std::size_t n = 0;
+        for (; n < Capacity && pos + sizeof(header) < len; ++n) {
+            std::uint8_t const* p = buf + pos;
+            auto hdr = reinterpret_cast<header const*>(p);
+            std::size_t const msg_len = be16toh(hdr->length) + sizeof(hdr->length);
+            if (pos + msg_len > len)
+                break;
+
+            // unknown types and lengths keep the raw msg only
+            auto const type = static_cast<std::uint8_t>(hdr->msg_type);
+            bool const known = msg_types[type].length == msg_len;
+            detail::field_offsets const off = known ? detail::FieldOffsets[type]
+                                                    : detail::field_offsets();
+
+            cols.type[n] = known ? hdr->msg_type : msg_columns<Capacity>::UnknownType;
+            cols.locate[n] = hdr->stock_locate;
+            cols.oid[n] = detail::load<oid_t>(p + off.oid);
+            cols.new_oid[n] = detail::load<oid_t>(p + off.new_oid);
+            cols.price[n] = detail::load<price_t>(p + off.price);
+            cols.qty[n] = detail::load<qty_t>(p + off.qty);
+            cols.side[n] = (p[off.side] == 'B') ? Side::Bid : Side::Ask;
+            cols.timestamp[n] = 0;
+            std::memcpy(&cols.timestamp[n], hdr->timestamp, sizeof(hdr->timestamp));
+            cols.msg[n] = hdr;
+
+            pos += msg_len;
+        }
+        cols.size = n;
+
+        for (std::size_t i = 0; i < Capacity; ++i)
+            cols.locate[i] = be16toh(cols.locate[i]);
+        for (std::size_t i = 0; i < Capacity; ++i)
+            cols.oid[i] = be64toh(cols.oid[i]);
+        for (std::size_t i = 0; i < Capacity; ++i)
+            cols.new_oid[i] = be64toh(cols.new_oid[i]);
+        for (std::size_t i = 0; i < Capacity; ++i)
+            cols.price[i] = be32toh(cols.price[i]);
+        for (std::size_t i = 0; i < Capacity; ++i)
+            cols.qty[i] = be32toh(cols.qty[i]);
+
+        // the 6 timestamp bytes were copied to the low end
+        for (std::size_t i = 0; i < Capacity; ++i)
+            cols.timestamp[i] = be64toh(cols.timestamp[i]) >> 16;
+
+        return pos;
+    }
+
+} // namespace itch
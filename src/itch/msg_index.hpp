@@ -0,0 +1,118 @@
+#pragma once
+
+#include "protocol/itch/itch.cppgen.hpp"
+#include <endian.h>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cstdio>  // std::fprintf
+#include <cstdlib> // std::abort
+#include <exception>
+#include <vector>
+
+
+namespace itch {
+
+    /// Per-locate msg offsets into a buffer holding a whole itch file.
+    ///
+    /// Built by a single pass that only chases the length field of each
+    /// msg header, so it runs at close to memory bandwidth and leaves the
+    /// file paged in for the replay. Offsets are kept per stock_locate,
+    /// in file order, so an instrument can be replayed on its own
+    /// straight from the buffer.
+    class msg_index
+    {
+    private:
+        std::vector<std::vector<std::uint64_t>> offsets_;
+        std::size_t msg_count_ = 0;
+        std::size_t unknown_count_ = 0;
+        std::size_t bytes_indexed_ = 0;
+
+    public:
+        msg_index() = default;
+
+        /// indexes every complete msg in buf. returns the number of bytes
+        /// indexed, a trailing partial msg is not included
+        std::size_t build(std::uint8_t const* buf, std::size_t len) noexcept;
+
+        /// offsets of the msgs for locate, in file order
+        std::vector<std::uint64_t> const& offsets(std::uint16_t locate) const noexcept;
+
+        /// one past the highest locate seen
+        std::size_t num_locates() const noexcept;
+
+        std::size_t msg_count() const noexcept;
+
+        /// msgs of a type unknown to msg_types, or of the wrong length
+        std::size_t unknown_count() const noexcept;
+
+        std::size_t bytes_indexed() const noexcept;
+    };
+
+    /**********************************************************************/
+
+    inline std::size_t
+    msg_index::build(std::uint8_t const* buf, std::size_t len) noexcept
+    {
+        try {
+            offsets_.clear();
+            msg_count_ = 0;
+            unknown_count_ = 0;
+
+            std::size_t pos = 0;
+            while (pos + sizeof(header) < len) {
+                auto hdr = reinterpret_cast<header const*>(buf + pos);
+                std::size_t const msg_len = be16toh(hdr->length) + sizeof(hdr->length);
+                if (pos + msg_len > len)
+                    break;
+
+                std::uint16_t const locate = be16toh(hdr->stock_locate);
+                if (locate >= offsets_.size())
+                    offsets_.resize(locate + 1);
+                offsets_[locate].push_back(pos);
+
+                if (msg_types[static_cast<std::uint8_t>(hdr->msg_type)].length != msg_len)
+                    ++unknown_count_;
+
+                ++msg_count_;
+                pos += msg_len;
+            }
+            bytes_indexed_ = pos;
+            return pos;
+        } catch (std::exception const& e) {
+            std::fprintf(stderr, "[ERROR] exception in %s: %s\n", __builtin_FUNCTION(), e.what());
+            std::abort();
+        }
+    }
+
+    inline std::vector<std::uint64_t> const&
+    msg_index::offsets(std::uint16_t locate) const noexcept
+    {
+        static std::vector<std::uint64_t> const none;
+        return locate < offsets_.size() ? offsets_[locate] : none;
+    }
+
+    inline std::size_t
+    msg_index::num_locates() const noexcept
+    {
+        return offsets_.size();
+    }
+
+    inline std::size_t
+    msg_index::msg_count() const noexcept
+    {
+        return msg_count_;
+    }
+
+    inline std::size_t
+    msg_index::unknown_count() const noexcept
+    {
+        return unknown_count_;
+    }
+
+    inline std::size_t
+    msg_index::bytes_indexed() const noexcept
+    {
+        return bytes_indexed_;
+    }
+
+} // namespace itch
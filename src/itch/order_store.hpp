@@ -0,0 +1,286 @@
+#pragma once
+
+#include "core.hpp"
+#include "allocator/lowlevel_allocator.hpp"
+#include "util/assert.hpp"
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <exception>   // std::terminate
+#include <memory>      // std::uninitialized_value_construct_n
+#include <new>         // std::nothrow
+#include <type_traits> // std::is_trivially_destructible_v
+#include <utility>     // std::move, std::pair
+#include <vector>
+
+
+namespace itch {
+
+    /// Order storage indexed directly by order reference number.
+    ///
+    /// Orders live in fixed-size pages of 2^PageBits orders. A page is
+    /// only allocated the first time one of its orders is touched, and
+    /// is recycled (kept for re-use by the next page to be touched) as
+    /// soon as every order inserted on it has been erased. Look-up is a
+    /// shift, a mask and two loads, same as the flat std::vector it
+    /// replaces, without committing memory for the whole order space up
+    /// front.
+    ///
+    /// Each page has a bitmap of its live orders (allocated apart from
+    /// the page, which keeps a page a whole number of huge pages), so
+    /// that erasing or looking up an order that was never inserted
+    /// leaves the page's live count alone.
+    template <typename Order = order, std::size_t PageBits = 16,
+            typename LLAllocator = lowlevel_allocator<malloc_allocator>>
+    class order_store : private LLAllocator
+    {
+        static_assert(std::is_trivially_destructible_v<Order>, "pages are never destroyed");
+
+    public:
+        using value_type = Order;
+        static constexpr std::size_t PageSize = std::size_t(1) << PageBits;
+
+    private:
+        static constexpr std::size_t PageMask = PageSize - 1;
+        static constexpr std::size_t PageBytes = PageSize * sizeof(Order);
+        static constexpr std::size_t BitmapWords = (PageSize + 63) / 64;
+
+        using page_type = std::pair<Order*, std::uint64_t*>; ///< orders, live bitmap
+
+    private:
+        std::vector<Order*> pages_;          ///< page directory, nullptr if not committed
+        std::vector<std::uint64_t*> bits_;   ///< live bitmap of each committed page
+        std::vector<std::uint32_t> live_;    ///< number of live orders on each page
+        std::vector<page_type> free_pages_;  ///< emptied pages waiting for re-use
+        std::size_t pages_in_use_ = 0;
+        std::size_t max_pages_in_use_ = 0; ///< stats only
+        std::size_t pages_allocated_ = 0;  ///< stats only
+
+    public:
+        /// alloc places the pages, e.g. a numa_allocator
+        explicit order_store(std::size_t capacity, LLAllocator alloc = LLAllocator());
+        ~order_store() noexcept;
+        order_store(order_store const&) noexcept = delete;
+        order_store(order_store&&) noexcept = delete;
+        order_store& operator=(order_store const&) noexcept = delete;
+        order_store& operator=(order_store&&) noexcept = delete;
+
+        /// returns the order slot, committing its page if necessary,
+        /// and marks it live
+        Order& insert(oid_t) noexcept;
+
+        /// returns the order if it is live (inserted and not erased since),
+        /// nullptr otherwise. never commits a page
+        Order* find(oid_t) noexcept;
+        Order const* find(oid_t) const noexcept;
+
+        /// returns the order slot, live or not, or nullptr if its page
+        /// isn't committed (or oid is out of range). never commits a page
+        Order const* slot(oid_t) const noexcept;
+
+        /// clears a live order and recycles its page if it was the last
+        /// live order on it. does nothing if the order isn't live
+        void erase(oid_t) noexcept;
+
+        constexpr std::size_t capacity() const noexcept;
+        constexpr std::size_t pages_in_use() const noexcept;
+        constexpr std::size_t max_pages_in_use() const noexcept;
+        constexpr std::size_t pages_allocated() const noexcept;
+        constexpr std::size_t page_bytes() const noexcept;
+
+    private:
+        Order* commit_page(std::size_t page_index) noexcept;
+        bool is_live(std::size_t page_index, oid_t) const noexcept;
+    };
+
+    /**********************************************************************/
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    order_store<Order, PageBits, LLAllocator>::order_store(
+            std::size_t capacity, LLAllocator alloc)
+            : LLAllocator(std::move(alloc))
+            , pages_((capacity + PageMask) >> PageBits, nullptr)
+            , bits_((capacity + PageMask) >> PageBits, nullptr)
+            , live_((capacity + PageMask) >> PageBits, 0)
+            , free_pages_()
+    {
+        // erase() must not allocate
+        free_pages_.reserve(pages_.size());
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    order_store<Order, PageBits, LLAllocator>::~order_store() noexcept
+    {
+        for (std::size_t i = 0; i < pages_.size(); ++i) {
+            if (pages_[i] != nullptr) {
+                LLAllocator::deallocate_node(pages_[i], PageBytes, alignof(Order));
+                delete[] bits_[i];
+            }
+        }
+        for (page_type const& p : free_pages_) {
+            LLAllocator::deallocate_node(p.first, PageBytes, alignof(Order));
+            delete[] p.second;
+        }
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    Order&
+    order_store<Order, PageBits, LLAllocator>::insert(oid_t oid) noexcept
+    {
+        std::size_t const page_index = oid >> PageBits;
+        DEBUG_ASSERT(page_index < pages_.size());
+
+        // a page is only ever committed here, with a live order on it,
+        // so every committed page is eventually recycled by erase()
+        Order* page = pages_[page_index];
+        if (page == nullptr) [[unlikely]]
+            page = commit_page(page_index);
+
+        std::size_t const i = oid & PageMask;
+        std::uint64_t& word = bits_[page_index][i / 64];
+        std::uint64_t const bit = std::uint64_t(1) << (i % 64);
+        if ((word & bit) == 0) {
+            word |= bit;
+            ++live_[page_index];
+        }
+        return page[i];
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    Order*
+    order_store<Order, PageBits, LLAllocator>::find(oid_t oid) noexcept
+    {
+        std::size_t const page_index = oid >> PageBits;
+        if (!is_live(page_index, oid))
+            return nullptr;
+
+        return &pages_[page_index][oid & PageMask];
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    Order const*
+    order_store<Order, PageBits, LLAllocator>::find(oid_t oid) const noexcept
+    {
+        std::size_t const page_index = oid >> PageBits;
+        if (!is_live(page_index, oid))
+            return nullptr;
+
+        return &pages_[page_index][oid & PageMask];
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    Order const*
+    order_store<Order, PageBits, LLAllocator>::slot(oid_t oid) const noexcept
+    {
+        std::size_t const page_index = oid >> PageBits;
+        if (page_index >= pages_.size())
+            return nullptr;
+
+        Order const* page = pages_[page_index];
+        return page == nullptr ? nullptr : &page[oid & PageMask];
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    void
+    order_store<Order, PageBits, LLAllocator>::erase(oid_t oid) noexcept
+    {
+        std::size_t const page_index = oid >> PageBits;
+        DEBUG_ASSERT(page_index < pages_.size());
+
+        if (!is_live(page_index, oid))
+            return;
+
+        std::size_t const i = oid & PageMask;
+        Order* page = pages_[page_index];
+        page[i].clear();
+        bits_[page_index][i / 64] &= ~(std::uint64_t(1) << (i % 64));
+
+        // every order inserted on this page has now been cleared, so
+        // the page is back in its initial state and can be handed out
+        // again without being re-initialized
+        if (--live_[page_index] == 0) {
+            free_pages_.emplace_back(page, bits_[page_index]);
+            pages_[page_index] = nullptr;
+            bits_[page_index] = nullptr;
+            --pages_in_use_;
+        }
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    constexpr std::size_t
+    order_store<Order, PageBits, LLAllocator>::capacity() const noexcept
+    {
+        return pages_.size() * PageSize;
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    constexpr std::size_t
+    order_store<Order, PageBits, LLAllocator>::pages_in_use() const noexcept
+    {
+        return pages_in_use_;
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    constexpr std::size_t
+    order_store<Order, PageBits, LLAllocator>::max_pages_in_use() const noexcept
+    {
+        return max_pages_in_use_;
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    constexpr std::size_t
+    order_store<Order, PageBits, LLAllocator>::pages_allocated() const noexcept
+    {
+        return pages_allocated_;
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    constexpr std::size_t
+    order_store<Order, PageBits, LLAllocator>::page_bytes() const noexcept
+    {
+        return PageBytes;
+    }
+
+    // private
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    Order*
+    order_store<Order, PageBits, LLAllocator>::commit_page(std::size_t page_index) noexcept
+    {
+        Order* page = nullptr;
+        std::uint64_t* bits = nullptr;
+        if (free_pages_.empty()) {
+            // allocate_node() terminates on failure
+            void* mem = LLAllocator::allocate_node(PageBytes, alignof(Order));
+            page = static_cast<Order*>(mem);
+            std::uninitialized_value_construct_n(page, PageSize);
+            bits = new (std::nothrow) std::uint64_t[BitmapWords]();
+            if (bits == nullptr)
+                std::terminate();
+            ++pages_allocated_;
+        } else {
+            page = free_pages_.back().first;
+            bits = free_pages_.back().second;
+            free_pages_.pop_back();
+        }
+
+        pages_[page_index] = page;
+        bits_[page_index] = bits;
+        ++pages_in_use_;
+        if (pages_in_use_ > max_pages_in_use_)
+            max_pages_in_use_ = pages_in_use_;
+        return page;
+    }
+
+    template <typename Order, std::size_t PageBits, typename LLAllocator>
+    bool
+    order_store<Order, PageBits, LLAllocator>::is_live(
+            std::size_t page_index, oid_t oid) const noexcept
+    {
+        if (page_index >= pages_.size() || bits_[page_index] == nullptr)
+            return false;
+
+        std::size_t const i = oid & PageMask;
+        return (bits_[page_index][i / 64] >> (i % 64)) & 1;
+    }
+
+} // namespace itch
@@ -1,23 +1,127 @@
 #pragma once
 
+#include "bbo.hpp"
+#include "book.hpp"
 #include "core.hpp"
+#include "depth.hpp"
 #include "instrument.hpp"
+#include "msg_columns.hpp"
+#include "order_store.hpp"
 #include "protocol/itch/itch-fmt.hpp"
 #include "protocol/itch/itch.cppgen.hpp"
+#include "util/assert.hpp"
 #include <endian.h>
+#include <bitset>
 #include <filesystem>
-#include <algorithm> // std::max, std::min
-#include <cstddef>   // std::size_t
+#include <algorithm> // std::binary_search, std::find, std::max, std::min, std::sort
+#include <cstddef>   // offsetof, std::size_t
 #include <cstdint>
-#include <cstdio> // std::fclose, std::fopen
+#include <cstdio>  // std::fclose, std::fopen
+#include <cstdlib> // std::abort
+#include <exception>
+#include <limits>
+#include <memory> // std::unique_ptr
+#include <string>
+#include <string_view>
+#include <type_traits> // std::is_same_v
+#include <utility>     // std::move
 #include <vector>
 
 
 namespace itch {
 
-    template <bool LoggingEnabled>
+    /// Handler policy of a parser: reacts to book and market events, on
+    /// top of the books and stats the parser always keeps. Every hook is
+    /// optional and called directly (no virtual dispatch), a hook the
+    /// handler doesn't declare compiles away.
+    ///
+    ///   on_add(instrument const&, order const&)
+    ///   on_executed(instrument const&, order const&, qty_t executed_qty,
+    ///           price_t price)
+    ///   on_cancel(instrument const&, order const&, qty_t cancelled_qty)
+    ///   on_delete(instrument const&, order const&)
+    ///   on_replace(instrument const&, order const& old_order,
+    ///           order const& new_order)
+    ///   on_trade(instrument const&, qty_t, price_t) (non-cross trades)
+    ///   on_system_event(system_event const*, MarketState new_state)
+    ///   on_bbo(bbo_update const&)
+    ///
+    /// Hooks run after the event is applied, so the instrument's book and
+    /// stats already reflect it. Deleted and replaced (old) orders are
+    /// passed as they were before the event, orders an execution or
+    /// cancel took out as they were but with no qty left, other orders
+    /// as they are now. Orders left with no qty are erased after the hook
+    /// returns.
+    /// Hooks are called the same way by parse() and parse_batched().
+    ///
+    /// on_bbo() is called, after the event's own hook, for each book
+    /// event that changes the best bid or ask (price or qty) of its
+    /// instrument. The parser checks the side the event touched against
+    /// the top it last reported, so this costs one best_bid() or
+    /// best_ask() per book event, and nothing without the hook.
+    /// With a book other than mp_book, instrument and order above are the
+    /// parser's instrument_type and order_type, e.g. the compact_order of
+    /// a compact_book (read through order_price() and order_side()).
+    struct default_handler
+    {};
+
+    namespace detail {
+
+        // clang-format off
+        template <typename H, typename I, typename O>
+        concept has_on_add = requires(H& h, I const& i, O const& o) {
+            h.on_add(i, o);
+        };
+        template <typename H, typename I, typename O>
+        concept has_on_executed = requires(H& h, I const& i, O const& o) {
+            h.on_executed(i, o, qty_t(), price_t());
+        };
+        template <typename H, typename I, typename O>
+        concept has_on_cancel = requires(H& h, I const& i, O const& o) {
+            h.on_cancel(i, o, qty_t());
+        };
+        template <typename H, typename I, typename O>
+        concept has_on_delete = requires(H& h, I const& i, O const& o) {
+            h.on_delete(i, o);
+        };
+        template <typename H, typename I, typename O>
+        concept has_on_replace = requires(H& h, I const& i, O const& o) {
+            h.on_replace(i, o, o);
+        };
+        template <typename H, typename I>
+        concept has_on_trade = requires(H& h, I const& i) {
+            h.on_trade(i, qty_t(), price_t());
+        };
+        template <typename H>
+        concept has_on_bbo = requires(H& h, bbo_update const& u) {
+            h.on_bbo(u);
+        };
+        template <typename H>
+        concept has_on_system_event = requires(H& h, system_event const* m) {
+            h.on_system_event(m, MarketState());
+        };
+        // clang-format on
+
+    } // namespace detail
+
+    /// B is the book kept for each instrument, see Book. OrderStore is
+    /// where the orders of B live: an order_store indexed by order ref,
+    /// or a hashed_order_store for a parser that only sees some of the
+    /// orders (see sharded_parser). Either takes its pages from a
+    /// lowlevel_allocator, e.g. lowlevel_allocator<mmap_hugepage_allocator>
+    /// to back them with huge pages (see benchmark_order)
+    template <bool LoggingEnabled, typename Handler = default_handler, Book B = mp_book,
+            typename OrderStore = order_store<book_order_t<B>>>
     class parser
     {
+    public:
+        using book_type = B;
+        using instrument_type = basic_instrument<B>;
+        using order_type = book_order_t<B>;
+        using order_store_type = OrderStore;
+
+        static_assert(std::is_same_v<typename OrderStore::value_type, order_type>);
+
     private:
         enum
         {
@@ -25,35 +129,165 @@ namespace itch {
             MaxNumInstruments = 9000,
 
             /// the number of distinct orders per run cannot exceed this number
-            MaxNumOrders = 800'000'000
+            MaxNumOrders = 800'000'000,
+
+            /// msgs parse() looks ahead to prefetch order slots, see benchmark_parser
+            DefaultPrefetchDepth = 16
         };
 
+        /// next_depth_ while dump_depth() is off
+        static constexpr std::uint64_t NoDepth = std::numeric_limits<std::uint64_t>::max();
+
     private:
         struct msg_stats
         {
             std::size_t msg_count = 0;
+            std::size_t unknown_count = 0;
+            std::size_t filtered_count = 0;
+        };
+
+        /// last top of book reported to on_bbo(), by locate
+        struct top
+        {
+            pq bid;
+            pq ask;
         };
 
     private:
-        std::vector<instrument> instruments_;
-        std::vector<order> orders_;
+        std::unique_ptr<book_pools_t<B>> pools_; ///< see share_pools, outlives the books
+        std::vector<instrument_type> instruments_;
+        order_store_type orders_;
         MarketState market_state_ = MarketState::Unknown;
         std::FILE* stats_file_ = nullptr;
         msg_stats msg_stats_;
         std::FILE* log_ = nullptr;
         bool print_sys_events_ = false;
+        bool skip_unknown_ = false;
+        std::size_t prefetch_depth_ = DefaultPrefetchDepth;
+        msg_columns<> columns_;
+        std::vector<top> tops_; ///< only kept with an on_bbo() hook
+        [[no_unique_address]] Handler handler_;
+
+        // see watch()
+        bool filtering_ = false;
+        std::vector<std::string> watchlist_; // sorted
+        std::bitset<std::size_t(1) << 16> watched_; // by locate
+
+        // see dump_depth()
+        std::unique_ptr<depth_file_writer> depth_;
+        std::vector<std::string> depth_symbols_;   // sorted, empty: all
+        std::vector<std::uint16_t> depth_locates_; // resolved so far
+        std::uint64_t depth_interval_ = 0;
+        std::uint64_t next_depth_ = NoDepth; ///< next interval boundary
 
     public:
-        parser(std::filesystem::path const& stats_fpath, bool print_sys_events) noexcept;
+        /// unknown msgs (unknown type, or the wrong length for the type)
+        /// abort unless skip_unknown is set, then they are counted.
+        /// with share_pools, every book draws its levels from one set of
+        /// pools (see SharedPoolBook) instead of pools of its own. books
+        /// that can't share ignore it
+        parser(std::filesystem::path const& stats_fpath, bool print_sys_events,
+                bool skip_unknown = false, Handler handler = Handler(),
+                bool share_pools = false) noexcept;
         ~parser() noexcept;
         parser(parser const&) noexcept = delete;
         parser(parser&&) noexcept = delete;
         parser& operator=(parser const&) noexcept = delete;
         parser& operator=(parser&&) noexcept = delete;
         std::size_t parse(std::uint8_t const* buf, std::size_t bytes_to_read) noexcept;
+
+        /// as parse(), but decodes msgs a chunk at a time into columns
+        /// (see msg_columns) before applying them. same as parse() when
+        /// logging is enabled
+        std::size_t parse_batched(std::uint8_t const* buf, std::size_t bytes_to_read) noexcept;
+
+        /// handles a single, complete msg
+        void process_msg(header const*) noexcept;
+
         void print_stats() const;
 
+        // accessors
+    public:
+        std::vector<instrument_type> const& instruments() const noexcept;
+        order_store_type const& orders() const noexcept;
+        std::size_t msg_count() const noexcept;
+        std::size_t filtered_count() const noexcept;
+        Handler& handler() noexcept;
+        Handler const& handler() const noexcept;
+
+        /// whether system events are printed to stdout
+        void print_sys_events(bool) noexcept;
+
+        /// how many msgs ahead parse() prefetches the order slot and
+        /// instrument of a msg. the order's price level is prefetched
+        /// half as far ahead, once its order slot is in cache. 0 disables
+        void prefetch_depth(std::size_t) noexcept;
+
+        /// Only builds books for these symbols (stock directory names,
+        /// without padding), an empty list means all of them, the
+        /// default. Symbols are resolved to locates as their stock
+        /// directory msgs come in, so this must be set before those. Any
+        /// other msg of an instrument not on the list is dropped (and
+        /// counted) after a look at its locate, before dispatch and
+        /// without touching the order store.
+        void watch(std::vector<std::string> symbols) noexcept;
+
+        /// whether msgs of this locate are processed
+        bool watching(std::uint16_t locate) const noexcept;
+
+        /// Every interval nsecs of feed time, writes the books of these
+        /// symbols (an empty list means all of them) to writer, as they
+        /// stood at the interval boundary: the snapshot is taken before
+        /// the first book event at or past a boundary and stamped with
+        /// it, so an interval without book events gets no snapshot of
+        /// its own. Symbols are resolved as for watch(), so this must be
+        /// set before the stock directory msgs come in. Off by default,
+        /// which costs one compare per book event.
+        void dump_depth(std::unique_ptr<depth_file_writer> writer,
+                std::vector<std::string> symbols, std::uint64_t interval) noexcept;
+
+        /// the writer given to dump_depth(), or nullptr
+        depth_file_writer const* depth_writer() const noexcept;
+
     private:
+        template <typename H>
+        friend void v5_0::dispatch(H&, header const*, std::size_t) noexcept;
+
+        static header const* next_msg(std::uint8_t const*& pos, std::uint8_t const* end) noexcept;
+
+        /// MaxNumInstruments instruments, their books on pools unless null
+        static std::vector<instrument_type> make_instruments(book_pools_t<B>* pools);
+        static oid_t order_ref(header const*) noexcept;
+        bool filtered(header const*) const noexcept;
+        void prefetch_order(header const*) const noexcept;
+        void prefetch_level(header const*) const noexcept;
+        void apply_batch() noexcept;
+
+        // book updates shared by the msg handlers and apply_batch(). all
+        // but apply_add() skip an order that isn't live
+        void apply_add(std::uint16_t index, oid_t, Side, qty_t, price_t,
+                std::uint64_t timestamp) noexcept;
+        void apply_cancel(std::uint16_t index, oid_t, qty_t cancelled_qty,
+                std::uint64_t timestamp) noexcept;
+        void apply_delete(std::uint16_t index, oid_t, std::uint64_t timestamp) noexcept;
+        void apply_executed(std::uint16_t index, oid_t, qty_t executed_qty,
+                std::uint64_t timestamp) noexcept;
+        void apply_replace(std::uint16_t index, oid_t orig_oid, oid_t new_oid, qty_t, price_t,
+                std::uint64_t timestamp) noexcept;
+
+        /// the order on_cancel() or on_executed() is passed: o, or if the
+        /// event took it out (and the book cleared it), before with no qty
+        /// left
+        static order_type const& after_cancel(order_type const& o, order_type& before) noexcept;
+
+        /// calls on_bbo() if a book event on this side of the instrument
+        /// moved its top of book
+        void publish_bbo(std::uint16_t index, Side, std::uint64_t timestamp) noexcept;
+
+        /// called before each book event, see dump_depth()
+        void sample_depth(std::uint64_t timestamp) noexcept;
+        void write_depth(std::uint64_t timestamp) noexcept;
+
         template <typename T>
         void log_msg(T const*) noexcept;
         void handle_add_order(add_order const*) noexcept;
@@ -77,25 +311,32 @@ namespace itch {
         void handle_system_event(system_event const*) noexcept;
         void handle_trade_non_cross(trade_non_cross const*) noexcept;
         void handle_trade_cross(trade_cross const*) noexcept;
+        void handle_unknown(header const*) noexcept;
     };
 
     /**********************************************************************/
 
-    template <bool LoggingEnabled>
-    parser<LoggingEnabled>::parser(
-            std::filesystem::path const& stats_fpath, bool print_sys_events) noexcept
-            : instruments_(MaxNumInstruments)
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    parser<LoggingEnabled, Handler, B, OrderStore>::parser(
+            std::filesystem::path const& stats_fpath, bool print_sys_events, bool skip_unknown,
+            Handler handler, bool share_pools) noexcept
+            : pools_(SharedPoolBook<B> && share_pools ? std::make_unique<book_pools_t<B>>()
+                                                      : nullptr)
+            , instruments_(make_instruments(pools_.get()))
             , orders_(MaxNumOrders)
             , stats_file_(stats_fpath.empty() ? nullptr : std::fopen(stats_fpath.c_str(), "w"))
             , msg_stats_()
             , log_(LoggingEnabled ? std::fopen("itch.log", "w") : nullptr)
             , print_sys_events_(print_sys_events)
+            , skip_unknown_(skip_unknown)
+            , tops_(detail::has_on_bbo<Handler> ? MaxNumInstruments : 0)
+            , handler_(std::move(handler))
     {
         // empty
     }
 
-    template <bool LoggingEnabled>
-    parser<LoggingEnabled>::~parser() noexcept
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    parser<LoggingEnabled, Handler, B, OrderStore>::~parser() noexcept
     {
         if (log_ != nullptr) {
             std::fclose(log_);
@@ -108,12 +349,28 @@ namespace itch {
         }
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     std::size_t
-    parser<LoggingEnabled>::parse(std::uint8_t const* buf, std::size_t bytes_to_read) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::parse(
+            std::uint8_t const* buf, std::size_t bytes_to_read) noexcept
     {
         std::size_t bytes_processed = 0;
         std::uint8_t const* end = buf + bytes_to_read;
+
+        // lookahead cursors, see prefetch_depth()
+        std::uint8_t const* order_ahead = buf;
+        std::uint8_t const* level_ahead = buf;
+        if (prefetch_depth_ != 0) {
+            for (std::size_t i = 0; i < prefetch_depth_; ++i) {
+                if (header const* next = next_msg(order_ahead, end))
+                    prefetch_order(next);
+            }
+            for (std::size_t i = 0; i < prefetch_depth_ / 2; ++i) {
+                if (header const* next = next_msg(level_ahead, end))
+                    prefetch_level(next);
+            }
+        }
+
         while (buf + sizeof(header) < end) {
             auto hdr = reinterpret_cast<header const*>(buf);
             std::uint16_t const msg_len = be16toh(hdr->length) + sizeof(hdr->length);
@@ -122,41 +379,14 @@ namespace itch {
             if (buf + msg_len > end)
                 break;
 
-            // clang-format off
-            // switch ordered by msg count on sample day (2020-01-30)
-            switch (hdr->msg_type) {
-                case 'A': handle_add_order(reinterpret_cast<add_order const*>(hdr)); break;
-                case 'D': handle_order_delete(reinterpret_cast<order_delete const*>(hdr)); break;
-                case 'U': handle_order_replace(reinterpret_cast<order_replace const*>(hdr)); break;
-                case 'E': handle_order_executed(reinterpret_cast<order_executed const*>(hdr)); break;
-                case 'X': handle_order_cancel(reinterpret_cast<order_cancel const*>(hdr)); break;
-                case 'I': handle_noii(reinterpret_cast<noii const*>(hdr)); break;
-                case 'F': handle_add_order_with_mpid(reinterpret_cast<add_order_with_mpid const*>(hdr)); break;
-                case 'P': handle_trade_non_cross(reinterpret_cast<trade_non_cross const*>(hdr)); break;
-                case 'L': handle_market_participant_position(reinterpret_cast<market_participant_position const*>(hdr)); break;
-                case 'C': handle_order_executed_with_price(reinterpret_cast<order_executed_with_price const*>(hdr)); break;
-                case 'Q': handle_trade_cross(reinterpret_cast<trade_cross const*>(hdr)); break;
-                case 'Y': handle_reg_sho_restriction(reinterpret_cast<reg_sho_restriction const*>(hdr)); break;
-                case 'H': handle_stock_trading_action(reinterpret_cast<stock_trading_action const*>(hdr)); break;
-                case 'R': handle_stock_directory(reinterpret_cast<stock_directory const*>(hdr)); break;
-                case 'S': handle_system_event(reinterpret_cast<system_event const*>(hdr)); break;
-                case 'J': handle_luld_auction_collar(reinterpret_cast<luld_auction_collar const*>(hdr)); break;
-                case 'K': handle_ipo_quoting_period_update(reinterpret_cast<ipo_quoting_period_update const*>(hdr)); break;
-                case 'V': handle_mwcb_decline_level(reinterpret_cast<mwcb_decline_level const*>(hdr)); break;
-
-                case 'W': handle_mwcb_status(reinterpret_cast<mwcb_status const*>(hdr)); break;
-                case 'h': handle_operational_halt(reinterpret_cast<operational_halt const*>(hdr)); break;
-                case 'B': handle_broken_trade(reinterpret_cast<broken_trade const*>(hdr)); break;
-
-                default:
-                    try {
-                        fmt::print(stderr, "[ERROR] parse(): unknown type=[{:c}]\n", hdr->msg_type);
-                    } catch (...)
-                    {}
-                    std::abort();
-                    break;
+            if (prefetch_depth_ != 0) {
+                if (header const* next = next_msg(order_ahead, end))
+                    prefetch_order(next);
+                if (header const* next = next_msg(level_ahead, end))
+                    prefetch_level(next);
             }
-            // clang-format on
+
+            process_msg(hdr);
 
             ++msg_stats_.msg_count;
             buf += msg_len;
@@ -165,9 +395,46 @@ namespace itch {
         return bytes_processed;
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    std::size_t
+    parser<LoggingEnabled, Handler, B, OrderStore>::parse_batched(
+            std::uint8_t const* buf, std::size_t bytes_to_read) noexcept
+    {
+        // the handlers log the raw msgs
+        if constexpr (LoggingEnabled)
+            return parse(buf, bytes_to_read);
+
+        std::size_t bytes_processed = 0;
+        while (true) {
+            std::size_t const bytes_decoded
+                    = decode(buf + bytes_processed, bytes_to_read - bytes_processed, columns_);
+            if (columns_.size == 0)
+                break;
+
+            apply_batch();
+
+            msg_stats_.msg_count += columns_.size;
+            bytes_processed += bytes_decoded;
+        }
+        return bytes_processed;
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::print_stats() const
+    parser<LoggingEnabled, Handler, B, OrderStore>::process_msg(header const* hdr) noexcept
+    {
+        if (filtered(hdr)) {
+            ++msg_stats_.filtered_count;
+            return;
+        }
+
+        // table driven (see itch.cppgen.json), also checks the msg length
+        dispatch(*this, hdr, be16toh(hdr->length) + sizeof(hdr->length));
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    void
+    parser<LoggingEnabled, Handler, B, OrderStore>::print_stats() const
     {
         std::size_t max_bid_pool_used = 0;
         std::size_t max_ask_pool_used = 0;
@@ -180,29 +447,262 @@ namespace itch {
         // clang-format off
         fmt::print("parser msg stats\n"
                 "  msgs processed:    {}\n"
+                "  msgs skipped:      {}\n"
+                "  msgs filtered:     {}\n"
                 "  max_bid_pool_used: {}\n"
-                "  max_ask_pool_used: {}\n",
+                "  max_ask_pool_used: {}\n"
+                "  order pages used:  {} (max {}, allocated {}, {} bytes each)\n",
             msg_stats_.msg_count,
+            msg_stats_.unknown_count,
+            msg_stats_.filtered_count,
             max_bid_pool_used,
-            max_ask_pool_used);
+            max_ask_pool_used,
+            orders_.pages_in_use(),
+            orders_.max_pages_in_use(),
+            orders_.pages_allocated(),
+            orders_.page_bytes());
         // clang-format on
 
         if (stats_file_ != nullptr) {
-            fmt::print(stats_file_, "{}\n", instrument::stats_csv_header());
+            fmt::print(stats_file_, "{}\n", instrument_type::stats_csv_header());
 
-            for (auto const& instrument : instruments_) {
-                if (instrument.locate == 0)
+            for (auto const& itr : instruments_) {
+                if (itr.locate == 0)
                     continue;
 
-                fmt::print(stats_file_, "{}\n", instrument.stats_csv());
+                fmt::print(stats_file_, "{}\n", itr.stats_csv());
+            }
+        }
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    std::vector<basic_instrument<B>> const&
+    parser<LoggingEnabled, Handler, B, OrderStore>::instruments() const noexcept
+    {
+        return instruments_;
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    typename parser<LoggingEnabled, Handler, B, OrderStore>::order_store_type const&
+    parser<LoggingEnabled, Handler, B, OrderStore>::orders() const noexcept
+    {
+        return orders_;
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    std::size_t
+    parser<LoggingEnabled, Handler, B, OrderStore>::msg_count() const noexcept
+    {
+        return msg_stats_.msg_count;
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    std::size_t
+    parser<LoggingEnabled, Handler, B, OrderStore>::filtered_count() const noexcept
+    {
+        return msg_stats_.filtered_count;
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    Handler&
+    parser<LoggingEnabled, Handler, B, OrderStore>::handler() noexcept
+    {
+        return handler_;
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    Handler const&
+    parser<LoggingEnabled, Handler, B, OrderStore>::handler() const noexcept
+    {
+        return handler_;
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    void
+    parser<LoggingEnabled, Handler, B, OrderStore>::print_sys_events(bool enable) noexcept
+    {
+        print_sys_events_ = enable;
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    void
+    parser<LoggingEnabled, Handler, B, OrderStore>::prefetch_depth(std::size_t depth) noexcept
+    {
+        prefetch_depth_ = depth;
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    void
+    parser<LoggingEnabled, Handler, B, OrderStore>::watch(
+            std::vector<std::string> symbols) noexcept
+    {
+        watchlist_ = std::move(symbols);
+        std::sort(watchlist_.begin(), watchlist_.end());
+        filtering_ = !watchlist_.empty();
+
+        // market-wide msgs
+        watched_.reset();
+        watched_.set(0);
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    bool
+    parser<LoggingEnabled, Handler, B, OrderStore>::watching(
+            std::uint16_t locate) const noexcept
+    {
+        return !filtering_ || watched_[locate];
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    void
+    parser<LoggingEnabled, Handler, B, OrderStore>::dump_depth(
+            std::unique_ptr<depth_file_writer> writer, std::vector<std::string> symbols,
+            std::uint64_t interval) noexcept
+    {
+        DEBUG_ASSERT(interval > 0);
+
+        try {
+            depth_ = std::move(writer);
+            depth_symbols_ = std::move(symbols);
+            std::sort(depth_symbols_.begin(), depth_symbols_.end());
+            depth_locates_.clear();
+            depth_locates_.reserve(depth_symbols_.empty() ? std::size_t(MaxNumInstruments)
+                                                          : depth_symbols_.size());
+            depth_interval_ = interval;
+            next_depth_ = depth_ ? 0 : NoDepth;
+        } catch (std::exception const& e) {
+            std::fprintf(stderr, "[ERROR] exception in %s: %s\n", __builtin_FUNCTION(), e.what());
+            std::abort();
+        }
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    depth_file_writer const*
+    parser<LoggingEnabled, Handler, B, OrderStore>::depth_writer() const noexcept
+    {
+        return depth_.get();
+    }
+
+    // private
+
+    /// returns the complete msg at pos and moves pos past it, or nullptr
+    /// (leaving pos as is) if there isn't one
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    header const*
+    parser<LoggingEnabled, Handler, B, OrderStore>::next_msg(
+            std::uint8_t const*& pos, std::uint8_t const* end) noexcept
+    {
+        if (pos + sizeof(header) >= end)
+            return nullptr;
+
+        auto hdr = reinterpret_cast<header const*>(pos);
+        std::uint16_t const msg_len = be16toh(hdr->length) + sizeof(hdr->length);
+        if (pos + msg_len > end)
+            return nullptr;
+
+        pos += msg_len;
+        return hdr;
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    std::vector<basic_instrument<B>>
+    parser<LoggingEnabled, Handler, B, OrderStore>::make_instruments(book_pools_t<B>* pools)
+    {
+        if constexpr (SharedPoolBook<B>) {
+            if (pools != nullptr) {
+                std::vector<instrument_type> v;
+                v.reserve(MaxNumInstruments);
+                for (std::size_t i = 0; i < MaxNumInstruments; ++i)
+                    v.emplace_back(*pools);
+                return v;
             }
         }
+        return std::vector<instrument_type>(MaxNumInstruments);
+    }
+
+    /// returns the order reference number of an order msg, 0 for any
+    /// other msg
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    oid_t
+    parser<LoggingEnabled, Handler, B, OrderStore>::order_ref(header const* hdr) noexcept
+    {
+        // the reference number directly follows the header in every
+        // order msg (the original one for a replace)
+        static_assert(offsetof(add_order, order_reference_number) == sizeof(header));
+        static_assert(offsetof(add_order_with_mpid, order_reference_number) == sizeof(header));
+        static_assert(offsetof(order_executed, order_reference_number) == sizeof(header));
+        static_assert(
+                offsetof(order_executed_with_price, order_reference_number) == sizeof(header));
+        static_assert(offsetof(order_cancel, order_reference_number) == sizeof(header));
+        static_assert(offsetof(order_delete, order_reference_number) == sizeof(header));
+        static_assert(offsetof(order_replace, original_order_reference_number) == sizeof(header));
+
+        switch (hdr->msg_type) {
+            case 'A':
+            case 'F':
+            case 'E':
+            case 'C':
+            case 'X':
+            case 'D':
+            case 'U':
+                return be64toh(reinterpret_cast<order_delete const*>(hdr)->order_reference_number);
+
+            default:
+                return 0;
+        }
     }
 
-    template <bool LoggingEnabled>
+    /// whether the watchlist drops the msg. stock directory msgs always
+    /// pass, they resolve the watchlist
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    bool
+    parser<LoggingEnabled, Handler, B, OrderStore>::filtered(header const* hdr) const noexcept
+    {
+        return filtering_ && !watched_[be16toh(hdr->stock_locate)] && hdr->msg_type != 'R';
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    void
+    parser<LoggingEnabled, Handler, B, OrderStore>::prefetch_order(
+            header const* hdr) const noexcept
+    {
+        if (filtered(hdr))
+            return;
+
+        std::uint16_t const index = be16toh(hdr->stock_locate);
+        if (index < instruments_.size())
+            __builtin_prefetch(&instruments_[index], 1);
+
+        if (oid_t const oid = order_ref(hdr); oid != 0) {
+            // an add's slot isn't live yet
+            if (order_type const* o = orders_.slot(oid))
+                __builtin_prefetch(o, 1);
+        }
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    void
+    parser<LoggingEnabled, Handler, B, OrderStore>::prefetch_level(
+            header const* hdr) const noexcept
+    {
+        if (filtered(hdr))
+            return;
+
+        // a compact_order's level is only known to its book
+        if constexpr (requires(order_type const& o) { o.pl; }) {
+            // a new order's slot is clear, pl is only set for live orders
+            if (oid_t const oid = order_ref(hdr); oid != 0) {
+                order_type const* o = orders_.find(oid);
+                if (o != nullptr && o->pl != nullptr)
+                    __builtin_prefetch(o->pl, 1);
+            }
+        }
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     template <typename T>
     void
-    parser<LoggingEnabled>::log_msg(T const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::log_msg(T const* m) noexcept
     {
         if constexpr (LoggingEnabled) {
             try {
@@ -213,100 +713,89 @@ namespace itch {
         }
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_add_order(add_order const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_add_order(
+            add_order const* m) noexcept
     {
         log_msg(m);
 
-        std::uint16_t const index = be16toh(m->stock_locate);
-        oid_t const order_number = be64toh(m->order_reference_number);
-
-        order& o = orders_[order_number];
-        o.price = be32toh(m->price);
-        o.qty = be32toh(m->shares);
-        o.side = m->buy_sell_indicator == 'B' ? Side::Bid : Side::Ask;
-        o.ts = to_local_nsecs(from_itch_timestamp(m->timestamp));
-
-        instruments_[index].book.add_order(o);
-
-        ++instruments_[index].num_orders;
+        apply_add(be16toh(m->stock_locate), be64toh(m->order_reference_number),
+                m->buy_sell_indicator == 'B' ? Side::Bid : Side::Ask, be32toh(m->shares),
+                be32toh(m->price), from_itch_timestamp(m->timestamp));
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_add_order_with_mpid(add_order_with_mpid const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_add_order_with_mpid(
+            add_order_with_mpid const* m) noexcept
     {
         log_msg(m);
 
-        std::uint16_t const index = be16toh(m->stock_locate);
-        oid_t const order_number = be64toh(m->order_reference_number);
-
-        order& o = orders_[order_number];
-        o.price = be32toh(m->price);
-        o.qty = be32toh(m->shares);
-        o.side = m->buy_sell_indicator == 'B' ? Side::Bid : Side::Ask;
-        o.ts = to_local_nsecs(from_itch_timestamp(m->timestamp));
-
-        instruments_[index].book.add_order(o);
-
-        ++instruments_[index].num_orders;
+        apply_add(be16toh(m->stock_locate), be64toh(m->order_reference_number),
+                m->buy_sell_indicator == 'B' ? Side::Bid : Side::Ask, be32toh(m->shares),
+                be32toh(m->price), from_itch_timestamp(m->timestamp));
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_broken_trade(broken_trade const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_broken_trade(
+            broken_trade const* m) noexcept
     {
         log_msg(m);
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_ipo_quoting_period_update(
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_ipo_quoting_period_update(
             ipo_quoting_period_update const* m) noexcept
     {
         log_msg(m);
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_luld_auction_collar(luld_auction_collar const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_luld_auction_collar(
+            luld_auction_collar const* m) noexcept
     {
         log_msg(m);
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_market_participant_position(
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_market_participant_position(
             market_participant_position const* m) noexcept
     {
         log_msg(m);
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_mwcb_decline_level(mwcb_decline_level const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_mwcb_decline_level(
+            mwcb_decline_level const* m) noexcept
     {
         log_msg(m);
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_mwcb_status(mwcb_status const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_mwcb_status(
+            mwcb_status const* m) noexcept
     {
         log_msg(m);
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_noii(noii const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_noii(noii const* m) noexcept
     {
         log_msg(m);
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_operational_halt(operational_halt const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_operational_halt(
+            operational_halt const* m) noexcept
     {
         log_msg(m);
 
@@ -325,80 +814,63 @@ namespace itch {
         }
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_order_cancel(order_cancel const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_order_cancel(
+            order_cancel const* m) noexcept
     {
         log_msg(m);
 
-        std::uint16_t const index = be16toh(m->stock_locate);
-        oid_t const order_number = be64toh(m->order_reference_number);
-
-        order& o = orders_[order_number];
-        qty_t const cancelled_shares = be32toh(m->cancelled_shares);
-
-        instruments_[index].book.cancel_order(o, cancelled_shares);
+        apply_cancel(be16toh(m->stock_locate), be64toh(m->order_reference_number),
+                be32toh(m->cancelled_shares), from_itch_timestamp(m->timestamp));
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_order_delete(order_delete const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_order_delete(
+            order_delete const* m) noexcept
     {
         log_msg(m);
 
-        std::uint16_t const index = be16toh(m->stock_locate);
-        oid_t const order_number = be64toh(m->order_reference_number);
-
-        order& o = orders_[order_number];
-        instruments_[index].book.delete_order(o);
-        o.clear();
+        apply_delete(be16toh(m->stock_locate), be64toh(m->order_reference_number),
+                from_itch_timestamp(m->timestamp));
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_order_executed(order_executed const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_order_executed(
+            order_executed const* m) noexcept
     {
         log_msg(m);
 
-        std::uint16_t const index = be16toh(m->stock_locate);
-        oid_t const order_number = be64toh(m->order_reference_number);
-
-        order& o = orders_[order_number];
-        qty_t const executed_qty = be32toh(m->executed_shares);
-        price_t const order_price = o.price;
-
-        instruments_[index].book.cancel_order(o, executed_qty);
-        instruments_[index].trade_qty += executed_qty;
-        instruments_[index].last = order_price;
-        ++instruments_[index].num_trades;
-
-        if (market_state_ == MarketState::Open) {
-            // not all cross_trades marked as opening have prices, so
-            // record this
-            if (instruments_[index].open == 0)
-                instruments_[index].open = order_price;
-
-            if (instruments_[index].lo == InvalidLoPrice || order_price < instruments_[index].lo)
-                instruments_[index].lo = order_price;
-            if (instruments_[index].hi == InvalidHiPrice || order_price > instruments_[index].hi)
-                instruments_[index].hi = order_price;
-        }
+        apply_executed(be16toh(m->stock_locate), be64toh(m->order_reference_number),
+                be32toh(m->executed_shares), from_itch_timestamp(m->timestamp));
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_order_executed_with_price(
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_order_executed_with_price(
             order_executed_with_price const* m) noexcept
     {
         log_msg(m);
 
         std::uint16_t const index = be16toh(m->stock_locate);
         oid_t const order_number = be64toh(m->order_reference_number);
+        std::uint64_t const timestamp = from_itch_timestamp(m->timestamp);
+
+        sample_depth(timestamp);
 
-        order& o = orders_[order_number];
+        // skip orders that were never added (or are already gone)
+        order_type* const o_ptr = orders_.find(order_number);
+        if (o_ptr == nullptr) [[unlikely]]
+            return;
+
+        order_type& o = *o_ptr;
         qty_t const executed_qty = be32toh(m->executed_shares);
         price_t const executed_price = be32toh(m->execution_price);
 
+        // the book clears the order if this takes it out
+        order_type before = o;
         instruments_[index].book.cancel_order(o, executed_qty);
 
         // only record stats if execution is marked "printable"
@@ -412,49 +884,72 @@ namespace itch {
             instruments_[index].last = executed_price;
             ++instruments_[index].num_trades;
         }
+
+        if constexpr (detail::has_on_executed<Handler, instrument_type, order_type>) {
+            handler_.on_executed(
+                    instruments_[index], after_cancel(o, before), executed_qty, executed_price);
+        }
+
+        publish_bbo(index, order_side(before), timestamp);
+
+        if (o.qty == 0)
+            orders_.erase(order_number);
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_order_replace(order_replace const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_order_replace(
+            order_replace const* m) noexcept
     {
         log_msg(m);
 
-        std::uint16_t const index = be16toh(m->stock_locate);
-        oid_t const orig_order_number = be64toh(m->original_order_reference_number);
-        oid_t const new_order_number = be64toh(m->new_order_reference_number);
-
-        order& old_order = orders_[orig_order_number];
-        order& new_order = orders_[new_order_number];
-
-        new_order.side = old_order.side;
-        new_order.price = be32toh(m->price);
-        new_order.qty = be32toh(m->shares);
-
-        instruments_[index].book.replace_order(old_order, new_order);
+        apply_replace(be16toh(m->stock_locate), be64toh(m->original_order_reference_number),
+                be64toh(m->new_order_reference_number), be32toh(m->shares), be32toh(m->price),
+                from_itch_timestamp(m->timestamp));
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_reg_sho_restriction(reg_sho_restriction const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_reg_sho_restriction(
+            reg_sho_restriction const* m) noexcept
     {
         log_msg(m);
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_stock_directory(stock_directory const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_stock_directory(
+            stock_directory const* m) noexcept
     {
         log_msg(m);
 
         std::uint16_t const index = be16toh(m->stock_locate);
+        std::string_view name(m->stock, sizeof(m->stock));
+        name = name.substr(0, name.find_last_not_of(' ') + 1);
+        if (filtering_) {
+            if (!std::binary_search(watchlist_.begin(), watchlist_.end(), name))
+                return;
+            watched_.set(index);
+        }
+
+        // within the capacity reserved by dump_depth(), bar a repeated
+        // stock directory msg
+        if (depth_ != nullptr
+                && (depth_symbols_.empty()
+                        || std::binary_search(depth_symbols_.begin(), depth_symbols_.end(), name))
+                && std::find(depth_locates_.begin(), depth_locates_.end(), index)
+                        == depth_locates_.end()
+                && depth_locates_.size() < depth_locates_.capacity())
+            depth_locates_.push_back(index);
+
         instruments_[index].locate = index;
         instruments_[index].set_name(m->stock);
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_stock_trading_action(stock_trading_action const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_stock_trading_action(
+            stock_trading_action const* m) noexcept
     {
         log_msg(m);
 
@@ -478,9 +973,10 @@ namespace itch {
         // clang-format on
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_system_event(system_event const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_system_event(
+            system_event const* m) noexcept
     {
         log_msg(m);
 
@@ -543,23 +1039,33 @@ namespace itch {
         } catch (...) {
             // suppress
         }
+
+        if constexpr (detail::has_on_system_event<Handler>)
+            handler_.on_system_event(m, market_state_);
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_trade_non_cross(trade_non_cross const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_trade_non_cross(
+            trade_non_cross const* m) noexcept
     {
         log_msg(m);
 
         std::uint16_t const index = be16toh(m->stock_locate);
-        instruments_[index].trade_qty += be32toh(m->shares);
-        instruments_[index].last = be32toh(m->price);
+        qty_t const qty = be32toh(m->shares);
+        price_t const price = be32toh(m->price);
+        instruments_[index].trade_qty += qty;
+        instruments_[index].last = price;
         ++instruments_[index].num_trades;
+
+        if constexpr (detail::has_on_trade<Handler, instrument_type>)
+            handler_.on_trade(instruments_[index], qty, price);
     }
 
-    template <bool LoggingEnabled>
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
     void
-    parser<LoggingEnabled>::handle_trade_cross(trade_cross const* m) noexcept
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_trade_cross(
+            trade_cross const* m) noexcept
     {
         log_msg(m);
 
@@ -577,4 +1083,260 @@ namespace itch {
         }
     }
 
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    void
+    parser<LoggingEnabled, Handler, B, OrderStore>::handle_unknown(header const* m) noexcept
+    {
+        ++msg_stats_.unknown_count;
+        if (skip_unknown_)
+            return;
+
+        try {
+            fmt::print(stderr, "[ERROR] parse(): unknown msg type=[{:c}] length={}\n", m->msg_type,
+                    be16toh(m->length) + sizeof(m->length));
+        } catch (...)
+        {}
+        std::abort();
+    }
+
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    void
+    parser<LoggingEnabled, Handler, B, OrderStore>::apply_batch() noexcept
+    {
+        msg_columns<> const& c = columns_;
+        for (std::size_t i = 0; i < c.size; ++i) {
+            // column layout makes the lookahead cheap: no framing needed
+            std::size_t const ahead = i + prefetch_depth_;
+            if (prefetch_depth_ != 0 && ahead < c.size && watching(c.locate[ahead])) {
+                if (order_type const* o = orders_.slot(c.oid[ahead]))
+                    __builtin_prefetch(o, 1);
+                if (c.locate[ahead] < instruments_.size())
+                    __builtin_prefetch(&instruments_[c.locate[ahead]], 1);
+            }
+
+            if (!watching(c.locate[i]) && c.type[i] != 'R') {
+                ++msg_stats_.filtered_count;
+                continue;
+            }
+
+            // clang-format off
+            switch (c.type[i]) {
+                case 'A':
+                case 'F': apply_add(c.locate[i], c.oid[i], c.side[i], c.qty[i], c.price[i], c.timestamp[i]); break;
+                case 'D': apply_delete(c.locate[i], c.oid[i], c.timestamp[i]); break;
+                case 'U': apply_replace(c.locate[i], c.oid[i], c.new_oid[i], c.qty[i], c.price[i], c.timestamp[i]); break;
+                case 'E': apply_executed(c.locate[i], c.oid[i], c.qty[i], c.timestamp[i]); break;
+                case 'X': apply_cancel(c.locate[i], c.oid[i], c.qty[i], c.timestamp[i]); break;
+                case msg_columns<>::UnknownType: handle_unknown(c.msg[i]); break;
+                default: process_msg(c.msg[i]); break;
+            }
+            // clang-format on
+        }
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    void
+    parser<LoggingEnabled, Handler, B, OrderStore>::apply_add(
+            std::uint16_t index, oid_t order_number, Side side, qty_t qty, price_t price,
+            std::uint64_t timestamp) noexcept
+    {
+        sample_depth(timestamp);
+
+        order_type& o = orders_.insert(order_number);
+        o = order_type(side, price, qty);
+        set_order_ts(o, to_local_nsecs(timestamp));
+
+        instruments_[index].book.add_order(o);
+
+        ++instruments_[index].num_orders;
+
+        if constexpr (detail::has_on_add<Handler, instrument_type, order_type>)
+            handler_.on_add(instruments_[index], o);
+
+        publish_bbo(index, side, timestamp);
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    void
+    parser<LoggingEnabled, Handler, B, OrderStore>::apply_cancel(
+            std::uint16_t index, oid_t order_number, qty_t cancelled_qty,
+            std::uint64_t timestamp) noexcept
+    {
+        sample_depth(timestamp);
+
+        order_type* const o_ptr = orders_.find(order_number);
+        if (o_ptr == nullptr) [[unlikely]]
+            return;
+
+        order_type& o = *o_ptr;
+        // the book clears the order if this takes it out
+        order_type before = o;
+        instruments_[index].book.cancel_order(o, cancelled_qty);
+
+        if constexpr (detail::has_on_cancel<Handler, instrument_type, order_type>)
+            handler_.on_cancel(instruments_[index], after_cancel(o, before), cancelled_qty);
+
+        publish_bbo(index, order_side(before), timestamp);
+
+        if (o.qty == 0)
+            orders_.erase(order_number);
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    void
+    parser<LoggingEnabled, Handler, B, OrderStore>::apply_delete(
+            std::uint16_t index, oid_t order_number, std::uint64_t timestamp) noexcept
+    {
+        sample_depth(timestamp);
+
+        order_type* const o_ptr = orders_.find(order_number);
+        if (o_ptr == nullptr) [[unlikely]]
+            return;
+
+        order_type& o = *o_ptr;
+        Side const side = order_side(o);
+        if constexpr (detail::has_on_delete<Handler, instrument_type, order_type>) {
+            // the book clears the order it takes out
+            order_type const deleted = o;
+            instruments_[index].book.delete_order(o);
+            handler_.on_delete(instruments_[index], deleted);
+        } else {
+            instruments_[index].book.delete_order(o);
+        }
+        orders_.erase(order_number);
+
+        publish_bbo(index, side, timestamp);
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    void
+    parser<LoggingEnabled, Handler, B, OrderStore>::apply_executed(
+            std::uint16_t index, oid_t order_number, qty_t executed_qty,
+            std::uint64_t timestamp) noexcept
+    {
+        sample_depth(timestamp);
+
+        order_type* const o_ptr = orders_.find(order_number);
+        if (o_ptr == nullptr) [[unlikely]]
+            return;
+
+        order_type& o = *o_ptr;
+        price_t const price = order_price(o);
+        // the book clears the order if this takes it out
+        order_type before = o;
+
+        instruments_[index].book.cancel_order(o, executed_qty);
+
+        instruments_[index].trade_qty += executed_qty;
+        instruments_[index].last = price;
+        ++instruments_[index].num_trades;
+
+        if (market_state_ == MarketState::Open) {
+            // not all cross_trades marked as opening have prices, so
+            // record this
+            if (instruments_[index].open == 0)
+                instruments_[index].open = price;
+
+            if (instruments_[index].lo == InvalidLoPrice || price < instruments_[index].lo)
+                instruments_[index].lo = price;
+            if (instruments_[index].hi == InvalidHiPrice || price > instruments_[index].hi)
+                instruments_[index].hi = price;
+        }
+
+        if constexpr (detail::has_on_executed<Handler, instrument_type, order_type>) {
+            handler_.on_executed(instruments_[index], after_cancel(o, before), executed_qty, price);
+        }
+
+        publish_bbo(index, order_side(before), timestamp);
+
+        if (o.qty == 0)
+            orders_.erase(order_number);
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    void
+    parser<LoggingEnabled, Handler, B, OrderStore>::apply_replace(
+            std::uint16_t index, oid_t orig_order_number, oid_t new_order_number, qty_t qty,
+            price_t price, std::uint64_t timestamp) noexcept
+    {
+        sample_depth(timestamp);
+
+        order_type* const old_ptr = orders_.find(orig_order_number);
+        if (old_ptr == nullptr) [[unlikely]]
+            return;
+
+        order_type& old_order = *old_ptr;
+        order_type& new_order = orders_.insert(new_order_number);
+
+        new_order = order_type(order_side(old_order), price, qty);
+
+        if constexpr (detail::has_on_replace<Handler, instrument_type, order_type>) {
+            order_type const replaced = old_order;
+            instruments_[index].book.replace_order(old_order, new_order);
+            handler_.on_replace(instruments_[index], replaced, new_order);
+        } else {
+            instruments_[index].book.replace_order(old_order, new_order);
+        }
+        Side const side = order_side(new_order);
+        orders_.erase(orig_order_number);
+
+        publish_bbo(index, side, timestamp);
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    typename parser<LoggingEnabled, Handler, B, OrderStore>::order_type const&
+    parser<LoggingEnabled, Handler, B, OrderStore>::after_cancel(
+            order_type const& o, order_type& before) noexcept
+    {
+        if (o.qty != 0)
+            return o;
+
+        before.qty = 0;
+        return before;
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    void
+    parser<LoggingEnabled, Handler, B, OrderStore>::publish_bbo(
+            std::uint16_t index, Side side, std::uint64_t timestamp) noexcept
+    {
+        if constexpr (detail::has_on_bbo<Handler>) {
+            B const& book = instruments_[index].book;
+            top& t = tops_[index];
+            if (side == Side::Bid) {
+                pq const bid = book.best_bid();
+                if (bid == t.bid)
+                    return;
+                t.bid = bid;
+            } else {
+                pq const ask = book.best_ask();
+                if (ask == t.ask)
+                    return;
+                t.ask = ask;
+            }
+            handler_.on_bbo(bbo_update{timestamp, t.bid, t.ask, index});
+        }
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    void
+    parser<LoggingEnabled, Handler, B, OrderStore>::sample_depth(
+            std::uint64_t timestamp) noexcept
+    {
+        if (timestamp >= next_depth_) [[unlikely]]
+            write_depth(timestamp);
+    }
+
+    template <bool LoggingEnabled, typename Handler, Book B, typename OrderStore>
+    void
+    parser<LoggingEnabled, Handler, B, OrderStore>::write_depth(
+            std::uint64_t timestamp) noexcept
+    {
+        std::uint64_t const boundary = timestamp / depth_interval_ * depth_interval_;
+        for (std::uint16_t locate : depth_locates_)
+            depth_->write(boundary, locate, instruments_[locate].book);
+        next_depth_ = boundary + depth_interval_;
+    }
+
 } // namespace itch
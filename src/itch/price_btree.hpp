@@ -0,0 +1,365 @@
+#pragma once
+
+#include "core.hpp"
+#include "price_level.hpp"
+#include "allocator/memory_pool.hpp"
+#include "util/assert.hpp"
+#include <algorithm> // std::fill
+#include <cstddef>   // std::size_t
+#include <cstdint>
+#include <functional>  // std::greater, std::less
+#include <new>         // placement new
+#include <span>
+#include <type_traits> // std::conditional_t
+#include <vector>
+
+
+namespace itch {
+
+    namespace detail {
+
+        /// One side of a btree_book (or l3_book).
+        ///
+        /// A B+tree keyed by price, best first. Leaves hold up to LeafCap
+        /// prices in one contiguous array next to the pointers to their
+        /// levels, and are linked in price order so the book can be
+        /// walked from the inside out. Inner nodes hold the first price
+        /// of each child. Nodes are four cache lines, come from pools
+        /// that align them to a line, and so never straddle a fifth. The
+        /// price_levels live in a pool of their own so they never move
+        /// when a node splits, and order.pl stays valid.
+        ///
+        /// Nodes are not rebalanced on erase: a node is freed once it is
+        /// empty, and the root is collapsed while it has a single child.
+        /// Levels come and go around the inside, so underfull nodes are
+        /// refilled soon enough.
+        template <Side S, typename Level = price_level>
+        class price_btree
+        {
+        public:
+            static constexpr std::uint32_t LeafCap = 19;
+            static constexpr std::uint32_t InnerCap = 20;
+
+        private:
+            static constexpr std::uint32_t MaxHeight = 8;
+            static constexpr std::size_t CacheLineSize = 64;
+            using better = std::conditional_t<S == Side::Bid, std::greater<>, std::less<>>;
+
+            struct alignas(CacheLineSize) leaf
+            {
+                std::uint32_t count = 0;
+                leaf* prev = nullptr;
+                leaf* next = nullptr;
+                price_t prices[LeafCap];
+                Level* levels[LeafCap];
+            };
+
+            /// prices[i] is the first price under children[i], except
+            /// that prices[0] is never looked at
+            struct alignas(CacheLineSize) inner
+            {
+                std::uint32_t count = 0;
+                price_t prices[InnerCap];
+                void* children[InnerCap];
+            };
+
+            /// a descent from the root, with the child taken at each
+            /// inner node
+            struct path
+            {
+                inner* nodes[MaxHeight];
+                std::uint32_t slots[MaxHeight];
+            };
+
+        private:
+            static constexpr std::uint32_t NumLevels = 50;
+            static constexpr std::uint32_t NumLeaves = 4;
+            static constexpr std::uint32_t NumInners = 2;
+
+        private:
+            memory_pool pool_; ///< levels
+            aligned_memory_pool<CacheLineSize> leaf_pool_;
+            aligned_memory_pool<CacheLineSize> inner_pool_;
+            void* root_ = nullptr;
+            std::uint32_t height_ = 0; ///< inner levels above the leaves
+            leaf* first_ = nullptr;    ///< holds the best level
+
+        public:
+            inline price_btree() noexcept;
+
+            /// returns the level at price, creating it (with 0 qty) if
+            /// there isn't one
+            inline Level& find_or_add(price_t) noexcept;
+
+            /// returns the level at price, or nullptr if there isn't one
+            inline Level* find(price_t) const noexcept;
+
+            /// erases a level and frees it
+            inline void erase(Level&) noexcept;
+
+            inline Level const* best() const noexcept;
+
+            /// all levels, best first
+            inline std::vector<price_level> levels() const;
+
+            /// copies the best out.size() levels to out, {0, 0} past the
+            /// last one
+            inline void depth(std::span<pq> out) const noexcept;
+
+            inline std::size_t max_levels() const noexcept;
+
+        private:
+            inline leaf* descend(price_t, path&) const noexcept;
+            inline void insert_child(path&, std::uint32_t depth, price_t, void* child) noexcept;
+            inline void remove_child(path&, std::uint32_t depth) noexcept;
+        };
+
+        /**********************************************************************/
+
+        template <Side S, typename Level>
+        price_btree<S, Level>::price_btree() noexcept
+                : pool_(sizeof(Level), NumLevels)
+                , leaf_pool_(sizeof(leaf), NumLeaves)
+                , inner_pool_(sizeof(inner), NumInners)
+        {
+            static_assert(sizeof(leaf) == 4 * CacheLineSize);
+            static_assert(sizeof(inner) == 4 * CacheLineSize);
+            static_assert(decltype(leaf_pool_)::alignment == alignof(leaf));
+            static_assert(decltype(inner_pool_)::alignment == alignof(inner));
+
+            first_ = new (leaf_pool_.allocate_node()) leaf();
+            root_ = first_;
+        }
+
+        template <Side S, typename Level>
+        Level&
+        price_btree<S, Level>::find_or_add(price_t price) noexcept
+        {
+            path p;
+            leaf* l = descend(price, p);
+
+            std::uint32_t i = 0;
+            while (i < l->count && better()(l->prices[i], price))
+                ++i;
+            if (i < l->count && l->prices[i] == price)
+                return *l->levels[i];
+
+            Level* pl = new (pool_.allocate_node()) Level(price, 0);
+
+            if (l->count == LeafCap) {
+                // split, the upper half goes to a new leaf after l. a
+                // price going to the new leaf never goes first, so its
+                // first price is final
+                constexpr std::uint32_t Half = LeafCap / 2;
+                leaf* r = new (leaf_pool_.allocate_node()) leaf();
+                r->count = LeafCap - Half;
+                for (std::uint32_t j = 0; j < r->count; ++j) {
+                    r->prices[j] = l->prices[Half + j];
+                    r->levels[j] = l->levels[Half + j];
+                }
+                l->count = Half;
+
+                r->prev = l;
+                r->next = l->next;
+                if (l->next != nullptr)
+                    l->next->prev = r;
+                l->next = r;
+
+                insert_child(p, height_, r->prices[0], r);
+                if (i > Half) {
+                    i -= Half;
+                    l = r;
+                }
+            }
+
+            for (std::uint32_t j = l->count; j > i; --j) {
+                l->prices[j] = l->prices[j - 1];
+                l->levels[j] = l->levels[j - 1];
+            }
+            l->prices[i] = price;
+            l->levels[i] = pl;
+            ++l->count;
+            return *pl;
+        }
+
+        template <Side S, typename Level>
+        Level*
+        price_btree<S, Level>::find(price_t price) const noexcept
+        {
+            path p;
+            leaf const* l = descend(price, p);
+            for (std::uint32_t i = 0; i < l->count; ++i)
+                if (l->prices[i] == price)
+                    return l->levels[i];
+            return nullptr;
+        }
+
+        template <Side S, typename Level>
+        void
+        price_btree<S, Level>::erase(Level& pl) noexcept
+        {
+            path p;
+            leaf* l = descend(pl.price(), p);
+
+            std::uint32_t i = 0;
+            while (i < l->count && l->prices[i] != pl.price())
+                ++i;
+            DEBUG_ASSERT(i < l->count && l->levels[i] == &pl);
+
+            for (--l->count; i < l->count; ++i) {
+                l->prices[i] = l->prices[i + 1];
+                l->levels[i] = l->levels[i + 1];
+            }
+            pool_.deallocate_node(&pl);
+
+            // the root leaf stays, even when empty
+            if (l->count == 0 && height_ > 0) {
+                if (l->prev != nullptr)
+                    l->prev->next = l->next;
+                if (l->next != nullptr)
+                    l->next->prev = l->prev;
+                if (l == first_)
+                    first_ = l->next;
+                leaf_pool_.deallocate_node(l);
+                remove_child(p, height_);
+            }
+        }
+
+        template <Side S, typename Level>
+        Level const*
+        price_btree<S, Level>::best() const noexcept
+        {
+            return (first_->count != 0) ? first_->levels[0] : nullptr;
+        }
+
+        template <Side S, typename Level>
+        std::vector<price_level>
+        price_btree<S, Level>::levels() const
+        {
+            std::vector<price_level> v;
+            for (leaf const* l = first_; l != nullptr; l = l->next)
+                for (std::uint32_t i = 0; i < l->count; ++i)
+                    v.push_back(*l->levels[i]);
+            return v;
+        }
+
+        template <Side S, typename Level>
+        void
+        price_btree<S, Level>::depth(std::span<pq> out) const noexcept
+        {
+            std::size_t n = 0;
+            for (leaf const* l = first_; l != nullptr && n < out.size(); l = l->next)
+                for (std::uint32_t i = 0; i < l->count && n < out.size(); ++i)
+                    out[n++] = {l->levels[i]->price(), l->levels[i]->agg_qty()};
+            std::fill(out.begin() + n, out.end(), pq());
+        }
+
+        template <Side S, typename Level>
+        std::size_t
+        price_btree<S, Level>::max_levels() const noexcept
+        {
+            return pool_.max_used();
+        }
+
+        // private
+
+        /// the leaf that holds, or would hold, price
+        template <Side S, typename Level>
+        typename price_btree<S, Level>::leaf*
+        price_btree<S, Level>::descend(price_t price, path& p) const noexcept
+        {
+            void* n = root_;
+            for (std::uint32_t depth = 0; depth < height_; ++depth) {
+                inner* in = static_cast<inner*>(n);
+                std::uint32_t i = 1;
+                while (i < in->count && !better()(price, in->prices[i]))
+                    ++i;
+                p.nodes[depth] = in;
+                p.slots[depth] = i - 1;
+                n = in->children[i - 1];
+            }
+            return static_cast<leaf*>(n);
+        }
+
+        /// Inserts a node split off at depth into its parent, right after
+        /// the node it was split from, splitting the parent in turn if it
+        /// is full. A split root gets a new root above it.
+        template <Side S, typename Level>
+        void
+        price_btree<S, Level>::insert_child(
+                path& p, std::uint32_t depth, price_t price, void* child) noexcept
+        {
+            if (depth == 0) {
+                DEBUG_ASSERT(height_ < MaxHeight);
+                inner* r = new (inner_pool_.allocate_node()) inner();
+                r->count = 2;
+                r->prices[0] = 0;
+                r->children[0] = root_;
+                r->prices[1] = price;
+                r->children[1] = child;
+                root_ = r;
+                ++height_;
+                return;
+            }
+
+            inner* in = p.nodes[depth - 1];
+            std::uint32_t pos = p.slots[depth - 1] + 1;
+            if (in->count == InnerCap) {
+                constexpr std::uint32_t Half = InnerCap / 2;
+                inner* r = new (inner_pool_.allocate_node()) inner();
+                r->count = InnerCap - Half;
+                for (std::uint32_t j = 0; j < r->count; ++j) {
+                    r->prices[j] = in->prices[Half + j];
+                    r->children[j] = in->children[Half + j];
+                }
+                in->count = Half;
+
+                insert_child(p, depth - 1, r->prices[0], r);
+                if (pos > Half) {
+                    pos -= Half;
+                    in = r;
+                }
+            }
+
+            for (std::uint32_t j = in->count; j > pos; --j) {
+                in->prices[j] = in->prices[j - 1];
+                in->children[j] = in->children[j - 1];
+            }
+            in->prices[pos] = price;
+            in->children[pos] = child;
+            ++in->count;
+        }
+
+        /// Removes the (freed) node at depth from its parent, freeing
+        /// the parent in turn if that empties it, and collapses the root
+        /// while it has a single child.
+        template <Side S, typename Level>
+        void
+        price_btree<S, Level>::remove_child(path& p, std::uint32_t depth) noexcept
+        {
+            inner* in = p.nodes[depth - 1];
+            for (std::uint32_t i = p.slots[depth - 1] + 1; i < in->count; ++i) {
+                in->prices[i - 1] = in->prices[i];
+                in->children[i - 1] = in->children[i];
+            }
+            --in->count;
+
+            if (in->count == 0) {
+                // the root always has two children or more
+                DEBUG_ASSERT(depth > 1);
+                inner_pool_.deallocate_node(in);
+                remove_child(p, depth - 1);
+                return;
+            }
+
+            while (height_ > 0 && static_cast<inner*>(root_)->count == 1) {
+                inner* r = static_cast<inner*>(root_);
+                root_ = r->children[0];
+                --height_;
+                inner_pool_.deallocate_node(r);
+            }
+        }
+
+    } // namespace detail
+
+} // namespace itch
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "core.hpp"
+#include "util/assert.hpp"
+#include <algorithm> // std::max
+#include <bit>       // std::bit_ceil, std::countr_zero
+#include <cstddef>   // std::size_t
+#include <cstdint>
+#include <limits>
+#include <memory>      // std::unique_ptr, std::make_unique
+#include <type_traits> // std::is_unsigned_v
+#include <utility>     // std::exchange, std::move, std::swap
+
+
+namespace itch {
+
+    /// Open-addressing hash map keyed by price, as hashed_book's index
+    /// into its levels. Key may be any other unsigned integer, e.g. an
+    /// oid for hashed_order_store.
+    ///
+    /// Each slot holds a price and its value inline, so a lookup reads
+    /// one or two cache lines and an entry costs no allocation of its
+    /// own. Probing is linear with Robin Hood insertion: an entry never
+    /// sits further from its home slot than the one it displaced, which
+    /// keeps probe runs short and lets a miss stop early. Erase shifts
+    /// the rest of the run back one slot rather than leaving a
+    /// tombstone. The table is allocated on the first insert and
+    /// doubles once it is 7/8 full, so it stops allocating as soon as
+    /// it has been as deep as the book gets.
+    template <typename T, typename Key = price_t>
+    class price_map
+    {
+        static_assert(std::is_unsigned_v<Key>);
+
+    private:
+        /// marks an empty slot, never a price on a book (or an oid)
+        static constexpr Key EmptyPrice = std::numeric_limits<Key>::max();
+        static constexpr std::uint32_t MinCapacity = 8;
+
+        struct slot
+        {
+            Key price = EmptyPrice;
+            T value = T();
+        };
+
+    private:
+        std::unique_ptr<slot[]> slots_;
+        std::uint32_t capacity_ = 0; ///< a power of 2, 0 before the first insert
+        std::uint32_t shift_ = 0;    ///< 64 - log2(capacity_)
+        std::uint32_t size_ = 0;
+        std::uint32_t initial_capacity_;
+
+    public:
+        /// the first allocation has room for at least min_size entries
+        inline explicit price_map(std::uint32_t min_size) noexcept;
+
+        /// returns the value at price, or nullptr if there is none
+        inline T* find(Key) const noexcept;
+
+        /// adds price, which must not be in the map yet. may throw
+        /// std::bad_alloc when the table grows
+        inline void insert(Key, T value);
+
+        /// removes price, which must be in the map, and returns its value
+        inline T erase(Key) noexcept;
+
+        inline std::size_t size() const noexcept;
+
+        /// number of slots
+        inline std::size_t capacity() const noexcept;
+
+    private:
+        inline std::uint32_t home(Key) const noexcept;
+        inline std::uint32_t distance(std::uint32_t index) const noexcept;
+        inline std::uint32_t index_of(Key) const noexcept;
+        inline void place(slot) noexcept;
+        inline void grow();
+    };
+
+    /**********************************************************************/
+
+    template <typename T, typename Key>
+    price_map<T, Key>::price_map(std::uint32_t min_size) noexcept
+            : initial_capacity_(std::bit_ceil(std::max((min_size * 8 + 6) / 7, MinCapacity)))
+    {
+        // empty
+    }
+
+    template <typename T, typename Key>
+    T*
+    price_map<T, Key>::find(Key price) const noexcept
+    {
+        std::uint32_t const i = index_of(price);
+        return (i == capacity_) ? nullptr : &slots_[i].value;
+    }
+
+    template <typename T, typename Key>
+    void
+    price_map<T, Key>::insert(Key price, T value)
+    {
+        DEBUG_ASSERT(price != EmptyPrice);
+        DEBUG_ASSERT(index_of(price) == capacity_);
+
+        if ((size_ + 1) * 8 > capacity_ * 7)
+            grow();
+        place(slot{price, std::move(value)});
+        ++size_;
+    }
+
+    template <typename T, typename Key>
+    T
+    price_map<T, Key>::erase(Key price) noexcept
+    {
+        std::uint32_t i = index_of(price);
+        DEBUG_ASSERT(i != capacity_);
+        T value = std::move(slots_[i].value);
+
+        // pull the rest of the run back over the gap, up to an empty
+        // slot or an entry already in its home slot
+        std::uint32_t const mask = capacity_ - 1;
+        for (std::uint32_t j = (i + 1) & mask;
+                slots_[j].price != EmptyPrice && distance(j) != 0; j = (j + 1) & mask) {
+            slots_[i] = std::move(slots_[j]);
+            i = j;
+        }
+        slots_[i] = slot();
+        --size_;
+        return value;
+    }
+
+    template <typename T, typename Key>
+    std::size_t
+    price_map<T, Key>::size() const noexcept
+    {
+        return size_;
+    }
+
+    template <typename T, typename Key>
+    std::size_t
+    price_map<T, Key>::capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+    template <typename T, typename Key>
+    std::uint32_t
+    price_map<T, Key>::home(Key price) const noexcept
+    {
+        // fibonacci hashing, spreads prices a tick apart over the table
+        return static_cast<std::uint32_t>((price * 0x9e3779b97f4a7c15ULL) >> shift_);
+    }
+
+    template <typename T, typename Key>
+    std::uint32_t
+    price_map<T, Key>::distance(std::uint32_t index) const noexcept
+    {
+        return (index - home(slots_[index].price)) & (capacity_ - 1);
+    }
+
+    /// index of the slot holding price, capacity_ if there is none
+    template <typename T, typename Key>
+    std::uint32_t
+    price_map<T, Key>::index_of(Key price) const noexcept
+    {
+        if (size_ == 0)
+            return capacity_;
+
+        std::uint32_t const mask = capacity_ - 1;
+        std::uint32_t i = home(price);
+        for (std::uint32_t dist = 0;; ++dist, i = (i + 1) & mask) {
+            Key const p = slots_[i].price;
+            if (p == price)
+                return i;
+            // an entry closer to home than price would be means price
+            // would have displaced it
+            if (p == EmptyPrice || distance(i) < dist)
+                return capacity_;
+        }
+    }
+
+    /// robin hood insert, the table has a free slot
+    template <typename T, typename Key>
+    void
+    price_map<T, Key>::place(slot s) noexcept
+    {
+        std::uint32_t const mask = capacity_ - 1;
+        std::uint32_t i = home(s.price);
+        for (std::uint32_t dist = 0;; ++dist, i = (i + 1) & mask) {
+            if (slots_[i].price == EmptyPrice) {
+                slots_[i] = std::move(s);
+                return;
+            }
+            std::uint32_t const d = distance(i);
+            if (d < dist) {
+                std::swap(s, slots_[i]);
+                dist = d;
+            }
+        }
+    }
+
+    template <typename T, typename Key>
+    void
+    price_map<T, Key>::grow()
+    {
+        std::uint32_t const old_capacity = capacity_;
+        std::uint32_t const new_capacity =
+                (old_capacity == 0) ? initial_capacity_ : old_capacity * 2;
+        std::unique_ptr<slot[]> old = std::exchange(slots_, std::make_unique<slot[]>(new_capacity));
+
+        capacity_ = new_capacity;
+        shift_ = 64 - std::countr_zero(capacity_);
+        for (std::uint32_t i = 0; i < old_capacity; ++i) {
+            if (old[i].price != EmptyPrice)
+                place(std::move(old[i]));
+        }
+    }
+
+} // namespace itch
@@ -0,0 +1,370 @@
+#include "sharded_parser.hpp"
+#include "allocator/numa.hpp"
+#include "util/assert.hpp"
+#include <endian.h>
+#include <fmt/format.h>
+#include <algorithm> // std::max, std::min_element, std::ranges::all_of, std::sort
+#include <cstdlib>   // std::abort
+#include <cstring>   // std::memcpy
+#include <exception>
+#include <numeric> // std::iota
+
+
+namespace itch {
+
+    sharded_parser::shard::shard(
+            bool print_sys_events, bool skip_unknown, int numa_node, bool share_pools)
+            : p({}, print_sys_events, skip_unknown, default_handler(), share_pools)
+            , ring()
+            , thread()
+            , node(numa_node)
+    {
+        // empty
+    }
+
+    sharded_parser::sharded_parser(std::filesystem::path const& stats_fpath,
+            bool print_sys_events, bool skip_unknown, std::size_t num_shards, bool numa,
+            bool share_pools)
+            : shards_()
+            , owner_(std::size_t(1) << 16)
+            , skip_unknown_(skip_unknown)
+            , stats_file_(stats_fpath.empty() ? nullptr : std::fopen(stats_fpath.c_str(), "w"))
+    {
+        DEBUG_ASSERT(num_shards > 0);
+
+        // only one worker reports system events, they're seen by all
+        std::size_t const num_nodes = numa ? numa::num_nodes() : 1;
+        for (std::size_t i = 0; i < num_shards; ++i) {
+            int const node = numa ? static_cast<int>(i % num_nodes) : numa::AnyNode;
+            if (numa)
+                numa::prefer_node(node);
+            shards_.push_back(std::make_unique<shard>(
+                    print_sys_events && i == 0, skip_unknown, node, share_pools));
+        }
+        if (numa)
+            numa::prefer_node(numa::AnyNode);
+
+        for (std::size_t locate = 0; locate < owner_.size(); ++locate)
+            owner_[locate] = locate % num_shards;
+    }
+
+    sharded_parser::~sharded_parser() noexcept
+    {
+        finish();
+
+        if (stats_file_ != nullptr) {
+            std::fclose(stats_file_);
+            stats_file_ = nullptr;
+        }
+    }
+
+    std::size_t
+    sharded_parser::parse(std::uint8_t const* buf, std::size_t bytes_to_read) noexcept
+    {
+        if (!streaming_) {
+            streaming_ = true;
+            for (auto& s : shards_)
+                s->thread = std::thread(&sharded_parser::run, std::ref(*s));
+        }
+
+        // only known msgs are routed
+        static_assert(std::ranges::all_of(msg_types, [](auto const& t) {
+            return t.length <= MaxMsgLen;
+        }));
+
+        std::size_t const num_shards = shards_.size();
+        std::size_t bytes_processed = 0;
+        std::uint8_t const* end = buf + bytes_to_read;
+        while (buf + sizeof(header) < end) {
+            auto hdr = reinterpret_cast<header const*>(buf);
+            std::uint16_t const msg_len = be16toh(hdr->length) + sizeof(hdr->length);
+
+            // not enough bytes for the full msg, read nothing
+            if (buf + msg_len > end)
+                break;
+
+            // counted here, as locate 0 msgs are seen by every shard
+            std::uint16_t const locate = be16toh(hdr->stock_locate);
+            if (msg_types[static_cast<std::uint8_t>(hdr->msg_type)].length != msg_len) {
+                handle_unknown(hdr);
+            } else if (locate == 0) {
+                for (std::size_t i = 0; i < num_shards; ++i)
+                    route(i, hdr, msg_len);
+            } else {
+                route(owner_[locate], hdr, msg_len);
+            }
+
+            ++msg_count_;
+            buf += msg_len;
+            bytes_processed += msg_len;
+        }
+        return bytes_processed;
+    }
+
+    std::size_t
+    sharded_parser::replay(std::uint8_t const* buf, std::size_t bytes_to_read) noexcept
+    {
+        DEBUG_ASSERT(!streaming_);
+
+        msg_index index;
+        std::size_t const bytes_indexed = index.build(buf, bytes_to_read);
+        assign_locates(index);
+
+        try {
+            std::vector<std::vector<std::uint16_t>> locates(shards_.size());
+            for (std::size_t locate = 1; locate < index.num_locates(); ++locate) {
+                if (!index.offsets(locate).empty())
+                    locates[owner_[locate]].push_back(locate);
+            }
+
+            for (std::size_t i = 0; i < shards_.size(); ++i) {
+                shards_[i]->thread = std::thread(&sharded_parser::replay_locates,
+                        std::ref(*shards_[i]), buf, std::cref(index), std::cref(locates[i]));
+            }
+
+            for (auto& s : shards_)
+                s->thread.join();
+        } catch (std::exception const& e) {
+            std::fprintf(stderr, "[ERROR] exception in %s: %s\n", __builtin_FUNCTION(), e.what());
+            std::abort();
+        }
+
+        msg_count_ += index.msg_count();
+        unknown_count_ += index.unknown_count();
+        return bytes_indexed;
+    }
+
+    void
+    sharded_parser::finish() noexcept
+    {
+        if (!streaming_)
+            return;
+
+        for (auto& s : shards_) {
+            if (!s->thread.joinable())
+                continue;
+
+            // a zero-length msg tells the worker to stop
+            msg_slot* slot = s->ring.alloc();
+            reinterpret_cast<header*>(slot->bytes)->length = 0;
+            s->ring.push();
+        }
+
+        for (auto& s : shards_) {
+            if (s->thread.joinable())
+                s->thread.join();
+        }
+
+        // the next parse() starts the workers again
+        streaming_ = false;
+    }
+
+    void
+    sharded_parser::watch(std::vector<std::string> const& symbols)
+    {
+        for (auto& s : shards_)
+            s->p.watch(symbols);
+    }
+
+    void
+    sharded_parser::print_stats() const
+    {
+        std::size_t max_bid_pool_used = 0;
+        std::size_t max_ask_pool_used = 0;
+        std::size_t pages_in_use = 0;
+        std::size_t max_pages_in_use = 0;
+        std::size_t pages_allocated = 0;
+        std::size_t filtered_count = 0;
+        for (auto const& s : shards_) {
+            for (auto const& itr : s->p.instruments()) {
+                auto [bid_used, ask_used] = itr.allocator_stats();
+                max_bid_pool_used = std::max(max_bid_pool_used, bid_used);
+                max_ask_pool_used = std::max(max_ask_pool_used, ask_used);
+            }
+            pages_in_use += s->p.orders().pages_in_use();
+            max_pages_in_use += s->p.orders().max_pages_in_use();
+            pages_allocated += s->p.orders().pages_allocated();
+            filtered_count += s->p.filtered_count();
+        }
+
+        // clang-format off
+        fmt::print("parser msg stats\n"
+                "  msgs processed:    {}\n"
+                "  msgs skipped:      {}\n"
+                "  msgs filtered:     {}\n"
+                "  shards:            {}\n"
+                "  max_bid_pool_used: {}\n"
+                "  max_ask_pool_used: {}\n"
+                "  order pages used:  {} (max {}, allocated {}, {} bytes each)\n",
+            msg_count_,
+            unknown_count_,
+            filtered_count,
+            shards_.size(),
+            max_bid_pool_used,
+            max_ask_pool_used,
+            pages_in_use,
+            max_pages_in_use,
+            pages_allocated,
+            shards_.front()->p.orders().page_bytes());
+        // clang-format on
+
+        // each shard commits pages for its own orders only
+        for (std::size_t i = 0; i < shards_.size(); ++i) {
+            auto const& orders = shards_[i]->p.orders();
+            fmt::print("  shard {} order pages: {} ({} orders live)\n", i, orders.pages_in_use(),
+                    orders.size());
+        }
+
+        if (stats_file_ != nullptr) {
+            fmt::print(stats_file_, "{}\n", instrument::stats_csv_header());
+
+            // same (locate) order as a single-threaded run
+            std::size_t const num_instruments = shards_.front()->p.instruments().size();
+            for (std::size_t locate = 1; locate < num_instruments; ++locate) {
+                auto const& instrument = shards_[owner_[locate]]->p.instruments()[locate];
+                if (instrument.locate == 0)
+                    continue;
+
+                fmt::print(stats_file_, "{}\n", instrument.stats_csv());
+            }
+        }
+    }
+
+    std::size_t
+    sharded_parser::msg_count() const noexcept
+    {
+        return msg_count_;
+    }
+
+    std::size_t
+    sharded_parser::unknown_count() const noexcept
+    {
+        return unknown_count_;
+    }
+
+    parser<false>::instrument_type const&
+    sharded_parser::instrument(std::uint16_t locate) const noexcept
+    {
+        auto const& instruments = shards_[owner_[locate]]->p.instruments();
+        DEBUG_ASSERT(locate < instruments.size());
+        return instruments[locate];
+    }
+
+    // private
+
+    void
+    sharded_parser::handle_unknown(header const* hdr) noexcept
+    {
+        ++unknown_count_;
+        if (skip_unknown_)
+            return;
+        try {
+            fmt::print(stderr, "[ERROR] parse(): unknown msg type=[{:c}] length={}\n",
+                    hdr->msg_type, be16toh(hdr->length) + sizeof(hdr->length));
+        } catch (...)
+        {}
+        std::abort();
+    }
+
+    void
+    sharded_parser::route(std::size_t shard_index, header const* hdr, std::size_t msg_len) noexcept
+    {
+        DEBUG_ASSERT(msg_len <= MaxMsgLen);
+        auto& ring = shards_[shard_index]->ring;
+        msg_slot* slot = ring.alloc();
+        std::memcpy(slot->bytes, hdr, msg_len);
+        ring.push();
+    }
+
+    void
+    sharded_parser::assign_locates(msg_index const& index) noexcept
+    {
+        if (index.num_locates() < 2)
+            return;
+
+        try {
+            // largest first, each to the least loaded shard. locate 0
+            // (market-wide msgs) is seen by all of them
+            std::vector<std::uint16_t> by_count(index.num_locates() - 1);
+            std::iota(by_count.begin(), by_count.end(), 1);
+            std::sort(by_count.begin(), by_count.end(), [&index](auto lhs, auto rhs) {
+                return index.offsets(lhs).size() > index.offsets(rhs).size();
+            });
+
+            std::vector<std::size_t> load(shards_.size(), 0);
+            for (std::uint16_t const locate : by_count) {
+                std::size_t const i = std::min_element(load.begin(), load.end()) - load.begin();
+                owner_[locate] = i;
+                load[i] += index.offsets(locate).size();
+            }
+        } catch (std::exception const& e) {
+            std::fprintf(stderr, "[ERROR] exception in %s: %s\n", __builtin_FUNCTION(), e.what());
+            std::abort();
+        }
+    }
+
+    void
+    sharded_parser::replay_locates(shard& s, std::uint8_t const* buf, msg_index const& index,
+            std::vector<std::uint16_t> const& locates) noexcept
+    {
+        place(s);
+        auto const process = [&s, buf](std::uint64_t offset) {
+            s.p.process_msg(reinterpret_cast<header const*>(buf + offset));
+        };
+
+        // market-wide msgs on their own first, that's when they are
+        // printed (by shard 0 only)
+        std::vector<std::uint64_t> const& events = index.offsets(0);
+        for (std::uint64_t const offset : events)
+            process(offset);
+        s.p.print_sys_events(false);
+
+        // market state is per parser, so each locate gets the market-wide
+        // msgs again, merged in file order with its own
+        for (std::uint16_t const locate : locates) {
+            auto event = events.begin();
+            for (std::uint64_t const offset : index.offsets(locate)) {
+                for (; event != events.end() && *event < offset; ++event)
+                    process(*event);
+                process(offset);
+            }
+            for (; event != events.end(); ++event)
+                process(*event);
+        }
+    }
+
+    void
+    sharded_parser::run(shard& s) noexcept
+    {
+        place(s);
+        std::size_t spins = 0;
+        while (true) {
+            msg_slot const* slot = s.ring.front();
+            if (slot == nullptr) {
+                decltype(s.ring)::relax(spins);
+                continue;
+            }
+            spins = 0;
+
+            auto hdr = reinterpret_cast<header const*>(slot->bytes);
+            if (hdr->length == 0) {
+                s.ring.pop();
+                break;
+            }
+
+            s.p.process_msg(hdr);
+            s.ring.pop();
+        }
+    }
+
+    void
+    sharded_parser::place(shard const& s) noexcept
+    {
+        if (s.node == numa::AnyNode)
+            return;
+
+        numa::run_on_node(s.node);
+        numa::prefer_node(s.node);
+    }
+
+} // namespace itch
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "hashed_order_store.hpp"
+#include "msg_index.hpp"
+#include "parser.hpp"
+#include "protocol/itch/itch.cppgen.hpp"
+#include "util/spsc_ring.hpp"
+#include <filesystem>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cstdio> // std::FILE
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace itch {
+
+    /// Builds books on several threads.
+    ///
+    /// Each worker runs its own parser and so owns its own instruments
+    /// and its own order store: every order msg carries the locate of the
+    /// instrument the order belongs to, so an order is only ever seen by
+    /// one worker and nothing is shared between them. Order refs are
+    /// assigned across all locates, so a worker's orders are spread over
+    /// the whole order space: its store is a hashed_order_store, which
+    /// commits pages for the orders the worker holds rather than for
+    /// every page of refs in flight (see print_stats()).
+    ///
+    /// Msgs are fed in one of two ways (not both on the same object):
+    ///  - parse(): streaming. The calling thread frames msgs and routes
+    ///    each one, by stock_locate, to the worker owning that locate
+    ///    over a lock-free SPSC ring. Market-wide msgs (stock_locate 0,
+    ///    e.g. system events) are broadcast to every worker.
+    ///  - replay(): whole buffer (e.g. an mmap'd file). A msg_index
+    ///    pre-pass finds every msg of every locate, locates are spread
+    ///    over the workers by msg count and each worker then replays its
+    ///    own locates, one after the other, straight from the buffer.
+    ///
+    /// With numa set, shards are spread round-robin over the NUMA nodes:
+    /// a shard's parser (books and pools) is allocated preferring its
+    /// node, and its worker runs on the node's cpus and prefers its
+    /// memory, for the order pages it commits. This replaces the memory
+    /// policy of the threads involved (e.g. one set with numactl); on a
+    /// single node machine it only pins the workers to that node's cpus.
+    ///
+    /// With share_pools, the books of each shard share one set of level
+    /// pools (see parser), so pools are never shared across threads.
+    class sharded_parser
+    {
+    private:
+        enum
+        {
+            /// largest itch msg (incl. length) is 52 bytes
+            MaxMsgLen = 64,
+
+            /// msgs in flight per worker
+            RingSize = 1 << 14,
+        };
+
+        struct alignas(MaxMsgLen) msg_slot
+        {
+            std::uint8_t bytes[MaxMsgLen];
+        };
+
+        using shard_parser = parser<false, default_handler, mp_book, hashed_order_store<>>;
+
+        struct shard
+        {
+            shard_parser p;
+            spsc_ring<msg_slot, RingSize> ring;
+            std::thread thread;
+            int node; ///< numa::AnyNode unless placed
+
+            shard(bool print_sys_events, bool skip_unknown, int numa_node, bool share_pools);
+        };
+
+    private:
+        std::vector<std::unique_ptr<shard>> shards_;
+        std::vector<std::uint16_t> owner_; // shard index by locate
+        bool streaming_ = false;
+        bool skip_unknown_ = false;
+        std::FILE* stats_file_ = nullptr;
+        std::size_t msg_count_ = 0;
+        std::size_t unknown_count_ = 0;
+
+    public:
+        sharded_parser(std::filesystem::path const& stats_fpath, bool print_sys_events,
+                bool skip_unknown, std::size_t num_shards, bool numa = false,
+                bool share_pools = false);
+        ~sharded_parser() noexcept;
+        sharded_parser(sharded_parser const&) noexcept = delete;
+        sharded_parser(sharded_parser&&) noexcept = delete;
+        sharded_parser& operator=(sharded_parser const&) noexcept = delete;
+        sharded_parser& operator=(sharded_parser&&) noexcept = delete;
+
+        std::size_t parse(std::uint8_t const* buf, std::size_t bytes_to_read) noexcept;
+
+        /// processes every complete msg in buf, returns once all of them
+        /// have been applied to the books
+        std::size_t replay(std::uint8_t const* buf, std::size_t bytes_to_read) noexcept;
+
+        /// waits for every worker to drain its ring and stops them.
+        /// must be called before print_stats(). parse() may be called
+        /// again afterwards, which restarts the workers
+        void finish() noexcept;
+
+        /// see parser::watch(), must be called before parse()/replay()
+        void watch(std::vector<std::string> const& symbols);
+
+        /// as parser::print_stats(), with the order pages of each shard
+        void print_stats() const;
+
+        // accessors
+    public:
+        std::size_t msg_count() const noexcept;
+
+        /// msgs of an unknown type or length, see parser
+        std::size_t unknown_count() const noexcept;
+
+        /// the instrument of this locate, from the shard owning it. only
+        /// complete after finish() or replay()
+        parser<false>::instrument_type const& instrument(std::uint16_t locate) const noexcept;
+
+    private:
+        /// counts the msg, aborts unless skip_unknown is set, as
+        /// parser::handle_unknown() does
+        void handle_unknown(header const*) noexcept;
+        void route(std::size_t shard_index, header const*, std::size_t msg_len) noexcept;
+        void assign_locates(msg_index const&) noexcept;
+        static void replay_locates(shard&, std::uint8_t const* buf, msg_index const&,
+                std::vector<std::uint16_t> const& locates) noexcept;
+        static void run(shard&) noexcept;
+        static void place(shard const&) noexcept;
+    };
+
+} // namespace itch
@@ -0,0 +1,321 @@
+#include "vector_book.hpp"
+#include "level_table.hpp" // handled_level
+#include "util/assert.hpp"
+#include "util/simd.hpp"
+#include <immintrin.h>
+#include <algorithm> // std::fill, std::min
+#include <cstdint>
+#include <cstdio>  // std::fprintf
+#include <cstdlib> // std::abort
+#include <exception>
+#include <new> // placement new
+
+
+namespace { // unnamed
+
+    using namespace itch;
+
+    // allocate this many price levels in the memory pool
+    constexpr std::uint32_t NumPriceLevels = 50;
+
+    bool const UseAvx2 = detect_simd_level() >= simd_level::avx2;
+
+    /// true if a is a worse price than b for side S
+    template <Side S>
+    constexpr bool
+    worse(price_t a, price_t b) noexcept
+    {
+        return (S == Side::Bid) ? a < b : a > b;
+    }
+
+    template <Side S>
+    std::size_t
+    position_scalar(price_t const* prices, std::size_t n, price_t price) noexcept
+    {
+        while (n > 0 && !worse<S>(prices[n - 1], price))
+            --n;
+        return n;
+    }
+
+    /// Scans 8 prices at a time from the back. The worse prices are a
+    /// prefix, so the first block that has any ends the scan, and the
+    /// position is just past its last worse lane.
+    template <Side S>
+    __attribute__((target("avx2"))) std::size_t
+    position_avx2(price_t const* prices, std::size_t n, price_t price) noexcept
+    {
+        // prices are unsigned, flip the sign bit for the signed compare
+        __m256i const bias = _mm256_set1_epi32(static_cast<int>(0x80000000));
+        __m256i const p = _mm256_xor_si256(_mm256_set1_epi32(static_cast<int>(price)), bias);
+
+        for (; n >= 8; n -= 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(prices + n - 8));
+            v = _mm256_xor_si256(v, bias);
+            __m256i const w =
+                    (S == Side::Bid) ? _mm256_cmpgt_epi32(p, v) : _mm256_cmpgt_epi32(v, p);
+            unsigned const mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(w)));
+            if (mask != 0)
+                return n - 8 + (32 - __builtin_clz(mask));
+        }
+        return position_scalar<S>(prices, n, price);
+    }
+
+} // namespace
+
+
+namespace itch {
+
+    namespace detail {
+
+        template <Side S, typename Level>
+        level_vector<S, Level>::level_vector() noexcept
+                : pool_(sizeof(Level), NumPriceLevels)
+        {
+            // reserve may throw, in which case we abort
+            try {
+                prices_.reserve(NumPriceLevels);
+                levels_.reserve(NumPriceLevels);
+            } catch (std::exception const& e) {
+                std::fprintf(
+                        stderr, "[ERROR] exception in %s: %s\n", __builtin_FUNCTION(), e.what());
+                std::abort();
+            }
+        }
+
+        template <Side S, typename Level>
+        price_level&
+        level_vector<S, Level>::find_or_add(price_t price) noexcept
+        {
+            std::size_t const i = position(price);
+            if (i < prices_.size() && prices_[i] == price)
+                return *levels_[i];
+
+            // inserts may throw, in which case we abort
+            try {
+                price_level* pl = new (pool_.allocate_node()) Level(price, 0);
+                prices_.insert(prices_.begin() + i, price);
+                levels_.insert(levels_.begin() + i, pl);
+                return *pl;
+            } catch (std::exception const& e) {
+                std::fprintf(
+                        stderr, "[ERROR] exception in %s: %s\n", __builtin_FUNCTION(), e.what());
+                std::abort();
+            }
+        }
+
+        template <Side S, typename Level>
+        void
+        level_vector<S, Level>::erase(price_level& pl) noexcept
+        {
+            std::size_t const i = position(pl.price());
+            DEBUG_ASSERT(i < prices_.size() && levels_[i] == &pl);
+
+            prices_.erase(prices_.begin() + i);
+            levels_.erase(levels_.begin() + i);
+            pool_.deallocate_node(&pl);
+        }
+
+        template <Side S, typename Level>
+        price_level const*
+        level_vector<S, Level>::best() const noexcept
+        {
+            return levels_.empty() ? nullptr : levels_.back();
+        }
+
+        template <Side S, typename Level>
+        std::vector<price_level>
+        level_vector<S, Level>::levels() const
+        {
+            std::vector<price_level> v;
+            v.reserve(levels_.size());
+            for (auto itr = levels_.rbegin(); itr != levels_.rend(); ++itr)
+                v.push_back(**itr);
+            return v;
+        }
+
+        template <Side S, typename Level>
+        void
+        level_vector<S, Level>::depth(std::span<pq> out) const noexcept
+        {
+            std::size_t const n = std::min(out.size(), levels_.size());
+            for (std::size_t i = 0; i < n; ++i) {
+                price_level const* pl = levels_[levels_.size() - 1 - i];
+                out[i] = {pl->price(), pl->agg_qty()};
+            }
+            std::fill(out.begin() + n, out.end(), pq());
+        }
+
+        template <Side S, typename Level>
+        std::size_t
+        level_vector<S, Level>::max_levels() const noexcept
+        {
+            return pool_.max_used();
+        }
+
+        // private
+
+        template <Side S, typename Level>
+        std::size_t
+        level_vector<S, Level>::position(price_t price) const noexcept
+        {
+            return UseAvx2 ? position_avx2<S>(prices_.data(), prices_.size(), price)
+                           : position_scalar<S>(prices_.data(), prices_.size(), price);
+        }
+
+        template class level_vector<Side::Bid, price_level>;
+        template class level_vector<Side::Bid, handled_level>;
+        template class level_vector<Side::Ask, price_level>;
+        template class level_vector<Side::Ask, handled_level>;
+
+    } // namespace detail
+
+    template <typename Level>
+    basic_vector_book<Level>::basic_vector_book() noexcept
+            : bids_()
+            , asks_()
+    {
+        // empty
+    }
+
+    template <typename Level>
+    void
+    basic_vector_book<Level>::add_order(order& order) noexcept
+    {
+        price_level& pl = (order.side == Side::Bid) ? bids_.find_or_add(order.price)
+                                                    : asks_.find_or_add(order.price);
+        pl.inc_qty(order.qty);
+        order.pl = &pl;
+    }
+
+    template <typename Level>
+    void
+    basic_vector_book<Level>::delete_order(order& order) noexcept
+    {
+        DEBUG_ASSERT(order.pl != nullptr);
+        if (order.pl == nullptr)
+            return;
+
+        DEBUG_ASSERT(order.qty <= order.pl->agg_qty());
+
+        // decrease qty on price level, if it goes to zero, delete the level
+        if (order.qty < order.pl->agg_qty()) {
+            order.pl->dec_qty(order.qty);
+        } else if (order.side == Side::Bid) {
+            bids_.erase(*order.pl);
+        } else {
+            asks_.erase(*order.pl);
+        }
+
+        order.clear();
+    }
+
+    template <typename Level>
+    void
+    basic_vector_book<Level>::cancel_order(order& order, qty_t remove_qty) noexcept
+    {
+        DEBUG_ASSERT(remove_qty <= order.qty);
+
+        if (remove_qty < order.qty) {
+            order.qty -= remove_qty;
+            order.pl->dec_qty(remove_qty);
+        } else {
+            // this cancel will remove the order (may happen if caused
+            // by an execution)
+            delete_order(order);
+        }
+    }
+
+    template <typename Level>
+    void
+    basic_vector_book<Level>::replace_order(order& old_order, order& new_order) noexcept
+    {
+        DEBUG_ASSERT(old_order.pl != nullptr);
+        DEBUG_ASSERT(new_order.pl == nullptr);
+
+        delete_order(old_order);
+        DEBUG_ASSERT(old_order.pl == nullptr);
+
+        add_order(new_order);
+        DEBUG_ASSERT(new_order.pl != nullptr);
+    }
+
+    template <typename Level>
+    std::vector<price_level>
+    basic_vector_book<Level>::bids() const
+    {
+        return bids_.levels();
+    }
+
+    template <typename Level>
+    std::vector<price_level>
+    basic_vector_book<Level>::asks() const
+    {
+        return asks_.levels();
+    }
+
+    template <typename Level>
+    pq
+    basic_vector_book<Level>::best_bid() const noexcept
+    {
+        price_level const* pl = bids_.best();
+        if (pl == nullptr)
+            return {0, 0};
+
+        return {pl->price(), pl->agg_qty()};
+    }
+
+    template <typename Level>
+    pq
+    basic_vector_book<Level>::best_ask() const noexcept
+    {
+        price_level const* pl = asks_.best();
+        if (pl == nullptr)
+            return {0, 0};
+
+        return {pl->price(), pl->agg_qty()};
+    }
+
+    template <typename Level>
+    void
+    basic_vector_book<Level>::depth(
+            std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept
+    {
+        DEBUG_ASSERT(n <= bids.size() && n <= asks.size());
+
+        bids_.depth(bids.first(n));
+        asks_.depth(asks.first(n));
+    }
+
+    template <typename Level>
+    std::size_t
+    basic_vector_book<Level>::max_bid_book_depth() const noexcept
+    {
+        return bids_.max_levels();
+    }
+
+    template <typename Level>
+    std::size_t
+    basic_vector_book<Level>::max_ask_book_depth() const noexcept
+    {
+        return asks_.max_levels();
+    }
+
+    template <typename Level>
+    std::size_t
+    basic_vector_book<Level>::max_bid_order_depth() const noexcept
+    {
+        return max_bid_order_depth_;
+    }
+
+    template <typename Level>
+    std::size_t
+    basic_vector_book<Level>::max_ask_order_depth() const noexcept
+    {
+        return max_ask_order_depth_;
+    }
+
+    // explicit instantiations
+    template class basic_vector_book<price_level>;
+    template class basic_vector_book<handled_level>;
+
+} // namespace itch
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "core.hpp"
+#include "price_level.hpp"
+#include "allocator/memory_pool.hpp"
+#include <cstddef> // std::size_t
+#include <span>
+#include <vector>
+
+
+namespace itch {
+
+    namespace detail {
+
+        /// One side of a vector_book.
+        ///
+        /// Level prices are packed into a sorted vector, worst first, so
+        /// the inside sits at the back where most adds and deletes land
+        /// and inserting or erasing there moves few elements. A parallel
+        /// vector holds pointers to the levels themselves, which live in
+        /// a memory pool and never move, so order.pl stays valid while
+        /// the vectors shift around them.
+        ///
+        /// Levels are found by scanning the prices from the back, 8 at a
+        /// time with an AVX2 compare where the cpu has it.
+        template <Side S, typename Level = price_level>
+        class level_vector
+        {
+        private:
+            memory_pool pool_;
+            std::vector<price_t> prices_;      ///< worst first
+            std::vector<price_level*> levels_; ///< same order as prices_
+
+        public:
+            level_vector() noexcept;
+
+            /// returns the level at price, creating it (with 0 qty) if
+            /// there isn't one
+            price_level& find_or_add(price_t) noexcept;
+
+            /// erases a level and frees it
+            void erase(price_level&) noexcept;
+
+            price_level const* best() const noexcept;
+
+            /// all levels, best first
+            std::vector<price_level> levels() const;
+
+            /// copies the best out.size() levels to out, {0, 0} past the
+            /// last one
+            void depth(std::span<pq> out) const noexcept;
+
+            std::size_t max_levels() const noexcept;
+
+        private:
+            /// index of the first price that is not worse than price
+            std::size_t position(price_t) const noexcept;
+        };
+
+    } // namespace detail
+
+    /// Two-sided book on sorted price vectors, see detail::level_vector.
+    template <typename Level = price_level>
+    class basic_vector_book
+    {
+    private:
+        detail::level_vector<Side::Bid, Level> bids_;
+        detail::level_vector<Side::Ask, Level> asks_;
+        std::size_t max_bid_order_depth_ = 0; ///< stats only
+        std::size_t max_ask_order_depth_ = 0; ///< stats only
+
+    public:
+        basic_vector_book() noexcept;
+        void add_order(order&) noexcept;
+        void delete_order(order&) noexcept;
+        void cancel_order(order&, qty_t remove_qty) noexcept;
+        void replace_order(order& old_order, order& new_order) noexcept;
+
+        // accessors
+    public:
+        /// snapshots of the levels, best first. not for the hot path
+        std::vector<price_level> bids() const;
+        std::vector<price_level> asks() const;
+        pq best_bid() const noexcept;
+        pq best_ask() const noexcept;
+        void depth(std::size_t n, std::span<pq> bids, std::span<pq> asks) const noexcept;
+        std::size_t max_bid_book_depth() const noexcept;
+        std::size_t max_ask_book_depth() const noexcept;
+        std::size_t max_bid_order_depth() const noexcept;
+        std::size_t max_ask_order_depth() const noexcept;
+    };
+
+    using vector_book = basic_vector_book<>;
+
+} // namespace itch
@@ -1,4 +1,5 @@
 MODULE_NAME := parser
 MODULE_LIBRARIES := file_reader itch util
+MODULE_LDLIBS := -lpthread
 
 $(call add-executable-module,$(get-path))
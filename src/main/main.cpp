@@ -1,38 +1,111 @@
 #include "version.h"
 #include "file_reader/file_reader.hpp"
+#include "itch/basic_book.hpp"
+#include "itch/bbo.hpp"
+#include "itch/bitmap_book.hpp"
+#include "itch/btree_book.hpp"
+#include "itch/compact_book.hpp"
+#include "itch/depth.hpp"
+#include "itch/hashed_book.hpp"
+#include "itch/l3_book.hpp"
+#include "itch/ladder_book.hpp"
+#include "itch/map_book.hpp"
+#include "itch/mp_book.hpp"
 #include "itch/parser.hpp"
+#include "itch/sharded_parser.hpp"
+#include "itch/vector_book.hpp"
 #include "util/compiler.hpp"
 #include "util/time.hpp"
 #include <filesystem>
 #include <getopt.h>
+#include <algorithm> // std::find
+#include <iterator>  // std::begin, std::end
 #include <cstdio>  // std::fprintf
-#include <cstdlib> // std::exit
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cstdlib> // std::exit, std::strtol, std::strtoul, std::strtoull
+#include <memory> // std::make_unique
 #include <string>
+#include <string_view>
+#include <utility> // std::move
+#include <vector>
 
 
 namespace { // unnamed
 
+    /// book implementations selectable with --book, see run_book()
+    constexpr std::string_view BookNames[] = {
+            "basic", "bitmap", "btree", "compact", "hashed", "l3", "ladder", "map", "mp", "vector"};
+    constexpr std::string_view DefaultBook = "mp";
+
     struct cli_args
     {
         std::string input_file;
         bool logging = false;
         std::filesystem::path stats_fp;
         bool print_status_events = false;
+        std::size_t threads = 1;
+        bool numa = false;
+        bool shared_pools = false;
+        bool skip_unknown = false;
+        long prefetch_depth = -1; // parser default
+        bool batch = false;
+        std::vector<std::string> symbols; // empty: all
+        std::string book{DefaultBook};
+        std::filesystem::path bbo_fp; // empty: no bbo stream
+        std::filesystem::path depth_fp; // empty: no depth snapshots
+        std::size_t depth_levels = 10;
+        std::uint64_t depth_interval_ms = 1000;
+        std::vector<std::string> depth_symbols; // empty: all
     };
 
+    /// comma-separated list, empty items dropped
+    std::vector<std::string>
+    split_symbols(char const* list)
+    {
+        std::vector<std::string> symbols;
+        std::string_view rest(list);
+        while (!rest.empty()) {
+            std::size_t const comma = rest.find(',');
+            std::string_view const item = rest.substr(0, comma);
+            if (!item.empty())
+                symbols.emplace_back(item);
+            rest = (comma == std::string_view::npos) ? "" : rest.substr(comma + 1);
+        }
+        return symbols;
+    }
+
     cli_args
     arg_parse(int argc, char** argv)
     {
         auto usage = [](std::FILE* outerr, std::filesystem::path const& app) {
             std::fprintf(outerr,
-                    "usage: %s [-hlv] [-s <stats_file>] <input_file>\n"
+                    "usage: %s [-bhlv] [-s <stats_file>] [-t <n>] <input_file>\n"
                     "arguments:\n"
                     "   input_file              input file\n"
                     "options:\n"
+                    "  -b, --batch              decode msgs into columns a chunk at a time\n"
+                    "      --bbo=<filepath>     write top of book changes to file\n"
+                    "      --book=<name>        book implementation: basic, bitmap, btree,\n"
+                    "                           compact (mp on 16-byte orders), hashed, l3,\n"
+                    "                           ladder, map, mp (default), vector\n"
+                    "      --depth=<filepath>   write book depth snapshots to file\n"
+                    "      --depth-interval=<ms>\n"
+                    "                           feed time between snapshots (default 1000)\n"
+                    "      --depth-levels=<n>   levels per side in a snapshot (default 10)\n"
+                    "      --depth-symbols=<list>\n"
+                    "                           only snapshot <list> (default all)\n"
                     "  -h, --help               this output\n"
                     "  -l, --log                log protocol msgs to <protocol>.log\n"
+                    "      --numa               spread worker threads and their books over\n"
+                    "                           the NUMA nodes (with --threads)\n"
+                    "      --prefetch=<n>       prefetch order state <n> msgs ahead, 0 disables\n"
+                    "      --shared-pools       mp books share their level pools\n"
                     "      --status             print status msgs to stdout\n"
+                    "      --skip-unknown       skip (and count) unknown msgs, don't abort\n"
                     "  -s, --stats=<filepath>   record instrument stats to file\n"
+                    "      --symbols=<list>     only build books for <list> (e.g. AAPL,MSFT)\n"
+                    "  -t, --threads=<n>        build books on <n> worker threads\n"
                     "  -v, --version            version\n",
                     app.c_str());
             std::exit(outerr == stdout ? EXIT_SUCCESS : EXIT_FAILURE);
@@ -45,20 +118,37 @@ namespace { // unnamed
         cli_args args;
         while (true) {
             static option long_options[] = {
+                    {"batch", no_argument, nullptr, 'b'},
                     {"help", no_argument, nullptr, 'h'},
                     {"log", no_argument, nullptr, 'l'},
                     {"status", no_argument, nullptr, '1'},
+                    {"skip-unknown", no_argument, nullptr, '2'},
+                    {"prefetch", required_argument, nullptr, '3'},
+                    {"symbols", required_argument, nullptr, '4'},
+                    {"book", required_argument, nullptr, '5'},
+                    {"bbo", required_argument, nullptr, '6'},
+                    {"depth", required_argument, nullptr, '7'},
+                    {"depth-interval", required_argument, nullptr, '8'},
+                    {"depth-levels", required_argument, nullptr, '9'},
+                    {"depth-symbols", required_argument, nullptr, '0'},
+                    {"numa", no_argument, nullptr, 'N'},
+                    {"shared-pools", no_argument, nullptr, 'P'},
                     {"stats", required_argument, nullptr, 's'},
+                    {"threads", required_argument, nullptr, 't'},
                     {"version", no_argument, nullptr, 'v'},
                     {nullptr, 0, nullptr, 0},
             };
 
-            int const c = ::getopt_long(
-                    argc, argv, "hls:1v", static_cast<option const*>(long_options), nullptr);
+            int const c = ::getopt_long(argc, argv, "bhls:t:123:4:5:6:7:8:9:0:v",
+                    static_cast<option const*>(long_options), nullptr);
             if (c == -1)
                 break;
 
             switch (c) {
+                case 'b':
+                    args.batch = true;
+                    break;
+
                 case 'h':
                     usage(stdout, app);
                     break;
@@ -71,10 +161,87 @@ namespace { // unnamed
                     args.stats_fp = optarg;
                     break;
 
+                case 't':
+                    args.threads = std::strtoul(optarg, nullptr, 10);
+                    if (args.threads == 0) {
+                        std::fprintf(stderr, "invalid thread count: %s\n\n", optarg);
+                        usage(stderr, app);
+                    }
+                    break;
+
                 case '1': // --status
                     args.print_status_events = true;
                     break;
 
+                case '2': // --skip-unknown
+                    args.skip_unknown = true;
+                    break;
+
+                case '3': // --prefetch
+                    args.prefetch_depth = std::strtol(optarg, nullptr, 10);
+                    if (args.prefetch_depth < 0) {
+                        std::fprintf(stderr, "invalid prefetch depth: %s\n\n", optarg);
+                        usage(stderr, app);
+                    }
+                    break;
+
+                case '4': // --symbols
+                    args.symbols = split_symbols(optarg);
+                    if (args.symbols.empty()) {
+                        std::fprintf(stderr, "invalid symbol list: %s\n\n", optarg);
+                        usage(stderr, app);
+                    }
+                    break;
+
+                case '5': // --book
+                    args.book = optarg;
+                    if (std::find(std::begin(BookNames), std::end(BookNames), args.book)
+                            == std::end(BookNames)) {
+                        std::fprintf(stderr, "unknown book: %s\n\n", optarg);
+                        usage(stderr, app);
+                    }
+                    break;
+
+                case '6': // --bbo
+                    args.bbo_fp = optarg;
+                    break;
+
+                case '7': // --depth
+                    args.depth_fp = optarg;
+                    break;
+
+                case '8': // --depth-interval
+                    args.depth_interval_ms = std::strtoull(optarg, nullptr, 10);
+                    if (args.depth_interval_ms == 0) {
+                        std::fprintf(stderr, "invalid depth interval: %s\n\n", optarg);
+                        usage(stderr, app);
+                    }
+                    break;
+
+                case '9': // --depth-levels
+                    args.depth_levels = std::strtoul(optarg, nullptr, 10);
+                    if (args.depth_levels == 0 || args.depth_levels > 65535) {
+                        std::fprintf(stderr, "invalid depth levels: %s\n\n", optarg);
+                        usage(stderr, app);
+                    }
+                    break;
+
+                case '0': // --depth-symbols
+                    args.depth_symbols = split_symbols(optarg);
+                    if (args.depth_symbols.empty()) {
+                        std::fprintf(stderr, "invalid symbol list: %s\n\n", optarg);
+                        usage(stderr, app);
+                    }
+                    break;
+
+                case 'N': // --numa
+                    args.numa = true;
+                    break;
+
+                case 'P': // --shared-pools
+                    args.shared_pools = true;
+                    break;
+
                 case 'v':
                     std::fprintf(stdout, "app_version=%s\n%s\n", ::VERSION,
                             get_version_info_multiline().c_str());
@@ -93,6 +260,46 @@ namespace { // unnamed
             usage(stderr, app);
         }
 
+        if (args.logging && args.threads > 1) {
+            std::fprintf(stderr, "--log is not supported with --threads\n\n");
+            usage(stderr, app);
+        }
+
+        if (args.batch && args.threads > 1) {
+            std::fprintf(stderr, "--batch is not supported with --threads\n\n");
+            usage(stderr, app);
+        }
+
+        if (args.prefetch_depth >= 0 && args.threads > 1) {
+            std::fprintf(stderr, "--prefetch is not supported with --threads\n\n");
+            usage(stderr, app);
+        }
+
+        if (args.book != DefaultBook && args.threads > 1) {
+            std::fprintf(stderr, "--book is not supported with --threads\n\n");
+            usage(stderr, app);
+        }
+
+        if (!args.bbo_fp.empty() && args.threads > 1) {
+            std::fprintf(stderr, "--bbo is not supported with --threads\n\n");
+            usage(stderr, app);
+        }
+
+        if (!args.depth_fp.empty() && args.threads > 1) {
+            std::fprintf(stderr, "--depth is not supported with --threads\n\n");
+            usage(stderr, app);
+        }
+
+        if (args.shared_pools && args.book != "mp") {
+            std::fprintf(stderr, "--shared-pools is only supported with --book=mp\n\n");
+            usage(stderr, app);
+        }
+
+        if (args.numa && args.threads == 1) {
+            std::fprintf(stderr, "--numa requires --threads\n\n");
+            usage(stderr, app);
+        }
+
         std::string input_file;
         for (; optind != argc; ++optind) {
             if (args.input_file.empty()) {
@@ -105,6 +312,100 @@ namespace { // unnamed
         return args;
     }
 
+    void
+    report(itch::default_handler const&) noexcept
+    {
+        // empty
+    }
+
+    void
+    report(itch::bbo_file_writer& writer) noexcept
+    {
+        writer.flush();
+        std::fprintf(stdout, "bbo updates: %zu\n", writer.count());
+    }
+
+    /// applies the options every parse mode shares
+    template <typename Parser>
+    void
+    setup(Parser& parser, cli_args const& args)
+    {
+        if (args.prefetch_depth >= 0)
+            parser.prefetch_depth(args.prefetch_depth);
+        parser.watch(args.symbols);
+        if (!args.depth_fp.empty()) {
+            parser.dump_depth(
+                    std::make_unique<itch::depth_file_writer>(args.depth_fp, args.depth_levels),
+                    args.depth_symbols, args.depth_interval_ms * 1'000'000);
+        }
+    }
+
+    template <typename Parser>
+    void
+    finish(Parser& parser)
+    {
+        parser.print_stats();
+        report(parser.handler());
+        if (itch::depth_file_writer const* writer = parser.depth_writer())
+            std::fprintf(stdout, "depth snapshots: %zu\n", writer->count());
+    }
+
+    /// builds B books over the whole file on this thread
+    template <itch::Book B, typename Handler>
+    void
+    run_parser(cli_args const& args, file_reader& reader, Handler handler)
+    {
+        if (args.logging) {
+            itch::parser<true, Handler, B> parser(args.stats_fp, args.print_status_events,
+                    args.skip_unknown, std::move(handler), args.shared_pools);
+            setup(parser, args);
+            reader.process_file([&parser](auto ptr, auto len) { return parser.parse(ptr, len); });
+            finish(parser);
+        } else if (args.batch) {
+            itch::parser<false, Handler, B> parser(args.stats_fp, args.print_status_events,
+                    args.skip_unknown, std::move(handler), args.shared_pools);
+            setup(parser, args);
+            reader.process_file(
+                    [&parser](auto ptr, auto len) { return parser.parse_batched(ptr, len); });
+            finish(parser);
+        } else {
+            itch::parser<false, Handler, B> parser(args.stats_fp, args.print_status_events,
+                    args.skip_unknown, std::move(handler), args.shared_pools);
+            setup(parser, args);
+            reader.process_file([&parser](auto ptr, auto len) { return parser.parse(ptr, len); });
+            finish(parser);
+        }
+    }
+
+    /// run_parser() with the handler --bbo asks for
+    template <itch::Book B>
+    void
+    run(cli_args const& args, file_reader& reader)
+    {
+        if (args.bbo_fp.empty())
+            run_parser<B>(args, reader, itch::default_handler());
+        else
+            run_parser<B>(args, reader, itch::bbo_file_writer(args.bbo_fp));
+    }
+
+    /// run() with the book named by --book, one of BookNames
+    void
+    run_book(cli_args const& args, file_reader& reader)
+    {
+        // clang-format off
+        if (args.book == "basic")        run<itch::basic_book>(args, reader);
+        else if (args.book == "bitmap")  run<itch::bitmap_book>(args, reader);
+        else if (args.book == "btree")   run<itch::btree_book>(args, reader);
+        else if (args.book == "compact") run<itch::compact_book<itch::mp_book>>(args, reader);
+        else if (args.book == "hashed")  run<itch::hashed_book>(args, reader);
+        else if (args.book == "l3")      run<itch::l3_book>(args, reader);
+        else if (args.book == "ladder")  run<itch::ladder_book>(args, reader);
+        else if (args.book == "map")     run<itch::map_book>(args, reader);
+        else if (args.book == "vector")  run<itch::vector_book>(args, reader);
+        else                             run<itch::mp_book>(args, reader);
+        // clang-format on
+    }
+
 } // namespace
 
 
@@ -118,14 +419,21 @@ main(int argc, char** argv)
     try {
         file_reader reader(args.input_file);
 
-        if (args.logging) {
-            itch::parser<true> parser(args.stats_fp, args.print_status_events);
-            reader.process_file([&parser](auto ptr, auto len) { return parser.parse(ptr, len); });
+        if (args.threads > 1) {
+            itch::sharded_parser parser(args.stats_fp, args.print_status_events,
+                    args.skip_unknown, args.threads, args.numa, args.shared_pools);
+            parser.watch(args.symbols);
+            if (reader.compressed()) {
+                reader.process_file(
+                        [&parser](auto ptr, auto len) { return parser.parse(ptr, len); });
+            } else {
+                reader.process_file(
+                        [&parser](auto ptr, auto len) { return parser.replay(ptr, len); });
+            }
+            parser.finish();
             parser.print_stats();
         } else {
-            itch::parser<false> parser(args.stats_fp, args.print_status_events);
-            reader.process_file([&parser](auto ptr, auto len) { return parser.parse(ptr, len); });
-            parser.print_stats();
+            run_book(args, reader);
         }
 
         reader.print_stats();
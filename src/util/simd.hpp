@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+
+enum class simd_level : std::uint8_t
+{
+    scalar,
+    sse4, ///< pshufb on 16-byte loads
+    avx2  ///< vpshufb on a single 32-byte load per msg
+};
+
+/// best level supported by the cpu we're running on
+inline simd_level
+detect_simd_level() noexcept
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return simd_level::avx2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return simd_level::sse4;
+    return simd_level::scalar;
+}
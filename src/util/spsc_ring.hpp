@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef> // std::size_t
+#include <thread>  // std::this_thread::yield
+
+
+/// Bounded lock-free single-producer/single-consumer queue.
+///
+/// Each side keeps a private copy of the other side's index and only
+/// re-reads the shared atomic when that copy says the ring is full (or
+/// empty), so in steady state a push or pop touches no cache line owned
+/// by the other thread except the slot itself.
+template <typename T, std::size_t Capacity>
+class spsc_ring
+{
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0,
+            "capacity must be a power of two");
+
+private:
+    static constexpr std::size_t CacheLineSize = 64;
+    static constexpr std::size_t Mask = Capacity - 1;
+
+private:
+    // consumer
+    alignas(CacheLineSize) std::atomic<std::size_t> head_ = 0;
+    std::size_t cached_tail_ = 0;
+
+    // producer
+    alignas(CacheLineSize) std::atomic<std::size_t> tail_ = 0;
+    std::size_t cached_head_ = 0;
+
+    alignas(CacheLineSize) T* buf_ = nullptr;
+
+public:
+    spsc_ring();
+    ~spsc_ring() noexcept;
+    spsc_ring(spsc_ring const&) noexcept = delete;
+    spsc_ring(spsc_ring&&) noexcept = delete;
+    spsc_ring& operator=(spsc_ring const&) noexcept = delete;
+    spsc_ring& operator=(spsc_ring&&) noexcept = delete;
+
+    // producer side
+
+    /// returns the slot to write the next element into, or nullptr if
+    /// the ring is full. the element is not visible until push()
+    T* try_alloc() noexcept;
+
+    /// as try_alloc(), but waits for the consumer to make room
+    T* alloc() noexcept;
+
+    /// publishes the slot returned by the last (try_)alloc()
+    void push() noexcept;
+
+    // consumer side
+
+    /// returns the oldest element, or nullptr if the ring is empty
+    T const* front() noexcept;
+
+    /// releases the element returned by front() back to the producer
+    void pop() noexcept;
+
+    bool empty() const noexcept;
+    constexpr std::size_t capacity() const noexcept;
+
+    /// spin-wait backoff shared by both sides
+    static void relax(std::size_t& spins) noexcept;
+};
+
+/**********************************************************************/
+
+template <typename T, std::size_t Capacity>
+spsc_ring<T, Capacity>::spsc_ring()
+        : buf_(new T[Capacity])
+{
+    // empty
+}
+
+template <typename T, std::size_t Capacity>
+spsc_ring<T, Capacity>::~spsc_ring() noexcept
+{
+    delete[] buf_;
+}
+
+template <typename T, std::size_t Capacity>
+T*
+spsc_ring<T, Capacity>::try_alloc() noexcept
+{
+    std::size_t const tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == Capacity) {
+        cached_head_ = head_.load(std::memory_order_acquire);
+        if (tail - cached_head_ == Capacity)
+            return nullptr;
+    }
+    return &buf_[tail & Mask];
+}
+
+template <typename T, std::size_t Capacity>
+T*
+spsc_ring<T, Capacity>::alloc() noexcept
+{
+    std::size_t spins = 0;
+    T* slot = nullptr;
+    while ((slot = try_alloc()) == nullptr)
+        relax(spins);
+    return slot;
+}
+
+template <typename T, std::size_t Capacity>
+void
+spsc_ring<T, Capacity>::push() noexcept
+{
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+template <typename T, std::size_t Capacity>
+T const*
+spsc_ring<T, Capacity>::front() noexcept
+{
+    std::size_t const head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+        cached_tail_ = tail_.load(std::memory_order_acquire);
+        if (head == cached_tail_)
+            return nullptr;
+    }
+    return &buf_[head & Mask];
+}
+
+template <typename T, std::size_t Capacity>
+void
+spsc_ring<T, Capacity>::pop() noexcept
+{
+    head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+template <typename T, std::size_t Capacity>
+bool
+spsc_ring<T, Capacity>::empty() const noexcept
+{
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+}
+
+template <typename T, std::size_t Capacity>
+constexpr std::size_t
+spsc_ring<T, Capacity>::capacity() const noexcept
+{
+    return Capacity;
+}
+
+template <typename T, std::size_t Capacity>
+void
+spsc_ring<T, Capacity>::relax(std::size_t& spins) noexcept
+{
+    // spin briefly, then give the cpu away in case the other side is
+    // sharing it
+    static constexpr std::size_t MaxSpins = 64;
+    if (++spins < MaxSpins) {
+        __builtin_ia32_pause();
+    } else {
+        spins = 0;
+        std::this_thread::yield();
+    }
+}
@@ -2,6 +2,7 @@ MODULE_NAME := test-runner
 MODULE_CPPFLAGS := -I.
 MODULE_SOURCE_FILES := $(call rwildcard,$(get-path),*.cpp)
 MODULE_LIBRARIES := allocator itch protocol util
+MODULE_LDLIBS := -lpthread
 
 $(use-catch)
 $(use-fmt)
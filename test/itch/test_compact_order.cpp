@@ -0,0 +1,208 @@
+#include "itch/basic_book.hpp"
+#include "itch/bitmap_book.hpp"
+#include "itch/btree_book.hpp"
+#include "itch/compact_book.hpp"
+#include "itch/hashed_book.hpp"
+#include "itch/ladder_book.hpp"
+#include "itch/map_book.hpp"
+#include "itch/mp_book.hpp"
+#include "itch/vector_book.hpp"
+#include <catch2/catch.hpp>
+#include <type_traits> // std::is_same_v
+
+
+namespace { // unnamed
+
+    /// basic_book counting the cancels that reach it
+    template <typename Level = itch::price_level>
+    struct counting_book : itch::basic_basic_book<Level>
+    {
+        int cancels = 0;
+
+        void
+        cancel_order(itch::order& o, itch::qty_t remove_qty) noexcept
+        {
+            ++cancels;
+            itch::basic_basic_book<Level>::cancel_order(o, remove_qty);
+        }
+    };
+
+} // namespace
+
+TEST_CASE("compact_order layout", "[compact_order]")
+{
+    using namespace itch;
+
+    SECTION("size")
+    {
+        REQUIRE(sizeof(compact_order<false>) == 16);
+        REQUIRE(sizeof(compact_order<true>) == 24);
+        REQUIRE(sizeof(order) == 32);
+    }
+
+    SECTION("side and price packing")
+    {
+        compact_order<> o1(Side::Bid, 1'999'999'900, 100);
+        REQUIRE(o1.side() == Side::Bid);
+        REQUIRE(o1.price() == 1'999'999'900);
+        REQUIRE(o1.qty == 100);
+        REQUIRE(o1.lh == InvalidLevelHandle);
+
+        compact_order<> o2(Side::Ask, 1'999'999'900, 100);
+        REQUIRE(o2.side() == Side::Ask);
+        REQUIRE(o2.price() == 1'999'999'900);
+        REQUIRE_FALSE(o1 == o2);
+
+        o2.set(Side::Bid, 42);
+        REQUIRE(o2.side() == Side::Bid);
+        REQUIRE(o2.price() == 42);
+
+        o2.clear();
+        REQUIRE(o2 == compact_order<>());
+    }
+}
+
+TEMPLATE_TEST_CASE("compact_order books", "[compact_order]", itch::basic_book, itch::mp_book,
+        itch::map_book, itch::hashed_book, itch::ladder_book, itch::vector_book,
+        itch::bitmap_book, itch::btree_book)
+{
+    using namespace itch;
+    compact_book<TestType> book;
+
+    SECTION("add_order")
+    {
+        compact_order<> o1(Side::Bid, 100, 10);
+        compact_order<> o2(Side::Bid, 200, 20);
+        compact_order<> o3(Side::Bid, 200, 30);
+        compact_order<> o4(Side::Ask, 300, 40);
+
+        book.add_order(o1);
+        book.add_order(o2);
+        book.add_order(o3);
+        book.add_order(o4);
+
+        REQUIRE(o1.lh != InvalidLevelHandle);
+        REQUIRE(o2.lh != o1.lh);
+        REQUIRE(o2.lh == o3.lh);
+        REQUIRE(book.level(o1.lh)->price() == 100);
+        REQUIRE(book.level(o1.lh)->agg_qty() == 10);
+        REQUIRE(book.level(o3.lh)->price() == 200);
+        REQUIRE(book.level(o3.lh)->agg_qty() == 50);
+        REQUIRE(book.level(o4.lh)->price() == 300);
+        REQUIRE(book.best_bid() == pq{200, 50});
+        REQUIRE(book.best_ask() == pq{300, 40});
+    }
+
+    SECTION("delete_order")
+    {
+        compact_order<> o1(Side::Bid, 100, 10);
+        compact_order<> o2(Side::Bid, 200, 20);
+        compact_order<> o3(Side::Bid, 200, 30);
+
+        book.add_order(o1);
+        book.add_order(o2);
+        book.add_order(o3);
+
+        // only deletes part of level
+        level_handle const h = o2.lh;
+        book.delete_order(o2);
+        REQUIRE(o2 == compact_order<>());
+        REQUIRE(book.level(h)->agg_qty() == 30);
+        REQUIRE(book.best_bid() == pq{200, 30});
+
+        // deletes level, handle is re-used
+        book.delete_order(o3);
+        REQUIRE(book.bids().size() == 1);
+        REQUIRE(book.best_bid() == pq{100, 10});
+
+        compact_order<> o4(Side::Bid, 300, 40);
+        book.add_order(o4);
+        REQUIRE(o4.lh == h);
+        REQUIRE(book.best_bid() == pq{300, 40});
+    }
+
+    SECTION("cancel_order")
+    {
+        compact_order<> o1(Side::Ask, 100, 10);
+        compact_order<> o2(Side::Ask, 100, 20);
+
+        book.add_order(o1);
+        book.add_order(o2);
+
+        book.cancel_order(o1, 5);
+        REQUIRE(o1.qty == 5);
+        REQUIRE(book.best_ask() == pq{100, 25});
+
+        book.cancel_order(o2, 20);
+        REQUIRE(o2 == compact_order<>());
+        REQUIRE(book.best_ask() == pq{100, 5});
+
+        book.cancel_order(o1, 5);
+        REQUIRE(book.asks().empty());
+    }
+
+    SECTION("replace_order")
+    {
+        compact_order<> o1(Side::Ask, 100, 10);
+        compact_order<> o2(Side::Ask, 200, 20);
+
+        book.add_order(o1);
+        book.add_order(o2);
+
+        compact_order<> new_o1(Side::Ask, 300, 30);
+        book.replace_order(o1, new_o1);
+        REQUIRE(o1 == compact_order<>());
+        REQUIRE(book.level(new_o1.lh)->price() == 300);
+        REQUIRE(book.asks().size() == 2);
+        REQUIRE(book.best_ask() == pq{200, 20});
+    }
+}
+
+TEST_CASE("compact_order updates go through the book", "[compact_order]")
+{
+    using namespace itch;
+    compact_book<counting_book<>> book;
+
+    compact_order<> o1(Side::Bid, 100, 10);
+    compact_order<> o2(Side::Bid, 100, 20);
+    book.add_order(o1);
+    book.add_order(o2);
+
+    book.cancel_order(o1, 4);
+    REQUIRE(book.book().cancels == 1);
+    REQUIRE(o1.qty == 6);
+    REQUIRE(book.best_bid() == pq{100, 26});
+
+    book.cancel_order(o2, 20);
+    REQUIRE(book.book().cancels == 2);
+    REQUIRE(o2 == compact_order<>());
+    REQUIRE(book.best_bid() == pq{100, 6});
+
+    // takes out the level, its handle is released
+    book.cancel_order(o1, 6);
+    REQUIRE(book.book().cancels == 3);
+    REQUIRE(o1 == compact_order<>());
+    REQUIRE(book.bids().empty());
+
+    compact_order<> o3(Side::Bid, 200, 30);
+    book.add_order(o3);
+    REQUIRE(book.level(o3.lh)->price() == 200);
+}
+
+TEST_CASE("compact_book is a Book", "[compact_order]")
+{
+    using namespace itch;
+    static_assert(Book<compact_book<mp_book>>);
+    static_assert(std::is_same_v<book_order_t<compact_book<mp_book>>, compact_order<>>);
+    static_assert(std::is_same_v<book_order_t<compact_book<mp_book, true>>, compact_order<true>>);
+
+    compact_book<mp_book, true> book;
+    compact_order<true> o(Side::Bid, 100, 10);
+    set_order_ts(o, 42);
+    book.add_order(o);
+    REQUIRE(o.ts == 42);
+    REQUIRE(order_price(o) == 100);
+    REQUIRE(order_side(o) == Side::Bid);
+    REQUIRE(book.best_bid() == pq{100, 10});
+    REQUIRE(book.max_bid_book_depth() == book.book().max_bid_book_depth());
+}
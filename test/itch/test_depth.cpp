@@ -0,0 +1,192 @@
+#include "itch/basic_book.hpp"
+#include "itch/bitmap_book.hpp"
+#include "itch/btree_book.hpp"
+#include "itch/depth.hpp"
+#include "itch/hashed_book.hpp"
+#include "itch/l3_book.hpp"
+#include "itch/ladder_book.hpp"
+#include "itch/map_book.hpp"
+#include "itch/mp_book.hpp"
+#include "itch/vector_book.hpp"
+#include <catch2/catch.hpp>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cstdio>
+#include <cstring> // std::memcpy
+#include <filesystem>
+#include <functional> // std::greater
+#include <map>
+#include <memory> // std::make_unique, std::unique_ptr
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+
+namespace { // unnamed
+
+    using namespace itch;
+
+    /// the best n levels of a reference side, padded with {0, 0}
+    template <typename Map>
+    std::vector<pq>
+    expected_depth(Map const& levels, std::size_t n)
+    {
+        std::vector<pq> v;
+        for (auto itr = levels.begin(); itr != levels.end() && v.size() < n; ++itr)
+            v.push_back({itr->first, itr->second});
+        v.resize(n);
+        return v;
+    }
+
+} // namespace
+
+
+TEMPLATE_TEST_CASE("depth", "[depth]", basic_book, bitmap_book, btree_book, hashed_book, l3_book,
+        ladder_book, map_book, mp_book, vector_book)
+{
+    using order_type = book_order_t<TestType>;
+    auto book = std::make_unique<TestType>();
+    std::vector<pq> bids(4, pq{1, 1});
+    std::vector<pq> asks(4, pq{1, 1});
+
+    SECTION("empty")
+    {
+        book->depth(3, bids, asks);
+        REQUIRE(bids == std::vector<pq>{{0, 0}, {0, 0}, {0, 0}, {1, 1}});
+        REQUIRE(asks == std::vector<pq>{{0, 0}, {0, 0}, {0, 0}, {1, 1}});
+
+        book->depth(0, bids, asks);
+        REQUIRE(bids[0] == pq{0, 0});
+    }
+
+    SECTION("levels")
+    {
+        order_type o1(Side::Bid, 10000, 100);
+        order_type o2(Side::Bid, 9900, 50);
+        order_type o3(Side::Bid, 9900, 20);
+        order_type o4(Side::Bid, 9800, 70);
+        order_type o5(Side::Bid, 9700, 10);
+        order_type o6(Side::Ask, 10100, 10);
+        order_type o7(Side::Ask, 10300, 30);
+        for (order_type* o : {&o1, &o2, &o3, &o4, &o5, &o6, &o7})
+            book->add_order(*o);
+
+        book->depth(3, bids, asks);
+        REQUIRE(bids == std::vector<pq>{{10000, 100}, {9900, 70}, {9800, 70}, {1, 1}});
+        REQUIRE(asks == std::vector<pq>{{10100, 10}, {10300, 30}, {0, 0}, {1, 1}});
+
+        book->delete_order(o1);
+        book->depth(1, bids, asks);
+        REQUIRE(bids[0] == pq{9900, 70});
+        REQUIRE(asks[0] == pq{10100, 10});
+    }
+
+    SECTION("random against std::map")
+    {
+        constexpr std::size_t Depth = 20;
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> tick_dist(-300, 300);
+        std::uniform_int_distribution<qty_t> qty_dist(1, 100);
+        std::uniform_int_distribution<int> op_dist(0, 99);
+
+        std::vector<std::unique_ptr<order_type>> live;
+        std::map<price_t, qty_t, std::greater<>> bid_ref;
+        std::map<price_t, qty_t> ask_ref;
+        bids.resize(Depth);
+        asks.resize(Depth);
+
+        for (int i = 0; i < 5000; ++i) {
+            if (live.empty() || op_dist(rng) < 55) {
+                int const tick = tick_dist(rng);
+                Side const side = (tick < 0) ? Side::Bid : Side::Ask;
+                // some prices off the tick grid, and far enough out for
+                // the ladder and bitmap books to overflow
+                price_t const price = 100'000 + tick * 100 + (op_dist(rng) < 5 ? 7 : 0);
+                auto& o = live.emplace_back(
+                        std::make_unique<order_type>(side, price, qty_dist(rng)));
+                book->add_order(*o);
+                if (side == Side::Bid)
+                    bid_ref[price] += o->qty;
+                else
+                    ask_ref[price] += o->qty;
+            } else {
+                std::size_t const j = std::uniform_int_distribution<std::size_t>(
+                        0, live.size() - 1)(rng);
+                order_type& o = *live[j];
+                if (o.side == Side::Bid && (bid_ref[o.price] -= o.qty) == 0)
+                    bid_ref.erase(o.price);
+                if (o.side == Side::Ask && (ask_ref[o.price] -= o.qty) == 0)
+                    ask_ref.erase(o.price);
+                book->delete_order(o);
+                live[j] = std::move(live.back());
+                live.pop_back();
+            }
+
+            if (i % 50 == 0) {
+                book->depth(Depth, bids, asks);
+                REQUIRE(bids == expected_depth(bid_ref, Depth));
+                REQUIRE(asks == expected_depth(ask_ref, Depth));
+            }
+        }
+    }
+}
+
+TEST_CASE("depth_file_writer", "[depth]")
+{
+    using namespace itch;
+    std::filesystem::path const fpath =
+            std::filesystem::temp_directory_path() / "test_depth_writer.bin";
+
+    SECTION("invalid levels")
+    {
+        REQUIRE_THROWS_AS(depth_file_writer(fpath, 0), std::invalid_argument);
+        REQUIRE_THROWS_AS(depth_file_writer(fpath, 65536), std::invalid_argument);
+    }
+
+    SECTION("records")
+    {
+        map_book book;
+        order o1(Side::Bid, 10000, 100);
+        order o2(Side::Ask, 10100, 200);
+        book.add_order(o1);
+
+        {
+            depth_file_writer writer(fpath, 2);
+            REQUIRE(writer.levels() == 2);
+            REQUIRE(writer.record_bytes() == sizeof(depth_header) + 4 * sizeof(pq));
+
+            writer.write(1000, 3, book);
+            book.add_order(o2);
+            writer.write(2000, 3, book);
+            REQUIRE(writer.count() == 2);
+        }
+
+        std::size_t const record_bytes = sizeof(depth_header) + 4 * sizeof(pq);
+        REQUIRE(std::filesystem::file_size(fpath) == 2 * record_bytes);
+
+        std::vector<std::uint8_t> buf(2 * record_bytes);
+        std::FILE* f = std::fopen(fpath.c_str(), "rb");
+        REQUIRE(f != nullptr);
+        REQUIRE(std::fread(buf.data(), 1, buf.size(), f) == buf.size());
+        std::fclose(f);
+        std::filesystem::remove(fpath);
+
+        depth_header h;
+        pq levels[4];
+        std::memcpy(&h, buf.data(), sizeof(h));
+        std::memcpy(levels, buf.data() + sizeof(h), sizeof(levels));
+        REQUIRE(h.timestamp == 1000);
+        REQUIRE(h.locate == 3);
+        REQUIRE(h.levels == 2);
+        REQUIRE(levels[0] == pq{10000, 100});
+        REQUIRE(levels[1] == pq{0, 0});
+        REQUIRE(levels[2] == pq{0, 0});
+        REQUIRE(levels[3] == pq{0, 0});
+
+        std::memcpy(&h, buf.data() + record_bytes, sizeof(h));
+        std::memcpy(levels, buf.data() + record_bytes + sizeof(h), sizeof(levels));
+        REQUIRE(h.timestamp == 2000);
+        REQUIRE(levels[0] == pq{10000, 100});
+        REQUIRE(levels[2] == pq{10100, 200});
+    }
+}
@@ -0,0 +1,161 @@
+#include "itch/extract.hpp"
+#include <catch2/catch.hpp>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <random>
+#include <vector>
+
+
+namespace { // unnamed
+
+    using namespace itch;
+
+    /// levels the cpu running the test supports
+    std::vector<simd_level>
+    supported_levels()
+    {
+        std::vector<simd_level> levels = {simd_level::scalar};
+        if (detect_simd_level() >= simd_level::sse4)
+            levels.push_back(simd_level::sse4);
+        if (detect_simd_level() >= simd_level::avx2)
+            levels.push_back(simd_level::avx2);
+        return levels;
+    }
+
+    /// A page followed by an inaccessible one. Msgs are placed at the end
+    /// of the first page, so reading past a msg faults.
+    class guarded_page
+    {
+    public:
+        guarded_page()
+                : size_(sysconf(_SC_PAGESIZE))
+        {
+            void* p = mmap(nullptr, 2 * size_, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            REQUIRE(p != MAP_FAILED);
+            base_ = static_cast<std::uint8_t*>(p);
+            REQUIRE(mprotect(base_ + size_, size_, PROT_NONE) == 0);
+        }
+
+        ~guarded_page() { munmap(base_, 2 * size_); }
+
+        guarded_page(guarded_page const&) = delete;
+        guarded_page& operator=(guarded_page const&) = delete;
+
+        template <typename Msg>
+        Msg const*
+        place(Msg const& m)
+        {
+            std::uint8_t* p = base_ + size_ - sizeof(Msg);
+            std::memcpy(p, &m, sizeof(Msg));
+            return reinterpret_cast<Msg const*>(p);
+        }
+
+    private:
+        std::size_t size_;
+        std::uint8_t* base_;
+    };
+
+    template <typename Msg>
+    void
+    randomize(Msg& m, std::mt19937_64& rng)
+    {
+        std::uint8_t bytes[sizeof(Msg)];
+        for (auto& b : bytes)
+            b = static_cast<std::uint8_t>(rng());
+        std::memcpy(&m, bytes, sizeof(Msg));
+    }
+
+    /// every level's extractor agrees bit for bit with extract_scalar()
+    /// on random msgs, and leaves no stale field behind
+    template <typename Msg, typename Extractor>
+    void
+    check_random(Extractor order_extractors::*fn)
+    {
+        guarded_page page;
+        std::mt19937_64 rng(42);
+
+        for (int i = 0; i < 10'000; ++i) {
+            Msg m;
+            randomize(m, rng);
+            Msg const* msg = page.place(m);
+
+            order_fields expected;
+            extract_scalar(msg, expected);
+
+            for (simd_level level : supported_levels()) {
+                order_fields f;
+                randomize(f, rng);
+                (get_extractors(level).*fn)(msg, f);
+                REQUIRE(f == expected);
+            }
+        }
+    }
+
+    template <typename Msg>
+    void
+    set_timestamp(Msg& m, std::uint64_t timestamp)
+    {
+        for (std::size_t i = 0; i < sizeof(m.timestamp); ++i)
+            m.timestamp[i] = timestamp >> (8 * (sizeof(m.timestamp) - 1 - i));
+    }
+
+} // namespace
+
+
+TEST_CASE("scalar", "[extract]")
+{
+    order_fields f;
+
+    add_order a = {};
+    a.stock_locate = htobe16(7);
+    a.tracking_number = 0xffff;
+    set_timestamp(a, 0x123456789abc);
+    a.order_reference_number = htobe64(0x0102030405060708);
+    a.shares = htobe32(300);
+    a.price = htobe32(1'234'500);
+    extract_scalar(&a, f);
+    REQUIRE(f == order_fields{0x123456789abc, 0x0102030405060708, 0, 1'234'500, 300, 7});
+
+    order_executed e = {};
+    e.stock_locate = htobe16(8);
+    set_timestamp(e, 3);
+    e.order_reference_number = htobe64(11);
+    e.executed_shares = htobe32(40);
+    e.match_number = htobe64(99);
+    extract_scalar(&e, f);
+    REQUIRE(f == order_fields{3, 11, 99, 0, 40, 8});
+
+    order_delete d = {};
+    d.stock_locate = htobe16(9);
+    set_timestamp(d, 0xffffffffffff);
+    d.order_reference_number = htobe64(12);
+    extract_scalar(&d, f);
+    REQUIRE(f == order_fields{0xffffffffffff, 12, 0, 0, 0, 9});
+
+    order_replace u = {};
+    u.stock_locate = htobe16(10);
+    set_timestamp(u, 5);
+    u.original_order_reference_number = htobe64(11);
+    u.new_order_reference_number = htobe64(12);
+    u.shares = htobe32(500);
+    u.price = htobe32(101);
+    extract_scalar(&u, f);
+    REQUIRE(f == order_fields{5, 11, 12, 101, 500, 10});
+}
+
+TEST_CASE("matches scalar", "[extract]")
+{
+    SECTION("add_order") { check_random<add_order>(&order_extractors::add); }
+    SECTION("order_executed") { check_random<order_executed>(&order_extractors::execute); }
+    SECTION("order_delete") { check_random<order_delete>(&order_extractors::remove); }
+    SECTION("order_replace") { check_random<order_replace>(&order_extractors::replace); }
+}
+
+TEST_CASE("best level", "[extract]")
+{
+    REQUIRE(&get_extractors() == &get_extractors(detect_simd_level()));
+}
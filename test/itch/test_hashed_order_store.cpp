@@ -0,0 +1,100 @@
+#include "itch/hashed_order_store.hpp"
+#include "itch/order_store.hpp"
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+
+TEST_CASE("hashed_order_store", "[hashed_order_store]")
+{
+    using namespace itch;
+
+    // 16 orders per page
+    hashed_order_store<order, 4> store(1'000'000);
+
+    SECTION("initial state")
+    {
+        REQUIRE(store.capacity() == 1'000'000);
+        REQUIRE(store.size() == 0);
+        REQUIRE(store.pages_in_use() == 0);
+        REQUIRE(store.page_bytes() == 16 * sizeof(order));
+    }
+
+    SECTION("orders far apart share a page")
+    {
+        order& o = store.insert(17);
+        REQUIRE(store.pages_in_use() == 1);
+        REQUIRE(o == order());
+
+        o = order(Side::Ask, 100, 200);
+        REQUIRE(store.find(17) == &o);
+        REQUIRE(store.slot(17) == &o);
+        REQUIRE(store.insert(17).qty == 200);
+        REQUIRE(store.size() == 1);
+
+        for (oid_t oid = 1; oid < 16; ++oid)
+            store.insert(oid * 65'536);
+        REQUIRE(store.size() == 16);
+        REQUIRE(store.pages_in_use() == 1);
+
+        store.insert(999'999);
+        REQUIRE(store.pages_in_use() == 2);
+        REQUIRE(store.pages_allocated() == 2);
+    }
+
+    SECTION("erased slots are re-used, cleared")
+    {
+        store.insert(1) = order(Side::Bid, 10, 10);
+        order* o = &store.insert(2);
+        *o = order(Side::Bid, 20, 20);
+
+        store.erase(2);
+        REQUIRE(store.find(2) == nullptr);
+        REQUIRE(store.slot(2) == nullptr);
+        REQUIRE(store.find(1)->price == 10);
+        REQUIRE(*o == order());
+
+        REQUIRE(&store.insert(500'000) == o);
+        REQUIRE(store.size() == 2);
+        REQUIRE(store.pages_in_use() == 1);
+    }
+
+    SECTION("erase of an order never inserted")
+    {
+        store.insert(1) = order(Side::Bid, 10, 10);
+
+        store.erase(7);
+        store.erase(1);
+        store.erase(1);
+        REQUIRE(store.size() == 0);
+        REQUIRE(store.find(1) == nullptr);
+    }
+
+    SECTION("pages follow the live orders, not their refs")
+    {
+        // every 4th ref, as one of 4 shards might see them
+        order_store<order, 4> flat(1'000'000);
+        std::mt19937 rng(42);
+        std::vector<oid_t> live;
+        for (oid_t oid = 4; oid < 100'000; oid += 4) {
+            store.insert(oid) = order(Side::Bid, 100, 1);
+            flat.insert(oid) = order(Side::Bid, 100, 1);
+            live.push_back(oid);
+            if (live.size() > 40) {
+                std::size_t const i = rng() % live.size();
+                REQUIRE(store.find(live[i]) != nullptr);
+                store.erase(live[i]);
+                flat.erase(live[i]);
+                live[i] = live.back();
+                live.pop_back();
+            }
+        }
+
+        REQUIRE(store.size() == live.size());
+        for (oid_t oid : live)
+            REQUIRE(store.find(oid)->qty == 1);
+        REQUIRE(store.pages_in_use() <= 41 / 16 + 1);
+        REQUIRE(flat.max_pages_in_use() > 4 * store.pages_in_use());
+    }
+}
@@ -0,0 +1,202 @@
+#include "itch/l3_book.hpp"
+#include "itch/map_book.hpp"
+#include "itch/order_store.hpp"
+#include <catch2/catch.hpp>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <memory> // std::make_unique
+#include <random>
+#include <vector>
+
+
+namespace { // unnamed
+
+    using namespace itch;
+
+    /// order qtys on a level, front to back
+    std::vector<qty_t>
+    queue(l3_level const& pl)
+    {
+        std::vector<qty_t> v;
+        for (l3_order const& o : pl)
+            v.push_back(o.qty);
+        return v;
+    }
+
+} // namespace
+
+
+TEST_CASE("l3_book", "[l3_book]")
+{
+    using namespace itch;
+    l3_book book;
+
+    SECTION("queue")
+    {
+        l3_order o1(Side::Bid, 100, 10);
+        l3_order o2(Side::Bid, 100, 20);
+        l3_order o3(Side::Bid, 100, 30);
+        l3_order o4(Side::Bid, 90, 40);
+
+        book.add_order(o1);
+        book.add_order(o2);
+        book.add_order(o3);
+        book.add_order(o4);
+
+        l3_level const* pl = book.bid_level(100);
+        REQUIRE(pl != nullptr);
+        REQUIRE(&l3_book::level_of(o2) == pl);
+        REQUIRE(pl->count() == 3);
+        REQUIRE(pl->agg_qty() == 60);
+        REQUIRE(pl->front() == &o1);
+        REQUIRE(pl->back() == &o3);
+        REQUIRE(queue(*pl) == std::vector<qty_t>{10, 20, 30});
+        REQUIRE(book.bid_level(90)->count() == 1);
+        REQUIRE(book.bid_level(95) == nullptr);
+        REQUIRE(book.ask_level(100) == nullptr);
+
+        REQUIRE(l3_book::queue_position(o1) == 0);
+        REQUIRE(l3_book::queue_ahead(o1) == 0);
+        REQUIRE(l3_book::queue_position(o3) == 2);
+        REQUIRE(l3_book::queue_ahead(o3) == 30);
+        REQUIRE(book.max_bid_order_depth() == 3);
+    }
+
+    SECTION("delete_order")
+    {
+        l3_order o1(Side::Ask, 100, 10);
+        l3_order o2(Side::Ask, 100, 20);
+        l3_order o3(Side::Ask, 100, 30);
+        l3_order o4(Side::Ask, 100, 40);
+
+        book.add_order(o1);
+        book.add_order(o2);
+        book.add_order(o3);
+        book.add_order(o4);
+        l3_level const* pl = book.ask_level(100);
+
+        // middle
+        book.delete_order(o2);
+        REQUIRE(o2 == l3_order());
+        REQUIRE(queue(*pl) == std::vector<qty_t>{10, 30, 40});
+        REQUIRE(l3_book::queue_ahead(o4) == 40);
+
+        // front
+        book.delete_order(o1);
+        REQUIRE(pl->front() == &o3);
+        REQUIRE(l3_book::queue_position(o3) == 0);
+        REQUIRE(book.best_ask() == pq{100, 70});
+
+        // back
+        book.delete_order(o4);
+        REQUIRE(pl->front() == &o3);
+        REQUIRE(pl->back() == &o3);
+        REQUIRE(pl->count() == 1);
+
+        // last one takes the level with it
+        book.delete_order(o3);
+        REQUIRE(book.ask_level(100) == nullptr);
+        REQUIRE(book.asks().empty());
+        REQUIRE(book.best_ask() == pq{0, 0});
+    }
+
+    SECTION("cancel_order")
+    {
+        l3_order o1(Side::Bid, 100, 10);
+        l3_order o2(Side::Bid, 100, 20);
+        l3_order o3(Side::Bid, 100, 30);
+
+        book.add_order(o1);
+        book.add_order(o2);
+        book.add_order(o3);
+        l3_level const* pl = book.bid_level(100);
+
+        // partial cancel (or execution) keeps the order's place
+        book.cancel_order(o1, 5);
+        REQUIRE(queue(*pl) == std::vector<qty_t>{5, 20, 30});
+        REQUIRE(l3_book::queue_ahead(o3) == 25);
+        REQUIRE(pl->agg_qty() == 55);
+
+        // full cancel takes it out
+        book.cancel_order(o1, 5);
+        REQUIRE(queue(*pl) == std::vector<qty_t>{20, 30});
+        REQUIRE(l3_book::queue_ahead(o3) == 20);
+        REQUIRE(book.best_bid() == pq{100, 50});
+    }
+
+    SECTION("replace_order")
+    {
+        l3_order o1(Side::Bid, 100, 10);
+        l3_order o2(Side::Bid, 100, 20);
+        book.add_order(o1);
+        book.add_order(o2);
+
+        // same price, but it goes to the back
+        l3_order new_o1(Side::Bid, 100, 15);
+        book.replace_order(o1, new_o1);
+        l3_level const* pl = book.bid_level(100);
+        REQUIRE(queue(*pl) == std::vector<qty_t>{20, 15});
+        REQUIRE(l3_book::queue_ahead(new_o1) == 20);
+
+        l3_order new_o2(Side::Bid, 110, 25);
+        book.replace_order(o2, new_o2);
+        REQUIRE(book.best_bid() == pq{110, 25});
+        REQUIRE(queue(*book.bid_level(100)) == std::vector<qty_t>{15});
+    }
+
+    SECTION("random against map_book")
+    {
+        // orders in an order_store, as the parser keeps them
+        constexpr std::size_t NumOrders = 20'000;
+        auto store = std::make_unique<order_store<l3_order>>(NumOrders);
+        map_book ref;
+        std::vector<order> ref_orders(NumOrders);
+        std::vector<oid_t> live;
+        std::mt19937 rng(42);
+
+        for (oid_t oid = 0; oid < NumOrders; ++oid) {
+            if (live.empty() || rng() % 3 != 0) {
+                Side const side = (rng() & 1) ? Side::Bid : Side::Ask;
+                price_t const offset = (rng() % 50 + 1) * 100;
+                price_t const price = (side == Side::Bid) ? 1'000'000 - offset : 1'000'000 + offset;
+                qty_t const qty = rng() % 1000 + 1;
+
+                l3_order& o = store->insert(oid);
+                o = l3_order(side, price, qty);
+                book.add_order(o);
+                ref_orders[oid] = order(side, price, qty);
+                ref.add_order(ref_orders[oid]);
+                live.push_back(oid);
+            } else {
+                std::size_t const j = rng() % live.size();
+                oid_t const victim = live[j];
+                l3_order& o = *store->find(victim);
+                if (rng() & 1) {
+                    qty_t const qty = o.qty / 2 + 1;
+                    book.cancel_order(o, qty);
+                    ref.cancel_order(ref_orders[victim], qty);
+                }
+                if (o.pl != nullptr) {
+                    book.delete_order(o);
+                    ref.delete_order(ref_orders[victim]);
+                }
+                store->erase(victim);
+                live[j] = live.back();
+                live.pop_back();
+            }
+            REQUIRE(book.best_bid() == ref.best_bid());
+            REQUIRE(book.best_ask() == ref.best_ask());
+        }
+
+        // every level's qty is the sum of its queue
+        for (auto const& [price, ref_pl] : ref.bids()) {
+            l3_level const* pl = book.bid_level(price);
+            REQUIRE(pl != nullptr);
+            qty_t qty = 0;
+            for (l3_order const& o : *pl)
+                qty += o.qty;
+            REQUIRE(qty == ref_pl.agg_qty());
+            REQUIRE(l3_book::queue_ahead(*pl->back()) == qty - pl->back()->qty);
+        }
+    }
+}
@@ -1,4 +1,5 @@
 #include "itch/map_book.hpp"
+#include "allocator/memory_resource.hpp"
 #include <catch2/catch.hpp>
 
 
@@ -303,3 +304,44 @@ TEST_CASE("map_book", "[map_book]")
         REQUIRE(itr->second.agg_qty() == 50);
     }
 }
+
+TEST_CASE("map_book on a memory resource", "[map_book]")
+{
+    using namespace itch;
+
+    // two books sharing one pool through a pool_resource
+    memory_pool pool(64, 10);
+    pool_resource<> resource(pool);
+    map_book book1(&resource);
+    map_book book2(&resource);
+
+    order o1(Side::Bid, 100, 10);
+    order o2(Side::Bid, 200, 20);
+    order o3(Side::Ask, 300, 30);
+    order o4(Side::Bid, 100, 40);
+    book1.add_order(o1);
+    book1.add_order(o2);
+    book2.add_order(o3);
+    book2.add_order(o4);
+    REQUIRE(pool.max_used() == 4);
+
+    REQUIRE(book1.best_bid() == pq{200, 20});
+    REQUIRE(book2.best_bid() == pq{100, 40});
+    REQUIRE(book2.best_ask() == pq{300, 30});
+    REQUIRE(book1.max_bid_book_depth() == 2);
+    REQUIRE(book1.max_ask_book_depth() == 0);
+    REQUIRE(book2.max_bid_book_depth() == 1);
+    REQUIRE(book2.max_ask_book_depth() == 1);
+
+    book1.delete_order(o2);
+    REQUIRE(book1.best_bid() == pq{100, 10});
+    REQUIRE(book1.max_bid_book_depth() == 2);
+
+    // and one on a monotonic arena
+    monotonic_arena_resource<> arena(4096);
+    map_book book3(&arena);
+    order o5(Side::Ask, 500, 50);
+    book3.add_order(o5);
+    REQUIRE(book3.best_ask() == pq{500, 50});
+    REQUIRE(arena.num_blocks() == 1);
+}
@@ -303,3 +303,44 @@ TEST_CASE("mp_book", "[mp_book]")
         REQUIRE(itr->agg_qty() == 50);
     }
 }
+
+TEST_CASE("mp_book shared pools", "[mp_book]")
+{
+    using namespace itch;
+    mp_book::shared_pools pools(4);
+    mp_book book1(pools);
+    mp_book book2(pools);
+
+    order o1(Side::Bid, 100, 10);
+    order o2(Side::Bid, 200, 20);
+    order o3(Side::Ask, 300, 30);
+    order o4(Side::Bid, 100, 40);
+    order o5(Side::Bid, 150, 50);
+    order o6(Side::Bid, 120, 60);
+    book1.add_order(o1);
+    book1.add_order(o2);
+    book1.add_order(o3);
+    book2.add_order(o4);
+    book2.add_order(o5);
+    book2.add_order(o6);
+
+    // levels come from the pools of their side, past their initial size
+    REQUIRE(pools.bids.max_used() == 5);
+    REQUIRE(pools.asks.max_used() == 1);
+    REQUIRE(book1.best_bid() == pq{200, 20});
+    REQUIRE(book2.best_bid() == pq{150, 50});
+
+    // while each book keeps its own depth stats
+    REQUIRE(book1.max_bid_book_depth() == 2);
+    REQUIRE(book1.max_ask_book_depth() == 1);
+    REQUIRE(book2.max_bid_book_depth() == 3);
+    REQUIRE(book2.max_ask_book_depth() == 0);
+
+    book2.delete_order(o5);
+    book2.delete_order(o6);
+    book1.add_order(o5);
+    REQUIRE(pools.bids.max_used() == 5);
+    REQUIRE(book1.max_bid_book_depth() == 3);
+    REQUIRE(book2.max_bid_book_depth() == 3);
+    REQUIRE(book1.bids().size() == 3);
+}
@@ -0,0 +1,170 @@
+#include "itch/msg_columns.hpp"
+#include <catch2/catch.hpp>
+#include <endian.h>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <vector>
+
+
+namespace { // unnamed
+
+    using namespace itch;
+
+    template <typename T>
+    void
+    append(std::vector<std::uint8_t>& buf, T& m, char type, std::uint16_t locate,
+            std::uint64_t timestamp)
+    {
+        m.length = htobe16(sizeof(T) - sizeof(m.length));
+        m.msg_type = type;
+        m.stock_locate = htobe16(locate);
+        for (std::size_t i = 0; i < sizeof(m.timestamp); ++i)
+            m.timestamp[i] = timestamp >> (8 * (sizeof(m.timestamp) - 1 - i));
+
+        std::size_t const pos = buf.size();
+        buf.resize(pos + sizeof(T));
+        std::memcpy(buf.data() + pos, &m, sizeof(T));
+    }
+
+} // namespace
+
+
+TEST_CASE("decode", "[msg_columns]")
+{
+    std::vector<std::uint8_t> buf;
+
+    add_order a = {};
+    a.order_reference_number = htobe64(0x0102030405060708);
+    a.buy_sell_indicator = 'B';
+    a.shares = htobe32(300);
+    a.price = htobe32(1'234'500);
+    append(buf, a, 'A', 7, 0x123456789abc);
+
+    add_order_with_mpid f = {};
+    f.order_reference_number = htobe64(11);
+    f.buy_sell_indicator = 'S';
+    f.shares = htobe32(100);
+    f.price = htobe32(99);
+    append(buf, f, 'F', 8, 2);
+
+    order_executed e = {};
+    e.order_reference_number = htobe64(11);
+    e.executed_shares = htobe32(40);
+    append(buf, e, 'E', 8, 3);
+
+    order_cancel x = {};
+    x.order_reference_number = htobe64(11);
+    x.cancelled_shares = htobe32(10);
+    append(buf, x, 'X', 8, 4);
+
+    order_replace u = {};
+    u.original_order_reference_number = htobe64(11);
+    u.new_order_reference_number = htobe64(12);
+    u.shares = htobe32(500);
+    u.price = htobe32(101);
+    append(buf, u, 'U', 8, 5);
+
+    order_delete d = {};
+    d.order_reference_number = htobe64(12);
+    append(buf, d, 'D', 8, 6);
+
+    system_event s = {};
+    s.event_code = 'Q';
+    append(buf, s, 'S', 0, 7);
+
+    std::size_t const complete = buf.size();
+    msg_columns<8> cols;
+
+    SECTION("columns")
+    {
+        REQUIRE(decode(buf.data(), buf.size(), cols) == complete);
+        REQUIRE(cols.size == 7);
+
+        REQUIRE(cols.type[0] == 'A');
+        REQUIRE(cols.locate[0] == 7);
+        REQUIRE(cols.oid[0] == 0x0102030405060708);
+        REQUIRE(cols.side[0] == Side::Bid);
+        REQUIRE(cols.qty[0] == 300);
+        REQUIRE(cols.price[0] == 1'234'500);
+        REQUIRE(cols.timestamp[0] == 0x123456789abc);
+        REQUIRE(cols.msg[0] == reinterpret_cast<header const*>(buf.data()));
+
+        REQUIRE(cols.type[1] == 'F');
+        REQUIRE(cols.locate[1] == 8);
+        REQUIRE(cols.oid[1] == 11);
+        REQUIRE(cols.side[1] == Side::Ask);
+        REQUIRE(cols.qty[1] == 100);
+        REQUIRE(cols.price[1] == 99);
+        REQUIRE(cols.timestamp[1] == 2);
+
+        REQUIRE(cols.type[2] == 'E');
+        REQUIRE(cols.oid[2] == 11);
+        REQUIRE(cols.qty[2] == 40);
+
+        REQUIRE(cols.type[3] == 'X');
+        REQUIRE(cols.oid[3] == 11);
+        REQUIRE(cols.qty[3] == 10);
+
+        REQUIRE(cols.type[4] == 'U');
+        REQUIRE(cols.oid[4] == 11);
+        REQUIRE(cols.new_oid[4] == 12);
+        REQUIRE(cols.qty[4] == 500);
+        REQUIRE(cols.price[4] == 101);
+
+        REQUIRE(cols.type[5] == 'D');
+        REQUIRE(cols.oid[5] == 12);
+        REQUIRE(cols.timestamp[5] == 6);
+
+        REQUIRE(cols.type[6] == 'S');
+        REQUIRE(cols.locate[6] == 0);
+        REQUIRE(cols.timestamp[6] == 7);
+        REQUIRE(reinterpret_cast<system_event const*>(cols.msg[6])->event_code == 'Q');
+    }
+
+    SECTION("stops at capacity")
+    {
+        append(buf, d, 'D', 9, 8);
+        append(buf, d, 'D', 10, 9);
+
+        std::size_t const bytes = decode(buf.data(), buf.size(), cols);
+        REQUIRE(cols.size == 8);
+        REQUIRE(bytes == complete + sizeof(order_delete));
+        REQUIRE(cols.locate[7] == 9);
+
+        REQUIRE(decode(buf.data() + bytes, buf.size() - bytes, cols) == sizeof(order_delete));
+        REQUIRE(cols.size == 1);
+        REQUIRE(cols.locate[0] == 10);
+    }
+
+    SECTION("unknown type or length")
+    {
+        // an add order with 4 bytes too many, and an unknown type
+        std::size_t const pos = buf.size();
+        append(buf, a, 'A', 9, 8);
+        std::uint16_t const length = htobe16(sizeof(a) - sizeof(a.length) + 4);
+        std::memcpy(buf.data() + pos, &length, sizeof(length));
+        buf.resize(buf.size() + 4);
+        append(buf, s, 'z', 10, 9);
+
+        std::size_t const bytes = decode(buf.data() + complete, buf.size() - complete, cols);
+        REQUIRE(bytes == buf.size() - complete);
+        REQUIRE(cols.size == 2);
+        REQUIRE(cols.type[0] == cols.UnknownType);
+        REQUIRE(cols.locate[0] == 9);
+        REQUIRE(cols.timestamp[0] == 8);
+        REQUIRE(cols.msg[0] == reinterpret_cast<header const*>(buf.data() + pos));
+        REQUIRE(cols.type[1] == cols.UnknownType);
+        REQUIRE(cols.locate[1] == 10);
+    }
+
+    SECTION("trailing partial msg")
+    {
+        append(buf, a, 'A', 9, 8);
+        REQUIRE(decode(buf.data(), buf.size() - 1, cols) == complete);
+        REQUIRE(cols.size == 7);
+
+        REQUIRE(decode(buf.data(), 0, cols) == 0);
+        REQUIRE(cols.size == 0);
+    }
+}
@@ -0,0 +1,83 @@
+#include "itch/msg_index.hpp"
+#include <catch2/catch.hpp>
+#include <endian.h>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <vector>
+
+
+namespace { // unnamed
+
+    /// appends a msg of msg_len bytes (incl. the length field)
+    void
+    append_msg(std::vector<std::uint8_t>& buf, std::uint16_t locate, std::size_t msg_len)
+    {
+        itch::header hdr = {};
+        hdr.length = htobe16(msg_len - sizeof(hdr.length));
+        hdr.msg_type = 'X';
+        hdr.stock_locate = htobe16(locate);
+
+        std::size_t const pos = buf.size();
+        buf.resize(pos + msg_len);
+        std::memcpy(buf.data() + pos, &hdr, sizeof(hdr));
+    }
+
+} // namespace
+
+
+TEST_CASE("msg_index", "[msg_index]")
+{
+    using namespace itch;
+
+    std::vector<std::uint8_t> buf;
+    append_msg(buf, 0, 12);  // 0
+    append_msg(buf, 3, 36);  // 12
+    append_msg(buf, 1, 25);  // 48
+    append_msg(buf, 3, 31);  // 73
+    append_msg(buf, 3, 36);  // 104
+    std::size_t const complete = buf.size();
+
+    msg_index index;
+
+    SECTION("initial state")
+    {
+        REQUIRE(index.num_locates() == 0);
+        REQUIRE(index.msg_count() == 0);
+        REQUIRE(index.unknown_count() == 0);
+        REQUIRE(index.bytes_indexed() == 0);
+        REQUIRE(index.offsets(3).empty());
+    }
+
+    SECTION("offsets by locate")
+    {
+        REQUIRE(index.build(buf.data(), buf.size()) == complete);
+        REQUIRE(index.msg_count() == 5);
+        REQUIRE(index.unknown_count() == 4); // only 25 is an order_cancel length
+        REQUIRE(index.bytes_indexed() == complete);
+        REQUIRE(index.num_locates() == 4);
+        REQUIRE(index.offsets(0) == std::vector<std::uint64_t>{0});
+        REQUIRE(index.offsets(1) == std::vector<std::uint64_t>{48});
+        REQUIRE(index.offsets(2).empty());
+        REQUIRE(index.offsets(3) == std::vector<std::uint64_t>{12, 73, 104});
+        REQUIRE(index.offsets(9000).empty());
+    }
+
+    SECTION("trailing partial msg")
+    {
+        append_msg(buf, 2, 40);
+        REQUIRE(index.build(buf.data(), buf.size() - 1) == complete);
+        REQUIRE(index.msg_count() == 5);
+        REQUIRE(index.offsets(2).empty());
+    }
+
+    SECTION("rebuild")
+    {
+        index.build(buf.data(), buf.size());
+        REQUIRE(index.build(buf.data(), 48) == 48);
+        REQUIRE(index.msg_count() == 2);
+        REQUIRE(index.num_locates() == 4);
+        REQUIRE(index.offsets(3) == std::vector<std::uint64_t>{12});
+        REQUIRE(index.offsets(1).empty());
+    }
+}
@@ -0,0 +1,138 @@
+#include "itch/order_store.hpp"
+#include <catch2/catch.hpp>
+#include <cstdint> // std::uintptr_t
+
+
+TEST_CASE("order_store", "[order_store]")
+{
+    using namespace itch;
+
+    // 16 orders per page
+    order_store<order, 4> store(100);
+
+    SECTION("initial state")
+    {
+        REQUIRE(store.capacity() == 112);
+        REQUIRE(store.pages_in_use() == 0);
+        REQUIRE(store.max_pages_in_use() == 0);
+        REQUIRE(store.pages_allocated() == 0);
+        REQUIRE(store.page_bytes() == 16 * sizeof(order));
+    }
+
+    SECTION("first touch commits page")
+    {
+        order& o = store.insert(17);
+        REQUIRE(store.pages_in_use() == 1);
+        REQUIRE(store.pages_allocated() == 1);
+        REQUIRE(o == order());
+
+        o = order(Side::Ask, 100, 200);
+        REQUIRE(store.find(17) == &o);
+        REQUIRE(store.slot(17)->price == 100);
+        REQUIRE(store.slot(17)->qty == 200);
+        REQUIRE(store.slot(17)->side == Side::Ask);
+
+        // same page
+        store.insert(31);
+        REQUIRE(store.pages_in_use() == 1);
+
+        // next page
+        store.insert(32);
+        REQUIRE(store.pages_in_use() == 2);
+        REQUIRE(store.pages_allocated() == 2);
+    }
+
+    SECTION("page recycled once all orders erased")
+    {
+        store.insert(0) = order(Side::Bid, 10, 10);
+        store.insert(1) = order(Side::Bid, 20, 20);
+        order const* page = store.find(0);
+        REQUIRE(store.pages_in_use() == 1);
+
+        store.erase(0);
+        REQUIRE(store.pages_in_use() == 1);
+        REQUIRE(*store.slot(0) == order());
+        REQUIRE(store.slot(1)->price == 20);
+
+        store.erase(1);
+        REQUIRE(store.pages_in_use() == 0);
+        REQUIRE(store.max_pages_in_use() == 1);
+
+        // re-used for a different page, and handed out cleared
+        order& o = store.insert(50);
+        REQUIRE(store.pages_in_use() == 1);
+        REQUIRE(store.pages_allocated() == 1);
+        REQUIRE(&o == page + 2);
+        REQUIRE(o == order());
+        REQUIRE(*store.slot(48) == order());
+        REQUIRE(*store.slot(49) == order());
+    }
+
+    SECTION("erase on untouched page")
+    {
+        store.erase(5);
+        REQUIRE(store.pages_in_use() == 0);
+        REQUIRE(store.pages_allocated() == 0);
+    }
+
+    SECTION("erase of an order never inserted")
+    {
+        store.insert(1) = order(Side::Bid, 10, 10);
+        store.insert(2) = order(Side::Bid, 20, 20);
+
+        store.erase(7);
+        store.erase(1);
+        store.erase(1);
+        REQUIRE(store.pages_in_use() == 1);
+        REQUIRE(store.find(2)->price == 20);
+
+        // the page isn't handed out while 2 is live
+        store.insert(80);
+        REQUIRE(store.pages_in_use() == 2);
+        REQUIRE(store.pages_allocated() == 2);
+        REQUIRE(store.slot(2)->price == 20);
+    }
+
+    SECTION("find does not commit")
+    {
+        REQUIRE(store.find(17) == nullptr);
+        REQUIRE(store.find(1000) == nullptr);
+        REQUIRE(store.slot(17) == nullptr);
+        REQUIRE(store.pages_in_use() == 0);
+
+        order& o = store.insert(17);
+        REQUIRE(store.find(17) == &o);
+        REQUIRE(store.slot(17) == &o);
+        REQUIRE(store.find(20) == nullptr);
+        REQUIRE(store.slot(20) == store.slot(17) + 3);
+        REQUIRE(store.find(32) == nullptr);
+        REQUIRE(store.slot(32) == nullptr);
+        REQUIRE(store.pages_in_use() == 1);
+
+        store.erase(17);
+        REQUIRE(store.find(17) == nullptr);
+    }
+}
+
+TEST_CASE("order_store on huge pages", "[order_store]")
+{
+    using namespace itch;
+
+    // 2^16 32-byte orders: a page is exactly one 2 MB huge page
+    order_store<order, 16, lowlevel_allocator<mmap_hugepage_allocator>> store(1 << 20);
+    REQUIRE(store.page_bytes() == mmap_hugepage_allocator::HugePageSize);
+
+    order& o = store.insert(70'000);
+    REQUIRE(o == order());
+    REQUIRE(reinterpret_cast<std::uintptr_t>(store.slot(65'536))
+            % mmap_hugepage_allocator::HugePageSize == 0);
+
+    o = order(Side::Ask, 100, 200);
+    REQUIRE(store.slot(70'000)->qty == 200);
+    REQUIRE(*store.slot(65'536) == order());
+
+    store.erase(70'000);
+    REQUIRE(store.pages_in_use() == 0);
+    REQUIRE(store.insert(3) == order());
+    REQUIRE(store.pages_allocated() == 1);
+}
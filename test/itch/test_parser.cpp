@@ -0,0 +1,663 @@
+#include "itch/basic_book.hpp"
+#include "itch/bbo.hpp"
+#include "itch/bitmap_book.hpp"
+#include "itch/btree_book.hpp"
+#include "itch/compact_book.hpp"
+#include "itch/depth.hpp"
+#include "itch/hashed_book.hpp"
+#include "itch/l3_book.hpp"
+#include "itch/ladder_book.hpp"
+#include "itch/map_book.hpp"
+#include "itch/mp_book.hpp"
+#include "itch/parser.hpp"
+#include "itch/vector_book.hpp"
+#include <catch2/catch.hpp>
+#include <endian.h>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cstdio>
+#include <cstring> // std::memcpy
+#include <filesystem>
+#include <memory>  // std::make_unique
+#include <string>
+#include <vector>
+
+
+namespace { // unnamed
+
+    using namespace itch;
+
+    template <typename T>
+    void
+    append(std::vector<std::uint8_t>& buf, T& m, char type, std::uint16_t locate)
+    {
+        m.length = htobe16(sizeof(T) - sizeof(m.length));
+        m.msg_type = type;
+        m.stock_locate = htobe16(locate);
+
+        std::size_t const pos = buf.size();
+        buf.resize(pos + sizeof(T));
+        std::memcpy(buf.data() + pos, &m, sizeof(T));
+    }
+
+    /// records every hook call as a string, with the book's top at the
+    /// time. works with the instrument and order of any book
+    struct recording_handler
+    {
+        std::vector<std::string> calls;
+
+        template <typename I>
+        static std::string
+        top(I const& i)
+        {
+            return fmt::format("{}x{}/{}x{}", i.book.best_bid().qty, i.book.best_bid().price,
+                    i.book.best_ask().qty, i.book.best_ask().price);
+        }
+
+        template <typename O>
+        static std::string
+        side_price(O const& o)
+        {
+            return fmt::format("{}@{}", order_side(o) == Side::Bid ? 'B' : 'S', order_price(o));
+        }
+
+        template <typename I, typename O>
+        void
+        on_add(I const& i, O const& o)
+        {
+            calls.push_back(
+                    fmt::format("add {} {}@{} {}", i.locate, o.qty, order_price(o), top(i)));
+        }
+
+        template <typename I, typename O>
+        void
+        on_executed(I const& i, O const& o, qty_t qty, price_t price)
+        {
+            calls.push_back(fmt::format("executed {} {}@{} left {} of {} last {} {}", i.locate,
+                    qty, price, o.qty, side_price(o), i.last, top(i)));
+        }
+
+        template <typename I, typename O>
+        void
+        on_cancel(I const& i, O const& o, qty_t qty)
+        {
+            calls.push_back(fmt::format("cancel {} {} left {} of {} {}", i.locate, qty, o.qty,
+                    side_price(o), top(i)));
+        }
+
+        template <typename I, typename O>
+        void
+        on_delete(I const& i, O const& o)
+        {
+            calls.push_back(
+                    fmt::format("delete {} {}@{} {}", i.locate, o.qty, order_price(o), top(i)));
+        }
+
+        template <typename I, typename O>
+        void
+        on_replace(I const& i, O const& old_order, O const& new_order)
+        {
+            calls.push_back(fmt::format("replace {} {}@{} -> {}@{} {}", i.locate, old_order.qty,
+                    order_price(old_order), new_order.qty, order_price(new_order), top(i)));
+        }
+
+        template <typename I>
+        void
+        on_trade(I const& i, qty_t qty, price_t price)
+        {
+            calls.push_back(fmt::format("trade {} {}@{}", i.locate, qty, price));
+        }
+
+        void
+        on_system_event(system_event const* m, MarketState state)
+        {
+            calls.push_back(fmt::format("system {} {}", m->event_code, static_cast<int>(state)));
+        }
+    };
+
+    /// keeps every bbo_update
+    struct bbo_recorder
+    {
+        std::vector<bbo_update> updates;
+
+        void on_bbo(bbo_update const& u) { updates.push_back(u); }
+    };
+
+    /// only cares about adds
+    struct add_counter
+    {
+        std::size_t adds = 0;
+
+        void on_add(instrument const&, order const&) noexcept { ++adds; }
+    };
+
+    std::vector<std::uint8_t>
+    make_msgs()
+    {
+        std::vector<std::uint8_t> buf;
+
+        system_event s = {};
+        s.event_code = 'Q';
+        append(buf, s, 'S', 0);
+
+        stock_directory r = {};
+        std::memcpy(r.stock, "AAPL    ", sizeof(r.stock));
+        append(buf, r, 'R', 3);
+
+        add_order a = {};
+        a.order_reference_number = htobe64(1);
+        a.buy_sell_indicator = 'B';
+        a.shares = htobe32(300);
+        a.price = htobe32(1000);
+        append(buf, a, 'A', 3);
+
+        a.order_reference_number = htobe64(2);
+        a.buy_sell_indicator = 'S';
+        a.shares = htobe32(200);
+        a.price = htobe32(1100);
+        append(buf, a, 'A', 3);
+
+        order_executed e = {};
+        e.order_reference_number = htobe64(1);
+        e.executed_shares = htobe32(100);
+        append(buf, e, 'E', 3);
+
+        order_cancel x = {};
+        x.order_reference_number = htobe64(2);
+        x.cancelled_shares = htobe32(50);
+        append(buf, x, 'X', 3);
+
+        order_replace u = {};
+        u.original_order_reference_number = htobe64(1);
+        u.new_order_reference_number = htobe64(3);
+        u.shares = htobe32(400);
+        u.price = htobe32(1010);
+        append(buf, u, 'U', 3);
+
+        order_executed_with_price c = {};
+        c.order_reference_number = htobe64(3);
+        c.executed_shares = htobe32(400);
+        c.printable = 'Y';
+        c.execution_price = htobe32(1005);
+        append(buf, c, 'C', 3);
+
+        order_delete d = {};
+        d.order_reference_number = htobe64(2);
+        append(buf, d, 'D', 3);
+
+        trade_non_cross p = {};
+        p.shares = htobe32(10);
+        p.price = htobe32(999);
+        append(buf, p, 'P', 3);
+
+        return buf;
+    }
+
+    /// make_msgs(), then book events that leave the top alone, bar the
+    /// first, and then asks taken out by a full execution, a full
+    /// cancel and a full execution with price
+    std::vector<std::uint8_t>
+    make_bbo_msgs()
+    {
+        std::vector<std::uint8_t> buf = make_msgs();
+
+        add_order a = {};
+        a.timestamp[5] = 7;
+        a.order_reference_number = htobe64(4);
+        a.buy_sell_indicator = 'B';
+        a.shares = htobe32(100);
+        a.price = htobe32(900);
+        append(buf, a, 'A', 3);
+
+        a.timestamp[5] = 8;
+        a.order_reference_number = htobe64(5);
+        a.shares = htobe32(50);
+        a.price = htobe32(800);
+        append(buf, a, 'A', 3);
+
+        order_cancel x = {};
+        x.order_reference_number = htobe64(5);
+        x.cancelled_shares = htobe32(10);
+        append(buf, x, 'X', 3);
+
+        order_delete d = {};
+        d.order_reference_number = htobe64(5);
+        append(buf, d, 'D', 3);
+
+        a.timestamp[5] = 9;
+        a.order_reference_number = htobe64(6);
+        a.buy_sell_indicator = 'S';
+        a.shares = htobe32(10);
+        a.price = htobe32(1200);
+        append(buf, a, 'A', 3);
+
+        a.timestamp[5] = 10;
+        a.order_reference_number = htobe64(7);
+        a.shares = htobe32(20);
+        a.price = htobe32(1300);
+        append(buf, a, 'A', 3);
+
+        order_executed e = {};
+        e.timestamp[5] = 11;
+        e.order_reference_number = htobe64(6);
+        e.executed_shares = htobe32(10);
+        append(buf, e, 'E', 3);
+
+        a.timestamp[5] = 12;
+        a.order_reference_number = htobe64(8);
+        a.shares = htobe32(5);
+        a.price = htobe32(1250);
+        append(buf, a, 'A', 3);
+
+        x.timestamp[5] = 13;
+        x.order_reference_number = htobe64(8);
+        x.cancelled_shares = htobe32(5);
+        append(buf, x, 'X', 3);
+
+        order_executed_with_price c = {};
+        c.timestamp[5] = 14;
+        c.order_reference_number = htobe64(7);
+        c.executed_shares = htobe32(20);
+        c.printable = 'Y';
+        c.execution_price = htobe32(1300);
+        append(buf, c, 'C', 3);
+
+        return buf;
+    }
+
+} // namespace
+
+
+TEMPLATE_TEST_CASE("handler hooks", "[parser]", basic_book, bitmap_book, btree_book,
+        compact_book<mp_book>, hashed_book, l3_book, ladder_book, map_book, mp_book, vector_book)
+{
+    std::vector<std::uint8_t> const buf = make_msgs();
+    std::vector<std::string> const expected = {
+            "system Q 0",
+            "add 3 300@1000 300x1000/0x0",
+            "add 3 200@1100 300x1000/200x1100",
+            "executed 3 100@1000 left 200 of B@1000 last 1000 200x1000/200x1100",
+            "cancel 3 50 left 150 of S@1100 200x1000/150x1100",
+            "replace 3 200@1000 -> 400@1010 400x1010/150x1100",
+            "executed 3 400@1005 left 0 of B@1010 last 1005 0x0/150x1100",
+            "delete 3 150@1100 0x0/0x0",
+            "trade 3 10@999",
+    };
+
+    SECTION("parse")
+    {
+        auto p = std::make_unique<parser<false, recording_handler, TestType>>("", false);
+        REQUIRE(p->parse(buf.data(), buf.size()) == buf.size());
+        REQUIRE(p->handler().calls == expected);
+        REQUIRE(p->orders().find(1) == nullptr);
+        REQUIRE(p->orders().find(3) == nullptr);
+    }
+
+    SECTION("parse_batched")
+    {
+        auto p = std::make_unique<parser<false, recording_handler, TestType>>("", false);
+        REQUIRE(p->parse_batched(buf.data(), buf.size()) == buf.size());
+        REQUIRE(p->handler().calls == expected);
+    }
+}
+
+TEMPLATE_TEST_CASE("orders taken out", "[parser]", basic_book, bitmap_book, btree_book,
+        compact_book<mp_book>, hashed_book, l3_book, ladder_book, map_book, mp_book, vector_book)
+{
+    std::vector<std::uint8_t> const buf = make_bbo_msgs();
+    std::vector<std::string> const expected = {
+            "cancel 3 10 left 40 of B@800 100x900/0x0",
+            "executed 3 10@1200 left 0 of S@1200 last 1200 100x900/20x1300",
+            "cancel 3 5 left 0 of S@1250 100x900/20x1300",
+            "executed 3 20@1300 left 0 of S@1300 last 1300 100x900/0x0",
+    };
+
+    // the hooks of the events past make_msgs()
+    auto const calls = [](auto const& p) {
+        std::vector<std::string> v;
+        for (std::string const& call : p->handler().calls) {
+            if (call.starts_with("executed") || call.starts_with("cancel"))
+                v.push_back(call);
+        }
+        v.erase(v.begin(), v.begin() + 3);
+        return v;
+    };
+
+    SECTION("parse")
+    {
+        auto p = std::make_unique<parser<false, recording_handler, TestType>>("", false);
+        REQUIRE(p->parse(buf.data(), buf.size()) == buf.size());
+        REQUIRE(calls(p) == expected);
+    }
+
+    SECTION("parse_batched")
+    {
+        auto p = std::make_unique<parser<false, recording_handler, TestType>>("", false);
+        REQUIRE(p->parse_batched(buf.data(), buf.size()) == buf.size());
+        REQUIRE(calls(p) == expected);
+    }
+}
+
+TEST_CASE("unknown oids", "[parser]")
+{
+    std::vector<std::uint8_t> buf = make_msgs();
+
+    add_order a = {};
+    a.order_reference_number = htobe64(4);
+    a.buy_sell_indicator = 'B';
+    a.shares = htobe32(100);
+    a.price = htobe32(900);
+    append(buf, a, 'A', 3);
+
+    a.order_reference_number = htobe64(5);
+    a.price = htobe32(950);
+    append(buf, a, 'A', 3);
+
+    // the page still holds a live order after 4 is gone
+    order_delete live = {};
+    live.order_reference_number = htobe64(4);
+    std::vector<std::uint8_t> known = buf;
+    append(known, live, 'D', 3);
+
+    // 9 was never added and 2 is already gone, all of these are skipped
+    for (std::uint64_t oid : {9, 2}) {
+        order_delete d = {};
+        d.order_reference_number = htobe64(oid);
+        append(buf, d, 'D', 3);
+
+        order_cancel x = {};
+        x.order_reference_number = htobe64(oid);
+        x.cancelled_shares = htobe32(10);
+        append(buf, x, 'X', 3);
+
+        order_executed e = {};
+        e.order_reference_number = htobe64(oid);
+        e.executed_shares = htobe32(10);
+        append(buf, e, 'E', 3);
+
+        order_executed_with_price c = {};
+        c.order_reference_number = htobe64(oid);
+        c.executed_shares = htobe32(10);
+        c.printable = 'Y';
+        c.execution_price = htobe32(1000);
+        append(buf, c, 'C', 3);
+
+        order_replace u = {};
+        u.original_order_reference_number = htobe64(oid);
+        u.new_order_reference_number = htobe64(6);
+        u.shares = htobe32(10);
+        u.price = htobe32(1000);
+        append(buf, u, 'U', 3);
+    }
+
+    append(buf, live, 'D', 3);
+
+    auto expected = std::make_unique<parser<false, recording_handler>>("", false);
+    REQUIRE(expected->parse(known.data(), known.size()) == known.size());
+    auto p = std::make_unique<parser<false, recording_handler>>("", false);
+
+    SECTION("parse")
+    {
+        REQUIRE(p->parse(buf.data(), buf.size()) == buf.size());
+    }
+
+    SECTION("parse_batched")
+    {
+        REQUIRE(p->parse_batched(buf.data(), buf.size()) == buf.size());
+    }
+
+    REQUIRE(p->handler().calls == expected->handler().calls);
+    REQUIRE(p->instruments()[3].stats_csv() == expected->instruments()[3].stats_csv());
+    REQUIRE(p->orders().pages_in_use() == 1);
+    REQUIRE(p->orders().find(5)->qty == 100);
+    REQUIRE(p->orders().find(6) == nullptr);
+    REQUIRE(p->instruments()[3].book.best_bid() == pq{950, 100});
+}
+
+TEMPLATE_TEST_CASE("bbo updates", "[parser]", basic_book, bitmap_book, btree_book,
+        compact_book<mp_book>, hashed_book, l3_book, ladder_book, map_book, mp_book, vector_book)
+{
+    std::vector<std::uint8_t> const buf = make_bbo_msgs();
+    std::vector<bbo_update> const expected = {
+            {0, {1000, 300}, {0, 0}, 3},
+            {0, {1000, 300}, {1100, 200}, 3},
+            {0, {1000, 200}, {1100, 200}, 3},
+            {0, {1000, 200}, {1100, 150}, 3},
+            {0, {1010, 400}, {1100, 150}, 3},
+            {0, {0, 0}, {1100, 150}, 3},
+            {0, {0, 0}, {0, 0}, 3},
+            {7, {900, 100}, {0, 0}, 3},
+            {9, {900, 100}, {1200, 10}, 3},
+            {11, {900, 100}, {1300, 20}, 3},
+            {12, {900, 100}, {1250, 5}, 3},
+            {13, {900, 100}, {1300, 20}, 3},
+            {14, {900, 100}, {0, 0}, 3},
+    };
+
+    SECTION("parse")
+    {
+        auto p = std::make_unique<parser<false, bbo_recorder, TestType>>("", false);
+        REQUIRE(p->parse(buf.data(), buf.size()) == buf.size());
+        REQUIRE(p->handler().updates == expected);
+    }
+
+    SECTION("parse_batched")
+    {
+        auto p = std::make_unique<parser<false, bbo_recorder, TestType>>("", false);
+        REQUIRE(p->parse_batched(buf.data(), buf.size()) == buf.size());
+        REQUIRE(p->handler().updates == expected);
+    }
+}
+
+TEST_CASE("bbo file", "[parser]")
+{
+    std::vector<std::uint8_t> const buf = make_bbo_msgs();
+    std::filesystem::path const fpath =
+            std::filesystem::temp_directory_path() / "test_parser_bbo.bin";
+
+    std::vector<bbo_update> expected;
+    {
+        auto r = std::make_unique<parser<false, bbo_recorder>>("", false);
+        r->parse(buf.data(), buf.size());
+        expected = r->handler().updates;
+
+        auto p = std::make_unique<parser<false, bbo_file_writer>>(
+                "", false, false, bbo_file_writer(fpath));
+        p->parse(buf.data(), buf.size());
+        REQUIRE(p->handler().count() == expected.size());
+    }
+    REQUIRE(std::filesystem::file_size(fpath) == expected.size() * sizeof(bbo_update));
+
+    std::vector<bbo_update> written(expected.size());
+    std::FILE* f = std::fopen(fpath.c_str(), "rb");
+    REQUIRE(f != nullptr);
+    REQUIRE(std::fread(written.data(), sizeof(bbo_update), written.size(), f) == written.size());
+    std::fclose(f);
+    std::filesystem::remove(fpath);
+
+    REQUIRE(written == expected);
+}
+
+TEST_CASE("depth snapshots", "[parser]")
+{
+    std::filesystem::path const fpath =
+            std::filesystem::temp_directory_path() / "test_parser_depth.bin";
+    std::vector<std::uint8_t> buf;
+
+    stock_directory r = {};
+    std::memcpy(r.stock, "AAPL    ", sizeof(r.stock));
+    append(buf, r, 'R', 3);
+    std::memcpy(r.stock, "MSFT    ", sizeof(r.stock));
+    append(buf, r, 'R', 4);
+
+    // feed times 5, 6, 7 and then 25: snapshots at 0 (before the first
+    // add) and at 20, one for each AAPL boundary crossed by a book event
+    add_order a = {};
+    a.buy_sell_indicator = 'B';
+    for (std::uint8_t i = 0; i < 3; ++i) {
+        a.timestamp[5] = 5 + i;
+        a.order_reference_number = htobe64(1 + i);
+        a.shares = htobe32(100);
+        a.price = htobe32(1000 - i * 10);
+        append(buf, a, 'A', (i == 1) ? 4 : 3);
+    }
+    a.timestamp[5] = 25;
+    a.order_reference_number = htobe64(4);
+    a.buy_sell_indicator = 'S';
+    a.price = htobe32(1100);
+    append(buf, a, 'A', 3);
+
+    {
+        auto p = std::make_unique<parser<false>>("", false);
+        p->dump_depth(std::make_unique<depth_file_writer>(fpath, 3), {"AAPL"}, 10);
+        REQUIRE(p->parse(buf.data(), buf.size()) == buf.size());
+        REQUIRE(p->depth_writer()->count() == 2);
+    }
+
+    struct record
+    {
+        depth_header h;
+        pq bids[3];
+        pq asks[3];
+    };
+    std::vector<record> records(2);
+    REQUIRE(std::filesystem::file_size(fpath) == records.size() * sizeof(record));
+    std::FILE* f = std::fopen(fpath.c_str(), "rb");
+    REQUIRE(f != nullptr);
+    REQUIRE(std::fread(records.data(), sizeof(record), records.size(), f) == records.size());
+    std::fclose(f);
+    std::filesystem::remove(fpath);
+
+    REQUIRE(records[0].h.timestamp == 0);
+    REQUIRE(records[0].h.locate == 3);
+    REQUIRE(records[0].h.levels == 3);
+    REQUIRE(records[0].bids[0] == pq{0, 0});
+
+    REQUIRE(records[1].h.timestamp == 20);
+    REQUIRE(records[1].h.locate == 3);
+    REQUIRE(records[1].bids[0] == pq{1000, 100});
+    REQUIRE(records[1].bids[1] == pq{980, 100});
+    REQUIRE(records[1].bids[2] == pq{0, 0});
+    REQUIRE(records[1].asks[0] == pq{0, 0});
+}
+
+TEST_CASE("shared pools", "[parser]")
+{
+    std::vector<std::uint8_t> const buf = make_msgs();
+    auto own = std::make_unique<parser<false>>("", false);
+    auto shared = std::make_unique<parser<false>>("", false, false, default_handler(), true);
+    own->parse(buf.data(), buf.size());
+    shared->parse(buf.data(), buf.size());
+
+    instrument const& i1 = own->instruments()[3];
+    instrument const& i2 = shared->instruments()[3];
+    REQUIRE(i2.book.best_bid() == i1.book.best_bid());
+    REQUIRE(i2.book.best_ask() == i1.book.best_ask());
+    REQUIRE(i2.allocator_stats() == i1.allocator_stats());
+    REQUIRE(i2.stats_csv() == i1.stats_csv());
+}
+
+TEST_CASE("partial handler", "[parser]")
+{
+    std::vector<std::uint8_t> const buf = make_msgs();
+    auto p = std::make_unique<parser<false, add_counter>>("", false, false, add_counter{10});
+    p->parse(buf.data(), buf.size());
+    REQUIRE(p->handler().adds == 12);
+}
+
+TEST_CASE("unknown msgs", "[parser]")
+{
+    std::vector<std::uint8_t> buf = make_msgs();
+    std::size_t const num_msgs = 10;
+
+    // an add order with 4 bytes too many, then a good one
+    add_order a = {};
+    a.order_reference_number = htobe64(4);
+    a.buy_sell_indicator = 'B';
+    a.shares = htobe32(100);
+    a.price = htobe32(2000);
+    std::size_t const pos = buf.size();
+    append(buf, a, 'A', 3);
+    std::uint16_t const length = htobe16(sizeof(a) - sizeof(a.length) + 4);
+    std::memcpy(buf.data() + pos, &length, sizeof(length));
+    buf.resize(buf.size() + 4);
+
+    a.order_reference_number = htobe64(5);
+    a.price = htobe32(900);
+    append(buf, a, 'A', 3);
+
+    auto p = std::make_unique<parser<false, add_counter>>("", false, true);
+
+    SECTION("parse")
+    {
+        REQUIRE(p->parse(buf.data(), buf.size()) == buf.size());
+    }
+
+    SECTION("parse_batched")
+    {
+        REQUIRE(p->parse_batched(buf.data(), buf.size()) == buf.size());
+    }
+
+    REQUIRE(p->msg_count() == num_msgs + 2);
+    REQUIRE(p->handler().adds == 3);
+    REQUIRE(p->orders().find(4) == nullptr);
+    REQUIRE(p->instruments()[3].book.best_bid() == pq{900, 100});
+}
+
+TEST_CASE("watchlist", "[parser]")
+{
+    std::vector<std::uint8_t> buf = make_msgs();
+    std::size_t const aapl_bytes = buf.size();
+
+    stock_directory r = {};
+    std::memcpy(r.stock, "MSFT    ", sizeof(r.stock));
+    append(buf, r, 'R', 4);
+
+    add_order a = {};
+    a.order_reference_number = htobe64(4);
+    a.buy_sell_indicator = 'B';
+    a.shares = htobe32(100);
+    a.price = htobe32(500);
+    append(buf, a, 'A', 4);
+
+    auto p = std::make_unique<parser<false, add_counter>>("", false);
+
+    SECTION("everything by default")
+    {
+        REQUIRE(p->watching(3));
+        REQUIRE(p->watching(4));
+        p->parse(buf.data(), buf.size());
+        REQUIRE(p->handler().adds == 3);
+        REQUIRE(p->filtered_count() == 0);
+        REQUIRE(p->instruments()[4].book.best_bid() == pq{500, 100});
+    }
+
+    SECTION("parse")
+    {
+        p->watch({"MSFT", "IBM"});
+        REQUIRE(p->watching(0));
+        REQUIRE_FALSE(p->watching(3));
+
+        // every AAPL msg but its stock directory, which is only looked at
+        p->parse(buf.data(), aapl_bytes);
+        REQUIRE(p->filtered_count() == 8);
+        REQUIRE(p->handler().adds == 0);
+        REQUIRE(p->orders().max_pages_in_use() == 0);
+        REQUIRE(p->instruments()[3].locate == 0);
+        REQUIRE_FALSE(p->watching(3));
+
+        p->parse(buf.data() + aapl_bytes, buf.size() - aapl_bytes);
+        REQUIRE(p->watching(4));
+        REQUIRE(p->handler().adds == 1);
+        REQUIRE(p->instruments()[4].book.best_bid() == pq{500, 100});
+    }
+
+    SECTION("parse_batched")
+    {
+        p->watch({"MSFT"});
+        p->parse_batched(buf.data(), buf.size());
+        REQUIRE(p->handler().adds == 1);
+        REQUIRE(p->filtered_count() == 8);
+        REQUIRE(p->instruments()[4].book.best_bid() == pq{500, 100});
+    }
+}
@@ -0,0 +1,99 @@
+#include "itch/price_map.hpp"
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <map>
+#include <random>
+
+
+TEST_CASE("price_map", "[price_map]")
+{
+    using namespace itch;
+    price_map<std::uint64_t> map(100);
+
+    SECTION("empty")
+    {
+        REQUIRE(map.size() == 0);
+        REQUIRE(map.capacity() == 0); // allocated on first insert
+        REQUIRE(map.find(100) == nullptr);
+    }
+
+    SECTION("insert, find and erase")
+    {
+        map.insert(10000, 1);
+        map.insert(10100, 2);
+        map.insert(0, 3);
+        REQUIRE(map.size() == 3);
+        REQUIRE(map.capacity() == 128);
+
+        REQUIRE(*map.find(10000) == 1);
+        REQUIRE(*map.find(10100) == 2);
+        REQUIRE(*map.find(0) == 3);
+        REQUIRE(map.find(10200) == nullptr);
+
+        *map.find(10100) = 4;
+        REQUIRE(map.erase(10100) == 4);
+        REQUIRE(map.find(10100) == nullptr);
+        REQUIRE(*map.find(10000) == 1);
+        REQUIRE(*map.find(0) == 3);
+        REQUIRE(map.size() == 2);
+    }
+
+    SECTION("grows")
+    {
+        for (std::uint32_t i = 0; i < 1000; ++i)
+            map.insert(1'000'000 - i * 100, i);
+        REQUIRE(map.size() == 1000);
+        REQUIRE(map.capacity() == 2048);
+        for (std::uint32_t i = 0; i < 1000; ++i)
+            REQUIRE(*map.find(1'000'000 - i * 100) == i);
+        REQUIRE(map.find(1'000'100) == nullptr);
+    }
+
+    SECTION("random against std::map")
+    {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<std::uint32_t> tick(0, 300);
+        std::map<price_t, std::uint64_t> ref;
+
+        for (std::uint64_t i = 0; i < 100'000; ++i) {
+            price_t const price = 500'000 + tick(rng) * 100;
+            if (auto itr = ref.find(price); itr != ref.end()) {
+                REQUIRE(map.erase(price) == itr->second);
+                ref.erase(itr);
+            } else {
+                map.insert(price, i);
+                ref.emplace(price, i);
+            }
+            REQUIRE(map.size() == ref.size());
+        }
+
+        for (std::uint32_t t = 0; t <= 300; ++t) {
+            price_t const price = 500'000 + t * 100;
+            auto itr = ref.find(price);
+            if (itr == ref.end()) {
+                REQUIRE(map.find(price) == nullptr);
+            } else {
+                REQUIRE(map.find(price) != nullptr);
+                REQUIRE(*map.find(price) == itr->second);
+            }
+        }
+    }
+}
+
+TEST_CASE("price_map keyed by oid", "[price_map]")
+{
+    using namespace itch;
+    price_map<std::uint32_t, oid_t> map(8);
+
+    // refs a page (2^16) apart, and past 32 bits
+    for (std::uint32_t i = 0; i < 100; ++i)
+        map.insert((oid_t(i) << 16) + (oid_t(1) << 40), i);
+    REQUIRE(map.size() == 100);
+    for (std::uint32_t i = 0; i < 100; ++i)
+        REQUIRE(*map.find((oid_t(i) << 16) + (oid_t(1) << 40)) == i);
+    REQUIRE(map.find(oid_t(1) << 16) == nullptr);
+
+    REQUIRE(map.erase(oid_t(1) << 40) == 0);
+    REQUIRE(map.find(oid_t(1) << 40) == nullptr);
+    REQUIRE(map.size() == 99);
+}
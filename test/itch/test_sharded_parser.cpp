@@ -0,0 +1,286 @@
+#include "itch/parser.hpp"
+#include "itch/sharded_parser.hpp"
+#include <catch2/catch.hpp>
+#include <endian.h>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <memory>  // std::make_unique
+#include <random>
+#include <string>
+#include <vector>
+
+
+namespace { // unnamed
+
+    using namespace itch;
+
+    template <typename T>
+    void
+    append(std::vector<std::uint8_t>& buf, T& m, char type, std::uint16_t locate)
+    {
+        m.length = htobe16(sizeof(T) - sizeof(m.length));
+        m.msg_type = type;
+        m.stock_locate = htobe16(locate);
+
+        std::size_t const pos = buf.size();
+        buf.resize(pos + sizeof(T));
+        std::memcpy(buf.data() + pos, &m, sizeof(T));
+    }
+
+    /// appends a zeroed msg of msg_len bytes (incl. the length field)
+    void
+    append_raw(std::vector<std::uint8_t>& buf, char type, std::uint16_t locate,
+            std::size_t msg_len)
+    {
+        header hdr = {};
+        hdr.length = htobe16(msg_len - sizeof(hdr.length));
+        hdr.msg_type = type;
+        hdr.stock_locate = htobe16(locate);
+
+        std::size_t const pos = buf.size();
+        buf.resize(pos + msg_len);
+        std::memcpy(buf.data() + pos, &hdr, sizeof(hdr));
+    }
+
+    /// a system event and an add order for each of locates 1 to 4, oids
+    /// from first_oid on
+    std::vector<std::uint8_t>
+    make_msgs(std::uint64_t first_oid)
+    {
+        std::vector<std::uint8_t> buf;
+
+        system_event s = {};
+        s.event_code = 'Q';
+        append(buf, s, 'S', 0);
+
+        for (std::uint16_t locate = 1; locate <= 4; ++locate) {
+            add_order a = {};
+            a.order_reference_number = htobe64(first_oid + locate - 1);
+            a.buy_sell_indicator = 'B';
+            a.shares = htobe32(100);
+            a.price = htobe32(1000 + locate);
+            append(buf, a, 'A', locate);
+        }
+        return buf;
+    }
+
+    void
+    append_system_event(std::vector<std::uint8_t>& buf, char event_code)
+    {
+        system_event s = {};
+        s.event_code = event_code;
+        append(buf, s, 'S', 0);
+    }
+
+    /// a random session over num_locates instruments: every kind of order
+    /// msg and trades, with the market opening and closing (locate 0
+    /// system events) along the way
+    std::vector<std::uint8_t>
+    make_feed(std::uint16_t num_locates, std::size_t num_events)
+    {
+        struct live_order
+        {
+            std::uint64_t oid;
+            std::uint16_t locate;
+            std::uint32_t qty;
+            std::uint32_t price;
+        };
+
+        std::mt19937 gen(42);
+        auto const random = [&gen](std::uint32_t n) {
+            return std::uniform_int_distribution<std::uint32_t>(0, n - 1)(gen);
+        };
+
+        std::vector<std::uint8_t> buf;
+        append_system_event(buf, 'O');
+        for (std::uint16_t locate = 1; locate <= num_locates; ++locate) {
+            stock_directory r = {};
+            std::string const name = fmt::format("S{:<7}", locate);
+            std::memcpy(r.stock, name.data(), sizeof(r.stock));
+            append(buf, r, 'R', locate);
+        }
+        append_system_event(buf, 'S');
+
+        std::vector<live_order> live;
+        std::uint64_t next_oid = 1;
+        for (std::size_t i = 0; i < num_events; ++i) {
+            if (i == num_events / 4)
+                append_system_event(buf, 'Q');
+            if (i == 3 * num_events / 4)
+                append_system_event(buf, 'M');
+
+            std::uint32_t const op = random(10);
+            if (live.size() < 20 || op < 4) {
+                auto const locate = static_cast<std::uint16_t>(1 + random(num_locates));
+                live_order const o = {
+                        next_oid++, locate, 100 * (1 + random(5)), 1000 + 10 * random(20)};
+                add_order a = {};
+                a.order_reference_number = htobe64(o.oid);
+                a.buy_sell_indicator = (o.price < 1100) ? 'B' : 'S';
+                a.shares = htobe32(o.qty);
+                a.price = htobe32(o.price);
+                append(buf, a, 'A', o.locate);
+                live.push_back(o);
+                continue;
+            }
+
+            std::size_t const n = random(live.size());
+            live_order& o = live[n];
+            std::uint32_t const qty = (random(2) == 0) ? o.qty : 1 + random(o.qty);
+            switch (op) {
+                case 4: {
+                    order_executed e = {};
+                    e.order_reference_number = htobe64(o.oid);
+                    e.executed_shares = htobe32(qty);
+                    append(buf, e, 'E', o.locate);
+                    o.qty -= qty;
+                    break;
+                }
+                case 5: {
+                    order_executed_with_price c = {};
+                    c.order_reference_number = htobe64(o.oid);
+                    c.executed_shares = htobe32(qty);
+                    c.printable = 'Y';
+                    c.execution_price = htobe32(o.price + 1);
+                    append(buf, c, 'C', o.locate);
+                    o.qty -= qty;
+                    break;
+                }
+                case 6: {
+                    order_cancel x = {};
+                    x.order_reference_number = htobe64(o.oid);
+                    x.cancelled_shares = htobe32(qty);
+                    append(buf, x, 'X', o.locate);
+                    o.qty -= qty;
+                    break;
+                }
+                case 7: {
+                    order_replace u = {};
+                    u.original_order_reference_number = htobe64(o.oid);
+                    u.new_order_reference_number = htobe64(next_oid);
+                    u.shares = htobe32(qty);
+                    u.price = htobe32(o.price);
+                    append(buf, u, 'U', o.locate);
+                    o.oid = next_oid++;
+                    o.qty = qty;
+                    break;
+                }
+                case 8: {
+                    trade_non_cross p = {};
+                    p.shares = htobe32(qty);
+                    p.price = htobe32(o.price);
+                    append(buf, p, 'P', o.locate);
+                    break;
+                }
+                default: {
+                    order_delete d = {};
+                    d.order_reference_number = htobe64(o.oid);
+                    append(buf, d, 'D', o.locate);
+                    o.qty = 0;
+                    break;
+                }
+            }
+
+            if (o.qty == 0) {
+                o = live.back();
+                live.pop_back();
+            }
+        }
+        append_system_event(buf, 'E');
+        return buf;
+    }
+
+} // namespace
+
+
+TEST_CASE("sharded_parser matches parser", "[sharded_parser]")
+{
+    std::uint16_t const num_locates = 12;
+    std::vector<std::uint8_t> const buf = make_feed(num_locates, 20'000);
+
+    auto single = std::make_unique<parser<false>>("", false);
+    REQUIRE(single->parse(buf.data(), buf.size()) == buf.size());
+
+    // stats that depend on the market state set by locate 0 msgs
+    REQUIRE(single->instruments()[1].open != 0);
+    REQUIRE(single->instruments()[1].close != 0);
+
+    for (std::size_t num_shards : {1, 2, 3, 5}) {
+        INFO("shards: " << num_shards);
+
+        sharded_parser streamed({}, false, false, num_shards);
+        REQUIRE(streamed.parse(buf.data(), buf.size()) == buf.size());
+        streamed.finish();
+        REQUIRE(streamed.msg_count() == single->msg_count());
+
+        sharded_parser replayed({}, false, false, num_shards);
+        REQUIRE(replayed.replay(buf.data(), buf.size()) == buf.size());
+        REQUIRE(replayed.msg_count() == single->msg_count());
+
+        for (std::uint16_t locate = 1; locate <= num_locates; ++locate) {
+            INFO("locate: " << locate);
+            std::string const stats = single->instruments()[locate].stats_csv();
+            REQUIRE(streamed.instrument(locate).stats_csv() == stats);
+            REQUIRE(replayed.instrument(locate).stats_csv() == stats);
+        }
+    }
+}
+
+TEST_CASE("sharded_parser parse after finish", "[sharded_parser]")
+{
+    std::uint16_t const num_locates = 6;
+    std::vector<std::uint8_t> const buf = make_feed(num_locates, 5'000);
+
+    auto single = std::make_unique<parser<false>>("", false);
+    REQUIRE(single->parse(buf.data(), buf.size()) == buf.size());
+
+    // the workers are restarted by the second parse()
+    sharded_parser p({}, false, false, 3);
+    std::size_t const first = p.parse(buf.data(), buf.size() / 2);
+    p.finish();
+    REQUIRE(p.parse(buf.data() + first, buf.size() - first) == buf.size() - first);
+    p.finish();
+    REQUIRE(p.msg_count() == single->msg_count());
+
+    for (std::uint16_t locate = 1; locate <= num_locates; ++locate) {
+        INFO("locate: " << locate);
+        REQUIRE(p.instrument(locate).stats_csv() == single->instruments()[locate].stats_csv());
+    }
+}
+
+TEST_CASE("sharded_parser unknown msgs", "[sharded_parser]")
+{
+    std::vector<std::uint8_t> buf = make_msgs(1);
+    std::size_t const num_msgs = 5;
+
+    SECTION("too big for a ring slot")
+    {
+        append_raw(buf, 'z', 2, 200);
+    }
+
+    SECTION("wrong length for the type")
+    {
+        // an add order with 4 bytes too many
+        add_order a = {};
+        a.order_reference_number = htobe64(99);
+        a.buy_sell_indicator = 'B';
+        a.shares = htobe32(100);
+        a.price = htobe32(2000);
+        std::size_t const pos = buf.size();
+        append(buf, a, 'A', 2);
+        std::uint16_t const length = htobe16(sizeof(a) - sizeof(a.length) + 4);
+        std::memcpy(buf.data() + pos, &length, sizeof(length));
+        buf.resize(buf.size() + 4);
+    }
+
+    std::vector<std::uint8_t> const tail = make_msgs(11);
+    buf.insert(buf.end(), tail.begin(), tail.end());
+
+    sharded_parser p({}, false, true, 2);
+    REQUIRE(p.parse(buf.data(), buf.size()) == buf.size());
+    p.finish();
+    REQUIRE(p.msg_count() == 2 * num_msgs + 1);
+    REQUIRE(p.unknown_count() == 1);
+    REQUIRE(p.instrument(2).book.best_bid() == pq{1002, 200});
+}
@@ -0,0 +1,173 @@
+#include "allocator/concurrent_memory_pool.hpp"
+#include "allocator/mp_allocator.hpp"
+#include <catch2/catch.hpp>
+#include <algorithm> // std::sort, std::unique
+#include <barrier>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+
+namespace { // unnamed
+
+    struct payload
+    {
+        std::uint64_t owner;
+        std::uint64_t seq;
+        std::uint64_t check;
+    };
+
+    payload*
+    make_payload(concurrent_memory_pool& pool, std::uint64_t owner, std::uint64_t seq)
+    {
+        auto* p = static_cast<payload*>(pool.allocate_node());
+        *p = {owner, seq, owner ^ seq};
+        return p;
+    }
+
+    bool
+    intact(payload const* p)
+    {
+        return p->check == (p->owner ^ p->seq);
+    }
+
+} // namespace
+
+TEST_CASE("concurrent_memory_pool", "[concurrent_memory_pool]")
+{
+    SECTION("node size")
+    {
+        REQUIRE(concurrent_memory_pool(1, 10).node_size() == 16);
+        REQUIRE(concurrent_memory_pool(20, 10).node_size() == 24);
+    }
+
+    SECTION("single thread")
+    {
+        // more than the first block and many magazines' worth
+        constexpr std::size_t N = 10'000;
+        concurrent_memory_pool pool(sizeof(payload), 1000);
+        std::vector<payload*> v;
+        for (std::size_t i = 0; i < N; ++i)
+            v.push_back(make_payload(pool, 0, i));
+
+        std::set<payload*> const unique(v.begin(), v.end());
+        REQUIRE(unique.size() == N);
+        for (payload* p : v) {
+            REQUIRE(intact(p));
+            REQUIRE(detail::is_aligned(p, 8));
+        }
+
+        for (payload* p : v)
+            pool.deallocate_node(p);
+        std::vector<payload*> again;
+        for (std::size_t i = 0; i < N; ++i)
+            again.push_back(make_payload(pool, 1, i));
+        REQUIRE(std::set<payload*>(again.begin(), again.end()) == unique);
+        REQUIRE(pool.next_capacity() > 8000 * pool.node_size());
+    }
+
+    SECTION("arrays")
+    {
+        concurrent_memory_pool pool(8, 100);
+        void* one = pool.allocate_array(1);
+        void* many = pool.allocate_array(1000);
+        REQUIRE(one != nullptr);
+        REQUIRE(many != nullptr);
+        pool.deallocate_array(many, 1000);
+        pool.deallocate_array(one, 1);
+        REQUIRE(pool.allocate_node() == one);
+    }
+
+    SECTION("mp_allocator")
+    {
+        concurrent_memory_pool pool(32, 100);
+        std::list<int, mp_allocator<int, concurrent_memory_pool>> list(pool);
+        for (int i = 0; i < 1000; ++i)
+            list.push_back(i);
+        REQUIRE(list.size() == 1000);
+        REQUIRE(list.front() == 0);
+        REQUIRE(list.back() == 999);
+        REQUIRE(list.get_allocator().get_allocator().node_size() == 32);
+    }
+}
+
+TEST_CASE("concurrent_memory_pool across threads", "[concurrent_memory_pool]")
+{
+    constexpr std::size_t PerThread = 20'000;
+    constexpr std::size_t Batch = 100;
+    concurrent_memory_pool pool(sizeof(payload), 256);
+
+    // every thread allocates, frees half itself and hands the other
+    // half to the next thread to free
+    auto run = [&](std::size_t num_threads) {
+        std::vector<std::vector<payload*>> mailboxes(num_threads);
+        std::vector<std::mutex> mutexes(num_threads);
+        std::barrier sync(static_cast<std::ptrdiff_t>(num_threads));
+        std::vector<std::size_t> corrupt(num_threads, 0);
+
+        auto worker = [&](std::size_t id) {
+            sync.arrive_and_wait();
+            std::vector<payload*> mine;
+            for (std::size_t i = 0; i < PerThread; i += Batch) {
+                for (std::size_t j = 0; j < Batch; ++j)
+                    mine.push_back(make_payload(pool, id, i + j));
+                for (payload* p : mine)
+                    corrupt[id] += !intact(p) || p->owner != id;
+
+                std::vector<payload*> theirs;
+                {
+                    std::lock_guard<std::mutex> lock(mutexes[id]);
+                    theirs.swap(mailboxes[id]);
+                }
+                for (payload* p : theirs) {
+                    corrupt[id] += !intact(p);
+                    pool.deallocate_node(p);
+                }
+
+                std::size_t const next = (id + 1) % num_threads;
+                {
+                    std::lock_guard<std::mutex> lock(mutexes[next]);
+                    mailboxes[next].insert(mailboxes[next].end(), mine.begin() + Batch / 2,
+                            mine.end());
+                }
+                mine.resize(Batch / 2);
+                for (payload* p : mine)
+                    pool.deallocate_node(p);
+                mine.clear();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (std::size_t id = 0; id < num_threads; ++id)
+            threads.emplace_back(worker, id);
+        for (auto& t : threads)
+            t.join();
+        for (std::size_t n : corrupt)
+            REQUIRE(n == 0);
+        for (auto& mailbox : mailboxes) {
+            for (payload* p : mailbox)
+                pool.deallocate_node(p);
+        }
+    };
+
+    SECTION("with thread slots")
+    {
+        run(4);
+    }
+
+    SECTION("more threads than slots")
+    {
+        run(detail::MaxThreadSlots + 4);
+    }
+
+    // what the threads freed is handed out again, with no node twice
+    std::vector<void*> v;
+    for (std::size_t i = 0; i < 10'000; ++i)
+        v.push_back(pool.allocate_node());
+    std::sort(v.begin(), v.end());
+    REQUIRE(std::unique(v.begin(), v.end()) == v.end());
+}
@@ -0,0 +1,41 @@
+#include "allocator/memory_pool.hpp"
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <vector>
+
+
+TEST_CASE("aligned_memory_pool", "[memory_pool]")
+{
+    auto aligned = [](void* p, std::uintptr_t alignment) {
+        return reinterpret_cast<std::uintptr_t>(p) % alignment == 0;
+    };
+
+    SECTION("nodes are rounded up to the alignment")
+    {
+        aligned_memory_pool<64> pool(200, 4);
+        REQUIRE(pool.node_size() == 256);
+        REQUIRE(memory_pool(200, 4).node_size() == 200);
+    }
+
+    SECTION("every node is aligned, across blocks")
+    {
+        aligned_memory_pool<64> pool(256, 3);
+        std::vector<void*> nodes;
+        for (int i = 0; i < 50; ++i) {
+            nodes.push_back(pool.allocate_node());
+            REQUIRE(aligned(nodes.back(), 64));
+        }
+
+        for (void* p : nodes)
+            pool.deallocate_node(p);
+        REQUIRE(aligned(pool.allocate_node(), 64));
+    }
+
+    SECTION("room for count nodes in the first block")
+    {
+        aligned_memory_pool<128> pool(100, 8);
+        for (int i = 0; i < 8; ++i)
+            REQUIRE(aligned(pool.allocate_node(), 128));
+        REQUIRE(pool.capacity_left() == 0);
+    }
+}
@@ -0,0 +1,127 @@
+#include "allocator/concurrent_memory_pool.hpp"
+#include "allocator/memory_resource.hpp"
+#include <catch2/catch.hpp>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <list>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+
+TEST_CASE("pool_resource", "[memory_resource]")
+{
+    memory_pool pool(32, 100);
+    pool_resource<> resource(pool);
+    REQUIRE(&resource.pool() == &pool);
+    REQUIRE(resource.upstream_resource() == std::pmr::new_delete_resource());
+
+    SECTION("nodes from the pool")
+    {
+        void* p1 = resource.allocate(32, 8);
+        void* p2 = resource.allocate(1, 1);
+        REQUIRE(pool.max_used() == 2);
+        resource.deallocate(p1, 32, 8);
+        resource.deallocate(p2, 1, 1);
+        REQUIRE(resource.allocate(24, 8) == p2);
+    }
+
+    SECTION("the rest from upstream")
+    {
+        void* big = resource.allocate(33, 8);
+        void* aligned = resource.allocate(16, 64);
+        REQUIRE(pool.max_used() == 0);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(aligned) % 64 == 0);
+        resource.deallocate(big, 33, 8);
+        resource.deallocate(aligned, 16, 64);
+    }
+
+    SECTION("is_equal")
+    {
+        pool_resource<> same(pool);
+        memory_pool other_pool(32, 100);
+        pool_resource<> other(other_pool);
+        REQUIRE(resource == same);
+        REQUIRE(resource != other);
+        REQUIRE(resource != *std::pmr::new_delete_resource());
+    }
+
+    SECTION("pmr containers")
+    {
+        std::pmr::list<int> list(&resource);
+        for (int i = 0; i < 1000; ++i)
+            list.push_back(i);
+        REQUIRE(list.size() == 1000);
+        REQUIRE(pool.max_used() == 1000);
+
+        // same type as any other std::pmr::list
+        std::pmr::list<int> copy(list, std::pmr::new_delete_resource());
+        REQUIRE(copy == list);
+
+        std::pmr::unordered_map<int, int> map(&resource);
+        for (int i = 0; i < 100; ++i)
+            map.emplace(i, i);
+        REQUIRE(map.size() == 100);
+        REQUIRE(map.at(42) == 42);
+    }
+
+    SECTION("concurrent_memory_pool")
+    {
+        concurrent_memory_pool cpool(32, 100);
+        pool_resource<concurrent_memory_pool> cresource(cpool);
+        std::pmr::list<int> list(&cresource);
+        for (int i = 0; i < 1000; ++i)
+            list.push_back(i);
+        REQUIRE(list.back() == 999);
+    }
+}
+
+TEST_CASE("monotonic_arena_resource", "[memory_resource]")
+{
+    monotonic_arena_resource<> resource(4096);
+    REQUIRE(resource.num_blocks() == 0);
+
+    SECTION("bumps through blocks")
+    {
+        std::vector<std::uint8_t*> v;
+        for (std::size_t align : {1, 2, 4, 8, 16, 32, 64}) {
+            auto* p = static_cast<std::uint8_t*>(resource.allocate(24, align));
+            REQUIRE(reinterpret_cast<std::uintptr_t>(p) % align == 0);
+            v.push_back(p);
+        }
+        REQUIRE(resource.num_blocks() == 1);
+        for (std::size_t i = 1; i < v.size(); ++i)
+            REQUIRE(v[i] >= v[i - 1] + 24);
+
+        // deallocate is a no-op, so this doesn't come back
+        resource.deallocate(v.back(), 24, 64);
+        REQUIRE(resource.allocate(24, 64) != v.back());
+
+        for (int i = 0; i < 1000; ++i)
+            REQUIRE(resource.allocate(100, 8) != nullptr);
+        REQUIRE(resource.num_blocks() > 1);
+
+        resource.release();
+        REQUIRE(resource.num_blocks() == 0);
+        REQUIRE(resource.allocate(8, 8) != nullptr);
+        REQUIRE(resource.num_blocks() == 1);
+    }
+
+    SECTION("too big for a block")
+    {
+        void* big = resource.allocate(1 << 20, 8);
+        REQUIRE(big != nullptr);
+        REQUIRE(resource.num_blocks() == 0);
+        resource.deallocate(big, 1 << 20, 8);
+    }
+
+    SECTION("pmr containers")
+    {
+        std::pmr::vector<int> v(&resource);
+        for (int i = 0; i < 10'000; ++i)
+            v.push_back(i);
+        REQUIRE(v[9999] == 9999);
+        REQUIRE(resource == resource);
+        REQUIRE(resource != *std::pmr::new_delete_resource());
+    }
+}
@@ -0,0 +1,124 @@
+#include "allocator/numa.hpp"
+#include "itch/order_store.hpp"
+#include <catch2/catch.hpp>
+#include <sys/mman.h>
+#include <cstddef> // std::size_t
+#include <thread>
+
+
+// every machine has a node 0, NUMA support or not: with it policy
+// calls must succeed for node 0, and fall back without binding for
+// nodes that don't exist. without it nothing is ever bound
+
+namespace { // unnamed
+
+    /// what bound_node() should report for memory bound to node 0
+    int
+    bound_to_0()
+    {
+        return numa::available() ? 0 : numa::AnyNode;
+    }
+
+} // namespace
+
+TEST_CASE("nodes", "[numa]")
+{
+    REQUIRE(numa::num_nodes() >= 1);
+    REQUIRE(numa::node_allowed(0));
+    REQUIRE_FALSE(numa::node_allowed(numa::AnyNode));
+    REQUIRE_FALSE(numa::node_allowed(numa::num_nodes()));
+    REQUIRE_FALSE(numa::node_allowed(numa::MaxNodes));
+}
+
+TEST_CASE("bind_memory", "[numa]")
+{
+    constexpr std::size_t Size = 1 << 20;
+    void* ptr = ::mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    REQUIRE(ptr != MAP_FAILED);
+    REQUIRE(numa::bound_node(ptr) == numa::AnyNode);
+
+    REQUIRE_FALSE(numa::bind_memory(ptr, Size, numa::MaxNodes - 1));
+    REQUIRE(numa::bound_node(ptr) == numa::AnyNode);
+
+    REQUIRE(numa::bind_memory(ptr, Size, 0) == numa::available());
+    REQUIRE(numa::bound_node(ptr) == bound_to_0());
+    REQUIRE(numa::bound_node(static_cast<char*>(ptr) + Size - 1) == bound_to_0());
+
+    ::munmap(ptr, Size);
+}
+
+TEST_CASE("numa_allocator", "[numa]")
+{
+    SECTION("node")
+    {
+        numa_allocator<> alloc(0);
+        REQUIRE(alloc.node() == 0);
+
+        void* ptr = alloc.allocate(100'000, 8);
+        REQUIRE(ptr != nullptr);
+        REQUIRE(numa::bound_node(ptr) == bound_to_0());
+        alloc.deallocate(ptr, 100'000, 8);
+    }
+
+    SECTION("unknown node")
+    {
+        numa_allocator<> alloc(numa::MaxNodes - 1);
+        REQUIRE(alloc.node() == numa::AnyNode);
+
+        void* ptr = alloc.allocate(100'000, 8);
+        REQUIRE(ptr != nullptr);
+        REQUIRE(numa::bound_node(ptr) == numa::AnyNode);
+        alloc.deallocate(ptr, 100'000, 8);
+    }
+
+    SECTION("huge pages")
+    {
+        numa_allocator<mmap_hugepage_allocator> alloc(0);
+        void* ptr = alloc.allocate(100'000, 8);
+        REQUIRE(ptr != nullptr);
+        REQUIRE(numa::bound_node(ptr) == bound_to_0());
+        alloc.deallocate(ptr, 100'000, 8);
+    }
+
+    SECTION("memory_pool")
+    {
+        numa_memory_pool pool(64, 1000, numa_allocator<>(0));
+        void* node = pool.allocate_node();
+        REQUIRE(numa::bound_node(node) == bound_to_0());
+        pool.deallocate_node(node);
+
+        memory_pool plain(64, 1000);
+        REQUIRE(numa::bound_node(plain.allocate_node()) == numa::AnyNode);
+    }
+
+    SECTION("order_store")
+    {
+        itch::order_store<itch::order, 16, lowlevel_allocator<numa_allocator<>>> store(
+                1 << 20, numa_allocator<>(0));
+        itch::order& o = store.insert(70'000);
+        REQUIRE(o == itch::order());
+        REQUIRE(numa::bound_node(&o) == bound_to_0());
+    }
+}
+
+TEST_CASE("thread placement", "[numa]")
+{
+    // on a thread of its own, to leave the test runner's policy alone
+    int preferred = numa::AnyNode;
+    int restored = 0;
+    bool ran = false;
+    std::thread t([&] {
+        numa::prefer_node(0);
+        preferred = numa::preferred_node();
+        numa::prefer_node(numa::AnyNode);
+        restored = numa::preferred_node();
+        ran = numa::run_on_node(0);
+    });
+    t.join();
+
+    REQUIRE(preferred == bound_to_0());
+    REQUIRE(restored == numa::AnyNode);
+    REQUIRE(ran == numa::available());
+    REQUIRE_FALSE(numa::prefer_node(numa::MaxNodes - 1));
+    REQUIRE(numa::preferred_node() == numa::AnyNode);
+}
@@ -0,0 +1,90 @@
+#include "util/spsc_ring.hpp"
+#include <catch2/catch.hpp>
+#include <cstddef> // std::size_t
+#include <cstdint>
+#include <thread>
+
+
+TEST_CASE("single thread", "[spsc_ring]")
+{
+    spsc_ring<int, 4> ring;
+
+    SECTION("initial state")
+    {
+        REQUIRE(ring.capacity() == 4);
+        REQUIRE(ring.empty());
+        REQUIRE(ring.front() == nullptr);
+    }
+
+    SECTION("push pop")
+    {
+        *ring.try_alloc() = 1;
+        REQUIRE(ring.empty());
+        ring.push();
+        REQUIRE_FALSE(ring.empty());
+
+        *ring.try_alloc() = 2;
+        ring.push();
+
+        REQUIRE(*ring.front() == 1);
+        ring.pop();
+        REQUIRE(*ring.front() == 2);
+        ring.pop();
+        REQUIRE(ring.front() == nullptr);
+        REQUIRE(ring.empty());
+    }
+
+    SECTION("full")
+    {
+        for (int i = 0; i < 4; ++i) {
+            int* slot = ring.try_alloc();
+            REQUIRE(slot != nullptr);
+            *slot = i;
+            ring.push();
+        }
+        REQUIRE(ring.try_alloc() == nullptr);
+
+        REQUIRE(*ring.front() == 0);
+        ring.pop();
+        REQUIRE(ring.try_alloc() != nullptr);
+
+        // wrap around
+        *ring.try_alloc() = 4;
+        ring.push();
+        for (int i = 1; i < 5; ++i) {
+            REQUIRE(*ring.front() == i);
+            ring.pop();
+        }
+        REQUIRE(ring.empty());
+    }
+}
+
+TEST_CASE("two threads", "[spsc_ring]")
+{
+    constexpr std::uint64_t count = 1'000'000;
+    spsc_ring<std::uint64_t, 1024> ring;
+
+    std::thread producer([&ring] {
+        for (std::uint64_t i = 0; i < count; ++i) {
+            *ring.alloc() = i;
+            ring.push();
+        }
+    });
+
+    std::uint64_t expected = 0;
+    bool in_order = true;
+    std::size_t spins = 0;
+    while (expected < count) {
+        std::uint64_t const* v = ring.front();
+        if (v == nullptr) {
+            spsc_ring<std::uint64_t, 1024>::relax(spins);
+            continue;
+        }
+        in_order &= (*v == expected++);
+        ring.pop();
+    }
+    producer.join();
+
+    REQUIRE(in_order);
+    REQUIRE(ring.empty());
+}